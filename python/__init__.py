@@ -1365,6 +1365,13 @@ class System(object):
         """
         return self._ptr.selectAsArray(seltext, None, None)
 
+    def prepareSelection(self, seltext):
+        """Parse the given VMD atom selection once, returning a
+        PreparedSelection which can be evaluated repeatedly, for example
+        against the positions of each frame of a trajectory.
+        """
+        return PreparedSelection(self, seltext)
+
     def selectChain(self, name=None, segid=None):
         """Returns a single Chain with the matching name and/or segid,
         or raises an exception if no single such chain is present.
@@ -1528,6 +1535,58 @@ class System(object):
         return results
 
 
+class PreparedSelection(object):
+    """A VMD atom selection parsed once for repeated evaluation.
+
+    Parts of the selection which depend on neither positions, cell nor
+    velocities (atom names, residues, bonds, smarts, ...) are evaluated
+    the first time the selection is used, and their results are reused
+    after that.  Call reset() after modifying the System in any way
+    other than changing its positions, cell or velocities.
+    """
+
+    def __init__(self, system, seltext):
+        self._system = system
+        self._ptr = _msys.CompiledSelection(system._ptr, str(seltext))
+
+    def __repr__(self):
+        return "<PreparedSelection '%s'>" % self.text
+
+    @property
+    def system(self):
+        """ System the selection was prepared for """
+        return self._system
+
+    @property
+    def text(self):
+        """ selection text """
+        return self._ptr.text()
+
+    @property
+    def positional(self):
+        """ True if the selection depends on positions, cell or velocities """
+        return self._ptr.positional()
+
+    def ids(self, pos=None, box=None):
+        """Return the ids of the selected Atoms.  pos and box are as for
+        System.selectIds; if not supplied, those of the System are used.
+        """
+        return self._ptr.selectAsList(pos, box)
+
+    def array(self, pos=None, box=None):
+        """ As ids(), but returning a numpy array of type uint32. """
+        return self._ptr.selectAsArray(pos, box)
+
+    def atoms(self, pos=None, box=None):
+        """ Return a list of the selected Atoms. """
+        ptr = self._system._ptr
+        return [Atom(ptr, i) for i in self._ptr.selectAsList(pos, box)]
+
+    def reset(self):
+        """ Forget cached results, after the System has been modified. """
+        self._ptr.reset()
+
+
 class AnnotatedSystem(object):
     """System that has been annotated with additional chemical information
 
@@ -2800,7 +2859,18 @@ class SpatialHash(object):
         """
         self._hash.voxelize(float(radius))
 
-    def findWithin(self, radius, pos, ids=None, reuse_voxels=False):
+    def update(self, pos, box=None):
+        """Replace the hashed positions with new ones for the same ids,
+        e.g. from the next frame of a trajectory, reusing the existing
+        buffers and voxel grid.  Particles are re-binned only if some
+        particle changed voxel.  After update, queries with
+        reuse_voxels=True at the previous voxelization radius remain
+        accurate.  box replaces the periodic cell; None disables
+        periodic boundary conditions.
+        """
+        self._hash.update(pos, box)
+
+    def findWithin(self, radius, pos, ids=None, reuse_voxels=False, nthreads=1):
         """Find particles from pos which are within the given radius
         of some particle in the spatial hash (i.e. provided in the
         SpatialHash constructor).  By default, voxelization is performed
@@ -2809,11 +2879,14 @@ class SpatialHash(object):
         with reuse_voxels=True.  pos is expected to be an Nx3 array of
         floats.  The ids parameter defaults to arange(len(pos)); supply
         an array of ids to limit the search to a subset of rows in pos.
+        If nthreads is not 1, the query particles are split across that
+        many threads (0 means use all available cores); the result is
+        the same as for the serial search.
         """
         # FIXME: Make ids optional in the C++ interface
         if ids is None:
             ids = numpy.arange(len(pos), dtype="uint32")
-        return self._hash.findWithin(radius, pos, ids, reuse_voxels)
+        return self._hash.findWithin(radius, pos, ids, reuse_voxels, nthreads)
 
     def findNearest(self, k, pos, ids=None):
         """Find at most k particles from pos with the smallest minimum
@@ -2824,7 +2897,7 @@ class SpatialHash(object):
             ids = numpy.arange(len(pos), dtype="uint32")
         return self._hash.findNearest(k, pos, ids)
 
-    def findContacts(self, radius, pos, ids=None, reuse_voxels=False):
+    def findContacts(self, radius, pos, ids=None, reuse_voxels=False, nthreads=1):
         """Find pairs of particles within radius of each other.
 
         Args:
@@ -2833,6 +2906,7 @@ class SpatialHash(object):
             ids (array[uint]): particle indices
             reuse_voxels (bool): assume voxelize(R>=radius) has already been called
             ignore_excluded (bool): exclude atom pairs in the exclusion table.
+            nthreads (int): number of search threads; 0 means all available cores.
 
         Returns:
            i, j, dists (tuple): Mx1 arrays of ids and distances.
@@ -2846,8 +2920,10 @@ class SpatialHash(object):
         the positions passsed to findContacts should correspond to the
         same atom indices as the positions passed to the SpatialHash
         constructor.
+
+        Contacts are returned in the same order regardless of nthreads.
         """
-        return self._hash.findContacts(radius, pos, ids, reuse_voxels)
+        return self._hash.findContacts(radius, pos, ids, reuse_voxels, nthreads)
 
     def findPairlist(self, radius, excl, reuse_voxels=False):
         return self._hash.findPairlist(radius, excl, reuse_voxels)
@@ -11,6 +11,10 @@ namespace desres { namespace msys {
         SystemPtr mol;
         Id id;
 
+        /* read through a const System, so that blocks shared with a
+         * snapshot are not copied */
+        System const& cmol() const { return *mol; }
+
         bool operator==(T const& rhs) const { return mol==rhs.mol && id==rhs.id; }
         bool operator!=(T const& rhs) const { return mol!=rhs.mol || id!=rhs.id; }
     };
@@ -18,6 +22,7 @@ namespace desres { namespace msys {
     struct Atom : Handle<Atom> {
         Atom(SystemPtr m, Id i) : Handle{m,i} {}
         atom_t& data() { return mol->atom(id); }
+        atom_t const& cdata() const { return cmol().atom(id); }
         void remove() { mol->delAtom(id); }
     };
 
@@ -25,28 +30,30 @@ namespace desres { namespace msys {
     struct Residue : Handle<Residue> {
         Residue(SystemPtr m, Id i) : Handle{m,i} {}
         residue_t& data() { return mol->residue(id); }
-        const char* name() { return data().name.c_str(); }
+        residue_t const& cdata() const { return cmol().residue(id); }
+        const char* name() { return cdata().name.c_str(); }
         void setName(std::string const& s) { data().name=s; }
-        const char* insertion() { return data().insertion.c_str(); }
+        const char* insertion() { return cdata().insertion.c_str(); }
         void setInsertion(std::string const& s) { data().insertion=s; }
-        int resid() { return data().resid; }
+        int resid() { return cdata().resid; }
         void setResid(int i) { data().resid=i; }
         void remove() { mol->delResidue(id); }
         Id addAtom() { return mol->addAtom(id); }
         IdList atoms() { return mol->atomsForResidue(id); }
         Id natoms() { return mol->atomCountForResidue(id); }
-        Id chainId() { return data().chain; }
+        Id chainId() { return cdata().chain; }
         void setChainId(Id chn) { mol->setChain(id, chn); }
     };
 
     struct Chain : Handle<Chain> {
         Chain(SystemPtr m, Id i) : Handle{m,i} {}
         chain_t& data() { return mol->chain(id); }
-        const char* name() { return data().name.c_str(); }
+        chain_t const& cdata() const { return cmol().chain(id); }
+        const char* name() { return cdata().name.c_str(); }
         void setName(std::string const& s) { data().name=s; }
-        const char* segid() { return data().segid.c_str(); }
+        const char* segid() { return cdata().segid.c_str(); }
         void setSegid(std::string const& s) { data().segid=s; }
-        Id ctId() { return data().ct; }
+        Id ctId() { return cdata().ct; }
         void setCtId(Id ct) { mol->setCt(id, ct); }
         IdList residues() { return mol->residuesForChain(id); }
         Id nresidues() { return mol->residueCountForChain(id); }
@@ -57,7 +64,8 @@ namespace desres { namespace msys {
     struct Ct : Handle<Ct> {
         Ct(SystemPtr m, Id i) : Handle{m,i} {}
         component_t& data() { return mol->ct(id); }
-        String name() { return data().name(); }
+        component_t const& cdata() const { return cmol().ct(id); }
+        String name() { return cdata().name(); }
         void setName(std::string const& s) { data().setName(s); }
         void remove() { mol->delCt(id); }
         Id nchains() { return mol->chainCountForCt(id); }
@@ -67,8 +75,8 @@ namespace desres { namespace msys {
         IdList atoms() { return mol->atomsForCt(id); }
         IdList bonds() { return mol->bondsForCt(id); }
         IdList append(SystemPtr src) { return AppendSystem(mol, src, id); }
-        std::vector<String> keys() { return data().keys(); }
-        bool has(String const& key) { return data().has(key); }
+        std::vector<String> keys() { return cdata().keys(); }
+        bool has(String const& key) { return cdata().has(key); }
         void del(String const& key) { data().del(key); }
         ValueRef value(String const& key) { return data().value(key); }
         Id add(String const& key, ValueType type) { return data().add(key, type); }
@@ -105,42 +113,42 @@ namespace desres { namespace msys {
                 }
                 to_value_ref(val, b.mol->atomPropValue(b.id,col)); },
                 arg("key"), arg("val"), "set Atom property")
-        .def_property("x", [](Atom& a) { return a.mol->atom(a.id).x; },
-                [](Atom& a, double val) { a.mol->atom(a.id).x = val; },
+        .def_property("x", [](Atom& a) { return a.cmol().atomPos(a.id)[0]; },
+                [](Atom& a, double val) { a.mol->atomPos(a.id)[0] = val; },
                 "x component of position")
-        .def_property("y", [](Atom& a) { return a.mol->atom(a.id).y; },
-                [](Atom& a, double val) { a.mol->atom(a.id).y = val; },
+        .def_property("y", [](Atom& a) { return a.cmol().atomPos(a.id)[1]; },
+                [](Atom& a, double val) { a.mol->atomPos(a.id)[1] = val; },
                 "y component of position")
-        .def_property("z", [](Atom& a) { return a.mol->atom(a.id).z; },
-                [](Atom& a, double val) { a.mol->atom(a.id).z = val; },
+        .def_property("z", [](Atom& a) { return a.cmol().atomPos(a.id)[2]; },
+                [](Atom& a, double val) { a.mol->atomPos(a.id)[2] = val; },
                 "z component of position")
-        .def_property("vx", [](Atom& a) { return a.mol->atom(a.id).vx; },
-                [](Atom& a, double val) { a.mol->atom(a.id).vx = val; },
+        .def_property("vx", [](Atom& a) { return a.cmol().atomVel(a.id)[0]; },
+                [](Atom& a, double val) { a.mol->atomVel(a.id)[0] = val; },
                 "x component of velocity")
-        .def_property("vy", [](Atom& a) { return a.mol->atom(a.id).vy; },
-                [](Atom& a, double val) { a.mol->atom(a.id).vy = val; },
+        .def_property("vy", [](Atom& a) { return a.cmol().atomVel(a.id)[1]; },
+                [](Atom& a, double val) { a.mol->atomVel(a.id)[1] = val; },
                 "y component of velocity")
-        .def_property("vz", [](Atom& a) { return a.mol->atom(a.id).vz; },
-                [](Atom& a, double val) { a.mol->atom(a.id).vz = val; },
+        .def_property("vz", [](Atom& a) { return a.cmol().atomVel(a.id)[2]; },
+                [](Atom& a, double val) { a.mol->atomVel(a.id)[2] = val; },
                 "z component of velocity")
-        .def_property("mass", [](Atom& a) { return a.mol->atom(a.id).mass; },
+        .def_property("mass", [](Atom& a) { return a.cdata().mass; },
                 [](Atom& a, double val) { a.mol->atom(a.id).mass = val; },
                 "mass")
-        .def_property("charge", [](Atom& a) { return a.mol->atom(a.id).charge; },
+        .def_property("charge", [](Atom& a) { return a.cdata().charge; },
                 [](Atom& a, double val) { a.mol->atom(a.id).charge= val; },
                 "charge")
-        .def_property("atomic_number", [](Atom& a) { return a.mol->atom(a.id).atomic_number; },
+        .def_property("atomic_number", [](Atom& a) { return a.cdata().atomic_number; },
                 [](Atom& a, int val) { a.mol->atom(a.id).atomic_number = val; },
                 "atomic number")
-        .def_property("formal_charge", [](Atom& a) { return a.mol->atom(a.id).formal_charge; },
+        .def_property("formal_charge", [](Atom& a) { return a.cdata().formal_charge; },
                 [](Atom& a, int val) { a.mol->atom(a.id).formal_charge = val; },
                 "formal charge")
-        .def_property("name", [](Atom& a) { return str(a.mol->atom(a.id).name); },
+        .def_property("name", [](Atom& a) { return str(a.cdata().name); },
                 [](Atom& a, std::string const& val) { a.mol->atom(a.id).name = val; },
                 "name")
-        .def_property_readonly("fragid", [](Atom& a) { return a.mol->atom(a.id).fragid; },
+        .def_property_readonly("fragid", [](Atom& a) { return a.cdata().fragid; },
                 "fragment id")
-        .def_property_readonly("residue_id", [](Atom& a) { return a.mol->atom(a.id).residue; },
+        .def_property_readonly("residue_id", [](Atom& a) { return a.cdata().residue; },
                 "residue id")
         ;
 
@@ -153,10 +161,10 @@ namespace desres { namespace msys {
             .def_readonly("_ptr", &Bond::mol)
             .def_readonly("id", &Bond::id, "unique id")
             .def("remove", [](Bond& b) { b.mol->delBond(b.id); }, "remove this Bond from the System")
-            .def("otherId", [](Bond& b, Id i) { return b.mol->bond(b.id).other(i); })
-            .def_property_readonly("i", [](Bond& b) { return b.mol->bond(b.id).i; }, "unique id of first atom")
-            .def_property_readonly("j", [](Bond& b) { return b.mol->bond(b.id).j; }, "unique id of second atom")
-            .def_property("order", [](Bond& b) { return b.mol->bond(b.id).order; },
+            .def("otherId", [](Bond& b, Id i) { return b.cmol().bond(b.id).other(i); })
+            .def_property_readonly("i", [](Bond& b) { return b.cmol().bond(b.id).i; }, "unique id of first atom")
+            .def_property_readonly("j", [](Bond& b) { return b.cmol().bond(b.id).j; }, "unique id of second atom")
+            .def_property("order", [](Bond& b) { return b.cmol().bond(b.id).order; },
                                    [](Bond& b, int o) { b.mol->bond(b.id).order=o; },
                                    "bond order (integer)")
             .def("__contains__", [](Bond& b, std::string const& key) { return BadId != b.mol->bondPropIndex(key); },
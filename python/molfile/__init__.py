@@ -56,6 +56,13 @@ Read the raw fields from a frameset (dtr)::
         frame = dtr.frame(i, keyvals=keyvals)
         ## use data in keyvals
 
+Read raw fields through a memory mapping of the frame files, without
+copying them; numeric fields are read-only views into the mapping::
+
+    dtr = molfile.DtrReader('input.dtr', mapped=True)
+    for i in range(dtr.nframes):
+        pos = dtr.keyvals(i, mapped=True)['POSITION']
+
 
 Write raw fields to a frameset (dtr)::
 
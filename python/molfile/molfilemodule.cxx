@@ -216,6 +216,55 @@ namespace {
         }
     }
 
+    void mapping_capsule_destructor(PyObject* capsule) {
+        delete reinterpret_cast<std::shared_ptr<const void>*>(
+                PyCapsule_GetPointer(capsule, NULL));
+    }
+
+    /* As py_keyvals, but numeric fields become read-only arrays viewing
+     * the mapped frame, each holding a reference to the mapping.  Fields
+     * that need byte swapping are copied. */
+    void py_keyvals_mapped(dtr::KeyMap const& keymap,
+                           std::shared_ptr<const void> mapping,
+                           PyObject *dict) {
+        dtr::KeyMap copied;
+        for (auto it=keymap.begin(), e=keymap.end(); it!=e; ++it) {
+            dtr::Key const& val = it->second;
+            int typenum = -1;
+            switch (val.type) {
+                case dtr::Key::TYPE_INT32:   typenum = NPY_INT32; break;
+                case dtr::Key::TYPE_UINT32:  typenum = NPY_UINT32; break;
+                case dtr::Key::TYPE_INT64:   typenum = NPY_INT64; break;
+                case dtr::Key::TYPE_UINT64:  typenum = NPY_UINT64; break;
+                case dtr::Key::TYPE_FLOAT32: typenum = NPY_FLOAT32; break;
+                case dtr::Key::TYPE_FLOAT64: typenum = NPY_FLOAT64; break;
+                default:;
+            }
+            if (typenum<0 || val.swap || !val.data) {
+                copied.insert(*it);
+                continue;
+            }
+            npy_intp dims = val.count;
+            PyObject* arr = PyArray_SimpleNewFromData(1, &dims, typenum,
+                    const_cast<void*>(val.data));
+            if (!arr) throw error_already_set();
+            PyArray_CLEARFLAGS((PyArrayObject*)arr, NPY_ARRAY_WRITEABLE);
+            PyObject* base = PyCapsule_New(
+                    new std::shared_ptr<const void>(mapping), NULL,
+                    mapping_capsule_destructor);
+            if (!base || PyArray_SetBaseObject((PyArrayObject*)arr, base)) {
+                Py_XDECREF(base);
+                Py_DECREF(arr);
+                throw error_already_set();
+            }
+            char* key = const_cast<char*>(it->first.c_str());
+            int rc = PyMapping_SetItemString(dict, key, arr);
+            Py_DECREF(arr);
+            if (rc==-1) throw error_already_set();
+        }
+        py_keyvals(copied, dict);
+    }
+
     dict py_frame_from_bytes(buffer buf) {
         auto req = buf.request();
         bool swap_endian = false;   // FIXME ignored
@@ -228,15 +277,31 @@ namespace {
     }
 
     const char* keyvals_doc =
-        "keyvals(index) -> dict()\n"
-        "Read raw fields from frame.\n";
+        "keyvals(index, mapped=False) -> dict()\n"
+        "Read raw fields from frame.\n"
+        "If mapped is True, the frame file is memory-mapped rather than\n"
+        "read, and numeric fields are read-only arrays viewing the mapping.\n";
 
-    dict wrap_keyvals(FrameSetReader& self, Py_ssize_t index) {
+    dict wrap_keyvals(FrameSetReader& self, Py_ssize_t index, bool mapped) {
        const DtrReader *comp = self.component(index);
         if (!comp) {
             PyErr_SetString(PyExc_IndexError, "index out of bounds");
             throw error_already_set();
         }
+        if (mapped) {
+            std::shared_ptr<const void> mapping;
+            dtr::KeyMap keymap;
+            {
+                gil_scoped_release release;
+                keymap = comp->mapped_frame(index, NULL, &mapping);
+            }
+            if (mapping) {
+                dict d;
+                py_keyvals_mapped(keymap, mapping, d.ptr());
+                return d;
+            }
+            /* not mapped; fall back to a copy */
+        }
         void* keybuf = NULL;
         dtr::KeyMap keymap = comp->frame(index, NULL, &keybuf);
         std::shared_ptr<void> dtor(keybuf, free);
@@ -319,6 +384,66 @@ namespace {
         }
         return arr;
     }
+    const char* read_frames_doc =
+        "read_frames(indices, pos=None, vel=None, box=None, nthreads=0) -> pos\n"
+        "Read positions of the given frames into an (n, natoms, 3) float32\n"
+        "array, which is allocated if pos is None.  If supplied, vel and\n"
+        "box must be C-contiguous arrays of shape (n, natoms, 3) float32\n"
+        "and (n, 3, 3) float64, and are filled with velocities and unit\n"
+        "cells.  Frames are read by nthreads threads (0 for the default).\n";
+
+    template <typename T>
+    T* read_frames_output(object& obj, std::vector<Py_ssize_t> const& shape,
+                          const char* name) {
+        if (obj.is_none()) return nullptr;
+        if (!isinstance<array_t<T>>(obj)) {
+            PyErr_Format(PyExc_TypeError, "%s has the wrong dtype", name);
+            throw error_already_set();
+        }
+        auto arr = reinterpret_borrow<array_t<T>>(obj);
+        bool ok = (arr.flags() & array::c_style)
+               && arr.writeable()
+               && size_t(arr.ndim())==shape.size();
+        for (size_t i=0; ok && i<shape.size(); i++) {
+            ok = arr.shape(i)==shape[i];
+        }
+        if (!ok) {
+            PyErr_Format(PyExc_ValueError,
+                    "%s must be a writeable C-contiguous array of shape "
+                    "(%zd, %zd, %zd)", name, shape[0], shape[1], shape[2]);
+            throw error_already_set();
+        }
+        return arr.mutable_data();
+    }
+
+    object read_frames(const FrameSetReader& self,
+                       array_t<ssize_t, array::c_style | array::forcecast> indices,
+                       object pos, object vel, object box,
+                       unsigned nthreads) {
+        Py_ssize_t n = indices.size();
+        Py_ssize_t natoms = self.natoms();
+        const ssize_t* ind = indices.data();
+        for (Py_ssize_t i=0; i<n; i++) {
+            if (ind[i]<0 || ind[i]>=self.size()) {
+                PyErr_Format(PyExc_IndexError, "frame index %zd out of bounds",
+                        ind[i]);
+                throw error_already_set();
+            }
+        }
+        if (pos.is_none()) {
+            Py_ssize_t dims[3] = { n, natoms, 3 };
+            pos = array_t<float>(dims);
+        }
+        float* p = read_frames_output<float>(pos, {n, natoms, 3}, "pos");
+        float* v = read_frames_output<float>(vel, {n, natoms, 3}, "vel");
+        double* b = read_frames_output<double>(box, {n, 3, 3}, "box");
+        {
+            gil_scoped_release release;
+            self.read_frames(n, ind, p, v, b, nthreads);
+        }
+        return pos;
+    }
+
     ssize_t frameset_size(const FrameSetReader& self, Py_ssize_t n) {
         return self.frameset(n)->size();
     }
@@ -415,15 +540,19 @@ PYBIND11_MODULE(_molfile, m) {
 
     writer
         .def(init([](std::string const& path, uint32_t natoms, int mode, uint32_t fpf,
-                     DtrWriter::Type type, double precision, object metadata) {
+                     DtrWriter::Type type, double precision, object metadata,
+                     unsigned compression_threads) {
                 std::unique_ptr<dtr::KeyMap> keymap;
                 if (!metadata.is_none()) {
                     keymap.reset(new dtr::KeyMap);
                     convert_keyvals_to_keymap(dict(metadata), *keymap);
                 }
-                return new DtrWriter(path, type, natoms, DtrWriter::Mode(mode), fpf, keymap.get(), precision);
+                std::unique_ptr<DtrWriter> w(new DtrWriter(path, type, natoms, DtrWriter::Mode(mode), fpf, keymap.get(), precision));
+                w->set_compression_threads(compression_threads);
+                return w.release();
             }), arg("path"), arg("natoms"), arg("mode")=0, arg("frames_per_file")=0,
-                arg("format")=DtrWriter::Type::DTR, arg("precision")=0.0, arg("metadata")=none())
+                arg("format")=DtrWriter::Type::DTR, arg("precision")=0.0, arg("metadata")=none(),
+                arg("compression_threads")=0)
         .def("append", [](DtrWriter& w, double time, dict keyvals) {
             dtr::KeyMap keymap;
             convert_keyvals_to_keymap(keyvals, keymap);
@@ -444,16 +573,18 @@ PYBIND11_MODULE(_molfile, m) {
         ;
 
     class_<FrameSetReader>(m, "DtrReader")
-        .def(init([](std::string const& path, bool sequential) {
+        .def(init([](std::string const& path, bool sequential, bool mapped) {
             std::unique_ptr<FrameSetReader> r;
+            unsigned access = sequential ? DtrReader::SequentialAccess : 0;
+            if (mapped) access |= DtrReader::MappedAccess;
             if (StkReader::recognizes(path)) {
-                r.reset(new StkReader(path, sequential ? DtrReader::SequentialAccess : 0));
+                r.reset(new StkReader(path, access));
             } else {
-                r.reset(new DtrReader(path, sequential ? DtrReader::SequentialAccess : 0));
+                r.reset(new DtrReader(path, access));
             }
             r->init();
             return r;
-        }), arg("path"), arg("sequential")=false)
+        }), arg("path"), arg("sequential")=false, arg("mapped")=false)
         .def_property_readonly("path", &FrameSetReader::path)
         .def_property_readonly("natoms", &FrameSetReader::natoms)
         .def_property_readonly("nframes", &FrameSetReader::size)
@@ -475,9 +606,16 @@ PYBIND11_MODULE(_molfile, m) {
                 arg("index") 
                ,arg("bytes")=none()
                ,arg("keyvals")=none())
-        .def("keyvals", wrap_keyvals, keyvals_doc)
+        .def("keyvals", wrap_keyvals, keyvals_doc,
+                arg("index"), arg("mapped")=false)
         .def("reload", reload, reload_doc)
         .def("times", get_times)
+        .def("read_frames", read_frames, read_frames_doc,
+                arg("indices")
+               ,arg("pos")=none()
+               ,arg("vel")=none()
+               ,arg("box")=none()
+               ,arg("nthreads")=0)
         ;
 
     m.def("dtr_frame_from_bytes", py_frame_from_bytes);
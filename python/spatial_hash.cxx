@@ -10,12 +10,10 @@ using pos_t = array_t<float, array::forcecast | array::c_style>;
 using box_t = array_t<double, array::forcecast | array::c_style>;
 using ids_t = array_t<uint32_t, array::forcecast | array::c_style>;
 
-template <typename Func, typename Param>
-static object hash_find(SpatialHash& hash,
-                           Param r,
-                           pos_t posarr,
-                           ids_t idsarr,
-                           Func func) {
+template <typename Func>
+static object hash_find(pos_t posarr,
+                        ids_t idsarr,
+                        Func func) {
 
     if (posarr.ndim() != 2 || posarr.shape(1) != 3) {
         throw std::invalid_argument("expected Nx3 array for pos");
@@ -30,7 +28,7 @@ static object hash_find(SpatialHash& hash,
             throw error_already_set();
         }
     }
-    IdList result = (hash.*func)(r, pos, n, ids);
+    IdList result = func(pos, n, ids);
     ssize_t sz = result.size();
     auto arr = ids_t(sz);
     if (!result.empty()) {
@@ -43,10 +41,14 @@ static object hash_find_within(SpatialHash& hash,
                                   float r,
                                   pos_t pos,
                                   ids_t ids,
-                                  bool reuse_voxels) {
-
-    return reuse_voxels ? hash_find(hash, r, pos, ids, &SpatialHash::find_within)
-                        : hash_find(hash, r, pos, ids, &SpatialHash::findWithin);
+                                  bool reuse_voxels,
+                                  unsigned nthreads) {
+
+    if (!reuse_voxels) hash.voxelize(r);
+    return hash_find(pos, ids, [&](const float* pos, int n, const Id* ids) {
+        gil_scoped_release release;
+        return hash.find_within_parallel(r, pos, n, ids, nthreads);
+    });
 }
 
 static object hash_find_nearest(SpatialHash& hash,
@@ -54,14 +56,17 @@ static object hash_find_nearest(SpatialHash& hash,
                                    pos_t pos,
                                    ids_t ids) {
 
-    return hash_find(hash, k, pos, ids, &SpatialHash::findNearest);
+    return hash_find(pos, ids, [&](const float* pos, int n, const Id* ids) {
+        return hash.findNearest(k, pos, n, ids);
+    });
 }
 
 static object hash_find_contacts(SpatialHash& hash,
                                     float r,
                                     pos_t posarr,
                                     object idsobj,
-                                    bool reuse_voxels) {
+                                    bool reuse_voxels,
+                                    unsigned nthreads) {
 
     if (posarr.ndim() != 2 || posarr.shape(1) != 3) {
         throw std::invalid_argument("expected Nx3 array for pos");
@@ -85,11 +90,12 @@ static object hash_find_contacts(SpatialHash& hash,
 
     SpatialHash::contact_array_t contacts;
 
-    if (reuse_voxels) {
-        // drop the GIL here?
-        hash.findContactsReuseVoxels(r, pos, npos, ids, &contacts);
-    } else {
-        hash.findContacts(r, pos, npos, ids, &contacts);
+    if (!reuse_voxels) {
+        hash.voxelize(r);
+    }
+    {
+        gil_scoped_release release;
+        hash.findContactsReuseVoxels(r, pos, npos, ids, &contacts, nthreads);
     }
 
     auto dim = contacts.count;
@@ -104,6 +110,26 @@ static object hash_find_contacts(SpatialHash& hash,
     return make_tuple(iarr, jarr, darr);
 }
 
+static void hash_update(SpatialHash& hash, pos_t posarr, object boxobj) {
+    if (posarr.ndim() != 2 || posarr.shape(1) != 3) {
+        throw std::invalid_argument("expected Nx3 array for pos");
+    }
+    auto boxarr = box_t::ensure(boxobj);
+    auto box = boxobj.is_none() ? nullptr : boxarr.data();
+    if (box && (boxarr.ndim() != 2 || boxarr.shape(0)!=3 || boxarr.shape(1) != 3)) {
+        throw std::invalid_argument("expected 3x3 array or none for box");
+    }
+    uint32_t npos = posarr.shape(0);
+    auto ids = hash.ids();
+    for (int i=0, n=hash.size(); i<n; i++) {
+        if (ids[i] >= npos) {
+            PyErr_Format(PyExc_ValueError, "index out of bounds: %d", ids[i]);
+            throw error_already_set();
+        }
+    }
+    hash.update(posarr.data(), box);
+}
+
 namespace {
     // exclusions of (Id a, Id b) pairs; include both (a, b) and (b, a) in
     // the high and low order bits.
@@ -166,11 +192,13 @@ namespace desres { namespace msys {
                 return new SpatialHash(posarr.data(), idsarr.shape(0), idsarr.data(), box);
                 }), arg("pos"), arg("ids"), arg("box")=none())
             .def("voxelize", &SpatialHash::voxelize, return_value_policy::reference)
+            .def("update", hash_update, arg("pos"), arg("box")=none())
             .def("findWithin", hash_find_within,
                      arg("r"), 
                      arg("pos"), 
                      arg("ids"), 
-                     arg("reuse_voxels")=false)
+                     arg("reuse_voxels")=false,
+                     arg("nthreads")=1)
             .def("findNearest", hash_find_nearest,
                      arg("k"), 
                      arg("pos"), 
@@ -179,7 +207,8 @@ namespace desres { namespace msys {
                      arg("r"),
                      arg("pos"),
                      arg("ids")=none(),
-                     arg("reuse_voxels")=false)
+                     arg("reuse_voxels")=false,
+                     arg("nthreads")=1)
             .def("findPairlist", hash_find_pairlist,
                      arg("r"),
                      arg("excl"),
@@ -141,10 +141,10 @@ namespace {
     void sys_translate(System& sys, double x, double y, double z) {
         for (Id i=0, n=sys.maxAtomId(); i<n; i++) {
             if (!sys.hasAtom(i)) continue;
-            atom_t& atm = sys.atom(i);
-            atm.x += x;
-            atm.y += y;
-            atm.z += z;
+            Float* pos = sys.atomPosFAST(i);
+            pos[0] += x;
+            pos[1] += y;
+            pos[2] += z;
         }
     }
 
@@ -239,10 +239,7 @@ namespace {
                     PyErr_Format(PyExc_ValueError, "Invalid id %u", id);
                     throw error_already_set();
                 }
-                atom_t const& atm = sys.atomFAST(id);
-                ptr[0] = atm.x;
-                ptr[1] = atm.y;
-                ptr[2] = atm.z;
+                std::copy_n(sys.atomPosFAST(id), 3, ptr);
                 ptr += 3;
             }
         }
@@ -268,10 +265,7 @@ namespace {
                     PyErr_Format(PyExc_ValueError, "Invalid id %u", id);
                     throw error_already_set();
                 }
-                atom_t const& atm = sys.atomFAST(id);
-                ptr[0] = atm.vx;
-                ptr[1] = atm.vy;
-                ptr[2] = atm.vz;
+                std::copy_n(sys.atomVelFAST(id), 3, ptr);
                 ptr += 3;
             }
         }
@@ -313,10 +307,7 @@ namespace {
                             "Id %u at position %ld is invalid", id, i);
                     throw error_already_set();
                 }
-                atom_t& atm = sys.atomFAST(id);
-                atm.x = pos[0];
-                atm.y = pos[1];
-                atm.z = pos[2];
+                std::copy_n(pos, 3, sys.atomPosFAST(id));
                 pos += 3;
             }
         }
@@ -357,50 +348,68 @@ namespace {
                             "Id %u at velocity %ld is invalid", id, i);
                     throw error_already_set();
                 }
-                atom_t& atm = sys.atomFAST(id);
-                atm.vx = pos[0];
-                atm.vy = pos[1];
-                atm.vz = pos[2];
+                std::copy_n(pos, 3, sys.atomVelFAST(id));
                 pos += 3;
             }
         }
     }
 
-    IdList wrap_atomselect(SystemPtr mol, std::string const& sel,
-                           object posobj, object boxobj) {
+    /* positions and box arguments of the atom selection methods.  The
+     * arrays keep any converted copies alive. */
+    struct SelectionCoords {
         array_t<float> posarr;
         array_t<double> boxarr;
         const float* pos = NULL;
         const double* box = NULL;
-        if (!posobj.is_none()) {
-            posarr = array_t<float>::ensure(posobj);
-            if (!posarr) throw error_already_set();
-            if (posarr.ndim()!=2 || posarr.shape(0)!=mol->atomCount() || posarr.shape(1)!=3) {
-                PyErr_Format(PyExc_ValueError, "pos has wrong shape");
-                throw error_already_set();
+
+        SelectionCoords(System const& mol, object posobj, object boxobj) {
+            if (!posobj.is_none()) {
+                posarr = array_t<float>::ensure(posobj);
+                if (!posarr) throw error_already_set();
+                if (posarr.ndim()!=2 || posarr.shape(0)!=mol.atomCount() || posarr.shape(1)!=3) {
+                    PyErr_Format(PyExc_ValueError, "pos has wrong shape");
+                    throw error_already_set();
+                }
+                pos = posarr.data();
             }
-            pos = posarr.data();
-        }
-        if (!boxobj.is_none()) {
-            boxarr = array_t<double>::ensure(boxobj);
-            if (!boxarr) throw error_already_set();
-            if (boxarr.ndim()!=2 || boxarr.shape(0)!=3 || boxarr.shape(1)!=3) {
-                PyErr_Format(PyExc_ValueError, "box has wrong shape");
-                throw error_already_set();
+            if (!boxobj.is_none()) {
+                boxarr = array_t<double>::ensure(boxobj);
+                if (!boxarr) throw error_already_set();
+                if (boxarr.ndim()!=2 || boxarr.shape(0)!=3 || boxarr.shape(1)!=3) {
+                    PyErr_Format(PyExc_ValueError, "box has wrong shape");
+                    throw error_already_set();
+                }
+                box = boxarr.data();
             }
-            box = boxarr.data();
         }
-        return Atomselect(mol, sel, pos, box);
-    }
+    };
 
-    object array_Atomselect(SystemPtr mol, std::string const& sel,
-                               object pos, object box) {
-        auto ids = wrap_atomselect(mol,sel, pos, box);
+    object ids_as_array(IdList const& ids) {
         auto arr = array_t<unsigned>(ids.size());
         memcpy(arr.mutable_data(), ids.data(), ids.size()*sizeof(ids[0]));
         return arr;
     }
 
+    IdList wrap_atomselect(SystemPtr mol, std::string const& sel,
+                           object posobj, object boxobj) {
+        SelectionCoords c(*mol, posobj, boxobj);
+        return Atomselect(mol, sel, c.pos, c.box);
+    }
+
+    object array_Atomselect(SystemPtr mol, std::string const& sel,
+                               object pos, object box) {
+        return ids_as_array(wrap_atomselect(mol,sel, pos, box));
+    }
+
+    IdList compiled_select(CompiledSelection& sel, object posobj, object boxobj) {
+        SelectionCoords c(*sel.system(), posobj, boxobj);
+        return sel.select(c.pos, c.box);
+    }
+
+    object compiled_select_array(CompiledSelection& sel, object pos, object box) {
+        return ids_as_array(compiled_select(sel, pos, box));
+    }
+
     const double* get_vec3d(object obj) {
         if (obj.is_none()) return nullptr;
         auto arr = array_t<double>::ensure(obj);
@@ -674,6 +683,16 @@ namespace desres { namespace msys {
             ;
     m.def("HashSystem", HashSystem);
 
+    class_<CompiledSelection, CompiledSelectionPtr>(m, "CompiledSelection")
+        .def(init<SystemPtr, std::string const&>())
+        .def("system", &CompiledSelection::system)
+        .def("text", &CompiledSelection::text)
+        .def("positional", &CompiledSelection::positional)
+        .def("selectAsList", compiled_select, arg("pos")=none(), arg("box")=none())
+        .def("selectAsArray", compiled_select_array, arg("pos")=none(), arg("box")=none())
+        .def("reset", &CompiledSelection::reset)
+        ;
+
     class_<SystemImporter>(m, "SystemImporter")
         .def(init<SystemPtr>())
         .def("initialize", &SystemImporter::initialize)
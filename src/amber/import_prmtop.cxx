@@ -134,6 +134,7 @@ static void parse_nonbonded(SystemPtr mol, SectionMap const& map, int ntypes,
     parse_flts(map, "LENNARD_JONES_BCOEF", bcoef);
     parse_strs(map, "AMBER_ATOM_TYPE", vdwtypes);
 
+    IdList atoms, params;
     for (Id i=0; i<mol->atomCount(); i++) {
         int atype = types.at(i);
         int ico = inds.at((ntypes * (atype-1)+atype)-1);
@@ -148,9 +149,12 @@ static void parse_nonbonded(SystemPtr mol, SectionMap const& map, int ntypes,
         nb->params()->value(param, "sigma") = sig;
         nb->params()->value(param, "epsilon") = eps;
         nb->params()->value(param, "type") = vdwtypes[i];
-        IdList ids(1, i);
-        nb->addTerm(ids, param);
+        atoms.push_back(i);
+        params.push_back(param);
     }
+    nb->addTerms(params.size(), atoms.data(), params.data());
+    atoms.clear();
+    params.clear();
 
     for (PairList::const_iterator it=pairs.begin(); it!=pairs.end(); ++it) {
         Id ai = it->ai;
@@ -171,11 +175,11 @@ static void parse_nonbonded(SystemPtr mol, SectionMap const& map, int ntypes,
         pt->params()->value(param, "qij") = qij;
         //pt->params()->value(param, "scee_scale_factor") = it->es;
         //pt->params()->value(param, "scnb_scale_factor") = it->lj;
-        IdList ids(2);
-        ids[0] = ai;
-        ids[1] = aj;
-        pt->addTerm(ids, param);
+        atoms.push_back(ai);
+        atoms.push_back(aj);
+        params.push_back(param);
     }
+    pt->addTerms(params.size(), atoms.data(), params.data());
 }
 
 static void parse_stretch(SystemPtr mol, SectionMap const& map,
@@ -199,7 +203,7 @@ static void parse_stretch(SystemPtr mol, SectionMap const& map,
             tb->params()->value(param, "r0") = r0[i];
         }
     }
-    IdList ids(2);
+    IdList ids(2), atoms, params;
     for (int i=0; i<nbonh; i++) {
         ids[0] = bonh[3*i  ]/3;
         ids[1] = bonh[3*i+1]/3;
@@ -211,7 +215,8 @@ static void parse_stretch(SystemPtr mol, SectionMap const& map,
         }
         mol->addBond(ids[0], ids[1]);
         if (without_tables) continue;
-        tb->addTerm(ids, bonh[3*i+2]-1);
+        atoms.insert(atoms.end(), ids.begin(), ids.end());
+        params.push_back(bonh[3*i+2]-1);
     }
     for (int i=0; i<nbona; i++) {
         ids[0] = bona[3*i  ]/3;
@@ -224,7 +229,11 @@ static void parse_stretch(SystemPtr mol, SectionMap const& map,
         }
         mol->addBond(ids[0], ids[1]);
         if (without_tables) continue;
-        tb->addTerm(ids, bona[3*i+2]-1);
+        atoms.insert(atoms.end(), ids.begin(), ids.end());
+        params.push_back(bona[3*i+2]-1);
+    }
+    if (!without_tables) {
+        tb->addTerms(params.size(), atoms.data(), params.data());
     }
 }
 
@@ -245,19 +254,20 @@ static void parse_angle(SystemPtr mol, SectionMap const& map,
         tb->params()->value(param, "fc") = fc[i];
         tb->params()->value(param, "theta0") = r0[i] * 180 / M_PI;
     }
-    IdList ids(3);
+    IdList atoms, params;
     for (int i=0; i<nbonh; i++) {
-        ids[0] = bonh[4*i  ]/3;
-        ids[1] = bonh[4*i+1]/3;
-        ids[2] = bonh[4*i+2]/3;
-        tb->addTerm(ids, bonh[4*i+3]-1);
+        atoms.push_back(bonh[4*i  ]/3);
+        atoms.push_back(bonh[4*i+1]/3);
+        atoms.push_back(bonh[4*i+2]/3);
+        params.push_back(bonh[4*i+3]-1);
     }
     for (int i=0; i<nbona; i++) {
-        ids[0] = bona[4*i  ]/3;
-        ids[1] = bona[4*i+1]/3;
-        ids[2] = bona[4*i+2]/3;
-        tb->addTerm(ids, bona[4*i+3]-1);
+        atoms.push_back(bona[4*i  ]/3);
+        atoms.push_back(bona[4*i+1]/3);
+        atoms.push_back(bona[4*i+2]/3);
+        params.push_back(bona[4*i+3]-1);
     }
+    tb->addTerms(params.size(), atoms.data(), params.data());
 }
 
 
@@ -321,6 +331,7 @@ static void parse_cmap(SystemPtr mol, SectionMap const& map) {
 
     std::vector<int> terms(counts[0]*6);
     parse_ints(map, prefix+"CMAP_INDEX", terms);
+    IdList atoms, pids;
     for (int i=0; i<counts[0]; i++) {
         ids[0] =          terms[6*i  ] - 1;
         ids[1] = ids[4] = terms[6*i+1] - 1;
@@ -336,8 +347,10 @@ static void parse_cmap(SystemPtr mol, SectionMap const& map) {
             std::string tname = ss.str();
             params->value(param, "cmapid") = tname;
         }
-        tb->addTerm(ids, param);
+        atoms.insert(atoms.end(), ids.begin(), ids.end());
+        pids.push_back(param);
     }
+    tb->addTerms(pids.size(), atoms.data(), pids.data());
 }
 
 namespace {
@@ -380,7 +393,7 @@ static PairList parse_torsion(SystemPtr mol, SectionMap const& map,
     PairList pairs;
     typedef std::map<IdList, Id, CompareTorsion> TorsionHash;
     TorsionHash hash;
-    IdList ids(4);
+    IdList ids(4), atoms, pids;
     TermTablePtr tb = AddTable(mol, "dihedral_trig");
     ParamTablePtr params = tb->params();
 
@@ -430,7 +443,8 @@ static PairList parse_torsion(SystemPtr mol, SectionMap const& map,
             r = hash.insert(std::make_pair(ids, BadId ));
             if (r.second) {
                 param = params->addParam();
-                tb->addTerm(ids, param);
+                atoms.insert(atoms.end(), ids.begin(), ids.end());
+                pids.push_back(param);
                 r.first->second = param;
             } else {
                 param = r.first->second;
@@ -439,7 +453,8 @@ static PairList parse_torsion(SystemPtr mol, SectionMap const& map,
             /* give it its own term */
             param = params->addParam();
             params->value(param, "phi0") = phase_in_degrees;
-            tb->addTerm(ids, param);
+            atoms.insert(atoms.end(), ids.begin(), ids.end());
+            pids.push_back(param);
         }
 
         /* update values */
@@ -453,6 +468,7 @@ static PairList parse_torsion(SystemPtr mol, SectionMap const& map,
         double oldsum = params->value(param, 1);
         params->value(param, 1) = oldsum + fc_orig;
     }
+    tb->addTerms(pids.size(), atoms.data(), pids.data());
     return pairs;
 }
 
@@ -463,16 +479,16 @@ static void parse_exclusions(SystemPtr mol, SectionMap const& map, int n) {
     parse_ints(map, "NUMBER_EXCLUDED_ATOMS", nexcl);
     parse_ints(map, "EXCLUDED_ATOMS_LIST", excl);
     unsigned j=0;
-    IdList ids(2);
+    IdList atoms;
     for (Id ai=0; ai<mol->atomCount(); ai++) {
-        ids[0]=ai;
         for (int i=0; i<nexcl[ai]; i++, j++) {
             Id aj = excl[j];
             if (aj==0) continue;
-            ids[1]=aj-1;
-            tb->addTerm(ids, BadId);
+            atoms.push_back(ai);
+            atoms.push_back(aj-1);
         }
     }
+    tb->addTerms(atoms.size()/2, atoms.data(), NULL);
 }
 
 SystemPtr desres::msys::ImportPrmTop( std::string const& path,
@@ -7,6 +7,7 @@
 #include "system.hxx"
 #include "clone.hxx"
 #include "contacts.hxx"
+#include "spatial_hash.hxx"
 #include "pfx/pfx.hxx"
 #include "smiles.hxx"
 #include <numeric>
@@ -52,6 +53,82 @@ namespace {
         }
     };
 
+    /* Bond test for GuessBondConnectivity with periodic=true: the
+     * separation is wrapped using the projection inv (see pfx::wrap_vector)
+     * and compared to the scaled sum of Bondi radii. */
+    bool periodic_bond(System const& mol, Id i, Id j,
+                       const Float* box, const Float* inv) {
+        const auto ai = mol.atomFAST(i).atomic_number;
+        const auto aj = mol.atomFAST(j).atomic_number;
+        // don't bond H-H or Virt-Virt
+        if ((ai==1 && aj==1) || (ai==0 && aj==0)) return false;
+        const double cut = 0.6 * (RadiusForElement(ai)+RadiusForElement(aj));
+        Float vec[3];
+        const Float* pi = mol.atomPosFAST(i);
+        const Float* pj = mol.atomPosFAST(j);
+        Float d[3] = {pj[0]-pi[0], pj[1]-pi[1], pj[2]-pi[2]};
+        std::copy(d,d+3,vec);
+        pfx::wrap_vector(box, inv, d);
+        Float dx = d[0]+vec[0];
+        Float dy = d[1]+vec[1];
+        Float dz = d[2]+vec[2];
+        Float d2 = dx*dx + dy*dy + dz*dz;
+        return d2 < cut*cut;
+    }
+
+    /* Find the bonds satisfying periodic_bond using a voxel grid over
+     * positions wrapped into the unit cell.  Candidate pairs within the
+     * largest possible cutoff are found and filtered in parallel, then
+     * added in the same (i,j) order as an all-pairs search over atoms.
+     * The cutoff must not exceed the smallest cell height. */
+    void guess_periodic_bonds(SystemPtr mol, IdList const& atoms,
+                              const Float* box, const Float* inv,
+                              double maxcut, bool use_cell) {
+        std::vector<double> pos(3*mol->maxAtomId());
+        for (Id i : atoms) {
+            const double* a = mol->atomPosFAST(i);
+            double* p = &pos[3*i];
+            p[0] = a[0];
+            p[1] = a[1];
+            p[2] = a[2];
+            if (!use_cell) continue;
+            for (int j=0; j<3; j++) {
+                const Float* b = box+3*j;
+                const Float* v = inv+3*j;
+                double f = floor(v[0]*a[0] + v[1]*a[1] + v[2]*a[2]);
+                p[0] -= f*b[0];
+                p[1] -= f*b[1];
+                p[2] -= f*b[2];
+            }
+        }
+
+        /* pad the search radius so no pair is lost to roundoff in the
+         * wrapped coordinates; the exact test is applied below. */
+        const double rad = maxcut*1.01 + 1e-3;
+        SpatialHashT<double>::contact_array_t contacts;
+        SpatialHashT<double>(&pos[0], atoms.size(), atoms.data(),
+                             use_cell ? mol->global_cell[0] : nullptr)
+            .findContacts(rad, &pos[0], atoms.size(), atoms.data(), &contacts, 0);
+
+        std::vector<IdPair> pairs;
+        std::vector<std::vector<IdPair> > chunks(default_thread_count());
+        unsigned nchunks = parallel_chunks(contacts.count, chunks.size(),
+                [&](unsigned c, uint64_t b, uint64_t e) {
+                    for (; b<e; b++) {
+                        Id i = contacts.i[b], j = contacts.j[b];
+                        if (i>=j) continue;
+                        if (periodic_bond(*mol, i, j, box, inv)) {
+                            chunks[c].emplace_back(i,j);
+                        }
+                    }
+                }, 4096);
+        for (unsigned c=0; c<nchunks; c++) {
+            pairs.insert(pairs.end(), chunks[c].begin(), chunks[c].end());
+        }
+        sort_unique(pairs);
+        for (auto const& p : pairs) mol->addBond(p.first, p.second);
+    }
+
     std::vector<SystemPtr> _generate_kekule_structures(SystemPtr mol,
                            std::map<Id, Id> const& aid_to_canId,
                            std::unordered_map<Id, std::unordered_map<Id, std::vector<int> > > const& fc_canmol,
@@ -389,42 +466,46 @@ namespace desres { namespace msys {
         std::vector<Float> pos(3*mol->maxAtomId());
         if (pos.empty()) return;
         for (Id i : atoms) {
-            atom_t const& atom = mol->atom(i);
-            pos[3*i  ] = atom.x;
-            pos[3*i+1] = atom.y;
-            pos[3*i+2] = atom.z;
+            const Float* p = mol->atomPosFAST(i);
+            pos[3*i  ] = p[0];
+            pos[3*i+1] = p[1];
+            pos[3*i+2] = p[2];
         }
 
         if (periodic) {
-            /* brute force method that handles triclinics */
             const double* cell = mol->global_cell[0];
-            Float box[9], inv[9], vec[3];
+            Float box[9], inv[9];
             pfx::trans_3x3(box, cell);
-            if (!pfx::inverse_3x3(inv, box)) {
+            bool singular = !pfx::inverse_3x3(inv, box);
+            if (singular) {
                 memset(inv, 0, sizeof(inv));
             }
             std::copy(cell, cell+9, box);
 
-            for (Id i=0, n=atoms.size(); i<n; i++) {
-                const auto& iatm = mol->atomFAST(atoms[i]);
-                const auto ai = iatm.atomic_number;
-                const auto ri = RadiusForElement(ai);
-                for (Id j=i+1; j<n; j++) {
-                    const auto& jatm = mol->atomFAST(atoms[j]);
-                    const auto aj = jatm.atomic_number;
-                    // don't bond H-H or Virt-Virt
-                    if ((ai==1 && aj==1) || (ai==0 && aj==0)) continue;
-                    const auto rj = RadiusForElement(aj);
-                    const double cut = 0.6 * (ri+rj);
-                    Float d[3] = {jatm.x-iatm.x, jatm.y-iatm.y, jatm.z-iatm.z};
-                    std::copy(d,d+3,vec);
-                    pfx::wrap_vector(box, inv, d);
-                    Float dx = d[0]+vec[0];
-                    Float dy = d[1]+vec[1];
-                    Float dz = d[2]+vec[2];
-                    Float d2 = dx*dx + dy*dy + dz*dz;
-                    if (d2 < cut*cut) {
-                        mol->addBond(atoms[i], atoms[j]);
+            /* The voxel search tries only neighboring images in
+             * orthorhombic cells, so it needs the bond cutoff to fit
+             * within the cell. */
+            double maxrad = 0;
+            for (Id i : atoms) {
+                maxrad = std::max(maxrad,
+                        RadiusForElement(mol->atomFAST(i).atomic_number));
+            }
+            const double maxcut = 0.6 * 2 * maxrad;
+            double minheight = HUGE_VAL;
+            for (int i=0; i<3; i++) {
+                const Float* p = inv+3*i;
+                minheight = std::min(minheight,
+                        1/sqrt(p[0]*p[0] + p[1]*p[1] + p[2]*p[2]));
+            }
+            if (singular || maxcut < minheight) {
+                guess_periodic_bonds(mol, atoms, box, inv, maxcut, !singular);
+            } else {
+                /* brute force method for cells smaller than the cutoff */
+                for (Id i=0, n=atoms.size(); i<n; i++) {
+                    for (Id j=i+1; j<n; j++) {
+                        if (periodic_bond(*mol, atoms[i], atoms[j], box, inv)) {
+                            mol->addBond(atoms[i], atoms[j]);
+                        }
                     }
                 }
             }
@@ -805,7 +886,7 @@ void desres::msys::GuessHydrogenPositions(SystemPtr mol, IdList const& hatoms) {
     /* process each root atom */
     for (RootMap::iterator it=map.begin(); it!=map.end(); ++it) {
         const Id r = it->first;
-        const atom_t& root = mol->atom(r);
+        const Float* root = mol->atomPos(r);
         IdList& hlist = it->second;
         std::sort(hlist.begin(), hlist.end());
 
@@ -818,8 +899,8 @@ void desres::msys::GuessHydrogenPositions(SystemPtr mol, IdList const& hatoms) {
         }
 
         if (hlist.size()==2) {
-            atom_t& hyd1 = mol->atom(hlist[0]);
-            atom_t& hyd2 = mol->atom(hlist[1]);
+            Float* hyd1 = mol->atomPos(hlist[0]);
+            Float* hyd2 = mol->atomPos(hlist[1]);
             if (c.empty()) {
                 /* water */
 
@@ -831,17 +912,17 @@ void desres::msys::GuessHydrogenPositions(SystemPtr mol, IdList const& hatoms) {
                 double R = sqrt(1-z*z);
 
                 /* orient and place the first hydrogen */
-                hyd1.x = root.x + def_bond * R * cos(phi);
-                hyd1.y = root.y + def_bond * R * sin(phi);
-                hyd1.z = root.z + def_bond * z;
+                hyd1[0] = root[0] + def_bond * R * cos(phi);
+                hyd1[1] = root[1] + def_bond * R * sin(phi);
+                hyd1[2] = root[2] + def_bond * z;
 
                 /* arbitrary reference position for the second hydrogen */
-                Float A[3] = {hyd1.x, hyd1.y + def_bond, hyd1.z};
+                Float A[3] = {hyd1[0], hyd1[1] + def_bond, hyd1[2]};
                 /* position with random rotation about O-H1 */
-                apply_dihedral_geometry(hyd2.pos(),
+                apply_dihedral_geometry(hyd2,
                         A,
-                        mol->atom(hlist[0]).pos(),
-                        mol->atom(r).pos(),
+                        mol->atomPos(hlist[0]),
+                        mol->atomPos(r),
                         def_bond, def_angle, 2*M_PI*drand48());
 
             } else if (c.size()==1) {
@@ -853,27 +934,27 @@ void desres::msys::GuessHydrogenPositions(SystemPtr mol, IdList const& hatoms) {
                         if (A!=r) break;
                     }
                 }
-                apply_dihedral_geometry(hyd1.pos(),
-                        mol->atom(A).pos(),
-                        mol->atom(C).pos(),
-                        mol->atom(r).pos(),
+                apply_dihedral_geometry(hyd1,
+                        mol->atomPos(A),
+                        mol->atomPos(C),
+                        mol->atomPos(r),
                         def_bond, def_angle, -M_PI/2+def_dihedral);
 
-                apply_dihedral_geometry(hyd2.pos(),
-                        mol->atom(A).pos(),
-                        mol->atom(C).pos(),
-                        mol->atom(r).pos(),
+                apply_dihedral_geometry(hyd2,
+                        mol->atomPos(A),
+                        mol->atomPos(C),
+                        mol->atomPos(r),
                         def_bond, def_angle, -M_PI/2-def_dihedral);
             } else if (c.size()==2) {
-                apply_dihedral_geometry(hyd1.pos(),
-                        mol->atom(c[0]).pos(),
-                        mol->atom(c[1]).pos(),
-                        mol->atom(r).pos(),
+                apply_dihedral_geometry(hyd1,
+                        mol->atomPos(c[0]),
+                        mol->atomPos(c[1]),
+                        mol->atomPos(r),
                         def_bond, def_angle, def_dihedral);
-                apply_dihedral_geometry(hyd2.pos(),
-                        mol->atom(c[1]).pos(),
-                        mol->atom(c[0]).pos(),
-                        mol->atom(r).pos(),
+                apply_dihedral_geometry(hyd2,
+                        mol->atomPos(c[1]),
+                        mol->atomPos(c[0]),
+                        mol->atomPos(r),
                         def_bond, def_angle, def_dihedral);
             }
 
@@ -887,31 +968,31 @@ void desres::msys::GuessHydrogenPositions(SystemPtr mol, IdList const& hatoms) {
                         if (A!=r) break;
                     }
                 }
-                apply_dihedral_geometry(mol->atom(hlist[0]).pos(),
-                        mol->atom(A).pos(),
-                        mol->atom(C).pos(),
-                        mol->atom(r).pos(),
+                apply_dihedral_geometry(mol->atomPos(hlist[0]),
+                        mol->atomPos(A),
+                        mol->atomPos(C),
+                        mol->atomPos(r),
                         def_bond, def_angle, def_dihedral/2);
-                apply_dihedral_geometry(mol->atom(hlist[1]).pos(),
-                        mol->atom(hlist[0]).pos(),
-                        mol->atom(C).pos(),
-                        mol->atom(r).pos(),
+                apply_dihedral_geometry(mol->atomPos(hlist[1]),
+                        mol->atomPos(hlist[0]),
+                        mol->atomPos(C),
+                        mol->atomPos(r),
                         def_bond, def_angle, def_dihedral);
-                apply_dihedral_geometry(mol->atom(hlist[2]).pos(),
-                        mol->atom(C).pos(),
-                        mol->atom(hlist[0]).pos(),
-                        mol->atom(r).pos(),
+                apply_dihedral_geometry(mol->atomPos(hlist[2]),
+                        mol->atomPos(C),
+                        mol->atomPos(hlist[0]),
+                        mol->atomPos(r),
                         def_bond, def_angle, def_dihedral);
 
             }
 
         } else if (hlist.size()==1) {
-            atom_t& hyd1 = mol->atom(hlist[0]);
+            Float* hyd1 = mol->atomPos(hlist[0]);
 
             if (c.empty()) {
-                hyd1.x = root.x;
-                hyd1.y = root.y;
-                hyd1.z = root.z + def_bond;
+                hyd1[0] = root[0];
+                hyd1[1] = root[1];
+                hyd1[2] = root[2] + def_bond;
 
             } else if (c.size()==1) {
                 /* find another atom bonded to c to define the plane */
@@ -923,18 +1004,18 @@ void desres::msys::GuessHydrogenPositions(SystemPtr mol, IdList const& hatoms) {
                         if (A!=r) break;
                     }
                 }
-                apply_dihedral_geometry(hyd1.pos(),
-                        mol->atom(A).pos(),
-                        mol->atom(C).pos(),
-                        mol->atom(r).pos(),
+                apply_dihedral_geometry(hyd1,
+                        mol->atomPos(A),
+                        mol->atomPos(C),
+                        mol->atomPos(r),
                         def_bond, def_angle, 0);
 
             } else {
                 Float ux=0, uy=0, uz=0;
                 for (Id b : c) {
-                    ux += mol->atom(r).x - mol->atom(b).x;
-                    uy += mol->atom(r).y - mol->atom(b).y;
-                    uz += mol->atom(r).z - mol->atom(b).z;
+                    ux += mol->atomPos(r)[0] - mol->atomPos(b)[0];
+                    uy += mol->atomPos(r)[1] - mol->atomPos(b)[1];
+                    uz += mol->atomPos(r)[2] - mol->atomPos(b)[2];
                 }
                 Float len = sqrt(ux*ux + uy*uy + uz*uz);
                 if (len) {
@@ -942,9 +1023,9 @@ void desres::msys::GuessHydrogenPositions(SystemPtr mol, IdList const& hatoms) {
                     uy /= len;
                     uz /= len;
                 }
-                hyd1.x = root.x + def_bond*ux;
-                hyd1.y = root.y + def_bond*uy;
-                hyd1.z = root.z + def_bond*uz;
+                hyd1[0] = root[0] + def_bond*ux;
+                hyd1[1] = root[1] + def_bond*uy;
+                hyd1[2] = root[2] + def_bond*uz;
             }
         }
     }
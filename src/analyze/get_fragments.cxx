@@ -32,6 +32,7 @@ namespace desres { namespace msys {
                     indexmap_t::value_type(aid, i));
         }
 
+        BondGraphPtr graph = mol->bondGraph();
         std::stack<Id> S;
         Id fragid=0;
         for (Id i=0, n=atomIds.size(); i<n; i++) {
@@ -41,14 +42,12 @@ namespace desres { namespace msys {
             do {
                 Id aid=S.top();
                 S.pop();
-                const IdList& bonds = mol->bondsForAtom(aid);
-                for (IdList::const_iterator j=bonds.begin(), e=bonds.end(); j!=e; ++j) {
-                    Id other = mol->bond(*j).other(aid);
+                for (Id other : graph->neighbors(aid)) {
                     iter = atom_to_index.find(other);
                     if (iter != atom_to_index.end() && assignments[iter->second]==BadId){
                         assignments[iter->second]=fragid;
                         /* Only add this atom if its non-terminal */
-                        if(mol->bondCountForAtom(other)>1) S.push(other);
+                        if(graph->degree(other)>1) S.push(other);
                     }
                 }
             } while (S.size());
@@ -71,18 +71,27 @@ IdList desres::msys::AppendTerms( TermTablePtr dst, TermTablePtr src,
     }
 
     /* append all terms */
-    for (Id i=0; i<terms.size(); i++) {
+    const Id nterms = terms.size();
+    const Id natoms = src->atomCount();
+    if (dst->atomCount() != natoms) {
+        MSYS_FAIL("incorrect atom count for TermTable " << dst->name());
+    }
+    IdList atoms(nterms*natoms), params(nterms);
+    for (Id i=0; i<nterms; i++) {
         Id srcterm = terms[i];
         Id srcparam = src->param(srcterm);
-        Id dstparam = bad(srcparam) ? BadId : pmap[srcparam];
-        IdList atoms = src->atoms(srcterm);
-        for (Id j=0; j<atoms.size(); j++) atoms[j] = src2dst[atoms[j]];
-        Id dstterm = dst->addTerm(atoms, dstparam);
-
+        params[i] = bad(srcparam) ? BadId : pmap[srcparam];
+        const Id* srcatoms = src->atomsFAST(srcterm);
+        for (Id j=0; j<natoms; j++) atoms[i*natoms+j] = src2dst[srcatoms[j]];
+    }
+    Id first = dst->addTerms(nterms, atoms.data(), params.data());
+    ids.resize(nterms);
+    for (Id i=0; i<nterms; i++) {
+        Id dstterm = first+i;
         for (Id j=0; j<nprops; j++) {
-            dst->termPropValue(dstterm,map[j]) = src->termPropValue(srcterm, j);
+            dst->termPropValue(dstterm,map[j]) = src->termPropValue(terms[i], j);
         }
-        ids.push_back(dstterm);
+        ids[i] = dstterm;
     }
 
     /* copy overrides */
@@ -170,6 +179,8 @@ IdList desres::msys::AppendSystem( SystemPtr dstptr, SystemPtr srcptr, Id ctid)
         Id dstatm = atmmap[srcatm] = dst.addAtom(dstres);
         /* copy attributes from src atom to dst atom */
         dst.atom(dstatm) = src.atom(srcatm);
+        std::copy_n(src.atomPosFAST(srcatm), 3, dst.atomPosFAST(dstatm));
+        std::copy_n(src.atomVelFAST(srcatm), 3, dst.atomVelFAST(dstatm));
         dst.atom(dstatm).residue = dstres;
         /* Copy additional atom properties */
         for (Id p=0; p<nprops; p++) {
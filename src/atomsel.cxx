@@ -1,7 +1,67 @@
 #include "atomsel.hxx"
 #include "atomsel/token.hxx"
+#include <list>
+#include <mutex>
 
-namespace desres { namespace msys { 
+namespace desres { namespace msys {
+
+    namespace {
+        /* names of the atom properties, which decide how a selection
+         * is tokenized. */
+        std::vector<String> atom_props(System* mol) {
+            std::vector<String> props(mol->atomPropCount());
+            for (Id i=0; i<props.size(); i++) props[i]=mol->atomPropName(i);
+            return props;
+        }
+
+        /* Parsed queries for recently used (System, selection) pairs.  A
+         * query is taken out of the cache while it is being evaluated, so
+         * concurrent callers never share one, and the cache holds only
+         * weak references to its Systems. */
+        class QueryCache {
+            struct Entry {
+                std::weak_ptr<System> sys;
+                System* mol;
+                std::string text;
+                std::vector<String> props;
+                std::unique_ptr<atomsel::Query> q;
+            };
+            static const size_t max_entries = 32;
+            std::list<Entry> _entries;  /* most recently used first */
+            std::mutex _mtx;
+
+        public:
+            std::unique_ptr<atomsel::Query> take(SystemPtr sys,
+                                                 std::string const& text) {
+                std::lock_guard<std::mutex> lock(_mtx);
+                for (auto it=_entries.begin(); it!=_entries.end(); ++it) {
+                    if (it->mol!=sys.get() || it->text!=text) continue;
+                    std::unique_ptr<atomsel::Query> q;
+                    if (it->sys.lock()==sys && it->props==atom_props(sys.get())) {
+                        q = std::move(it->q);
+                    }
+                    _entries.erase(it);
+                    return q;
+                }
+                return nullptr;
+            }
+
+            void put(SystemPtr sys, std::string const& text,
+                     std::unique_ptr<atomsel::Query> q) {
+                std::lock_guard<std::mutex> lock(_mtx);
+                _entries.push_front(Entry());
+                Entry& e = _entries.front();
+                e.sys = sys;
+                e.mol = sys.get();
+                e.text = text;
+                e.props = atom_props(sys.get());
+                e.q = std::move(q);
+                if (_entries.size()>max_entries) _entries.pop_back();
+            }
+        };
+
+        QueryCache query_cache;
+    }
 
     IdList Atomselect(SystemPtr ptr, const std::string& txt) {
         return Atomselect(ptr, txt, nullptr, nullptr);
@@ -9,15 +69,70 @@ namespace desres { namespace msys {
 
     IdList Atomselect(SystemPtr ptr, const std::string& txt,
                       const float* pos, const double* cell) {
+        return Atomselect(ptr, txt, pos, cell, nullptr);
+    }
+
+    IdList Atomselect(SystemPtr ptr, const std::string& txt,
+                      const float* pos, const double* cell,
+                      SpatialHashCache* hashes) {
 
+        std::unique_ptr<atomsel::Query> q = query_cache.take(ptr, txt);
+        if (!q) {
+            q.reset(new atomsel::Query);
+            q->mol = ptr.get();
+            q->parse(txt);
+        }
+        q->pos = pos;
+        q->cell = cell;
+        q->hashes = hashes;
+        auto s = q->select();
+        q->pos = nullptr;
+        q->cell = nullptr;
+        q->hashes = nullptr;
+        query_cache.put(ptr, txt, std::move(q));
+        return s.ids();
+    }
+
+    struct CompiledSelection::Impl {
+        SystemPtr sys;
+        std::string text;
         atomsel::Query q;
-        q.mol = ptr.get();
+        bool positional;
+    };
+
+    CompiledSelection::CompiledSelection(SystemPtr sys, std::string const& sel)
+    : _impl(new Impl) {
+        _impl->sys = sys;
+        _impl->text = sel;
+        _impl->q.mol = sys.get();
+        _impl->q.parse(sel);
+        _impl->positional = _impl->q.pred && _impl->q.pred->positional();
+        _impl->q.cacheStatic();
+    }
+
+    CompiledSelection::~CompiledSelection() {}
+
+    SystemPtr CompiledSelection::system() const { return _impl->sys; }
+
+    std::string const& CompiledSelection::text() const { return _impl->text; }
+
+    bool CompiledSelection::positional() const { return _impl->positional; }
+
+    IdList CompiledSelection::select(const float* pos, const double* cell,
+                                     SpatialHashCache* hashes) {
+        atomsel::Query& q = _impl->q;
         q.pos = pos;
         q.cell = cell;
-        q.parse(txt);
-        auto s = atomsel::full_selection(q.mol);
-        q.pred->eval(s);
+        q.hashes = hashes;
+        auto s = q.select();
+        q.pos = nullptr;
+        q.cell = nullptr;
+        q.hashes = nullptr;
         return s.ids();
     }
 
+    void CompiledSelection::reset() {
+        _impl->q.resetCaches();
+    }
+
 }}
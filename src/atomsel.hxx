@@ -5,13 +5,55 @@
 
 namespace desres { namespace msys { 
 
-    /* evaluate a vmd atom selection, returning the selected atoms. */
+    class SpatialHashCache;
+
+    /* evaluate a vmd atom selection, returning the selected atoms.
+     * Recently used selections are kept parsed, keyed by their text. */
     IdList Atomselect(SystemPtr sys, const std::string& sel);
 
     /* evaluate with supplied positions and cell */
     IdList Atomselect(SystemPtr sys, const std::string& sel,
                       const float* pos, const double* cell);
 
+    /* evaluate with supplied positions and cell, keeping the spatial
+     * hashes built for within and pbwithin clauses in hashes so that
+     * evaluating the selection on later frames updates them in place. */
+    IdList Atomselect(SystemPtr sys, const std::string& sel,
+                      const float* pos, const double* cell,
+                      SpatialHashCache* hashes);
+
+    /* A selection parsed once for repeated evaluation against one
+     * System, typically with new positions on each frame of a trajectory.
+     * Clauses which depend on neither positions, cell nor velocities
+     * (names, residues, bonds, smarts, ...) are evaluated on the first
+     * call to select() and their results reused; call reset() after
+     * changing the System in any other way.  Not safe for concurrent
+     * use from multiple threads. */
+    class CompiledSelection {
+        struct Impl;
+        std::unique_ptr<Impl> _impl;
+
+    public:
+        CompiledSelection(SystemPtr sys, std::string const& sel);
+        ~CompiledSelection();
+
+        SystemPtr system() const;
+        std::string const& text() const;
+
+        /* true if the result depends on positions, cell or velocities */
+        bool positional() const;
+
+        /* evaluate with the given positions and cell, or those of the
+         * System if NULL, as Atomselect() does. */
+        IdList select(const float* pos=nullptr, const double* cell=nullptr,
+                      SpatialHashCache* hashes=nullptr);
+
+        /* forget cached results of clauses which are not positional */
+        void reset();
+    };
+
+    typedef std::shared_ptr<CompiledSelection> CompiledSelectionPtr;
+
 }}
 
 #endif
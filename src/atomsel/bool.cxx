@@ -14,57 +14,57 @@ static void eval_none(Selection& s, System* mol) {
 }
 
 static void eval_hydrogen(Selection& s, System* mol) {
-    for (Id i=0, n=s.size(); i<n; i++) {
-        s[i]=s[i] && mol->atomFAST(i).atomic_number==1;
-    }
+    s.filter([&](Id i) {
+        return mol->atomFAST(i).atomic_number==1;
+    });
 }
 static void eval_oxygen(Selection& s, System* mol) {
-    for (Id i=0, n=s.size(); i<n; i++) {
-        s[i]=s[i] && mol->atomFAST(i).atomic_number==8;
-    }
+    s.filter([&](Id i) {
+        return mol->atomFAST(i).atomic_number==8;
+    });
 }
 
 static void eval_noh(Selection& s, System* mol) {
-    for (Id i=0, n=s.size(); i<n; i++) {
-        s[i]=s[i] && mol->atomFAST(i).atomic_number!=1;
-    }
+    s.filter([&](Id i) {
+        return mol->atomFAST(i).atomic_number!=1;
+    });
 }
 
 static void eval_backbone(Selection& s, System* mol) {
-    for (Id i=0, n=s.size(); i<n; i++) {
-        s[i]=s[i] && (mol->atomFAST(i).type == AtomProBack ||
-                      mol->atomFAST(i).type == AtomNucBack);
-    }
+    s.filter([&](Id i) {
+        return mol->atomFAST(i).type == AtomProBack ||
+               mol->atomFAST(i).type == AtomNucBack;
+    });
 }
 
 static void eval_sidechain(Selection& s, System* mol) {
-    for (Id i=0, n=s.size(); i<n; i++) {
-        s[i]=s[i] && mol->atomFAST(i).type == AtomProSide;
-    }
+    s.filter([&](Id i) {
+        return mol->atomFAST(i).type == AtomProSide;
+    });
 }
 
 static void eval_protein(Selection& s, System* mol) {
-    for (Id i=0, n=s.size(); i<n; i++) {
-        s[i]=s[i] && mol->residueFAST(mol->atomFAST(i).residue).type==ResidueProtein;
-    }
+    s.filter([&](Id i) {
+        return mol->residueFAST(mol->atomFAST(i).residue).type==ResidueProtein;
+    });
 }
 
 static void eval_nucleic(Selection& s, System* mol) {
-    for (Id i=0, n=s.size(); i<n; i++) {
-        s[i]=s[i] && mol->residueFAST(mol->atomFAST(i).residue).type==ResidueNucleic;
-    }
+    s.filter([&](Id i) {
+        return mol->residueFAST(mol->atomFAST(i).residue).type==ResidueNucleic;
+    });
 }
 
 static void eval_water(Selection& s, System* mol) {
-    for (Id i=0, n=s.size(); i<n; i++) {
-        s[i]=s[i] && mol->residueFAST(mol->atomFAST(i).residue).type==ResidueWater;
-    }
+    s.filter([&](Id i) {
+        return mol->residueFAST(mol->atomFAST(i).residue).type==ResidueWater;
+    });
 }
 
 static void eval_lipid(Selection& s, System* mol) {
-    for (Id i=0, n=s.size(); i<n; i++) {
-        s[i]=s[i] && mol->residueFAST(mol->atomFAST(i).residue).type==ResidueLipid;
-    }
+    s.filter([&](Id i) {
+        return mol->residueFAST(mol->atomFAST(i).residue).type==ResidueLipid;
+    });
 }
 
 static const std::unordered_map<std::string,eval_t> map = {
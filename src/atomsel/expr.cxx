@@ -11,24 +11,22 @@ void CmpPredicate::eval(Selection& s) {
     rhs->eval(s,R);
     switch (cmp) {
     case Token::EQ:
-        for (Id i=0, n=s.size(); i<n; i++) if (s[i]) s[i]=L[i]==R[i];
+        s.filter([&](Id i) { return L[i]==R[i]; });
         break;
     case Token::NE:
-        for (Id i=0, n=s.size(); i<n; i++) if (s[i]) s[i]=L[i]!=R[i];
+        s.filter([&](Id i) { return L[i]!=R[i]; });
         break;
     case Token::LT:
-        for (Id i=0, n=s.size(); i<n; i++) {
-            if (s[i]) s[i]=L[i]<R[i];
-        }
+        s.filter([&](Id i) { return L[i]<R[i]; });
         break;
     case Token::GT:
-        for (Id i=0, n=s.size(); i<n; i++) if (s[i]) s[i]=L[i]>R[i];
+        s.filter([&](Id i) { return L[i]>R[i]; });
         break;
     case Token::LE:
-        for (Id i=0, n=s.size(); i<n; i++) if (s[i]) s[i]=L[i]<=R[i];
+        s.filter([&](Id i) { return L[i]<=R[i]; });
         break;
     case Token::GE:
-        for (Id i=0, n=s.size(); i<n; i++) if (s[i]) s[i]=L[i]>=R[i];
+        s.filter([&](Id i) { return L[i]>=R[i]; });
         break;
     default:;
         MSYS_FAIL("unrecognized binary operator");
@@ -42,9 +40,7 @@ void NegExpr::eval(Selection const& s, std::vector<double>& v) {
 
 void FuncExpr::eval(Selection const& s, std::vector<double>& v) {
     sub->eval(s,v);
-    for (Id i=0, n=s.size(); i<n; i++) {
-        if (s[i]) v[i] = func(v[i]);
-    }
+    s.for_each([&](Id i) { v[i] = func(v[i]); });
 }
 
 void BinExpr::eval(Selection const& s, std::vector<double>& v) {
@@ -52,15 +48,12 @@ void BinExpr::eval(Selection const& s, std::vector<double>& v) {
     lhs->eval(s,L);
     rhs->eval(s,R);
     switch (op) {
-    case ADD: for (Id i=0,n=s.size(); i<n; i++) if (s[i]) v[i]=L[i]+R[i]; break;
-    case SUB: for (Id i=0,n=s.size(); i<n; i++) if (s[i]) v[i]=L[i]-R[i]; break;
-    case MUL: for (Id i=0,n=s.size(); i<n; i++) if (s[i]) v[i]=L[i]*R[i]; break;
-    case DIV: for (Id i=0,n=s.size(); i<n; i++) if (s[i]) v[i]=L[i]/R[i]; break;
-    case MOD: for (Id i=0,n=s.size(); i<n; i++) {
-                  if (s[i]) v[i]=int(L[i]) % int(R[i]);
-              }
-              break;
-    case EXP: for (Id i=0,n=s.size(); i<n; i++) if (s[i]) v[i]=std::pow(L[i],R[i]); break;
+    case ADD: s.for_each([&](Id i) { v[i]=L[i]+R[i]; }); break;
+    case SUB: s.for_each([&](Id i) { v[i]=L[i]-R[i]; }); break;
+    case MUL: s.for_each([&](Id i) { v[i]=L[i]*R[i]; }); break;
+    case DIV: s.for_each([&](Id i) { v[i]=L[i]/R[i]; }); break;
+    case MOD: s.for_each([&](Id i) { v[i]=int(L[i]) % int(R[i]); }); break;
+    case EXP: s.for_each([&](Id i) { v[i]=std::pow(L[i],R[i]); }); break;
     }
 }
 
@@ -1,9 +1,9 @@
 #include "token.hxx"
 #include "../elements.hxx"
-#include "../smarts.hxx"
 #include <unordered_map>
 #include <unordered_set>
 #include <regex>
+#include <climits>
 
 using namespace desres::msys;
 using namespace desres::msys::atomsel;
@@ -13,164 +13,226 @@ Selection desres::msys::atomsel::full_selection(System* sys) {
     s.fill();
     if (sys->maxAtomId() != sys->atomCount()) {
         for (Id i=0, n=sys->maxAtomId(); i<n; i++) {
-            if (!sys->hasAtom(i)) s[i]=0;
+            if (!sys->hasAtom(i)) s.reset(i);
         }
     }
     return s;
 }
 
-static int get_index(Query* q, Id i) {
-    return i;
+/* Keyword values are computed for all atoms at once, into a Column of
+ * the Query, so that predicates scan flat arrays rather than calling
+ * through the System for each atom.  Values which belong to a residue
+ * or chain are computed once per residue or chain and then copied. */
+
+template <typename T, typename F>
+static void by_atom(System* mol, std::vector<T>& v, F f) {
+    v.assign(mol->maxAtomId(), T());
+    for (auto i=mol->atomBegin(), e=mol->atomEnd(); i!=e; ++i) {
+        v[*i] = f(*i);
+    }
 }
-static int get_frag(Query* q, Id i) {
-    auto mol = q->mol;
-    return mol->atomFAST(i).fragid;
+template <typename T, typename F>
+static void by_residue(System* mol, std::vector<T>& v, F f) {
+    std::vector<T> r(mol->maxResidueId());
+    for (auto i=mol->residueBegin(), e=mol->residueEnd(); i!=e; ++i) {
+        r[*i] = f(*i);
+    }
+    by_atom(mol, v, [&](Id i) { return r[mol->atomFAST(i).residue]; });
 }
-static int get_numbonds(Query* q, Id i) {
-    auto mol = q->mol;
-    return mol->bondCountForAtom(i);
+template <typename T, typename F>
+static void by_chain(System* mol, std::vector<T>& v, F f) {
+    std::vector<T> c(mol->maxChainId());
+    for (auto i=mol->chainBegin(), e=mol->chainEnd(); i!=e; ++i) {
+        c[*i] = f(*i);
+    }
+    by_residue(mol, v, [&](Id i) { return c[mol->residueFAST(i).chain]; });
 }
-static int get_degree(Query* q, Id i) {
-    auto mol = q->mol;
-    if (mol->atomFAST(i).atomic_number == 0) return 0;
-    int degree = 0;
-    for (auto bid : mol->bondsForAtom(i)) {
-        bond_t const& bnd = mol->bondFAST(bid);
-        if (mol->atomFAST(bnd.other(i)).atomic_number > 0) {
-            ++degree;
+
+/* assigns codes to the distinct strings of a column */
+namespace {
+    class Dict {
+        Column& c;
+        std::unordered_map<std::string, Id> ids;
+    public:
+        explicit Dict(Column& c) : c(c) {}
+        Id operator()(std::string const& s) {
+            auto r = ids.emplace(s, c.dict.size());
+            if (r.second) c.dict.push_back(s);
+            return r.first->second;
         }
-    }
-    return degree;
+    };
+
+    /* assigns codes to the distinct StringPool handles of a column */
+    class HandleDict {
+        Column& c;
+        std::unordered_map<Id, Id> ids;
+    public:
+        explicit HandleDict(Column& c) : c(c) { c.pooled = true; }
+        Id operator()(Id h) {
+            auto r = ids.emplace(h, c.handles.size());
+            if (r.second) c.handles.push_back(h);
+            return r.first->second;
+        }
+    };
 }
 
-static int get_ctnumber(Query* q, Id i) {
-    auto mol = q->mol;
-    return mol->chainFAST(mol->residueFAST(mol->atomFAST(i).residue).chain).ct+1;
+static void get_index(Query* q, Column& c) {
+    by_atom(q->mol, c.ival, [](Id i) { return int(i); });
 }
-static int get_ct(Query* q, Id i) {
+static void get_frag(Query* q, Column& c) {
     auto mol = q->mol;
-    return mol->chainFAST(mol->residueFAST(mol->atomFAST(i).residue).chain).ct;
+    by_atom(mol, c.ival, [&](Id i) { return int(mol->atomFAST(i).fragid); });
 }
-static int get_resid(Query* q, Id i) {
+static void get_numbonds(Query* q, Column& c) {
     auto mol = q->mol;
-    return mol->residueFAST(mol->atomFAST(i).residue).resid;
+    by_atom(mol, c.ival, [&](Id i) { return int(mol->bondCountForAtom(i)); });
 }
-static int get_residue(Query* q, Id i) {
+static void get_degree(Query* q, Column& c) {
     auto mol = q->mol;
-    return mol->atomFAST(i).residue;
+    by_atom(mol, c.ival, [&](Id i) {
+        if (mol->atomFAST(i).atomic_number == 0) return 0;
+        int degree = 0;
+        for (auto bid : mol->bondsForAtom(i)) {
+            bond_t const& bnd = mol->bondFAST(bid);
+            if (mol->atomFAST(bnd.other(i)).atomic_number > 0) {
+                ++degree;
+            }
+        }
+        return degree;
+    });
 }
-static int get_anum(Query* q, Id i) {
+
+static void get_ctnumber(Query* q, Column& c) {
     auto mol = q->mol;
-    return mol->atomFAST(i).atomic_number;
+    by_chain(mol, c.ival, [&](Id i) { return int(mol->chainFAST(i).ct+1); });
 }
-static double get_mass(Query* q, Id i) {
+static void get_ct(Query* q, Column& c) {
     auto mol = q->mol;
-    return mol->atomFAST(i).mass;
+    by_chain(mol, c.ival, [&](Id i) { return int(mol->chainFAST(i).ct); });
 }
-static double get_charge(Query* q, Id i) {
+static void get_resid(Query* q, Column& c) {
     auto mol = q->mol;
-    return mol->atomFAST(i).charge;
-}
-static double get_x(Query* q, Id i) {
-    return q->pos ? (double)q->pos[3*i] : q->mol->atomFAST(i).x;
+    by_residue(mol, c.ival, [&](Id i) { return mol->residueFAST(i).resid; });
 }
-static double get_y(Query* q, Id i) {
-    return q->pos ? (double)q->pos[3*i+1] : q->mol->atomFAST(i).y;
+static void get_residue(Query* q, Column& c) {
+    auto mol = q->mol;
+    by_atom(mol, c.ival, [&](Id i) { return int(mol->atomFAST(i).residue); });
 }
-static double get_z(Query* q, Id i) {
-    return q->pos ? (double)q->pos[3*i+2] : q->mol->atomFAST(i).z;
+static void get_anum(Query* q, Column& c) {
+    auto mol = q->mol;
+    by_atom(mol, c.ival, [&](Id i) { return int(mol->atomFAST(i).atomic_number); });
 }
-static double get_vx(Query* q, Id i) {
-    return q->mol->atomFAST(i).vx;
+static void get_mass(Query* q, Column& c) {
+    auto mol = q->mol;
+    by_atom(mol, c.fval, [&](Id i) { return double(mol->atomFAST(i).mass); });
 }
-static double get_vy(Query* q, Id i) {
-    return q->mol->atomFAST(i).vy;
+static void get_charge(Query* q, Column& c) {
+    auto mol = q->mol;
+    by_atom(mol, c.fval, [&](Id i) { return double(mol->atomFAST(i).charge); });
 }
-static double get_vz(Query* q, Id i) {
-    return q->mol->atomFAST(i).vz;
+template <int K>
+static void get_pos(Query* q, Column& c) {
+    auto mol = q->mol;
+    auto pos = q->pos;
+    if (pos) by_atom(mol, c.fval, [&](Id i) { return double(pos[3*i+K]); });
+    else by_atom(mol, c.fval, [&](Id i) { return double(mol->atomPosFAST(i)[K]); });
 }
-static const char* get_chain(Query* q, Id i) {
+template <int K>
+static void get_vel(Query* q, Column& c) {
     auto mol = q->mol;
-    return mol->chainFAST(mol->residueFAST(mol->atomFAST(i).residue).chain).name.data();
+    by_atom(mol, c.fval, [&](Id i) { return double(mol->atomVelFAST(i)[K]); });
 }
-static const char* get_segid(Query* q, Id i) {
+static void get_chain(Query* q, Column& c) {
     auto mol = q->mol;
-    return mol->chainFAST(mol->residueFAST(mol->atomFAST(i).residue).chain).segid.c_str();
+    Dict dict(c);
+    by_chain(mol, c.code, [&](Id i) { return dict(mol->chainFAST(i).name); });
 }
-static const char* get_name(Query* q, Id i) {
+static void get_segid(Query* q, Column& c) {
     auto mol = q->mol;
-    return mol->atomFAST(i).name.c_str();
+    Dict dict(c);
+    by_chain(mol, c.code, [&](Id i) { return dict(mol->chainFAST(i).segid); });
 }
-static const char* get_resname(Query* q, Id i) {
+static void get_name(Query* q, Column& c) {
     auto mol = q->mol;
-    return mol->residueFAST(mol->atomFAST(i).residue).name.c_str();
+    HandleDict dict(c);
+    by_atom(mol, c.code, [&](Id i) { return dict(mol->atomFAST(i).name.id()); });
 }
-static const char* get_insertion(Query* q, Id i) {
+static void get_resname(Query* q, Column& c) {
     auto mol = q->mol;
-    return mol->residueFAST(mol->atomFAST(i).residue).insertion.c_str();
+    HandleDict dict(c);
+    by_residue(mol, c.code, [&](Id i) { return dict(mol->residueFAST(i).name.id()); });
 }
-static const char* get_element(Query* q, Id i) {
+static void get_insertion(Query* q, Column& c) {
     auto mol = q->mol;
-    return AbbreviationForElement(mol->atomFAST(i).atomic_number);
+    Dict dict(c);
+    by_residue(mol, c.code, [&](Id i) {
+        return dict(mol->residueFAST(i).insertion.c_str());
+    });
 }
-static int get_iprop(Query* q, Id i) {
+static void get_element(Query* q, Column& c) {
+    auto mol = q->mol;
+    Dict dict(c);
+    std::vector<Id> codes(256, BadId);
+    by_atom(mol, c.code, [&](Id i) {
+        int anum = mol->atomFAST(i).atomic_number;
+        Id& code = codes[uint8_t(anum)];
+        if (bad(code)) code = dict(AbbreviationForElement(anum));
+        return code;
+    });
+}
+static void get_iprop(Query* q, Column& c) {
     auto mol = q->mol;
-    return mol->atomPropValue(i, q->id).asInt();
+    Id col = q->id;
+    by_atom(mol, c.ival, [&](Id i) { return int(mol->atomPropValue(i, col).asInt()); });
 }
-static double get_fprop(Query* q, Id i) {
+static void get_fprop(Query* q, Column& c) {
     auto mol = q->mol;
-    return mol->atomPropValue(i, q->id).asFloat();
+    Id col = q->id;
+    by_atom(mol, c.fval, [&](Id i) { return mol->atomPropValue(i, col).asFloat(); });
 }
-static const char*get_sprop(Query* q, Id i) {
+static void get_sprop(Query* q, Column& c) {
     auto mol = q->mol;
-    return mol->atomPropValue(i, q->id).c_str();
+    Id col = q->id;
+    Dict dict(c);
+    by_atom(mol, c.code, [&](Id i) { return dict(mol->atomPropValue(i, col).c_str()); });
 }
 
-typedef int (*iget)(Query*,Id);
-typedef double (*fget)(Query*,Id);
-typedef const char* (*sget)(Query*,Id);
+typedef void (*fill_t)(Query*, Column&);
 
 enum {
     StrFuncType = 4
 };
 struct Getter {
     const int type;
-    union {
-        iget i;
-        fget f;
-        sget s;
-    };
-    Getter(iget i) : type(IntType), i(i) {}
-    Getter(fget f) : type(FloatType), f(f) {}
-    Getter(sget s) : type(StringType), s(s) {}
+    const fill_t fill;
 };
 
 static const std::unordered_map<std::string, Getter> map = {
-    {"atomicnumber", get_anum},
-    {"mass", get_mass},
-    {"charge", get_charge},
-    {"chain", get_chain},
-    {"ctnumber", get_ctnumber},
-    {"ct", get_ct},
-    {"element", get_element},
-    {"fragment", get_frag},
-    {"fragid", get_frag},
-    {"index", get_index},
-    {"name", get_name},
-    {"numbonds", get_numbonds},
-    {"degree", get_degree},
-    {"resid", get_resid},
-    {"residue", get_residue},
-    {"resname", get_resname},
-    {"insertion", get_insertion},
-    {"segid", get_segid},
-    {"segname", get_segid},
-    {"x", get_x},
-    {"y", get_y},
-    {"z", get_z},
-    {"vx", get_vx},
-    {"vy", get_vy},
-    {"vz", get_vz},
+    {"atomicnumber", {IntType, get_anum}},
+    {"mass", {FloatType, get_mass}},
+    {"charge", {FloatType, get_charge}},
+    {"chain", {StringType, get_chain}},
+    {"ctnumber", {IntType, get_ctnumber}},
+    {"ct", {IntType, get_ct}},
+    {"element", {StringType, get_element}},
+    {"fragment", {IntType, get_frag}},
+    {"fragid", {IntType, get_frag}},
+    {"index", {IntType, get_index}},
+    {"name", {StringType, get_name}},
+    {"numbonds", {IntType, get_numbonds}},
+    {"degree", {IntType, get_degree}},
+    {"resid", {IntType, get_resid}},
+    {"residue", {IntType, get_residue}},
+    {"resname", {StringType, get_resname}},
+    {"insertion", {StringType, get_insertion}},
+    {"segid", {StringType, get_segid}},
+    {"segname", {StringType, get_segid}},
+    {"x", {FloatType, get_pos<0>}},
+    {"y", {FloatType, get_pos<1>}},
+    {"z", {FloatType, get_pos<2>}},
+    {"vx", {FloatType, get_vel<0>}},
+    {"vy", {FloatType, get_vel<1>}},
+    {"vz", {FloatType, get_vel<2>}},
 };
 
 template <typename T>
@@ -183,30 +245,7 @@ static bool find_in_ranges(std::vector<std::pair<T,T>> const& rng, T i) {
 
 static void eval_smarts(System* mol, std::vector<std::string> const& pats,
         Selection& s) {
-    AnnotatedSystem a(mol->shared_from_this());
-    /* get fragids of selected atoms */
-    std::unordered_set<Id> fragids;
-    for (Id i=0, n=s.size(); i<n; i++) {
-        if (s[i]) fragids.insert(mol->atomFAST(i).fragid);
-    }
-    /* use as starts atoms in same fragment as selected atoms */
-    IdList starts;
-    for (Id i=0, n=s.size(); i<n; i++) {
-        if (fragids.count(mol->atomFAST(i).fragid)) starts.push_back(i);
-    }
-
-    /* find atoms matched by smarts pattern */
-    Selection sel(s.size());
-    for (auto&& pat : pats) {
-        SmartsPattern p(pat);
-        for (auto&& ids : p.findMatches(a, starts)) {
-            //printf("hits: %u\n", (Id)ids.size());
-            for (auto id : ids) {
-                sel[id]=1;
-            }
-        }
-    }
-    s.intersect(sel);
+    s.intersect(smarts_matches(mol, pats, s));
 }
 
 static void eval_paramtype(System* mol, std::vector<std::string> const& pats,
@@ -229,11 +268,11 @@ static void eval_paramtype(System* mol, std::vector<std::string> const& pats,
         ids.insert(tmp.begin(), tmp.end());
     }
     const Id natoms = table->atomCount();
-    Selection sel(mol->atomCount());
+    Selection sel(s.size());
     for (auto i=table->begin(), e=table->end(); i!=e; ++i) {
         if (ids.count(i->param())) {
             for (Id j=0; j<natoms; j++) {
-                sel[i->atom(j)] = 1;
+                sel.set(i->atom(j));
             }
         }
     }
@@ -311,7 +350,7 @@ static void eval_sequence(System* mol, std::vector<std::string> const& pats, Sel
                 for (auto i=match->position(), j=match->position() + match->length(); i!=j; ++i) {
                     auto residue_id = mol->residuesForChain(chain_id).at(i);
                     for (auto atmid : mol->atomsForResidue(residue_id)) {
-                        sel[atmid] = 1;
+                        sel.set(atmid);
                     }
                 }
             }
@@ -335,6 +374,20 @@ bool desres::msys::atomsel::is_keyword(std::string const& name, System* mol) {
         ;
 }
 
+/* keywords whose values change from frame to frame */
+static bool is_positional_key(std::string const& name) {
+    static const std::unordered_set<std::string> keys = {
+        "x", "y", "z", "vx", "vy", "vz"
+    };
+    return keys.count(name);
+}
+
+bool KeyPredicate::positional() const { return is_positional_key(name); }
+bool KeyExpr::positional() const { return is_positional_key(name); }
+bool SamePredicate::positional() const {
+    return is_positional_key(name) || sub->positional();
+}
+
 static Getter lookup(std::string const& name, Query* q) {
     auto iter = map.find(name);
     if (iter!=map.end()) {
@@ -346,22 +399,73 @@ static Getter lookup(std::string const& name, Query* q) {
     }
     q->id = col;
     switch (q->mol->atomPropType(col)) {
-        case IntType:   return get_iprop;
-        case FloatType: return get_fprop;
+        case IntType:   return {IntType, get_iprop};
+        case FloatType: return {FloatType, get_fprop};
         default:;
-        case StringType: return get_sprop;
+        case StringType: return {StringType, get_sprop};
     };
 }
 
+Column const& Query::column(std::string const& name) {
+    auto& c = columns[name];
+    if (!c) {
+        auto g = lookup(name, this);
+        std::unique_ptr<Column> col(new Column);
+        col->type = g.type;
+        g.fill(this, *col);
+        c = std::move(col);
+    }
+    return *c;
+}
+
+/* Flags for the distinct codes of a string column. */
+static std::vector<char> code_flags(Column const& c) {
+    return std::vector<char>(c.ncodes());
+}
+
+/* Tells whether an int is one of ids or lies in one of rng, by table
+ * lookup when they span a small interval. */
+namespace {
+    class IntMatcher {
+        std::vector<int> const& ids;
+        std::vector<std::pair<int,int>> const& rng;
+        long lo=LONG_MAX, hi=LONG_MIN;
+        std::vector<char> table;
+
+    public:
+        IntMatcher(std::vector<int> const& ids,
+                   std::vector<std::pair<int,int>> const& rng)
+        : ids(ids), rng(rng) {
+            for (int i : ids) { lo=std::min<long>(lo,i); hi=std::max<long>(hi,i); }
+            for (auto const& r : rng) {
+                lo=std::min<long>(lo,r.first); hi=std::max<long>(hi,r.second);
+            }
+            if (lo<=hi && hi-lo < (1<<16)) {
+                table.resize(hi-lo+1);
+                for (int i : ids) table[i-lo] = 1;
+                for (auto const& r : rng) {
+                    for (long i=r.first; i<=r.second; i++) table[i-lo] = 1;
+                }
+            }
+        }
+
+        bool operator()(int v) const {
+            if (v<lo || v>hi) return false;
+            if (!table.empty()) return table[v-lo];
+            return std::binary_search(ids.begin(), ids.end(), v)
+                || find_in_ranges(rng, v);
+        }
+    };
+}
 
 void KeyExpr::eval(Selection const& s, std::vector<double>& v) {
-    auto g = lookup(name, q);
-    switch (g.type) {
+    auto const& c = q->column(name);
+    switch (c.type) {
         case IntType: 
-            for (Id i=0, n=s.size(); i<n; i++) if (s[i]) v[i] = g.i(q, i);
+            s.for_each([&](Id i) { v[i] = c.ival[i]; });
             break;
         case FloatType:
-            for (Id i=0, n=s.size(); i<n; i++) if (s[i]) v[i] = g.f(q, i);
+            s.for_each([&](Id i) { v[i] = c.fval[i]; });
             break;
         default:;
         case StringType:
@@ -378,23 +482,18 @@ void KeyPredicate::eval(Selection& s) {
         return;
     }
 
-    auto g = lookup(name, q);
+    auto const& c = q->column(name);
     std::vector<std::regex> regs;
-    switch (g.type) {
+    switch (c.type) {
     case IntType:
         {
             if (!(va->fval.empty() && va->sval.empty() && va->frng.empty() && va->regex.empty())) {
                 MSYS_FAIL("Selection keyword '" << name << "' expects integer values, but got float, string or regex values.");
             }
             sort_unique(va->ival);
-            for (Id i=0, n=s.size(); i<n; i++) {
-                if (s[i]) {
-                    int ival = g.i(q,i);
-                    if (std::binary_search(va->ival.begin(), va->ival.end(),ival)) continue;
-                    if (find_in_ranges(va->irng, ival)) continue;
-                    s[i] = 0;
-                }
-            }
+            auto const& v = c.ival;
+            IntMatcher match(va->ival, va->irng);
+            s.filter([&](Id i) { return match(v[i]); });
         }
         break;
     case FloatType:
@@ -403,15 +502,15 @@ void KeyPredicate::eval(Selection& s) {
             }
             sort_unique(va->ival); 
             sort_unique(va->fval); 
-            for (Id i=0, n=s.size(); i<n; i++) {
-                if (s[i]) {
-                    double val = g.f(q,i);
-                    if (std::binary_search(va->ival.begin(), va->ival.end(),(int)val)) continue;
-                    if (std::binary_search(va->fval.begin(), va->fval.end(),val)) continue;
-                    if (find_in_ranges(va->irng, (int)val)) continue;
-                    if (find_in_ranges(va->frng, val)) continue;
-                    s[i] = 0;
-                }
+            {
+                auto const& v = c.fval;
+                s.filter([&](Id i) {
+                    double val = v[i];
+                    return std::binary_search(va->ival.begin(), va->ival.end(),(int)val)
+                        || std::binary_search(va->fval.begin(), va->fval.end(),val)
+                        || find_in_ranges(va->irng, (int)val)
+                        || find_in_ranges(va->frng, val);
+                });
             }
             break;
     case StringType:
@@ -422,23 +521,24 @@ void KeyPredicate::eval(Selection& s) {
             for (auto const& r : va->regex) {
                 regs.emplace_back(r);
             }
-            for (Id i=0, n=s.size(); i<n; i++) {
-                if (s[i]) {
-                // TODO: compare the values as const char* rather than 
-                // constructing std::string intermediates
-                    std::string val(g.s(q,i));
-                    if (std::binary_search(va->sval.begin(), va->sval.end(), std::string(val))) continue;
+            {
+                auto matches = [&](std::string const& val) {
+                    if (std::binary_search(va->sval.begin(), va->sval.end(), val)) return true;
                     std::smatch match;
-                    bool found = false;
                     for (auto const& re : regs) {
-                        if (std::regex_match(val, match, re)) {
-                            found = true;
-                            break;
-                        }
+                        if (std::regex_match(val, match, re)) return true;
                     }
-                    if (found) continue;
-                    s[i]=0;
-                }
+                    return false;
+                };
+                /* match each distinct string once, then compare codes:
+                 * 0 unknown, 1 no match, 2 match */
+                std::vector<char> memo = code_flags(c);
+                auto const& v = c.code;
+                s.filter([&](Id i) {
+                    char& m = memo[v[i]];
+                    if (!m) m = matches(c.str(i)) ? 2 : 1;
+                    return m==2;
+                });
             }
             break;
     case StrFuncType:
@@ -458,39 +558,45 @@ void SamePredicate::eval(Selection& s) {
     Selection x = full_selection(q->mol);
     sub->eval(x);
 
-    auto g = lookup(name, q);
-    switch (g.type) {
+    auto const& c = q->column(name);
+    switch (c.type) {
         case IntType: 
         {
-            std::unordered_set<int> h;
-            for (Id i=0, n=x.size(); i<n; i++) {
-                if (x[i]) h.insert(g.i(q,i));
-            }
-            for (Id i=0, n=s.size(); i<n; i++) {
-                if (s[i]) s[i] = h.count(g.i(q,i));
+            auto const& v = c.ival;
+            long lo=LONG_MAX, hi=LONG_MIN;
+            x.for_each([&](Id i) {
+                lo=std::min<long>(lo,v[i]);
+                hi=std::max<long>(hi,v[i]);
+            });
+            if (lo>hi) {
+                s.clear();
+            } else if (hi-lo <= 4*long(v.size())+64) {
+                std::vector<char> h(hi-lo+1);
+                x.for_each([&](Id i) { h[v[i]-lo] = 1; });
+                s.filter([&](Id i) {
+                    return v[i]>=lo && v[i]<=hi && h[v[i]-lo];
+                });
+            } else {
+                std::unordered_set<int> h;
+                x.for_each([&](Id i) { h.insert(v[i]); });
+                s.filter([&](Id i) { return h.count(v[i]) > 0; });
             }
         }
         break;
         case FloatType:
         {
+            auto const& v = c.fval;
             std::unordered_set<double> h;
-            for (Id i=0, n=x.size(); i<n; i++) {
-                if (x[i]) h.insert(g.f(q,i));
-            }
-            for (Id i=0, n=s.size(); i<n; i++) {
-                if (s[i]) s[i] = h.count(g.f(q,i));
-            }
+            x.for_each([&](Id i) { h.insert(v[i]); });
+            s.filter([&](Id i) { return h.count(v[i]) > 0; });
         }
         break;
         case StringType:
         {
-            std::unordered_set<std::string> h;
-            for (Id i=0, n=x.size(); i<n; i++) {
-                if (x[i]) h.insert(g.s(q,i));
-            }
-            for (Id i=0, n=s.size(); i<n; i++) {
-                if (s[i]) s[i] = h.count(g.s(q,i));
-            }
+            auto const& v = c.code;
+            std::vector<char> h = code_flags(c);
+            x.for_each([&](Id i) { h[v[i]] = 1; });
+            s.filter([&](Id i) { return h[v[i]]; });
         }
         break;
     }
@@ -48,5 +48,44 @@ void Query::parse(std::string const& sel) {
             fail_with_error(sel,start,stop);
         }
     } while (tokenId>0);
+    if (!pred) MSYS_FAIL("empty selection");
 }
 
+Selection Query::select() {
+    /* columns hold values for the current positions and System, so
+     * they do not outlive one evaluation. */
+    columns.clear();
+    Selection s = full_selection(mol);
+    pred->eval(s);
+    columns.clear();
+    return s;
+}
+
+void CachedPredicate::eval(Selection& s) {
+    if (!cache || cache->size()!=s.size()) {
+        cache.reset(new Selection(full_selection(mol)));
+        sub->eval(*cache);
+    }
+    s.intersect(*cache);
+}
+
+static void cache_static(desres::msys::System* mol,
+                         std::unique_ptr<Predicate>& p,
+                         std::vector<CachedPredicate*>& caches) {
+    if (!p->positional()) {
+        auto c = new CachedPredicate(mol, p.release());
+        p.reset(c);
+        caches.push_back(c);
+        return;
+    }
+    for (auto slot : p->children()) cache_static(mol, *slot, caches);
+}
+
+void Query::cacheStatic() {
+    caches.clear();
+    if (pred) cache_static(mol, pred, caches);
+}
+
+void Query::resetCaches() {
+    for (auto c : caches) c->reset();
+}
@@ -2,90 +2,146 @@
 #define desres_msys_atomsel_selection2_hxx
 
 #include "../types.hxx"
-#include <string.h>
-#include <stdio.h>
-#include <stdlib.h>
+#include <stdint.h>
+#include <algorithm>
 
 namespace desres { namespace msys { namespace atomsel {
 
-    /* A selection is a list of booleans */
+    /* A selection is a set of atom ids, one bit per id.  Set operations
+     * work a word at a time; count() and ids() skip
+     * unselected runs using popcount and count-trailing-zeros.  Bits at or
+     * past size() are always zero. */
 
     class Selection {
 
-        std::vector<unsigned char> flags;
+        std::vector<uint64_t> words;
         Id _size;
 
-        void alloc() { 
-            flags.resize(_size + sizeof(size_t)-1);
+        void alloc() {
+            words.resize((_size+63)/64);
         }
 
+        template <typename Op>
+        void combine(Selection const& other, Op op) {
+            uint64_t* mine = words.data();
+            const uint64_t* that = other.words.data();
+            Id n=std::min(words.size(), other.words.size());
+            for (Id i=0; i<n; i++) mine[i] = op(mine[i], that[i]);
+        }
+
+        struct And {
+            uint64_t operator()(uint64_t a, uint64_t b) const { return a&b; }
+        };
+        struct Or {
+            uint64_t operator()(uint64_t a, uint64_t b) const { return a|b; }
+        };
+        struct AndNot {
+            uint64_t operator()(uint64_t a, uint64_t b) const { return a&~b; }
+        };
+
     public:
-        /* initialize with size and list of flags starting out as true */
+        /* initialize with size and list of ids starting out as selected */
         Selection(Id size, const IdList& ids) : _size(size) {
             alloc();
-            IdList::const_iterator i, e;
-            for (i=ids.begin(), e=ids.end(); i!=e; ++i) flags[*i]=1;
+            for (Id id : ids) set(id);
         }
 
         /* construct an empty selection of the given size */
         explicit Selection(Id size) : _size(size) {
             alloc();
         }
-        
-        /* clear all flags */
-        void clear() { memset(&flags[0], 0, _size); }
-        
+
+        /* deselect everything */
+        void clear() { std::fill(words.begin(), words.end(), 0); }
+
         /* number selected */
         Id count() const {
             Id cnt=0;
-            for (Id i=0, n=_size; i<n; i++) cnt += flags[i];
+            for (uint64_t w : words) cnt += __builtin_popcountll(w);
             return cnt;
         }
 
-        /* total number of flags */
+        /* total number of ids */
         inline Id size() const { return _size; }
 
         /* accessors */
-        inline unsigned char&       operator[](Id i)       { return flags[i]; }
-        inline unsigned char const& operator[](Id i) const { return flags[i]; }
+        inline bool operator[](Id i) const {
+            return (words[i/64] >> (i%64)) & 1;
+        }
+        inline void set(Id i)   { words[i/64] |=  (uint64_t(1) << (i%64)); }
+        inline void reset(Id i) { words[i/64] &= ~(uint64_t(1) << (i%64)); }
+
+        /* call f on each selected id, in increasing order */
+        template <typename F>
+        void for_each(F f) const {
+            for (Id w=0, n=words.size(); w<n; w++) {
+                for (uint64_t mask=words[w]; mask; mask &= mask-1) {
+                    f(Id(64*w + __builtin_ctzll(mask)));
+                }
+            }
+        }
+
+        /* call f on each selected id in [begin, end), in increasing order.
+         * Ranges starting on different multiples of 64 share no words. */
+        template <typename F>
+        void for_each_in(Id begin, Id end, F f) const {
+            if (begin>=end) return;
+            Id wb = begin/64, we = (end+63)/64;
+            for (Id w=wb; w<we; w++) {
+                uint64_t mask = words[w];
+                if (w==wb) mask &= ~uint64_t(0) << (begin%64);
+                if (w==we-1 && end%64) mask &= (uint64_t(1) << (end%64)) - 1;
+                for (; mask; mask &= mask-1) {
+                    f(Id(64*w + __builtin_ctzll(mask)));
+                }
+            }
+        }
+
+        /* deselect each selected id for which f returns false, writing
+         * a word of results at a time. */
+        template <typename F>
+        void filter(F f) {
+            for (Id w=0, n=words.size(); w<n; w++) {
+                uint64_t keep = 0;
+                for (uint64_t mask=words[w]; mask; mask &= mask-1) {
+                    unsigned b = __builtin_ctzll(mask);
+                    if (f(Id(64*w + b))) keep |= uint64_t(1) << b;
+                }
+                words[w] = keep;
+            }
+        }
 
         /* return the selected ids */
         IdList ids() const {
             IdList tmp;
-            for (Id i=0, n=_size; i!=n; i++) if (flags[i]) tmp.push_back(i);
+            tmp.reserve(count());
+            for_each([&](Id i) { tmp.push_back(i); });
             return tmp;
         }
 
         /* AND a selection into this one */
         Selection& intersect(Selection const& other) {
-            size_t* mine = (size_t*)&flags[0];
-            const size_t* that = (const size_t*)&other.flags[0];
-            Id i,n = flags.size()/sizeof(size_t);
-            for (i=0; i<n; i++) mine[i] &= that[i];
+            combine(other, And());
+            for (Id i=other.words.size(); i<words.size(); i++) words[i]=0;
             return *this;
         }
 
         /* OR a selection into this one */
         Selection& add(Selection const& other) {
-            size_t* mine = (size_t*)&flags[0];
-            const size_t* that = (const size_t*)&other.flags[0];
-            Id i,n = flags.size()/sizeof(size_t);
-            for (i=0; i<n; i++) mine[i] |= that[i];
+            combine(other, Or());
             return *this;
         }
 
         /* AND NOT a selection into this one (subtract) */
         Selection& subtract(Selection const& other) {
-            size_t* mine = (size_t*)&flags[0];
-            const size_t* that = (const size_t*)&other.flags[0];
-            Id i,n = flags.size()/sizeof(size_t);
-            for (i=0; i<n; i++) mine[i] &= ~(that[i]);
+            combine(other, AndNot());
             return *this;
         }
 
-        /* turn on all flags */
+        /* select everything */
         void fill() {
-            std::fill(flags.begin(), flags.begin()+_size, 1);
+            std::fill(words.begin(), words.end(), ~uint64_t(0));
+            if (_size%64) words.back() = (uint64_t(1) << (_size%64)) - 1;
         }
     };
 
@@ -0,0 +1,168 @@
+#include "token.hxx"
+#include "../annotated_system.hxx"
+#include "../smarts.hxx"
+#include "../parallel.hxx"
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+using namespace desres::msys;
+using namespace desres::msys::atomsel;
+
+namespace {
+
+    inline uint64_t mix(uint64_t h, uint64_t v) {
+        h ^= v + 0x9e3779b97f4a7c15ULL + (h<<6) + (h>>2);
+        h ^= h >> 30; h *= 0xbf58476d1ce4e5b9ULL;
+        h ^= h >> 27; h *= 0x94d049bb133111ebULL;
+        return h ^ (h >> 31);
+    }
+
+    /* hash of everything an AnnotatedSystem or a smarts match depends
+     * on.  Bond orders and charges are edited in place, so there is no
+     * cheaper way to notice that they changed. */
+    uint64_t topology_signature(System* mol) {
+        uint64_t h = mix(mol->maxAtomId(), mol->maxBondId());
+        for (auto i=mol->atomBegin(), e=mol->atomEnd(); i!=e; ++i) {
+            atom_t const& a = mol->atomFAST(*i);
+            h = mix(h, uint64_t(*i) << 32 | a.fragid);
+            h = mix(h, uint8_t(a.atomic_number) |
+                       uint8_t(a.formal_charge) << 8 |
+                       uint8_t(a.aromatic) << 16);
+        }
+        for (auto i=mol->bondBegin(), e=mol->bondEnd(); i!=e; ++i) {
+            bond_t const& b = mol->bondFAST(*i);
+            h = mix(h, uint64_t(b.i) << 32 | b.j);
+            h = mix(h, uint8_t(b.order) | uint8_t(b.aromatic) << 8);
+        }
+        return h;
+    }
+
+    /* atoms matched by one pattern, for the fragments searched so far */
+    struct Matches {
+        Selection atoms;
+        std::vector<char> searched;     /* by fragid */
+        explicit Matches(Id natoms) : atoms(natoms) {}
+    };
+
+    /* Annotation and match results for one System.  The mutex is held
+     * while either is being computed or used. */
+    struct Entry {
+        std::weak_ptr<System> sys;
+        System* mol;
+        uint64_t signature;
+        std::mutex mtx;
+        std::unique_ptr<AnnotatedSystem> annotated;
+        std::unordered_map<std::string, std::unique_ptr<Matches>> matches;
+    };
+    typedef std::shared_ptr<Entry> EntryPtr;
+
+    class SmartsCache {
+        static const size_t max_systems = 4;
+        static const size_t max_patterns = 256;
+
+        std::mutex _mtx;
+        std::list<EntryPtr> _entries;   /* most recently used first */
+        std::unordered_map<std::string, std::shared_ptr<SmartsPattern>> _patterns;
+
+    public:
+        /* the entry for mol, emptied if its topology has changed */
+        EntryPtr entry(System* mol) {
+            SystemPtr sys = mol->shared_from_this();
+            uint64_t sig = topology_signature(mol);
+            std::lock_guard<std::mutex> lock(_mtx);
+            for (auto it=_entries.begin(); it!=_entries.end(); ++it) {
+                if ((*it)->mol!=mol || (*it)->sys.lock()!=sys) continue;
+                EntryPtr e = *it;
+                _entries.erase(it);
+                _entries.push_front(e);
+                if (e->signature!=sig) {
+                    /* replace rather than clear, since another thread
+                     * may still be using the old entry. */
+                    e.reset(new Entry);
+                    e->sys = sys;
+                    e->mol = mol;
+                    e->signature = sig;
+                    _entries.front() = e;
+                }
+                return e;
+            }
+            EntryPtr e(new Entry);
+            e->sys = sys;
+            e->mol = mol;
+            e->signature = sig;
+            _entries.push_front(e);
+            if (_entries.size()>max_systems) _entries.pop_back();
+            return e;
+        }
+
+        std::shared_ptr<SmartsPattern> pattern(std::string const& pat) {
+            {
+                std::lock_guard<std::mutex> lock(_mtx);
+                auto it = _patterns.find(pat);
+                if (it!=_patterns.end()) return it->second;
+            }
+            std::shared_ptr<SmartsPattern> p(new SmartsPattern(pat));
+            std::lock_guard<std::mutex> lock(_mtx);
+            if (_patterns.size()>=max_patterns) _patterns.clear();
+            _patterns[pat] = p;
+            return p;
+        }
+    };
+
+    SmartsCache smarts_cache;
+}
+
+Selection desres::msys::atomsel::smarts_matches(System* mol,
+        std::vector<std::string> const& pats, Selection const& s) {
+
+    EntryPtr entry = smarts_cache.entry(mol);
+    std::lock_guard<std::mutex> lock(entry->mtx);
+    if (!entry->annotated) {
+        entry->annotated.reset(new AnnotatedSystem(mol->shared_from_this()));
+    }
+    AnnotatedSystem const& annotated = *entry->annotated;
+
+    /* fragments containing selected atoms */
+    std::vector<char> wanted;
+    s.for_each([&](Id i) {
+        Id frag = mol->atomFAST(i).fragid;
+        if (frag>=wanted.size()) wanted.resize(frag+1);
+        wanted[frag] = 1;
+    });
+
+    Selection sel(s.size());
+    for (auto const& pat : pats) {
+        auto& m = entry->matches[pat];
+        if (!m) m.reset(new Matches(s.size()));
+        if (m->searched.size()<wanted.size()) m->searched.resize(wanted.size());
+
+        /* start from atoms in wanted fragments not already searched */
+        IdList starts;
+        for (auto i=mol->atomBegin(), e=mol->atomEnd(); i!=e; ++i) {
+            Id frag = mol->atomFAST(*i).fragid;
+            if (frag<wanted.size() && wanted[frag] && !m->searched[frag]) {
+                starts.push_back(*i);
+            }
+        }
+        if (!starts.empty()) {
+            auto p = smarts_cache.pattern(pat);
+            unsigned nchunks = std::max<uint64_t>(1, std::min<uint64_t>(
+                        default_thread_count(), (starts.size()+63)/64));
+            std::vector<Selection> found(nchunks, Selection(s.size()));
+            nchunks = parallel_chunks(starts.size(), nchunks,
+                    [&](unsigned c, uint64_t b, uint64_t e) {
+                IdList chunk(starts.begin()+b, starts.begin()+e);
+                for (auto const& ids : p->findMatches(annotated, chunk)) {
+                    for (Id id : ids) found[c].set(id);
+                }
+            }, 64);
+            for (unsigned c=0; c<nchunks; c++) m->atoms.add(found[c]);
+            for (Id f=0; f<wanted.size(); f++) {
+                if (wanted[f]) m->searched[f] = 1;
+            }
+        }
+        sel.add(m->atoms);
+    }
+    return sel;
+}
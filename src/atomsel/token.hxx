@@ -3,10 +3,15 @@
 
 #include <stdio.h>
 #include <string>
+#include <unordered_map>
 #include "atomsel.h"
 #include "selection.hxx"
 #include "../system.hxx"
 
+namespace desres { namespace msys {
+    class SpatialHashCache;
+}}
+
 namespace desres { namespace msys { namespace atomsel {
 
 struct Predicate;
@@ -55,9 +60,53 @@ struct Valist {
     void add_regex(std::string&& s) { regex.emplace_back(s); }
 };
 
+/* Values of one keyword for every atom id, computed once per evaluation
+ * of a Query and shared by the predicates which use that keyword.  Strings
+ * are stored as codes numbering the distinct strings of the column: each
+ * code indexes handles, the StringPool handles of the strings, if pooled,
+ * else dict. */
+struct Column {
+    int type;
+    std::vector<int> ival;
+    std::vector<double> fval;
+    std::vector<Id> code;
+    std::vector<std::string> dict;
+    std::vector<Id> handles;
+    bool pooled = false;
+
+    /* number of distinct codes */
+    Id ncodes() const { return pooled ? handles.size() : dict.size(); }
+
+    const char* str(Id i) const {
+        return pooled ? StringPool::c_str(handles[code[i]])
+                      : dict[code[i]].c_str();
+    }
+};
+
+/* Predicates narrow the selection they are given to the atoms which
+ * satisfy them.  Except for nearest, the result for an atom depends only
+ * on that atom, so s.intersect(P(all atoms)) gives the same result. */
 struct Predicate {
     virtual ~Predicate() = default;
     virtual void eval(Selection& s) = 0;
+
+    /* true if the result depends on positions, cell or velocities */
+    virtual bool positional() const { return false; }
+
+    /* slots holding the child predicates, for rewriting the tree */
+    virtual std::vector<std::unique_ptr<Predicate>*> children() { return {}; }
+};
+
+/* Evaluates its child once against all atoms and reuses the result until
+ * reset; used for clauses which are not positional. */
+struct CachedPredicate : Predicate {
+    std::unique_ptr<Predicate> sub;
+    std::unique_ptr<Selection> cache;
+    System* mol;
+
+    CachedPredicate(System* m, Predicate* S) : sub(S), mol(m) {}
+    virtual void eval(Selection& s);
+    void reset() { cache.reset(); }
 };
 
 struct BoolPredicate : Predicate {
@@ -77,6 +126,7 @@ struct KeyPredicate : Predicate {
     KeyPredicate(Query* q, std::string&& s, Valist* v)
     : q(q), name(s), va(v) {}
     virtual void eval(Selection& s);
+    virtual bool positional() const;
 };
 
 struct AndPredicate : Predicate {
@@ -86,6 +136,8 @@ struct AndPredicate : Predicate {
         lhs->eval(s);
         rhs->eval(s);
     }
+    bool positional() const { return lhs->positional() || rhs->positional(); }
+    std::vector<std::unique_ptr<Predicate>*> children() { return {&lhs, &rhs}; }
 };
 struct OrPredicate : Predicate {
     std::unique_ptr<Predicate> lhs, rhs;
@@ -96,6 +148,8 @@ struct OrPredicate : Predicate {
         rhs->eval(s2);
         s.add(s2);
     }
+    bool positional() const { return lhs->positional() || rhs->positional(); }
+    std::vector<std::unique_ptr<Predicate>*> children() { return {&lhs, &rhs}; }
 };
 struct NotPredicate : Predicate {
     std::unique_ptr<Predicate> sub;
@@ -105,21 +159,25 @@ struct NotPredicate : Predicate {
         sub->eval(s2);
         s.subtract(s2);
     }
+    bool positional() const { return sub->positional(); }
+    std::vector<std::unique_ptr<Predicate>*> children() { return {&sub}; }
 };
+/* positions, cell and spatial hashes are taken from the query when the
+ * predicate is evaluated, so that it can be reevaluated on new frames. */
 class WithinPredicate : public Predicate {
-    System* sys;
-    const float* pos;
-    const double* cell;
+    Query* q;
     const float rad;
     std::unique_ptr<Predicate> sub;
     const bool exclude;
     const bool periodic;
 
 public:
-    WithinPredicate( System* e, const float* pos, const double* cell, float r, bool excl, bool per, Predicate* s )
-    : sys(e), pos(pos), cell(cell), rad(r), sub(s), exclude(excl), periodic(per) {}
+    WithinPredicate( Query* q, float r, bool excl, bool per, Predicate* s )
+    : q(q), rad(r), sub(s), exclude(excl), periodic(per) {}
 
   void eval( Selection& s );
+  bool positional() const { return true; }
+  std::vector<std::unique_ptr<Predicate>*> children() { return {&sub}; }
 };
 
 class WithinBondsPredicate : public Predicate {
@@ -132,20 +190,22 @@ public:
     : sys(e), N(n), sub(s) {}
 
   void eval( Selection& s );
+  bool positional() const { return sub->positional(); }
+  std::vector<std::unique_ptr<Predicate>*> children() { return {&sub}; }
 };
 class KNearestPredicate : public Predicate {
-  System* _sys;
-  const float* pos;
-  const double* cell;
+  Query* q;
   const unsigned _N;
   const bool periodic;
   std::unique_ptr<Predicate> _sub;
 
 public:
-  KNearestPredicate(System* sys, const float* pos, const double* cell, unsigned k, bool per, Predicate* sub)
-  : _sys(sys), pos(pos), cell(cell), _N(k), periodic(per), _sub(sub) {}
+  KNearestPredicate(Query* q, unsigned k, bool per, Predicate* sub)
+  : q(q), _N(k), periodic(per), _sub(sub) {}
 
   void eval(Selection& s);
+  bool positional() const { return true; }
+  std::vector<std::unique_ptr<Predicate>*> children() { return {&_sub}; }
 };
 
 struct SamePredicate : Predicate {
@@ -157,11 +217,14 @@ struct SamePredicate : Predicate {
     : q(q), name(name), sub(p) {}
 
     void eval( Selection& s );
+    bool positional() const;
+    std::vector<std::unique_ptr<Predicate>*> children() { return {&sub}; }
 };
 
 struct Expression {
     virtual ~Expression() = default;
     virtual void eval(Selection const& s, std::vector<double>& v) = 0;
+    virtual bool positional() const { return false; }
 };
 
 struct LitExpr : Expression {
@@ -177,6 +240,7 @@ struct KeyExpr : Expression {
     std::string name;
     KeyExpr(Query* q, std::string&& s) : q(q), name(s) {}
     void eval(Selection const& s, std::vector<double>& v);
+    bool positional() const;
 };
 
 struct FuncExpr : Expression {
@@ -185,12 +249,14 @@ struct FuncExpr : Expression {
     FuncExpr(double (*f)(double), Expression* e)
     : func(f), sub(e) {}
     void eval(Selection const& s, std::vector<double>& v);
+    bool positional() const { return sub->positional(); }
 };
 
 struct NegExpr : Expression {
     std::unique_ptr<Expression> sub;
     NegExpr(Expression* e) : sub(e) {}
     void eval(Selection const& s, std::vector<double>& v);
+    bool positional() const { return sub->positional(); }
 };
 
 struct BinExpr : Expression {
@@ -201,6 +267,7 @@ struct BinExpr : Expression {
     BinExpr(int op, Expression* L, Expression* R)
     : op(op), lhs(L), rhs(R) {}
     void eval(Selection const& s, std::vector<double>& v);
+    bool positional() const { return lhs->positional() || rhs->positional(); }
 };
 
 struct CmpPredicate : Predicate {
@@ -211,16 +278,36 @@ struct CmpPredicate : Predicate {
     : cmp(c), lhs(L), rhs(R) {}
 
     void eval( Selection& s );
+    bool positional() const { return lhs->positional() || rhs->positional(); }
 };
 
 struct Query {
     System* mol = nullptr;
     const float* pos = nullptr;
     const double* cell = nullptr;
+    SpatialHashCache* hashes = nullptr;
     Id id = BadId;  // hack for key selections
     std::unique_ptr<Predicate> pred;
 
     void parse(std::string const& selection);
+
+    /* evaluate pred against all atoms */
+    Selection select();
+
+    /* values of a keyword, computed on first use during select() */
+    Column const& column(std::string const& name);
+
+    /* Wrap each largest subtree of pred which is not positional in a
+     * CachedPredicate, so that reevaluating the query recomputes only
+     * the positional parts. */
+    void cacheStatic();
+
+    /* drop results cached by cacheStatic() */
+    void resetCaches();
+
+private:
+    std::vector<CachedPredicate*> caches;
+    std::unordered_map<std::string, std::unique_ptr<Column>> columns;
 };
 
 bool is_keyword(std::string const& name, System* mol);
@@ -228,6 +315,12 @@ bool is_keyword(std::string const& name, System* mol);
 
 Selection full_selection(System* sys);
 
+/* atoms matched by any of the smarts patterns pats, among the fragments
+ * containing atoms in s.  Annotations, parsed patterns and matches are
+ * cached per System until its atoms, bonds or bond orders change. */
+Selection smarts_matches(System* sys, std::vector<std::string> const& pats,
+                         Selection const& s);
+
 }}}
 
 
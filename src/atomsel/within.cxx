@@ -7,9 +7,81 @@ using namespace desres::msys;
 using namespace desres::msys::atomsel;
 
 namespace {
+
+    /* number of query atoms whose coordinates are gathered at a time */
+    const Id block_size = 4096;
+
+    /* float coordinates of atoms, from the query positions if given, else
+     * converted from the System as they are needed, so that no copy of
+     * every position is made. */
+    struct Positions {
+        const float* pos;
+        const System* sys;
+
+        explicit Positions(Query* q)
+        : pos(q->pos), sys(q->pos ? nullptr : q->mol) {}
+
+        void append(Id id, std::vector<float>& xyz) const {
+            if (pos) {
+                xyz.insert(xyz.end(), pos+3*id, pos+3*id+3);
+            } else {
+                const double* p = sys->atomPosFAST(id);
+                xyz.push_back(p[0]);
+                xyz.push_back(p[1]);
+                xyz.push_back(p[2]);
+            }
+        }
+
+        /* packed coordinates of the selected atoms */
+        std::vector<float> gather(Selection const& s) const {
+            std::vector<float> xyz;
+            xyz.reserve(3*s.count());
+            s.for_each([&](Id id) { append(id, xyz); });
+            return xyz;
+        }
+    };
+
+    IdList iota(Id n) {
+        IdList ids(n);
+        for (Id i=0; i<n; i++) ids[i]=i;
+        return ids;
+    }
+
+    /* Atoms of S within rad of the points in hash.  S is read a block
+     * at a time by each thread, over disjoint words, and the result is
+     * written to the same words, so memory beyond the hash is a block
+     * per thread plus the result bits. */
+    Selection stream_within(SpatialHash const& hash, float rad,
+                            Positions const& pos, Selection const& S) {
+        Selection result(S.size());
+        const IdList local = iota(block_size);
+        const Id nwords = (S.size()+63)/64;
+        parallel_chunks(nwords, 0, [&](unsigned, uint64_t b, uint64_t e) {
+            std::vector<float> xyz;
+            IdList ids;
+            xyz.reserve(3*block_size);
+            ids.reserve(block_size);
+            auto flush = [&]() {
+                for (Id i : hash.find_within(rad, xyz.data(), ids.size(),
+                                             local.data())) {
+                    result.set(ids[i]);
+                }
+                xyz.clear();
+                ids.clear();
+            };
+            S.for_each_in(64*b, std::min<uint64_t>(64*e, S.size()), [&](Id id) {
+                ids.push_back(id);
+                pos.append(id, xyz);
+                if (ids.size()==block_size) flush();
+            });
+            if (!ids.empty()) flush();
+        }, block_size/64);
+        return result;
+    }
 }
 
 void WithinPredicate::eval( Selection& S ) {
+    System* sys = q->mol;
     Selection subsel = full_selection(sys);
     sub->eval(subsel);
     if (exclude) S.subtract(subsel);
@@ -19,79 +91,66 @@ void WithinPredicate::eval( Selection& S ) {
         return;
     }
 
-    std::vector<float> coords;
-    if (!pos) {
-        coords.resize(3*sys->maxAtomId());
-        for (auto id : sys->atoms()) {
-            atom_t const& atm = sys->atomFAST(id);
-            coords[3*id  ] = atm.x;
-            coords[3*id+1] = atm.y;
-            coords[3*id+2] = atm.z;
-        }
-        pos = &coords[0];
-    }
-    if (periodic && !cell) {
-        cell = sys->global_cell[0];
+    const double* cell = nullptr;
+    if (periodic) {
+        cell = q->cell ? q->cell : sys->global_cell[0];
     }
-    IdList subsel_ids = subsel.ids();
-    IdList S_ids = S.ids();
-
-    IdList ids = FindWithin(S_ids, pos, subsel_ids, pos, rad, cell);
-    S.clear();
-    for (Id i=0, n=ids.size(); i<n; i++) S[ids[i]] = 1;
+    Positions pos(q);
 
+    /* cached hashes are keyed by atom id and updated from a full array
+     * of positions, so they are used only when positions are supplied. */
+    if (q->hashes && q->pos) {
+        SpatialHash& hash = q->hashes->get(subsel.ids(), q->pos, cell, rad);
+        S = stream_within(hash, rad, pos, S);
+        return;
+    }
+    std::vector<float> xyz = pos.gather(subsel);
+    SpatialHash hash(xyz.data(), xyz.size()/3, nullptr, cell);
+    hash.voxelize(rad);
+    S = stream_within(hash, rad, pos, S);
 }
 
 void WithinBondsPredicate::eval( Selection& S ) {
   Selection subsel = full_selection(sys);
   sub->eval(subsel);
-  IdSet atms;
-  /* hash the atoms in the subsel */
-  for (Id i=0; i<subsel.size(); i++) {
-    if (subsel[i]) atms.insert(i);
-  }
-  /* expand subsel by N bonds */
-  for (int i=0; i<N; i++) {
-    IdList tmp;
-    for (IdSet::const_iterator iter=atms.begin(); iter!=atms.end(); ++iter) {
-        IdList bonds = sys->bondsForAtom(*iter);
-        for (Id j=0; j<bonds.size(); j++) {
-            tmp.push_back(sys->bond(bonds[j]).other(*iter));
+  /* expand subsel by N bonds, visiting only the atoms added in the
+   * previous step */
+  BondGraphPtr graph = sys->bondGraph();
+  IdList frontier = subsel.ids(), next;
+  for (int i=0; i<N && !frontier.empty(); i++) {
+    next.clear();
+    for (Id id : frontier) {
+      for (Id other : graph->neighbors(id)) {
+        if (!subsel[other]) {
+          subsel.set(other);
+          next.push_back(other);
         }
+      }
     }
-    atms.insert(tmp.begin(), tmp.end());
-  }
-  for (Id i=0; i<subsel.size(); i++) {
-    subsel[i] = atms.count(i);
+    frontier.swap(next);
   }
   S.intersect(subsel);
 }
 
 void KNearestPredicate::eval( Selection& S ) {
-
-    Selection subsel = full_selection(_sys);
+    System* sys = q->mol;
+    Selection subsel = full_selection(sys);
     _sub->eval(subsel);
     S.subtract(subsel);
 
-    std::vector<float> coords;
-    if (!pos) {
-        coords.resize(3*_sys->maxAtomId());
-        for (auto id : _sys->atoms()) {
-            atom_t const& atm = _sys->atomFAST(id);
-            coords[3*id  ] = atm.x;
-            coords[3*id+1] = atm.y;
-            coords[3*id+2] = atm.z;
-        }
-        pos = &coords[0];
-    }
-    if (periodic && !cell) {
-        cell = _sys->global_cell[0];
+    const double* cell = nullptr;
+    if (periodic) {
+        cell = q->cell ? q->cell : sys->global_cell[0];
     }
-    IdList subsel_ids = subsel.ids();
-    IdList S_ids = S.ids();
+    Positions pos(q);
+    std::vector<float> xyz = pos.gather(subsel);
+    SpatialHash hash(xyz.data(), xyz.size()/3, nullptr, cell);
 
-    IdList ids = FindNearest(S_ids, pos, subsel_ids, pos, _N, cell);
+    /* search packed coordinates of S, then map back to atom ids */
+    IdList S_ids = S.ids();
+    xyz = pos.gather(S);
+    IdList local = iota(S_ids.size());
+    IdList ids = hash.findNearest(_N, xyz.data(), local.size(), local.data());
     S.clear();
-    for (Id i=0, n=ids.size(); i<n; i++) S[ids[i]] = 1;
+    for (Id i : ids) S.set(S_ids[i]);
 }
-
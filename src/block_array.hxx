@@ -0,0 +1,110 @@
+#ifndef desres_msys_block_array_hxx
+#define desres_msys_block_array_hxx
+
+#include "types.hxx"
+#include <vector>
+#include <memory>
+#include <stdexcept>
+#include <algorithm>
+
+namespace desres { namespace msys {
+
+    /* Growable array stored in blocks of 1024 values.  Values are
+     * contiguous within a block.  The first block starts small and is
+     * reallocated as it grows, like a vector, so that small arrays stay
+     * small; once it is full, later blocks are allocated whole and values
+     * no longer move.  Copies share blocks until one of them writes to a
+     * block, at which point the writer takes its own copy of just that
+     * block.  Only the non-const accessors copy, so reads should go
+     * through a const reference; and a reference taken before the array
+     * was copied should not be used afterwards, which is why ValueRef
+     * looks its storage up on every access. */
+    template <typename T>
+    class BlockArray {
+        static const Id bits = 10;
+        static const Id block = 1<<bits;
+        std::vector<std::shared_ptr<T> > _blocks;
+        Id _size = 0;
+        Id _first = 0;  /* capacity of the first block */
+
+        static std::shared_ptr<T> alloc(Id n) {
+            return std::shared_ptr<T>(new T[n](), std::default_delete<T[]>());
+        }
+
+        Id capacity() const {
+            return _blocks.empty() ? 0 : _first + (_blocks.size()-1)*block;
+        }
+
+        /* block b, copied first if another array shares it */
+        T* writable(Id b) {
+            std::shared_ptr<T>& p = _blocks[b];
+            if (p.use_count()>1) {
+                Id n = b ? block : _first;
+                std::shared_ptr<T> q = alloc(n);
+                std::copy(p.get(), p.get()+n, q.get());
+                p = q;
+            }
+            return p.get();
+        }
+
+    public:
+        Id size() const { return _size; }
+        bool empty() const { return _size==0; }
+        T& operator[](Id i) { return writable(i>>bits)[i&(block-1)]; }
+        T const& operator[](Id i) const { return _blocks[i>>bits].get()[i&(block-1)]; }
+        T& at(Id i) {
+            if (i>=_size) throw std::out_of_range("BlockArray index out of range");
+            return (*this)[i];
+        }
+        T const& at(Id i) const {
+            if (i>=_size) throw std::out_of_range("BlockArray index out of range");
+            return (*this)[i];
+        }
+
+        /* make room for n values without changing size() */
+        void reserve(Id n) {
+            if (n<=capacity()) return;
+            if (_first<block) {
+                Id m = std::min(block, n);
+                std::shared_ptr<T> q = alloc(m);
+                if (_blocks.empty()) {
+                    _blocks.push_back(q);
+                } else {
+                    std::copy(_blocks[0].get(), _blocks[0].get()+_size, q.get());
+                    _blocks[0] = q;
+                }
+                _first = m;
+            }
+            while (capacity()<n) _blocks.push_back(alloc(block));
+        }
+
+        /* append n copies of v */
+        void append(Id n, T const& v) {
+            Id m = _size+n;
+            if (m>capacity()) reserve(_first<block ? std::max(m, 2*_first) : m);
+            for (Id i=_size; i<m; i++) (*this)[i] = v;
+            _size = m;
+        }
+        void push_back(T const& v) { append(1, v); }
+
+        /* call f(const T* values, Id count) on each block in order */
+        template <typename F>
+        void forEachBlock(F f) const {
+            for (Id b=0; b*block<_size; b++) {
+                f(_blocks[b].get(), std::min(block, _size-b*block));
+            }
+        }
+
+        /* call f(T* values, Id count) on each block in order, copying
+         * shared blocks first */
+        template <typename F>
+        void forEachWritableBlock(F f) {
+            for (Id b=0; b*block<_size; b++) {
+                f(writable(b), std::min(block, _size-b*block));
+            }
+        }
+    };
+
+}}
+
+#endif
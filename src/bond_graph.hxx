@@ -0,0 +1,80 @@
+#ifndef desres_msys_bond_graph_hxx
+#define desres_msys_bond_graph_hxx
+
+#include "types.hxx"
+#include <vector>
+#include <memory>
+
+namespace desres { namespace msys {
+
+    /* Compressed sparse row view of the bond topology of a System: for
+     * each atom id, the ids of its bonded atoms and of the bonds to them,
+     * in the same order as System::bondsForAtom.  A BondGraph is an
+     * immutable snapshot; obtain one from System::bondGraph(), which
+     * rebuilds it after the topology changes. */
+    class BondGraph {
+        std::vector<Id> _offsets;   /* maxAtomId()+1 */
+        std::vector<Id> _nbrs;      /* partner atom ids */
+        std::vector<Id> _bonds;     /* bond ids, parallel to _nbrs */
+
+    public:
+        /* contiguous run of ids, usable in range-for */
+        class Range {
+            const Id* _b;
+            const Id* _e;
+        public:
+            Range(const Id* b, const Id* e) : _b(b), _e(e) {}
+            const Id* begin() const { return _b; }
+            const Id* end() const { return _e; }
+            Id size() const { return _e-_b; }
+            bool empty() const { return _b==_e; }
+            Id operator[](Id i) const { return _b[i]; }
+        };
+
+        /* index[i] holds the bond ids of atom i; other(b, i) returns the
+         * partner of atom i in bond b. */
+        template <typename Index, typename Other>
+        BondGraph(Index const& index, Other const& other) {
+            const Id n = index.size();
+            _offsets.resize(n+1);
+            for (Id i=0; i<n; i++) {
+                _offsets[i+1] = _offsets[i] + index[i].size();
+            }
+            _nbrs.resize(_offsets[n]);
+            _bonds.resize(_offsets[n]);
+            for (Id i=0; i<n; i++) {
+                Id* nbrs = &_nbrs[_offsets[i]];
+                Id* bonds = &_bonds[_offsets[i]];
+                for (Id b : index[i]) {
+                    *bonds++ = b;
+                    *nbrs++ = other(b, i);
+                }
+            }
+        }
+
+        /* number of atom ids covered, including deleted atoms */
+        Id atomCount() const { return _offsets.size()-1; }
+
+        Id degree(Id i) const { return _offsets[i+1]-_offsets[i]; }
+
+        /* atoms bonded to atom i */
+        Range neighbors(Id i) const {
+            return Range(_nbrs.data()+_offsets[i], _nbrs.data()+_offsets[i+1]);
+        }
+
+        /* bonds to atom i, parallel to neighbors(i) */
+        Range bonds(Id i) const {
+            return Range(_bonds.data()+_offsets[i], _bonds.data()+_offsets[i+1]);
+        }
+
+        /* raw arrays, for algorithms that want them directly */
+        const Id* offsetData() const { return _offsets.data(); }
+        const Id* neighborData() const { return _nbrs.data(); }
+        const Id* bondData() const { return _bonds.data(); }
+    };
+
+    typedef std::shared_ptr<const BondGraph> BondGraphPtr;
+
+}}
+
+#endif
@@ -29,6 +29,81 @@
 
 namespace desres { namespace msys {
 
+    namespace {
+        /* An atom with its position and velocity, serialized exactly as
+         * atom_t was when it held its own coordinates. */
+        struct atom_record_t {
+            atom_t* atom;
+            Float* pos;
+            Float* vel;
+
+            template<class Archive>
+            void serialize(Archive & archive) {
+                atom_t& a = *atom;
+                archive(a.fragid, a.residue, a.atomic_number, a.formal_charge, a.stereo_parity, a.aromatic);
+                archive(pos[0],pos[1],pos[2],a.charge, vel[0],vel[1],vel[2],a.mass);
+                archive(a.name, a.type);
+            }
+        };
+    }
+
+    /* same layout as cereal's std::vector<atom_t> */
+    template <class Archive>
+    void System::serialize_member(Archive& a, AtomList& atoms) {
+        cereal::size_type n = atoms.size();
+        a(cereal::make_size_tag(n));
+        if (Archive::is_loading::value) {
+            atoms.append(n-atoms.size(), atom_t());
+            _pos.append(n-_pos.size(), Coord());
+            _vel.append(n-_vel.size(), Coord());
+            for (cereal::size_type i=0; i<n; i++) {
+                atom_record_t rec{&atoms[i], _pos[i].data(), _vel[i].data()};
+                a(rec);
+            }
+        } else {
+            /* saving only reads, so don't copy blocks shared with a
+             * snapshot */
+            System const& self = *this;
+            for (cereal::size_type i=0; i<n; i++) {
+                atom_record_t rec{const_cast<atom_t*>(&self.atomFAST(i)),
+                                  const_cast<Float*>(self.atomPosFAST(i)),
+                                  const_cast<Float*>(self.atomVelFAST(i))};
+                a(rec);
+            }
+        }
+    }
+
+    /* same layout as cereal's std::vector<T> */
+    template <class Archive, typename T>
+    void System::serialize_member(Archive& a, BlockArray<T>& v) {
+        cereal::size_type n = v.size();
+        a(cereal::make_size_tag(n));
+        if (Archive::is_loading::value) {
+            v.append(n-v.size(), T());
+            for (cereal::size_type i=0; i<n; i++) a(v[i]);
+        } else {
+            BlockArray<T> const& c = v;
+            for (cereal::size_type i=0; i<n; i++) a(c[i]);
+        }
+    }
+
+    /* same layout as cereal's std::set<Id> */
+    template <class Archive>
+    void System::serialize_member(Archive& a, IdBitmap& dead) {
+        cereal::size_type n = dead.size();
+        a(cereal::make_size_tag(n));
+        if (Archive::is_loading::value) {
+            dead.clear();
+            for (cereal::size_type i=0; i<n; i++) {
+                Id id;
+                a(id);
+                dead.insert(id);
+            }
+        } else {
+            dead.for_each([&a](Id id) { a(id); });
+        }
+    }
+
     SystemPtr ImportCereal(std::string const& path) {
         std::ifstream in(path.c_str());
         if (!in) {
@@ -1,5 +1,6 @@
 #include "clone.hxx"
 #include "append.hxx"
+#include "parallel.hxx"
 #include <algorithm>
 #include <stdexcept>
 #include <sstream>
@@ -9,21 +10,20 @@
 using namespace desres::msys;
 
 namespace {
-    /* a predicate that returns true if a term is not in a subset */
-    struct BadTerm {
-        TermTablePtr _table;
-        IdList const& _atmmap;
-
-        BadTerm( TermTablePtr table, IdList const& atmmap ) 
-        : _table(table), _atmmap(atmmap) {}
-        bool operator()( Id const& id ) {
-            IdList atoms = _table->atoms(id);
-            for (unsigned i=0; i<atoms.size(); i++) {
-                if (bad(_atmmap[atoms[i]])) return true;
-            }
-            return false;
+    /* live terms of table whose atoms all have keep set.  The check is
+     * a running AND over the term's atoms, with no branch per atom. */
+    IdList terms_within(TermTablePtr table, std::vector<uint8_t> const& keep) {
+        IdList terms;
+        const Id natoms = table->atomCount();
+        for (Id t=0, n=table->maxTermId(); t<n; t++) {
+            if (!table->hasTerm(t)) continue;
+            const Id* atoms = table->atomsFAST(t);
+            uint8_t ok = 1;
+            for (Id j=0; j<natoms; j++) ok &= keep[atoms[j]];
+            if (ok) terms.push_back(t);
         }
-    };
+        return terms;
+    }
 
     IdList select_modified_interaction_rows(ParamTablePtr params, SystemPtr mol) {
         auto prop = mol->atomPropIndex("interaction_grp");
@@ -47,11 +47,95 @@ namespace {
         }
         return rows;
     }
+
+    /* tracks whether ids, seen in order, first appear as 0, 1, 2... */
+    struct FirstSeen {
+        Id next = 0;
+        bool ok = true;
+        void see(Id id) {
+            if (id==next) ++next;
+            else if (id>next) ok = false;
+        }
+        bool all(Id n) const { return ok && next==n; }
+    };
+
+    /* true if Clone(src, atoms, flags) would give the same System as
+     * src->snapshot(): every atom in id order, nothing deleted, and each
+     * id, term and param already where Clone would put it. */
+    bool clone_is_snapshot(System const& src, IdList const& atoms,
+                           CloneOption::Flags flags) {
+        if (flags & (CloneOption::ShareParams | CloneOption::StructureOnly)) {
+            return false;
+        }
+        const Id natoms = src.maxAtomId();
+        if (atoms.size()!=natoms || src.atomCount()!=natoms) return false;
+        for (Id i=0; i<natoms; i++) if (atoms[i]!=i) return false;
+        if (src.bondCount()!=src.maxBondId() ||
+            src.residueCount()!=src.maxResidueId() ||
+            src.chainCount()!=src.maxChainId() ||
+            src.ctCount()!=src.maxCtId()) {
+            return false;
+        }
+        if (src.auxTable("modified_interaction")) return false;
+
+        /* Clone creates residues, chains and cts as it first reaches
+         * them, and bonds as it walks each atom's bonds. */
+        FirstSeen res, chn, ct, bnd;
+        for (Id i=0; i<natoms; i++) {
+            res.see(src.atomFAST(i).residue);
+            for (Id b : src.bondsForAtom(i)) bnd.see(b);
+        }
+        for (Id i=0, n=src.maxResidueId(); i<n; i++) {
+            IdList const& ids = src.atomsForResidue(i);
+            if (!std::is_sorted(ids.begin(), ids.end())) return false;
+            chn.see(src.residueFAST(i).chain);
+        }
+        for (Id i=0, n=src.maxChainId(); i<n; i++) {
+            IdList const& ids = src.residuesForChain(i);
+            if (!std::is_sorted(ids.begin(), ids.end())) return false;
+            ct.see(src.chainFAST(i).ct);
+        }
+        for (Id i=0, n=src.maxCtId(); i<n; i++) {
+            IdList const& ids = src.chainsForCt(i);
+            if (!std::is_sorted(ids.begin(), ids.end())) return false;
+        }
+        if (!res.all(src.maxResidueId()) || !chn.all(src.maxChainId()) ||
+            !ct.all(src.maxCtId()) || !bnd.all(src.maxBondId())) {
+            return false;
+        }
+
+        /* Clone keeps only referenced params, adding them table by table
+         * in sorted order. */
+        std::unordered_map<ParamTablePtr, FirstSeen> params;
+        for (String const& name : src.tableNames()) {
+            TermTablePtr table = src.table(name);
+            if (table->termCount()!=table->maxTermId()) return false;
+            if (table->overrides()->count()) return false;
+            IdList ids;
+            for (Id t=0, n=table->maxTermId(); t<n; t++) {
+                Id p = table->paramFAST(t);
+                if (!bad(p)) ids.push_back(p);
+            }
+            sort_unique(ids);
+            FirstSeen& seen = params[table->params()];
+            for (Id p : ids) seen.see(p);
+        }
+        for (auto const& it : params) {
+            if (!it.second.all(it.first->paramCount())) return false;
+        }
+        return true;
+    }
 }
 
 SystemPtr desres::msys::Clone( SystemPtr src, IdList const& atoms,
                                CloneOption::Flags flags) {
 
+    if (clone_is_snapshot(*src, atoms, flags)) {
+        SystemPtr dst = src->snapshot();
+        dst->updateFragids();
+        return dst;
+    }
+
     SystemPtr dst = System::create();
 
     /* Mappings from src ids to dst ids */
@@ -116,6 +200,8 @@ SystemPtr desres::msys::Clone( SystemPtr src, IdList const& atoms,
         atmmap[srcatm] = dstatm;
         /* Copy built-in properties */
         dst->atom(dstatm) = atm;
+        std::copy_n(src->atomPosFAST(srcatm), 3, dst->atomPosFAST(dstatm));
+        std::copy_n(src->atomVelFAST(srcatm), 3, dst->atomVelFAST(dstatm));
         /* Restore the overwritten residue id */
         dst->atom(dstatm).residue = dstres;
         /* Copy additional atom properties */
@@ -152,77 +238,72 @@ SystemPtr desres::msys::Clone( SystemPtr src, IdList const& atoms,
     if (flags & CloneOption::StructureOnly) {
         // skip term tables
         //
-    } else if (flags & CloneOption::ShareParams) {
-        TermTablePtr srctable, dsttable;
-        for (String name : src->tableNames()) {
-            srctable = src->table(name);
-            dsttable = dst->addTable(name, 
-                                     srctable->atomCount(),
-                                     srctable->params());
-            dsttable->category = srctable->category;
-            IdList terms = srctable->terms();
-            IdList::iterator iter = std::remove_if(
-                    terms.begin(), terms.end(), BadTerm(srctable, atmmap));
-            terms.erase(iter, terms.end());
-            AppendTerms( dsttable, srctable, atmmap, terms );
-        }
-        
     } else {
-
-        /* Detect when term tables share a ParamTable.  First pass: sort
-         * by param table.  */
-        typedef std::vector<std::string> StringList;
-        typedef std::unordered_map<ParamTablePtr, StringList> TableMap;
-        TableMap tables;
-        TableMap::const_iterator it;
-        std::vector<String> tablenames = src->tableNames();
-        for (unsigned i=0; i<tablenames.size(); i++) {
-            std::string const& name = tablenames[i];
-            TermTablePtr srctable = src->table(name);
-            tables[srctable->params()].push_back(name);
+        /* Group tables by ParamTable.  Each group is filled by one task,
+         * so a ParamTable is only ever touched by one thread.  Unless
+         * ShareParams is set, tables sharing a ParamTable in src share
+         * a new one in dst holding just the params they use. */
+        std::vector<String> names = src->tableNames();
+        std::vector<IdList> groups;
+        std::unordered_map<ParamTablePtr, Id> groupmap;
+        std::vector<TermTablePtr> srctables, dsttables;
+        uint64_t nterms = 0;
+        for (Id i=0; i<names.size(); i++) {
+            TermTablePtr srctable = src->table(names[i]);
+            auto r = groupmap.emplace(srctable->params(), groups.size());
+            if (r.second) groups.emplace_back();
+            groups[r.first->second].push_back(i);
+            srctables.push_back(srctable);
+            nterms += srctable->termCount();
         }
-
-        /* process the unshared tables. */
-        for (it=tables.begin(); it!=tables.end(); ++it) {
-            if (it->second.size()>1) continue;
-            std::string const& name = it->second.at(0);
-            TermTablePtr srctable = src->table(name);
-            TermTablePtr dsttable = dst->addTable(name, srctable->atomCount());
-            dsttable->category = srctable->category;
-            IdList terms;
-            if (flags & CloneOption::UseIndex) {
-                terms = srctable->findWithOnly(atoms);
-            } else {
-                terms = srctable->terms();
-                auto iter = std::remove_if(
-                        terms.begin(), terms.end(), BadTerm(srctable, atmmap));
-                terms.erase(iter, terms.end());
+        /* create the tables up front, in src order */
+        dsttables.resize(names.size());
+        for (IdList const& group : groups) {
+            ParamTablePtr dstparams;
+            if (flags & CloneOption::ShareParams) {
+                dstparams = srctables[group[0]]->params();
+            } else if (group.size()>1) {
+                dstparams = ParamTable::create();
+            }
+            for (Id i : group) {
+                dsttables[i] = dst->addTable(names[i],
+                                             srctables[i]->atomCount(),
+                                             dstparams);
+                dsttables[i]->category = srctables[i]->category;
             }
-            AppendTerms( dsttable, srctable, atmmap, terms );
         }
+        std::vector<uint8_t> keep(atmmap.size());
+        for (Id i=0; i<atmmap.size(); i++) keep[i] = !bad(atmmap[i]);
 
-        /* process the tables with shared params */
-        for (it=tables.begin(); it!=tables.end(); ++it) {
-            StringList const& s = it->second;
-            if (it->second.size()<2) continue;
-            ParamTablePtr dstparams = ParamTable::create();
-            ParamTablePtr srcparams = src->table(s[0])->params();
+        auto fill = [&](IdList const& group) {
+            if ((flags & CloneOption::ShareParams) || group.size()==1) {
+                for (Id i : group) {
+                    TermTablePtr srctable = srctables[i];
+                    IdList terms;
+                    if ((flags & CloneOption::UseIndex) &&
+                       !(flags & CloneOption::ShareParams)) {
+                        terms = srctable->findWithOnly(atoms);
+                    } else {
+                        terms = terms_within(srctable, keep);
+                    }
+                    if (flags & CloneOption::ShareParams) {
+                        IdList pmap(srctable->params()->paramCount());
+                        for (Id p=0; p<pmap.size(); p++) pmap[p]=p;
+                        AppendTerms(dsttables[i], srctable, atmmap, terms, pmap);
+                    } else {
+                        AppendTerms(dsttables[i], srctable, atmmap, terms);
+                    }
+                }
+                return;
+            }
+            ParamTablePtr dstparams = dsttables[group[0]]->params();
+            ParamTablePtr srcparams = srctables[group[0]]->params();
             IdList src2dst(srcparams->paramCount(), BadId);
-            for (unsigned i=0; i<s.size(); i++) {
-                std::string const& name = s[i];
-                TermTablePtr srctable = src->table(name);
-                TermTablePtr dsttable = dst->addTable(name,
-                                                      srctable->atomCount(),
-                                                      dstparams);
-                dsttable->category = srctable->category;
+            for (Id i : group) {
+                TermTablePtr srctable = srctables[i];
 
                 /* get the terms included in the selection */
-                IdList terms = srctable->terms();
-                terms.erase(std::remove_if( 
-                            terms.begin(), 
-                            terms.end(), 
-                            BadTerm(srctable, atmmap)),
-                        terms.end());
+                IdList terms = terms_within(srctable, keep);
                 /* get the set of parameters referenced by at least one term.
                  * The reference counting in ParamTable doesn't help us here
                  * because we aren't interested in params that are referenced
@@ -230,8 +311,8 @@ SystemPtr desres::msys::Clone( SystemPtr src, IdList const& atoms,
                  * bit of duplication here of logic in append.cxx and that 
                  * should be addressed at some point. */
                 IdList params;
-                for (Id i=0; i<terms.size(); i++) {
-                    Id p = srctable->param(terms[i]);
+                for (Id t : terms) {
+                    Id p = srctable->param(t);
                     if (!bad(p)) params.push_back(p);
                 }
                 sort_unique(params);
@@ -239,21 +320,26 @@ SystemPtr desres::msys::Clone( SystemPtr src, IdList const& atoms,
                 /* Add to dstparams just the params that haven't already been
                  * added. */
                 IdList newsrcparams;
-                for (Id i=0; i<params.size(); i++) {
-                    Id p = params[i];
+                for (Id p : params) {
                     if (bad(src2dst.at(p))) newsrcparams.push_back(p);
                 }
                 IdList newdstparams = AppendParams(dstparams, srcparams, 
                                                    newsrcparams);
                 /* update the mapping */
-                for (Id i=0; i<newdstparams.size(); i++) {
-                    src2dst.at(newsrcparams[i]) = newdstparams[i];
+                for (Id j=0; j<newdstparams.size(); j++) {
+                    src2dst.at(newsrcparams[j]) = newdstparams[j];
                 }
 
                 /* append the terms */
-                AppendTerms(dsttable, srctable, atmmap, terms, src2dst);
+                AppendTerms(dsttables[i], srctable, atmmap, terms, src2dst);
             }
-        }
+        };
+        /* threads only pay for themselves on large systems */
+        unsigned nthreads = nterms < 100000 ? 1 : 0;
+        parallel_chunks(groups.size(), nthreads,
+                [&](unsigned, uint64_t b, uint64_t e) {
+            for (uint64_t g=b; g<e; g++) fill(groups[g]);
+        });
     }
 
     /* copy all top-level data */
@@ -151,6 +151,8 @@ static void export_particles(const System& sys, const IdList& map, Sqlite dms,
     for (Id i=0, n=ids.size(); i<n; i++) {
         Id atm = ids[i];
         const atom_t& atom = sys.atom(atm);
+        const Float* pos = sys.atomPos(atm);
+        const Float* vel = sys.atomVel(atm);
         Id res = atom.residue;
         const residue_t& residue = sys.residue(res);
         Id chn = residue.chain;
@@ -159,12 +161,12 @@ static void export_particles(const System& sys, const IdList& map, Sqlite dms,
         w.bind_int( 0, map[atm]);
         w.bind_int( 1, atom.atomic_number);
         w.bind_str( 2, atom.name.c_str());
-        w.bind_flt( 3, atom.x);
-        w.bind_flt( 4, atom.y);
-        w.bind_flt( 5, atom.z);
-        w.bind_flt( 6, atom.vx);
-        w.bind_flt( 7, atom.vy);
-        w.bind_flt( 8, atom.vz);
+        w.bind_flt( 3, pos[0]);
+        w.bind_flt( 4, pos[1]);
+        w.bind_flt( 5, pos[2]);
+        w.bind_flt( 6, vel[0]);
+        w.bind_flt( 7, vel[1]);
+        w.bind_flt( 8, vel[2]);
         w.bind_str( 9, residue.name.c_str());
         w.bind_int(10, residue.resid);
         w.bind_str(11, chain.name.c_str());
@@ -293,12 +295,30 @@ static void export_params(ParamTablePtr params, const std::string& tablename,
     }
 
     dms.exec( ss.str().c_str());
+    /* bind straight from the typed columns */
+    std::vector<ColumnView<Int> > ints;
+    std::vector<ColumnView<Float> > floats;
+    std::vector<ColumnView<const char*> > strs;
+    std::vector<ValueType> types;
+    for (Id j=0; j<nprops; j++) {
+        types.push_back(params->propType(j));
+        switch (types.back()) {
+            case IntType:   ints.push_back(params->intValues(j)); break;
+            case FloatType: floats.push_back(params->floatValues(j)); break;
+            default:
+            case StringType: strs.push_back(params->stringValues(j)); break;
+        }
+    }
     Writer w = dms.insert(tablename);
     dms.exec( "begin");
     for (Id i=0, n=params->paramCount(); i<n; i++) {
-        for (Id j=0; j<nprops; j++) {
-            ValueRef val = params->value(i,j);
-            write(val, j, w);
+        for (Id j=0, ji=0, jf=0, js=0; j<nprops; j++) {
+            switch (types[j]) {
+                case IntType:   w.bind_int(j, ints[ji++][i]); break;
+                case FloatType: w.bind_flt(j, floats[jf++][i]); break;
+                default:
+                case StringType: w.bind_str(j, strs[js++][i]); break;
+            }
         }
         if (with_id) {
             w.bind_int(nprops,i);
@@ -172,12 +172,20 @@ static void read_table( Sqlite dms,
         }
     }
 
-    /* inject terms */
-    IdList atoms(natoms);
+    /* read all terms, then add them at once.  Term properties are
+     * staged in a scratch table until the terms exist. */
+    IdList atoms, params;
+    ParamTablePtr termprops;
+    if (separate_param_table) {
+        termprops = ParamTable::create();
+        for (ExtraMap::const_iterator i=extra.begin(); i!=extra.end(); ++i) {
+            termprops->addProp(i->second.first, i->second.second);
+        }
+    }
     for (; r; r.next()) {
         /* read atoms */
         for (unsigned i=0; i<natoms; i++) {
-            atoms[i] = r.get_int(cols[i]);
+            atoms.push_back(r.get_int(cols[i]));
         }
         /* read param properties */
         Id param = BadId;
@@ -201,12 +209,22 @@ static void read_table( Sqlite dms,
                 read(r,i->first,terms->params()->value(param,j++));
             }
         }
-        Id term = terms->addTerm(atoms,param);
+        params.push_back(param);
         /* read term properties */
         if (separate_param_table) {
+            Id row = termprops->addParam();
             Id j=0;
             for (ExtraMap::const_iterator e=extra.begin(); e!=extra.end(); ++e) {
-                read(r,e->first,terms->termPropValue(term, j++));
+                read(r,e->first,termprops->value(row, j++));
+            }
+        }
+    }
+    const Id nterms = params.size();
+    Id first = terms->addTerms(nterms, atoms.data(), params.data());
+    if (separate_param_table) {
+        for (Id t=0; t<nterms; t++) {
+            for (Id j=0; j<extra.size(); j++) {
+                terms->termPropValue(first+t, j) = termprops->value(t, j);
             }
         }
     }
@@ -256,8 +274,9 @@ read_nonbonded( Sqlite dms, System& sys,
 
     IdList atoms(1);
     unsigned i,n = nbtypes.size();
+    IdList ids(n), params(n);
     for (i=0; i<n; i++) {
-        atoms[0]=i;
+        ids[i]=i;
         Id nb = nbtypes[i];
         if (!bad(nb)) {
             try {
@@ -270,8 +289,9 @@ read_nonbonded( Sqlite dms, System& sys,
                 throw std::runtime_error(ss.str());
             }
         }
-        terms->addTerm(atoms, nb);
+        params[i] = nb;
     }
+    terms->addTerms(n, ids.data(), params.data());
     known.insert("alchemical_particle");
     r = dms.fetch("alchemical_particle");
     if (r.size()) {
@@ -287,12 +307,16 @@ read_nonbonded( Sqlite dms, System& sys,
         TermTablePtr alc = 
             sys.addTable("alchemical_nonbonded", 1, terms->params());
         alc->category = NONBONDED;
+        /* the rest become term properties, staged as in read_table */
         std::vector<int> termprops;
+        ParamTablePtr props = ParamTable::create();
         for (int i=0; i<r.size(); i++) {
             if (i==P0 || i==CHARGEA || i==TYPEA || i==TYPEB) continue;
             alc->addTermProp(r.name(i), r.type(i));
+            props->addProp(r.name(i), r.type(i));
             termprops.push_back(i);
         }
+        IdList ids, paramsB;
         for (; r; r.next()) {
             int p0 = r.get_int(P0);
             atoms[0] = p0;
@@ -303,9 +327,10 @@ read_nonbonded( Sqlite dms, System& sys,
             Id paramA = r.get_int(TYPEA);
             terms->setParam(atoms[0], idmap.at(paramA));
 
-            /* add alchemical state */
+            /* alchemical state */
             Id paramB = r.get_int(TYPEB);
-            Id term = alc->addTerm(atoms, idmap.at(paramB));
+            ids.push_back(atoms[0]);
+            paramsB.push_back(idmap.at(paramB));
 
             /* override charge */
             if (CHARGEA>=0) {
@@ -313,9 +338,16 @@ read_nonbonded( Sqlite dms, System& sys,
                 atm.charge = r.get_flt(CHARGEA);
             }
 
-            /* add the rest as term properties */
+            Id row = props->addParam();
+            for (Id i=0; i<termprops.size(); i++) {
+                read(r, termprops[i], props->value(row, i));
+            }
+        }
+        const Id nterms = ids.size();
+        Id first = alc->addTerms(nterms, ids.data(), paramsB.data());
+        for (Id t=0; t<nterms; t++) {
             for (Id i=0; i<termprops.size(); i++) {
-                read(r, termprops[i], alc->termPropValue(term, i));
+                alc->termPropValue(first+t, i) = props->value(t, i);
             }
         }
     }
@@ -383,13 +415,14 @@ read_exclusions(Sqlite dms, System& sys, KnownSet& known) {
     TermTablePtr terms = sys.addTable("exclusion", 2);
     terms->reserve(dms.size("exclusion"));
     terms->category=EXCLUSION;
-    IdList atoms(2);
+    IdList atoms;
+    atoms.reserve(2*dms.size("exclusion"));
 
     for (; r; r.next()) {
-        atoms[0] = r.get_int(0);
-        atoms[1] = r.get_int(1);
-        terms->addTerm(atoms,-1);
+        atoms.push_back(r.get_int(0));
+        atoms.push_back(r.get_int(1));
     }
+    terms->addTerms(atoms.size()/2, atoms.data(), NULL);
 }
 
 static void
@@ -669,12 +702,14 @@ static SystemPtr import_dms( Sqlite dms, bool structure_only,
 
         /* add atom properties */
         atom_t& atm = sys.atomFAST(atmid);
-        atm.x = r.get_flt( X);
-        atm.y = r.get_flt( Y);
-        atm.z = r.get_flt( Z);
-        atm.vx = r.get_flt( VX);
-        atm.vy = r.get_flt( VY);
-        atm.vz = r.get_flt( VZ);
+        Float* pos = sys.atomPosFAST(atmid);
+        Float* vel = sys.atomVelFAST(atmid);
+        pos[0] = r.get_flt( X);
+        pos[1] = r.get_flt( Y);
+        pos[2] = r.get_flt( Z);
+        vel[0] = r.get_flt( VX);
+        vel[1] = r.get_flt( VY);
+        vel[2] = r.get_flt( VZ);
         atm.mass = r.get_flt( MASS);
         atm.atomic_number = anum;
         atm.charge = r.get_flt( CHARGE);
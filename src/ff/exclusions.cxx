@@ -72,6 +72,7 @@ void build<Component::exclusions>(
     IdList term(2);
 
     std::unordered_set<uint64_t> excl_set;
+    IdList excl_ids, pair_ids, pair_params;
 
     for (auto tlist : all_tuples) {
         if (tlist->empty()) continue;
@@ -88,7 +89,7 @@ void build<Component::exclusions>(
             term[1] = tuple[arity-1];
             uint64_t key = (uint64_t(term[0]) << 32) | term[1];
             if (!excl_set.emplace(key).second) continue;
-            excls->addTerm(term, BadId);
+            excl_ids.insert(excl_ids.end(), term.begin(), term.end());
             if (es_scale > 0 || lj_scale > 0) {
                 Id ni = nbterms->param(term[0]);
                 Id nj = nbterms->param(term[1]);
@@ -107,10 +108,14 @@ void build<Component::exclusions>(
                 pairs_table->params()->value(param, "aij") = lj.aij;
                 pairs_table->params()->value(param, "bij") = lj.bij;
                 pairs_table->params()->value(param, "qij") = qij;
-                pairs_table->addTerm(term, param);
+                pair_ids.insert(pair_ids.end(), term.begin(), term.end());
+                pair_params.push_back(param);
             }
         }
     }
+    excls->addTerms(excl_ids.size()/2, excl_ids.data(), NULL);
+    pairs_table->addTerms(pair_params.size(), pair_ids.data(),
+                          pair_params.data());
 }
 
 }}} // namespace
@@ -15,13 +15,13 @@ std::string Graph::hash(SystemPtr sys, IdList const& atoms){
     std::vector<Id> countmap(max_atomic_number,0);
     int biggest=0;
     Id bcount=0;
+    BondGraphPtr graph = sys->bondGraph();
     for (Id id : atoms){
         int anum=sys->atom(id).atomic_number;
         if (anum < 1) continue;
         ++countmap.at(anum);
-        const IdList& bonded = sys->bondedAtoms(id);
-        for (unsigned i = 0; i < bonded.size(); ++i) {
-            if (sys->atom(bonded[i]).atomic_number != 0)
+        for (Id other : graph->neighbors(id)) {
+            if (sys->atomFAST(other).atomic_number != 0)
                 ++bcount;
         }
         if (anum>biggest) biggest=anum;
@@ -108,14 +108,14 @@ Graph::Graph(SystemPtr sys, const IdList& atoms, const IdList& colors) {
      * the atom set, and compute the node attribute as the atomic number
      * combined with the number of non-pseudo bonds */
     int nidx=0;
+    BondGraphPtr graph = sys->bondGraph();
     for (auto const& entry : count_to_idx){
         for (Id id : freq_partition[entry.second]){
             Node& node = _nodes[nidx++];
             node.nbr = &_nbrs[node.nnbr];
             node.nnbr = 0;
             int degree = 0;
-            IdList const& bonded = sys->bondedAtoms(id);
-            for (Id other : bonded) {
+            for (Id other : graph->neighbors(id)) {
                 if (colormap.find(other) != colormap.end()) {
                     if (colormap[other] == 0) continue;
                 }
@@ -9,36 +9,69 @@ namespace desres { namespace msys {
             auto type = params->propType(iprop);
             tr.Update(name.data(), name.size());
             tr.Update(&type, sizeof(type));
-            for (Id i=0, n=params->paramCount(); i<n; i++) {
-                switch (type) {
-                case IntType:
-                {
-                    auto v = params->value(i,iprop).asInt();
-                    tr.Update(&v, sizeof(v));
-                    break;
-                }
-                case FloatType:
-                {
-                    auto v = params->value(i,iprop).asFloat();
-                    tr.Update(&v, sizeof(v));
-                    break;
-                }
-                default:
-                case StringType:
-                {
-                    auto v = params->value(i,iprop).c_str();
-                    tr.Update(v, strlen(v));
-                    break;
-                }
-                }
+            /* same bytes as hashing the column one value at a time */
+            switch (type) {
+            case IntType:
+            {
+                params->intValues(iprop).forEachBlock([&tr](const Int* v, Id n) {
+                    tr.Update(v, n*sizeof(Int));
+                });
+                break;
+            }
+            case FloatType:
+            {
+                params->floatValues(iprop).forEachBlock([&tr](const Float* v, Id n) {
+                    tr.Update(v, n*sizeof(Float));
+                });
+                break;
+            }
+            default:
+            case StringType:
+                params->stringValues(iprop).forEachBlock([&tr](const char* const* v, Id n) {
+                    for (Id i=0; i<n; i++) tr.Update(v[i], strlen(v[i]));
+                });
+                break;
             }
         }
     }
 
+    /* atom_t as laid out when it held its own position and velocity,
+     * so that hashes don't depend on where coordinates are stored. */
+    struct legacy_atom_t : pod<legacy_atom_t> {
+        Id  fragid;
+        Id  residue;
+        int8_t atomic_number;
+        int8_t formal_charge;
+        int8_t stereo_parity;
+        int8_t aromatic;
+        Float x,y,z;
+        Float charge;
+        Float vx,vy,vz;
+        Float mass;
+        SmallString<30> name;
+        AtomType type;
+    };
+
     static void hash_atoms(ThreeRoe& tr, SystemPtr mol) {
         for (auto i=mol->atomBegin(), e=mol->atomEnd(); i!=e; ++i) {
             // atoms memset 0 themselves, so this is ok.
-            tr.Update(&mol->atomFAST(*i), sizeof(atom_t));
+            auto const& atm = mol->atomFAST(*i);
+            const Float* pos = mol->atomPosFAST(*i);
+            const Float* vel = mol->atomVelFAST(*i);
+            legacy_atom_t rec;
+            rec.fragid = atm.fragid;
+            rec.residue = atm.residue;
+            rec.atomic_number = atm.atomic_number;
+            rec.formal_charge = atm.formal_charge;
+            rec.stereo_parity = atm.stereo_parity;
+            rec.aromatic = atm.aromatic;
+            rec.x = pos[0]; rec.y = pos[1]; rec.z = pos[2];
+            rec.charge = atm.charge;
+            rec.vx = vel[0]; rec.vy = vel[1]; rec.vz = vel[2];
+            rec.mass = atm.mass;
+            rec.name.assign(atm.name.c_str(), atm.name.size());
+            rec.type = atm.type;
+            tr.Update(&rec, sizeof(rec));
         }
         hash_params(tr, mol->atomProps());
     }
@@ -0,0 +1,73 @@
+#ifndef desres_msys_id_bitmap_hxx
+#define desres_msys_id_bitmap_hxx
+
+#include "types.hxx"
+#include <vector>
+#include <stdint.h>
+
+namespace desres { namespace msys {
+
+    /* A set of ids stored as one bit per id, for sets which are dense in
+     * a small range, like the deleted elements of a System.  Membership
+     * is O(1), and runs of members are skipped a word at a time. */
+    class IdBitmap {
+        std::vector<uint64_t> _words;
+        Id _size = 0;
+
+    public:
+        bool empty() const { return _size==0; }
+        Id size() const { return _size; }
+
+        /* 1 if id is a member, as std::set::count */
+        Id count(Id id) const {
+            Id w = id/64;
+            return w<_words.size() && ((_words[w] >> (id%64)) & 1);
+        }
+
+        /* add id; return true if it was not already a member */
+        bool insert(Id id) {
+            Id w = id/64;
+            if (w>=_words.size()) _words.resize(w+1);
+            uint64_t bit = uint64_t(1) << (id%64);
+            if (_words[w] & bit) return false;
+            _words[w] |= bit;
+            ++_size;
+            return true;
+        }
+
+        void clear() {
+            _words.clear();
+            _size = 0;
+        }
+
+        /* smallest id >= i which is not a member, or end if there is none
+         * smaller than end. */
+        Id next_clear(Id i, Id end) const {
+            Id w = i/64;
+            if (w>=_words.size()) return i<end ? i : end;
+            uint64_t mask = ~_words[w] & (~uint64_t(0) << (i%64));
+            while (!mask) {
+                if (++w==_words.size()) {
+                    i = 64*w;
+                    return i<end ? i : end;
+                }
+                mask = ~_words[w];
+            }
+            i = 64*w + __builtin_ctzll(mask);
+            return i<end ? i : end;
+        }
+
+        /* call f on each member, in increasing order */
+        template <typename F>
+        void for_each(F f) const {
+            for (Id w=0, n=_words.size(); w<n; w++) {
+                for (uint64_t mask=_words[w]; mask; mask &= mask-1) {
+                    f(Id(64*w + __builtin_ctzll(mask)));
+                }
+            }
+        }
+    };
+
+}}
+
+#endif
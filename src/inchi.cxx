@@ -72,11 +72,11 @@ InChI InChI::create(SystemPtr mol, unsigned options) {
 
     for (Id i=0; i<mol->maxAtomId(); i++) {
         inchi_Atom& iatom = atoms[i];
-        atom_t const& matom = mol->atom(i);
+        const double* pos = mol->atomPos(i);
 
-        iatom.x = matom.x;
-        iatom.y = matom.y;
-        iatom.z = matom.z;
+        iatom.x = pos[0];
+        iatom.y = pos[1];
+        iatom.z = pos[2];
         iatom.num_bonds = mol->bondCountForAtom(i);
         Id j=0;
         for (Id b : mol->bondsForAtom(i)) {
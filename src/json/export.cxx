@@ -211,16 +211,18 @@ static Value export_particles(Document& d, NameMap& map, System& mol) {
 
     for (auto i=mol.atomBegin(), e=mol.atomEnd(); i!=e; ++i) {
         auto const& a = mol.atomFAST(*i);
+        auto apos = mol.atomPosFAST(*i);
+        auto avel = mol.atomVelFAST(*i);
         uint64_t name = register_name(a.name, map, d);
         names.PushBack(name, alloc);
         anums.PushBack(a.atomic_number, alloc);
         residues.PushBack(a.residue, alloc);
-        pos.PushBack(a.x, alloc);
-        pos.PushBack(a.y, alloc);
-        pos.PushBack(a.z, alloc);
-        vel.PushBack(a.vx, alloc);
-        vel.PushBack(a.vy, alloc);
-        vel.PushBack(a.vz, alloc);
+        pos.PushBack(apos[0], alloc);
+        pos.PushBack(apos[1], alloc);
+        pos.PushBack(apos[2], alloc);
+        vel.PushBack(avel[0], alloc);
+        vel.PushBack(avel[1], alloc);
+        vel.PushBack(avel[2], alloc);
         fc.PushBack(a.formal_charge, alloc);
         mass.PushBack(a.mass, alloc);
         charge.PushBack(a.charge, alloc);
@@ -228,8 +230,8 @@ static Value export_particles(Document& d, NameMap& map, System& mol) {
         if (a.atomic_number!=0) nonzero_anm=true;
         if (a.formal_charge!=0) nonzero_fch=true;
         if (a.residue!=0) nonzero_res=true;
-        if (a.x!=0  || a.y!=0  || a.z!=0)  nonzero_pos=true;
-        if (a.vx!=0 || a.vy!=0 || a.vz!=0) nonzero_vel=true;
+        if (apos[0]!=0 || apos[1]!=0 || apos[2]!=0) nonzero_pos=true;
+        if (avel[0]!=0 || avel[1]!=0 || avel[2]!=0) nonzero_vel=true;
     }
     if (nonzero_nam) p.AddMember("name", names, alloc);
     if (nonzero_anm) p.AddMember("atomic_number", anums, alloc);
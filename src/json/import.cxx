@@ -264,20 +264,23 @@ static void read_particles(Document const& d, SystemPtr mol) {
 
     for (Id i=0; i<natoms; i++) {
         Id res = residue != particles.MemberEnd() ? residue->value[i].GetInt() : 0;
-        auto& atm = mol->atomFAST(mol->addAtom(res));
+        Id id = mol->addAtom(res);
+        auto& atm = mol->atomFAST(id);
         if (name != particles.MemberEnd()) {
             atm.name = get_name(names->value, name->value[i].GetInt());
         }
 
         if (pos != particles.MemberEnd()) {
-            atm.x = pos->value[3*i  ].GetDouble();
-            atm.y = pos->value[3*i+1].GetDouble();
-            atm.z = pos->value[3*i+2].GetDouble();
+            auto apos = mol->atomPosFAST(id);
+            apos[0] = pos->value[3*i  ].GetDouble();
+            apos[1] = pos->value[3*i+1].GetDouble();
+            apos[2] = pos->value[3*i+2].GetDouble();
         }
         if (vel != particles.MemberEnd()) {
-            atm.vx = vel->value[3*i  ].GetDouble();
-            atm.vy = vel->value[3*i+1].GetDouble();
-            atm.vz = vel->value[3*i+2].GetDouble();
+            auto avel = mol->atomVelFAST(id);
+            avel[0] = vel->value[3*i  ].GetDouble();
+            avel[1] = vel->value[3*i+1].GetDouble();
+            avel[2] = vel->value[3*i+2].GetDouble();
         }
 
         if (anum != particles.MemberEnd()) atm.atomic_number = anum->value[i].GetInt();
@@ -420,14 +423,16 @@ static void read_tables(Document const& d, SystemPtr mol) {
         auto& params = terms["p"];
         CHECK_SIZE(params, "p", particles.Size() / table->atomCount());
 
-        msys::IdList atoms(table->atomCount());
-        Id particle_index = 0;
-        for (Id i=0, n=params.Size(); i<n; i++) {
-            for (Id j=0, m=table->atomCount(); j<m; j++) {
-                atoms[j] = particles[particle_index++].GetInt();
-            }
-            table->addTerm(atoms, params[i].GetInt());
+        const Id nterms = params.Size();
+        msys::IdList atoms(nterms * table->atomCount());
+        msys::IdList pids(nterms);
+        for (Id i=0, n=atoms.size(); i<n; i++) {
+            atoms[i] = particles[i].GetInt();
+        }
+        for (Id i=0; i<nterms; i++) {
+            pids[i] = params[i].GetInt();
         }
+        table->addTerms(nterms, atoms.data(), pids.data());
 
         auto const &tags = m.value.FindMember("tags");
         if (tags != m.value.MemberEnd()) {
@@ -187,12 +187,14 @@ static IdList build_m_atom( SystemPtr mol, Destro& M ) {
         rec["m_pdb_residue_name"] = pad(res.name, 4);
         rec["m_chain_name"] = pad(chn.name, 1);
         rec["m_residue_number"] = res.resid;
-        rec["m_x_coord"] = atm.x;
-        rec["m_y_coord"] = atm.y;
-        rec["m_z_coord"] = atm.z;
-        rec["ffio_x_vel"] = atm.vx;
-        rec["ffio_y_vel"] = atm.vy;
-        rec["ffio_z_vel"] = atm.vz;
+        const Float* pos = mol->atomPos(id);
+        const Float* vel = mol->atomVel(id);
+        rec["m_x_coord"] = pos[0];
+        rec["m_y_coord"] = pos[1];
+        rec["m_z_coord"] = pos[2];
+        rec["ffio_x_vel"] = vel[0];
+        rec["ffio_y_vel"] = vel[1];
+        rec["ffio_z_vel"] = vel[2];
         rec["m_atomic_number"] = atm.atomic_number;
         rec["m_mmod_type"] = mmod;
         rec["m_color"] = color;
@@ -307,12 +309,14 @@ static void build_pseudos( SystemPtr mol, Destro& M ) {
         if (atm.atomic_number!=0) continue;
         Destro& row = pseudos.append();
         row["ffio_atom_name"] = atm.name;
-        row["ffio_x_coord"] = atm.x;
-        row["ffio_y_coord"] = atm.y;
-        row["ffio_z_coord"] = atm.z;
-        row["ffio_x_vel"] = atm.vx;
-        row["ffio_y_vel"] = atm.vy;
-        row["ffio_z_vel"] = atm.vz;
+        const Float* pos = mol->atomPos(id);
+        const Float* vel = mol->atomVel(id);
+        row["ffio_x_coord"] = pos[0];
+        row["ffio_y_coord"] = pos[1];
+        row["ffio_z_coord"] = pos[2];
+        row["ffio_x_vel"] = vel[0];
+        row["ffio_y_vel"] = vel[1];
+        row["ffio_z_vel"] = vel[2];
         row["ffio_pdb_residue_name"] = pad(res.name,4);
         row["ffio_chain_name"] = chn.name;
         row["ffio_pdb_segment_name"] = chn.name;
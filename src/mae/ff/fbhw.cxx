@@ -48,6 +48,8 @@ namespace {
             const Json& g2 = blk.get("ffio_group2");
             
             int i,n = blk.get("__size__").as_int();
+            IdList ids, ps;
+            std::vector<Int> groups;
             for (i=0; i<n; i++) {
                 Id itc = itable->addParam();
                 Id p = map.add(i);
@@ -57,15 +59,22 @@ namespace {
                 IdList group1 = parse_ids(g1.elem(i).as_string());
                 IdList group2 = parse_ids(g2.elem(i).as_string());
                 for (Id id : group1) {
-                    Id t = table->addTerm(IdList(1,id), p);
-                    table->termPropValue(t,"group") = max_group;
+                    ids.push_back(id);
+                    ps.push_back(p);
+                    groups.push_back(max_group);
                 }
                 for (Id id : group2) {
-                    Id t = table->addTerm(IdList(1,id), p);
-                    table->termPropValue(t,"group") = max_group+1;
+                    ids.push_back(id);
+                    ps.push_back(p);
+                    groups.push_back(max_group+1);
                 }
                 max_group += 2;
             }
+            Id first = table->addTerms(ids.size(), ids.data(), ps.data());
+            Id col = table->termPropIndex("group");
+            for (Id t=0; t<groups.size(); t++) {
+                table->termPropValue(first+t,col) = groups[t];
+            }
         }
 
     };
@@ -84,13 +93,14 @@ namespace {
             const Json& aj = blk.get("ffio_aj");
             const Json& ak = blk.get("ffio_ak");
             int i,n = blk.get("__size__").as_int();
-            IdList ids(3);
+            IdList ids(3*n), params(n);
             for (i=0; i<n; i++) {
-                ids[0]=ai.elem(i).as_int()-1;
-                ids[1]=aj.elem(i).as_int()-1;
-                ids[2]=ak.elem(i).as_int()-1;
-                table->addTerm(ids, map.add(i));
+                ids[3*i  ]=ai.elem(i).as_int()-1;
+                ids[3*i+1]=aj.elem(i).as_int()-1;
+                ids[3*i+2]=ak.elem(i).as_int()-1;
+                params[i]=map.add(i);
             }
+            table->addTerms(n, ids.data(), params.data());
         }
     };
 
@@ -109,14 +119,15 @@ namespace {
             const Json& ak = blk.get("ffio_ak");
             const Json& al = blk.get("ffio_al");
             int i,n = blk.get("__size__").as_int();
-            IdList ids(4);
+            IdList ids(4*n), params(n);
             for (i=0; i<n; i++) {
-                ids[0]=ai.elem(i).as_int()-1;
-                ids[1]=aj.elem(i).as_int()-1;
-                ids[2]=ak.elem(i).as_int()-1;
-                ids[3]=al.elem(i).as_int()-1;
-                table->addTerm(ids, map.add(i));
+                ids[4*i  ]=ai.elem(i).as_int()-1;
+                ids[4*i+1]=aj.elem(i).as_int()-1;
+                ids[4*i+2]=ak.elem(i).as_int()-1;
+                ids[4*i+3]=al.elem(i).as_int()-1;
+                params[i]=map.add(i);
             }
+            table->addTerms(n, ids.data(), params.data());
         }
     };
 
@@ -137,11 +148,14 @@ namespace {
             const Json& z0 = blk.get("ffio_z0");
 
             int i,n = blk.get("__size__").as_int();
+            IdList ids(n), params(n);
+            for (i=0; i<n; i++) {
+                ids[i] = sitemap.atoms().at(ai.elem(i).as_int()-1);
+                params[i] = map.add(i);
+            }
+            Id first = table->addTerms(n, ids.data(), params.data());
             for (i=0; i<n; i++) {
-                IdList ids(1,ai.elem(i).as_int()-1);
-                ids[0] = sitemap.atoms().at(ids[0]);
-                Id A = map.add(i);
-                Id term = table->addTerm(ids, A);
+                Id term = first+i;
                 table->termPropValue(term,0)=x0.elem(i).as_float();
                 table->termPropValue(term,1)=y0.elem(i).as_float();
                 table->termPropValue(term,2)=z0.elem(i).as_float();
@@ -19,6 +19,7 @@ namespace {
             const Json& fn = blk.get("ffio_funct");
 
             int i,n = blk.get("__size__").as_int();
+            IdList ids(n), params(n);
             for (i=0; i<n; i++) {
                 std::string f = fn.elem(i).as_string("");
                 to_lower(f);
@@ -26,10 +27,12 @@ namespace {
                     FFIO_ERROR("Unsupported ffio_funct in ffio_restraints: " 
                             << f);
                 }
-                IdList ids(1,ai.elem(i).as_int()-1);
-                ids[0] = sitemap.atoms().at(ids[0]);
-                Id A = map.add(i);
-                Id term = table->addTerm(ids, A);
+                ids[i] = sitemap.atoms().at(ai.elem(i).as_int()-1);
+                params[i] = map.add(i);
+            }
+            Id first = table->addTerms(n, ids.data(), params.data());
+            for (i=0; i<n; i++) {
+                Id term = first+i;
                 table->termPropValue(term,0)=t1.elem(i).as_float();
                 table->termPropValue(term,1)=t2.elem(i).as_float();
                 table->termPropValue(term,2)=t3.elem(i).as_float();
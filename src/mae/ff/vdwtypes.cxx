@@ -34,12 +34,12 @@ namespace {
             }
 
             TermTablePtr table = AddNonbonded(h,funct, vdwmap.rule());
-            TermTablePtr atable;
             ParamTablePtr params = table->params();
             Id typecol = params->addProp("type", StringType);
 
             typedef std::map<VdwType, Id> TypeMap;
             TypeMap map;
+            IdList asites, aatoms, aparams;
 
             for (Id i=0; i<sitemap.nsites(); i++) {
                 Id site = i+1;
@@ -66,26 +66,32 @@ namespace {
                 sitemap.addUnrolledTerms(table, p[0], ids );
 
                 if (!bad(p[1])) {
-                    /* alchemical nonbonded term */
-                    if (!atable) {
-                        atable = h->addTable(
-                                "alchemical_nonbonded", 1, params);
-                        atable->category = NONBONDED;
-                        atable->addTermProp("chargeB", FloatType);
-                        atable->addTermProp("moiety", IntType);
+                    /* alchemical nonbonded term, added below */
+                    asites.push_back(site);
+                    aatoms.push_back(sitemap.site(site));
+                    aparams.push_back(p[1]);
+                }
+            }
+
+            if (!asites.empty()) {
+                TermTablePtr atable = h->addTable(
+                        "alchemical_nonbonded", 1, params);
+                atable->category = NONBONDED;
+                atable->addTermProp("chargeB", FloatType);
+                atable->addTermProp("moiety", IntType);
 #ifdef DESMOND_USE_SCHRODINGER_MMSHARE
-                        atable->addTermProp("chargeC", FloatType);
+                atable->addTermProp("chargeC", FloatType);
 #endif
-                    }
-                    IdList realids(1,sitemap.site(site));
-                    Id term = atable->addTerm(realids, p[1]);
+                Id first = atable->addTerms(asites.size(), aatoms.data(),
+                                            aparams.data());
+                for (Id i=0; i<asites.size(); i++) {
+                    Id term = first+i;
                     atable->termPropValue(term,"chargeB") = 
-                        vdwmap.chargeB(site);
+                        vdwmap.chargeB(asites[i]);
 #ifdef DESMOND_USE_SCHRODINGER_MMSHARE
                     atable->termPropValue(term,"chargeC") = 
-                        vdwmap.chargeC(site);
+                        vdwmap.chargeC(asites[i]);
 #endif
-
                 }
             }
 
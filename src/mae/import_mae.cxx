@@ -176,13 +176,15 @@ namespace {
             Id id = imp.addAtom(chainname, segid, resid, resname, name, insert, ctid);
 
             atom_t& atm = h->atomFAST(id);
+            Float* pos = h->atomPosFAST(id);
+            Float* vel = h->atomVelFAST(id);
             atm.atomic_number = anum;
-            atm.x = x.elem(j).as_float(0);
-            atm.y = y.elem(j).as_float(0);
-            atm.z = z.elem(j).as_float(0);
-            atm.vx = vx.elem(j).as_float(0);
-            atm.vy = vy.elem(j).as_float(0);
-            atm.vz = vz.elem(j).as_float(0);
+            pos[0] = x.elem(j).as_float(0);
+            pos[1] = y.elem(j).as_float(0);
+            pos[2] = z.elem(j).as_float(0);
+            vel[0] = vx.elem(j).as_float(0);
+            vel[1] = vy.elem(j).as_float(0);
+            vel[2] = vz.elem(j).as_float(0);
             if (!!formals) atm.formal_charge = formals.elem(j).as_int(0);
             if (!!temp) h->atomPropValue(id,gtmp)=temp.elem(j).as_int(0);
             if (!!nrg)  h->atomPropValue(id,gene)=nrg.elem(j).as_int(0);
@@ -266,13 +268,14 @@ namespace {
                 std::string name=names.elem(j).as_string("");
 
                 Id id = imp.addAtom(chainname, segid, resid, resname, name, "", ctid);
-                atom_t& atom = h->atom(id);
-                atom.x = x.elem(j).as_float(0);
-                atom.y = y.elem(j).as_float(0);
-                atom.z = z.elem(j).as_float(0);
-                atom.vx = vx.elem(j).as_float(0);
-                atom.vy = vy.elem(j).as_float(0);
-                atom.vz = vz.elem(j).as_float(0);
+                Float* pos = h->atomPos(id);
+                Float* vel = h->atomVel(id);
+                pos[0] = x.elem(j).as_float(0);
+                pos[1] = y.elem(j).as_float(0);
+                pos[2] = z.elem(j).as_float(0);
+                vel[0] = vx.elem(j).as_float(0);
+                vel[1] = vy.elem(j).as_float(0);
+                vel[2] = vz.elem(j).as_float(0);
                 if (!!fep_pseudo_mapping)  h->atomPropValue(id,mapping_pid)=fep_pseudo_mapping.elem(j).as_int(0);
                 atoms.push_back(id);
                 *npseudos += 1;
@@ -74,16 +74,23 @@ void desres::msys::mae::SiteMap::addUnrolledTerms(TermTablePtr table, Id param,
 #endif
 
 
-    /* unroll the block */
-    int i, nblocks = _atoms.size() / _nsites;
-    IdList ids(m);
+    if (m != table->atomCount()) {
+        MSYS_FAIL("incorrect atom count for TermTable " << table->name());
+    }
+
+    /* unroll the block, converting site ids to atom ids */
+    Id i, nblocks = _atoms.size() / _nsites;
+    IdList ids(nblocks*m);
+    IdList params(nblocks, param);
     for (i=0; i<nblocks; i++) {
-        int offset = i*_nsites-1;
-        /* convert site ids to atom ids */
+        int64_t offset = int64_t(i)*_nsites-1;
         for (j=0; j<m; j++) {
-            ids[j] = _atoms.at(_s2p.at(sites[j]+offset));
+            ids[i*m+j] = _atoms.at(_s2p.at(sites[j]+offset));
         }
-        Id term = table->addTerm(ids, param);
+    }
+    Id first = table->addTerms(nblocks, ids.data(), params.data());
+    for (i=0; i<nblocks; i++) {
+        Id term = first+i;
         if (!bad(constrained_col)) {
             table->termPropValue(term, constrained_col)=1;
         }
@@ -165,10 +165,10 @@ const char* desres::msys::GuessSybylAtomType(SystemPtr mol, Id id, bool cyclic)
                     if (nh==0 && nd==1) {               /* 1.8.6.2.2 */
                         double tot=0;
                         IdList nbrs = mol->bondedAtoms(id);
-                        const double* A = &mol->atom(nbrs[0]).x;
-                        const double* B = &mol->atom(nbrs[1]).x;
-                        const double* C = &mol->atom(nbrs[2]).x;
-                        const double* o = &mol->atom(id).x;
+                        const double* A = mol->atomPos(nbrs[0]);
+                        const double* B = mol->atomPos(nbrs[1]);
+                        const double* C = mol->atomPos(nbrs[2]);
+                        const double* o = mol->atomPos(id);
                         tot += calc_angle(A,o,B);
                         tot += calc_angle(B,o,C);
                         tot += calc_angle(C,o,A);
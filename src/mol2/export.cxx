@@ -37,6 +37,7 @@ static void export_mol2(SystemPtr omol, AnnotatedSystem& asys,
     for (Id local_id=0, n=parent_ids.size(); local_id<n; local_id++) {
         Id parent_id = parent_ids[local_id];
         const atom_t& atm = mol->atomFAST(local_id);
+        const double* pos = mol->atomPosFAST(local_id);
         const residue_t& res = mol->residueFAST(atm.residue);
 
         /* Use atom name unless it's invalid */
@@ -66,7 +67,7 @@ static void export_mol2(SystemPtr omol, AnnotatedSystem& asys,
         const char* bb = atm.type==AtomProBack ? "BACKBONE" : "";
         fprintf(fd, 
            "%4d  %-4s  %8.4f  %8.4f  %8.4f %-5s %4d  %4s%-4d %7.4f %s\n", 
-           local_id+1, aname.c_str(), atm.x, atm.y, atm.z,
+           local_id+1, aname.c_str(), pos[0], pos[1], pos[2],
            type, atm.residue+1, rname.c_str(), res.resid, atm.charge, bb);
     }
 
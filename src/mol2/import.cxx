@@ -170,9 +170,10 @@ SystemPtr iterator::next() {
                     Id atmid = mol->addAtom(residue_id);
                     auto& atm = mol->atomFAST(atmid);
                     atm.name = name;
-                    atm.x = x;
-                    atm.y = y;
-                    atm.z = z;
+                    double* pos = mol->atomPosFAST(atmid);
+                    pos[0] = x;
+                    pos[1] = y;
+                    pos[2] = z;
                     atm.charge = q;
                     char* dot = strchr(type, '.');
                     if (dot) *dot='\0';
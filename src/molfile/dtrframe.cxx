@@ -6,6 +6,7 @@
 #include <stdlib.h>
 #include <vector>
 #include <set>
+#include <memory>
 #include "../types.hxx"
 
 #if defined __has_include
@@ -347,6 +348,19 @@ desres::molfile::dtr::ParseFrame(size_t sz, const void* data, bool *swap, void**
     return map;
 }
 
+bool desres::molfile::dtr::DecompressFrame(std::vector<char>& buf) {
+    bool swap = false;
+    void* allocated = nullptr;
+    KeyMap map = ParseFrame(buf.size(), buf.data(), &swap, &allocated);
+    std::shared_ptr<void> dtor(allocated, free);
+    if (!allocated || swap) return false;
+    void* frame = nullptr;
+    size_t sz = ConstructFrame(map, &frame, false);
+    std::shared_ptr<void> fdtor(frame, free);
+    buf.assign((const char*)frame, (const char*)frame + sz);
+    return true;
+}
+
 const char* Key::type_name(int type) {
     return typenames[type];
 }
@@ -2,6 +2,7 @@
 #define desres_msys_dtr_frame_hxx
 
 #include <map>
+#include <vector>
 #include <string>
 #include <stdint.h>
 
@@ -60,6 +61,12 @@ namespace desres { namespace molfile { namespace dtr {
     size_t ConstructFrame(KeyMap const& map, void ** bufptr, bool use_padding = true,
             double coordinate_precision=0);
 
+    // If the frame in buf holds compressed positions, replace it with an
+    // equivalent frame holding uncompressed POSITION and return true.
+    // Frames without compressed positions, and frames in non-native byte
+    // order, are left as they are.
+    bool DecompressFrame(std::vector<char>& buf);
+
     uint32_t fletcher( const uint16_t *data, unsigned len );
 
 }}}
@@ -62,6 +62,10 @@ using namespace desres::molfile::dtr;
 #include <iostream>
 #include <fstream>
 #include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/stat.h>
@@ -70,6 +74,7 @@ using namespace desres::molfile::dtr;
 
 #include "vmddir.h"
 #include "../types.hxx"
+#include "../parallel.hxx"
 
 
 #define BOOST_FILESYSTEM_VERSION 3
@@ -95,6 +100,7 @@ const char * desres::molfile::dtr_serialized_version() {
 static const char s_sep = '/';
 
 #include <netinet/in.h> /* for htonl */
+#include <sys/mman.h>
 #if defined(_AIX)
 #include <fcntl.h>
 #else
@@ -657,6 +663,7 @@ bool StkReader::read_stk_cache_file(const std::string &cachepath, bool verbose)
 
 void StkReader::init(int* changed) {
 
+    stop_prefetch();
     curframeset=0;
     if (changed) {
         *changed = 0;
@@ -1022,6 +1029,18 @@ ssize_t StkReader::size() const {
 }
 
 bool StkReader::next(molfile_timestep_t *ts) {
+  if (readahead() && ts) {
+    while (curframeset < framesets.size() && 
+           framesets[curframeset]->curframe() >= framesets[curframeset]->size()) {
+      ++curframeset;
+    }
+    if (curframeset == framesets.size()) return false;
+    ssize_t n = framesets[curframeset]->curframe();
+    for (size_t i=0; i<curframeset; i++) n += framesets[i]->size();
+    framesets[curframeset]->next(NULL);
+    read_prefetched(n, ts);
+    return true;
+  }
   int rc=false;
   while (curframeset < framesets.size() && 
          (rc=framesets[curframeset]->next(ts))==false) {
@@ -1046,7 +1065,15 @@ dtr::KeyMap StkReader::frame(ssize_t n, molfile_timestep_t *ts,
   return comp->frame(n, ts, bufptr);
 }
 
+dtr::KeyMap StkReader::mapped_frame(ssize_t n, molfile_timestep_t *ts,
+                                    std::shared_ptr<const void>* mapping) const {
+  const DtrReader *comp = component(n);
+  if (!comp) DTR_FAILURE("Bad frame index " << n);
+  return comp->mapped_frame(n, ts, mapping);
+}
+
 StkReader::~StkReader() {
+  stop_prefetch();
   for (size_t i=0; i<framesets.size(); i++) 
     delete framesets[i];
 }
@@ -1061,6 +1088,7 @@ void DtrReader::initWithTimekeys(Timekeys const& tk) {
 }
 
 void DtrReader::init(int* changed) {
+  stop_prefetch();
   keys.init(path());
   if (changed) *changed=1;
   init_common();
@@ -1674,7 +1702,11 @@ bool DtrReader::next(molfile_timestep_t *ts) {
   }
   ssize_t iframe = m_curframe;
   ++m_curframe;
-  frame(iframe, ts);
+  if (readahead()) {
+    read_prefetched(iframe, ts);
+  } else {
+    frame(iframe, ts);
+  }
   return true;
 }
 
@@ -1684,10 +1716,249 @@ namespace {
         FdCloser(int fd) : _fd(fd) {}
         ~FdCloser() { if (_fd>=0) close(_fd); }
     };
+
+    void pread_fully(int fd, char* ptr, ssize_t size, off_t offset,
+                     std::string const& fname) {
+        ssize_t nread = 0;
+        while (nread < size) {
+            auto rc = pread(fd, ptr+nread, size-nread, offset+nread);
+            if (rc <= 0) {
+                DTR_FAILURE("Error reading " << fname << " with offset " << offset << " size " << size << ": " << strerror(errno));
+            }
+            nread += rc;
+        }
+    }
+}
+
+void DtrReader::read_frame_bytes(ssize_t iframe, std::vector<char>& buf,
+                                 int* fdcache, std::string* pathcache) const {
+    if (iframe<0 || ((size_t)iframe)>=keys.full_size()) {
+        DTR_FAILURE("dtr " << dtr << " has no frame " << iframe << ": nframes=" << keys.full_size());
+    }
+    key_record_t key = keys[iframe];
+    buf.resize(key.size());
+    std::string fname=::framefile(dtr, iframe, framesperfile());
+    int fd = fdcache ? *fdcache : -1;
+    if (fd>=0 && *pathcache != fname) {
+        close(fd);
+        fd = *fdcache = -1;
+    }
+    if (fd<0) {
+        fd = open(fname.c_str(), O_RDONLY|O_BINARY);
+        if (fd<0) {
+            DTR_FAILURE("Error opening " << fname << ": " << strerror(errno));
+        }
+        if (fdcache) {
+            *fdcache = fd;
+            *pathcache = fname;
+        }
+    }
+    FdCloser _(fdcache ? -1 : fd);
+    pread_fully(fd, buf.data(), buf.size(), key.offset(), fname);
+}
+
+/* Reads the raw bytes of frames [start, end) of a FrameSetReader into a
+ * ring of depth buffers, on nthreads background threads.  Thread k
+ * handles frames start+k, start+k+nthreads, ..., decompressing any
+ * compressed positions after reading. */
+class desres::molfile::FramePrefetcher {
+    struct slot_t {
+        std::vector<char> bytes;
+        ssize_t frame = -1;     /* frame held by this slot, once ready */
+    };
+
+    const FrameSetReader* _reader;
+    const ssize_t _start, _end;
+    std::vector<slot_t> _slots;
+
+    std::mutex _mtx;
+    std::condition_variable _cv;
+    ssize_t _consumed;      /* frames before _consumed have been taken */
+    bool _stop = false;
+    std::vector<char> _done;   /* per-thread: no more frames coming */
+    std::vector<std::exception_ptr> _errs;  /* per-thread: why it stopped */
+    std::vector<std::thread> _threads;
+
+    /* A multiple of nthreads, so that each slot is only ever filled by
+     * the same thread, even when frames are skipped. */
+    static unsigned slot_count(unsigned depth, unsigned nthreads) {
+        nthreads = std::max(1u, nthreads);
+        depth = std::max(depth, nthreads);
+        return nthreads * ((depth + nthreads - 1) / nthreads);
+    }
+
+    void run(unsigned k) {
+        int fd = -1;
+        std::string path;
+        const ssize_t nthreads = _threads.size();
+        for (ssize_t i=_start+k; i<_end; i+=nthreads) {
+            {
+                std::unique_lock<std::mutex> lock(_mtx);
+                _cv.wait(lock, [&] {
+                    return _stop || i - _consumed < (ssize_t)_slots.size(); });
+                if (_stop) break;
+            }
+            slot_t& slot = _slots[(i-_start) % _slots.size()];
+            std::exception_ptr err;
+            try {
+                ssize_t local = i;
+                const DtrReader* comp = _reader->component(local);
+                if (!comp) DTR_FAILURE("Bad frame index " << i);
+                comp->read_frame_bytes(local, slot.bytes, &fd, &path);
+                dtr::DecompressFrame(slot.bytes);
+            } catch (...) {
+                err = std::current_exception();
+            }
+            {
+                std::lock_guard<std::mutex> lock(_mtx);
+                if (err) _errs[k] = err;
+                else slot.frame = i;
+            }
+            if (err) break;
+            _cv.notify_all();
+        }
+        if (fd>=0) close(fd);
+        {
+            std::lock_guard<std::mutex> lock(_mtx);
+            _done[k] = true;
+        }
+        _cv.notify_all();
+    }
+
+public:
+    FramePrefetcher(const FrameSetReader* reader, ssize_t start,
+                    unsigned depth, unsigned nthreads)
+    : _reader(reader), _start(start), _end(reader->size()),
+      _slots(slot_count(depth, nthreads)), _consumed(start),
+      _done(std::max(1u, nthreads)), _errs(_done.size()),
+      _threads(_done.size()) {
+        try {
+            for (unsigned k=0; k<_threads.size(); k++) {
+                _threads[k] = std::thread(&FramePrefetcher::run, this, k);
+            }
+        } catch (...) {
+            stop();
+            throw;
+        }
+    }
+
+    ~FramePrefetcher() { stop(); }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(_mtx);
+            _stop = true;
+        }
+        _cv.notify_all();
+        for (auto& t : _threads) if (t.joinable()) t.join();
+    }
+
+    /* true if frame n is still to come.  Called only by the consumer,
+     * which is the only writer of _consumed. */
+    bool covers(ssize_t n) const { return n >= _consumed && n < _end; }
+
+    /* Swap the bytes of frame n into buf, discarding any frames before
+     * it that were not taken.  Rethrows the error that stopped the
+     * thread reading frame n, if it stopped before reaching it. */
+    void take(ssize_t n, std::vector<char>& buf) {
+        std::unique_lock<std::mutex> lock(_mtx);
+        if (_consumed < n) {
+            /* release the slots of skipped frames to the readers */
+            _consumed = n;
+            _cv.notify_all();
+        }
+        slot_t& slot = _slots[(n-_start) % _slots.size()];
+        const unsigned k = (n-_start) % _threads.size();
+        _cv.wait(lock, [&] { return slot.frame == n || _done[k]; });
+        if (slot.frame != n) {
+            /* the reader of frame n stopped early; report why */
+            if (_errs[k]) std::rethrow_exception(_errs[k]);
+            DTR_FAILURE("read-ahead stopped before frame " << n);
+        }
+        buf.swap(slot.bytes);
+        _consumed = n+1;
+        lock.unlock();
+        _cv.notify_all();
+    }
+};
+
+FrameSetReader::~FrameSetReader() {
+}
+
+void FrameSetReader::read_frames(ssize_t nframes, const ssize_t* indices,
+                                 float* pos, float* vel, double* box,
+                                 unsigned nthreads) const {
+    if (nframes<=0) return;
+    if (vel && !has_velocities()) {
+        DTR_FAILURE("velocities requested from " << dtr << ", which has none");
+    }
+    const uint64_t stride = 3*uint64_t(natoms());
+
+    /* per-thread frame file descriptor and decompression space */
+    struct scratch_t {
+        std::vector<char> bytes;
+        int fd = -1;
+        std::string path;
+        void* allocated = nullptr;
+        ~scratch_t() {
+            if (fd>=0) close(fd);
+            free(allocated);
+        }
+    };
+
+    desres::msys::parallel_chunks(nframes, nthreads,
+            [&](unsigned, uint64_t b, uint64_t e) {
+        scratch_t scratch;
+        molfile_timestep_t ts;
+        memset(&ts, 0, sizeof(ts));
+        for (uint64_t i=b; i<e; i++) {
+            ssize_t local = indices[i];
+            const DtrReader* comp = local<0 ? NULL : component(local);
+            if (!comp) DTR_FAILURE("Bad frame index " << indices[i]);
+            comp->read_frame_bytes(local, scratch.bytes,
+                                   &scratch.fd, &scratch.path);
+            ts.coords = pos + i*stride;
+            ts.velocities = vel ? vel + i*stride : NULL;
+            comp->parse_frame(scratch.bytes.data(), scratch.bytes.size(),
+                              &ts, &scratch.allocated);
+            if (box) memcpy(box+9*i, ts.unit_cell, sizeof(ts.unit_cell));
+        }
+    });
+}
+
+void FrameSetReader::set_readahead(unsigned depth, unsigned nthreads) {
+    stop_prefetch();
+    _readahead = depth;
+    _readahead_threads = nthreads ? nthreads
+                                  : desres::msys::default_thread_count();
+}
+
+void FrameSetReader::stop_prefetch() {
+    _prefetch.reset();
+}
+
+void FrameSetReader::read_prefetched(ssize_t n, molfile_timestep_t *ts) {
+    if (!_prefetch || !_prefetch->covers(n)) {
+        _prefetch.reset();
+        _prefetch.reset(new FramePrefetcher(this, n, _readahead,
+                                                _readahead_threads));
+    }
+    _prefetch->take(n, _prefetched);
+    ssize_t local = n;
+    const DtrReader* comp = component(local);
+    if (!comp) DTR_FAILURE("Bad frame index " << n);
+    if (ts) ts->physical_time = comp->keys[local].time();
+    comp->frame_from_bytes(_prefetched.data(), _prefetched.size(), ts);
 }
 
 dtr::KeyMap DtrReader::frame(ssize_t iframe, molfile_timestep_t *ts, void ** bufptr) const {
 
+    if ((_access & MappedAccess) && !bufptr) {
+        std::shared_ptr<const void> mapping;
+        mapped_frame(iframe, ts, &mapping);
+        return KeyMap();
+    }
+
     if (iframe<0 || ((size_t)iframe)>=keys.full_size()) {
         DTR_FAILURE("dtr " << dtr << " has no frame " << iframe << ": nframes=" << keys.full_size());
     }
@@ -1712,7 +1983,7 @@ dtr::KeyMap DtrReader::frame(ssize_t iframe, molfile_timestep_t *ts, void ** buf
     /* get file descriptor for framefile */
     std::string fname=::framefile(dtr, iframe, framesperfile());
     int fd = -1;
-    if (_access==RandomAccess) {
+    if (!(_access & SequentialAccess)) {
         fd = open(fname.c_str(), O_RDONLY|O_BINARY);
     } else { // SequentialAccess
         if (_last_path != fname) {
@@ -1732,18 +2003,14 @@ dtr::KeyMap DtrReader::frame(ssize_t iframe, molfile_timestep_t *ts, void ** buf
      * unless it's being cached as _last_fd. */
     FdCloser _(fd==_last_fd ? -1 : fd);
 
-    ssize_t nread = 0;
-    char* ptr = (char *)buffer;
-
-    while (nread < framesize) {
-        auto rc = pread(fd, ptr+nread, framesize-nread, offset+nread);
-        if (rc <= 0) {
-            std::string err = strerror(errno);
+    try {
+        pread_fully(fd, (char *)buffer, framesize, offset, fname);
+    } catch (std::exception&) {
+        if (fd==_last_fd) {
             close(fd);
             _last_fd=0;
-            DTR_FAILURE("Error reading " << fname << " with offset " << offset << " size " << framesize << ": " << strerror(errno));
         }
-        nread += rc;
+        throw;
     }
     KeyMap map = frame_from_bytes(buffer, framesize, ts);
 
@@ -1754,11 +2021,129 @@ dtr::KeyMap DtrReader::frame(ssize_t iframe, molfile_timestep_t *ts, void ** buf
     return map;
 }
 
+namespace {
+#ifndef DESRES_WIN32
+    /* A read-only mapping of len bytes of a file.  Reading pages beyond
+     * the end of the file raises SIGBUS, so frame files must not be
+     * truncated while mapped. */
+    struct FileMapping {
+        void* addr = MAP_FAILED;
+        size_t len = 0;
+        std::string path;
+
+        FileMapping(int fd, off_t offset, size_t n, std::string const& fname)
+        : path(fname) {
+            if (n==0) return;
+            addr = mmap(NULL, n, PROT_READ, MAP_SHARED, fd, offset);
+            if (addr==MAP_FAILED) {
+                DTR_FAILURE("Error mapping " << fname << " with offset " << offset << " size " << n << ": " << strerror(errno));
+            }
+            len = n;
+        }
+        ~FileMapping() {
+            if (addr!=MAP_FAILED) munmap(addr, len);
+        }
+        const char* data() const { return (const char *)addr; }
+    };
+#else
+    /* No mmap; read the requested bytes into memory instead. */
+    struct FileMapping {
+        std::vector<char> buf;
+        size_t len = 0;
+        std::string path;
+
+        FileMapping(int fd, off_t offset, size_t n, std::string const& fname)
+        : buf(n), len(n), path(fname) {
+            size_t nread = 0;
+            while (nread < n) {
+                auto rc = pread(fd, &buf[nread], n-nread, offset+nread);
+                if (rc <= 0) {
+                    DTR_FAILURE("Error reading " << fname << " with offset " << offset << " size " << n << ": " << strerror(errno));
+                }
+                nread += rc;
+            }
+        }
+        const char* data() const { return buf.data(); }
+    };
+#endif
+
+    /* Keeps alive whatever a mapped frame's KeyMap points into. */
+    struct MappedFrame {
+        std::shared_ptr<FileMapping> map;
+        void* allocated = nullptr;  /* decompressed positions */
+        ~MappedFrame() { free(allocated); }
+    };
+}
+
+dtr::KeyMap DtrReader::mapped_frame(ssize_t iframe, molfile_timestep_t *ts,
+                                    std::shared_ptr<const void>* mapping) const {
+
+    if (iframe<0 || ((size_t)iframe)>=keys.full_size()) {
+        DTR_FAILURE("dtr " << dtr << " has no frame " << iframe << ": nframes=" << keys.full_size());
+    }
+    key_record_t key = keys[iframe];
+    uint64_t offset = key.offset();
+    uint64_t framesize = key.size();
+    if (ts) ts->physical_time = key.time();
+
+    std::string fname=::framefile(dtr, iframe, framesperfile());
+    auto frame = std::make_shared<MappedFrame>();
+    const char* bytes = nullptr;
+
+    if (_access & SequentialAccess) {
+        /* map the whole frame file, and keep the mapping for subsequent
+         * frames from the same file.  Remap if the file has grown. */
+        auto map = std::static_pointer_cast<FileMapping>(_last_map);
+        if (!map || map->path != fname || offset+framesize > map->len) {
+            _last_map.reset();
+            map.reset();
+            int fd = open(fname.c_str(), O_RDONLY|O_BINARY);
+            if (fd<0) {
+                DTR_FAILURE("Error opening " << fname << ": " << strerror(errno));
+            }
+            FdCloser _(fd);
+            struct stat statbuf;
+            if (fstat(fd, &statbuf)!=0) {
+                DTR_FAILURE("Error reading size of " << fname << ": " << strerror(errno));
+            }
+            if ((uint64_t)statbuf.st_size < offset+framesize) {
+                DTR_FAILURE("Frame file " << fname << " has size " << statbuf.st_size << ", too small to hold frame at offset " << offset << " size " << framesize);
+            }
+            map = std::make_shared<FileMapping>(fd, 0, statbuf.st_size, fname);
+            _last_map = map;
+        }
+        frame->map = map;
+        bytes = map->data() + offset;
+
+    } else {
+        /* map just the pages holding this frame */
+        static const uint64_t pagesize = sysconf(_SC_PAGESIZE);
+        uint64_t start = offset - offset % pagesize;
+        int fd = open(fname.c_str(), O_RDONLY|O_BINARY);
+        if (fd<0) {
+            DTR_FAILURE("Error opening " << fname << ": " << strerror(errno));
+        }
+        FdCloser _(fd);
+        frame->map = std::make_shared<FileMapping>(fd, start,
+                offset-start+framesize, fname);
+        bytes = frame->map->data() + (offset-start);
+    }
+
+    KeyMap map = parse_frame(bytes, framesize, ts, &frame->allocated);
+    *mapping = frame;
+    return map;
+}
+
 KeyMap DtrReader::frame_from_bytes(const void *buf, uint64_t len, 
                                 molfile_timestep_t *ts) const {
+    return parse_frame(buf, len, ts, &decompressed_data);
+}
+
+KeyMap DtrReader::parse_frame(const void *buf, uint64_t len, 
+                              molfile_timestep_t *ts, void** allocated) const {
 
     bool swap;
-    KeyMap blobs = ParseFrame(len, buf, &swap, &decompressed_data);
+    KeyMap blobs = ParseFrame(len, buf, &swap, allocated);
 
     // We will dispatch to routines based on format, which can be
     // defined in either the meta frame or the frame.
@@ -1829,6 +2214,123 @@ static std::string getcwd() {
     return cwd;
 }
 
+/* Constructs, and compresses positions if requested, DTR frames on a
+ * pool of background threads.  Frames are submitted in serialized,
+ * uncompressed form and handed back in submission order.  After any
+ * frame fails, all further calls to pop() rethrow its error. */
+class desres::molfile::FrameCompressor {
+    struct job_t {
+        double time;
+        double precision;
+        std::shared_ptr<void> frame;
+        uint64_t size;
+        bool done = false;
+    };
+
+    const size_t _max_pending;
+
+    std::mutex _mtx;
+    std::condition_variable _cv;        /* signals the workers */
+    std::condition_variable _done_cv;   /* signals pop() */
+    std::deque<job_t> _jobs;            /* submitted and not yet popped */
+    size_t _next = 0;                   /* first job not yet started */
+    std::exception_ptr _err;
+    bool _stop = false;
+    std::vector<std::thread> _threads;
+
+    void construct(job_t& job) const {
+        bool swap = false;
+        KeyMap map = ParseFrame(job.size, job.frame.get(), &swap);
+        void* frame = nullptr;
+        uint64_t size = ConstructFrame(map, &frame, true, job.precision);
+        job.frame.reset(frame, free);
+        job.size = size;
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(_mtx);
+        for (;;) {
+            _cv.wait(lock, [&] { return _stop || _next < _jobs.size(); });
+            if (_stop) break;
+            /* deque references survive push_back and pop_front of
+             * other elements */
+            job_t& job = _jobs[_next++];
+            lock.unlock();
+            std::exception_ptr err;
+            try {
+                construct(job);
+            } catch (...) {
+                err = std::current_exception();
+            }
+            lock.lock();
+            if (err && !_err) _err = err;
+            job.done = true;
+            _done_cv.notify_all();
+        }
+    }
+
+public:
+    explicit FrameCompressor(unsigned nthreads)
+    : _max_pending(2*nthreads) {
+        try {
+            for (unsigned i=0; i<nthreads; i++) {
+                _threads.emplace_back(&FrameCompressor::run, this);
+            }
+        } catch (...) {
+            stop();
+            throw;
+        }
+    }
+
+    ~FrameCompressor() { stop(); }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(_mtx);
+            _stop = true;
+        }
+        _cv.notify_all();
+        for (auto& t : _threads) if (t.joinable()) t.join();
+    }
+
+    /* Queue a serialized frame to be constructed with the given
+     * coordinate precision, taking ownership of the malloc'ed frame. */
+    void submit(double time, void* frame, uint64_t size, double precision) {
+        std::shared_ptr<void> ptr(frame, free);
+        {
+            std::lock_guard<std::mutex> lock(_mtx);
+            _jobs.emplace_back();
+            _jobs.back().time = time;
+            _jobs.back().precision = precision;
+            _jobs.back().frame = ptr;
+            _jobs.back().size = size;
+        }
+        _cv.notify_one();
+    }
+
+    /* Remove the oldest frame if it is ready, or wait for it if wait is
+     * true or too many frames are pending.  Returns false if there is
+     * no frame to remove. */
+    bool pop(bool wait, double* time, std::shared_ptr<void>* frame,
+             uint64_t* size) {
+        std::unique_lock<std::mutex> lock(_mtx);
+        if (_err) std::rethrow_exception(_err);
+        if (_jobs.empty()) return false;
+        job_t& job = _jobs.front();
+        if (!job.done) {
+            if (!wait && _jobs.size() <= _max_pending) return false;
+            _done_cv.wait(lock, [&] { return job.done; });
+            if (_err) std::rethrow_exception(_err);
+        }
+        *time = job.time;
+        *frame = job.frame;
+        *size = job.size;
+        _jobs.pop_front();
+        --_next;
+        return true;
+    }
+};
+
 DtrWriter::DtrWriter(std::string const& path, Type type, uint32_t natoms_, 
               Mode mode, uint32_t fpf, const dtr::KeyMap* metap, double precision)
 : traj_type(type), natoms(natoms_), frame_fd(0), framefile_offset(0),
@@ -1996,6 +2498,7 @@ DtrWriter::DtrWriter(std::string const& path, Type type, uint32_t natoms_,
 
 
 void DtrWriter::truncate(double t) {
+    write_compressed(true);
     rewind(timekeys_file);
     key_prologue_t prologue[1];
     key_record_t record[1];
@@ -2029,7 +2532,38 @@ void DtrWriter::truncate(double t) {
 }
 
 
+void DtrWriter::set_compression_threads(unsigned nthreads) {
+    write_compressed(true);
+    compressor.reset();
+    if (nthreads>0) {
+        compressor.reset(new FrameCompressor(nthreads));
+    }
+}
+
+void DtrWriter::write_compressed(bool wait_all) {
+    if (compress_error) std::rethrow_exception(compress_error);
+    if (!compressor) return;
+    double time;
+    std::shared_ptr<void> frame;
+    uint64_t size;
+    try {
+        while (compressor->pop(wait_all, &time, &frame, &size)) {
+            write_frame(time, frame.get(), size);
+        }
+    } catch (...) {
+        /* keep the error, dropping any frames still pending */
+        compress_error = std::current_exception();
+        compressor.reset();
+        throw;
+    }
+}
+
 int DtrWriter::sync() {
+    write_compressed(true);
+    return sync_files();
+}
+
+int DtrWriter::sync_files() {
     int frc, trc;
     if (timekeys_file) fflush(timekeys_file);
 #if defined(_MSC_VER)
@@ -2120,6 +2654,7 @@ void DtrWriter::write_metadata(KeyMap const& map) {
 
 void DtrWriter::append(double time, KeyMap const& map) {
 
+    if (compress_error) std::rethrow_exception(compress_error);
     uint64_t framesize = 0;
 
     if (!meta_written) {
@@ -2238,15 +2773,26 @@ void DtrWriter::append(double time, KeyMap const& map) {
 	KeyMap etr_map;
 	etr_map["_D"] = dtr::Key(etr_frame_buffer, etr_frame_size, desres::molfile::dtr::Key::TYPE_CHAR, false);
 	framesize = ConstructFrame(etr_map, &framebuffer, false);
+    } else if (compressor) {
+        /* copy the frame now, and construct it in the background */
+        void* raw = nullptr;
+        framesize = ConstructFrame(map, &raw, false);
+        compressor->submit(time, raw, framesize, coordinate_precision);
+        write_compressed(false);
+        return;
     } else {
 	framesize = ConstructFrame(map, &framebuffer, true, coordinate_precision);
     }
+    write_frame(time, framebuffer, framesize);
+}
+
+void DtrWriter::write_frame(double time, const void* buf, uint64_t framesize) {
 
     uint64_t keys_in_file = nwritten % frames_per_file;
 
     if (!keys_in_file) {
       if (frame_fd>0) {
-          sync();
+          sync_files();
           ::close(frame_fd);
       }
       framefile_offset = 0;
@@ -2256,7 +2802,7 @@ void DtrWriter::append(double time, KeyMap const& map) {
     }
 
     // write the data to disk
-    write_all( frame_fd, (const char *)framebuffer, framesize );
+    write_all( frame_fd, (const char *)buf, framesize );
 
     // add an entry to the keyfile list
     key_record_t timekey;
@@ -2276,11 +2822,23 @@ void DtrWriter::append(double time, KeyMap const& map) {
 }
 
 DtrWriter::~DtrWriter() {
-    close();
+    /* errors are reported only by an explicit close() */
+    try {
+        close();
+    } catch (std::exception&) {
+    }
 }
 
 void DtrWriter::close() {
-  sync();
+  /* write out frames still being constructed, but close files regardless */
+  std::exception_ptr err;
+  try {
+      write_compressed(true);
+  } catch (...) {
+      err = std::current_exception();
+  }
+  compressor.reset();
+  sync_files();
   if (frame_fd>0) ::close(frame_fd);
   if (timekeys_file) fclose(timekeys_file);
   if (meta_file) fclose(meta_file);
@@ -2294,6 +2852,7 @@ void DtrWriter::close() {
   framebuffer=nullptr;
   etr_key_buffer=nullptr;
   etr_frame_buffer=nullptr;
+  if (err) std::rethrow_exception(err);
 }
 
 /* Write out the size and then the bytes */
@@ -2541,9 +3100,12 @@ open_file_read( const char *filename, const char *filetype, int *natoms ) {
 
   FrameSetReader *h = NULL;
 
+  unsigned access = DtrReader::SequentialAccess;
+  if (getenv("DTRPLUGIN_MMAP")) access |= DtrReader::MappedAccess;
+
   // check for .stk file
   if (StkReader::recognizes(filename)) {
-    h = new StkReader(filename, DtrReader::SequentialAccess);
+    h = new StkReader(filename, access);
 
   } else {
     // check for "clickme.dtr"
@@ -2553,7 +3115,13 @@ open_file_read( const char *filename, const char *filetype, int *natoms ) {
       fname.resize(pos);
       filename = fname.c_str();
     }
-    h = new DtrReader(fname, DtrReader::SequentialAccess);
+    h = new DtrReader(fname, access);
+  }
+
+  const char* readahead = getenv("DTRPLUGIN_READAHEAD");
+  if (readahead && atoi(readahead) > 0) {
+    const char* threads = getenv("DTRPLUGIN_READAHEAD_THREADS");
+    h->set_readahead(atoi(readahead), threads ? std::max(0, atoi(threads)) : 1);
   }
 
   try {
@@ -84,6 +84,7 @@ typedef int mode_t;
 #include <string>
 #include <stdexcept>
 #include <memory>
+#include <exception>
 #include <cmath>
 
 #include "dtrframe.hxx"
@@ -167,13 +168,36 @@ namespace desres { namespace molfile {
   };
 
   class DtrReader;
+  class FramePrefetcher;
 
   class FrameSetReader {
+    unsigned _readahead = 0;
+    unsigned _readahead_threads = 1;
+    std::shared_ptr<FramePrefetcher> _prefetch;
+    std::vector<char> _prefetched;
+
   protected:
     std::string dtr;
 
+    // read frame n into ts using the read-ahead buffers.  Frames are
+    // expected to be requested in increasing order.
+    void read_prefetched(ssize_t n, molfile_timestep_t *ts);
+
+    // stop any read-ahead in progress, e.g. before reloading timekeys.
+    void stop_prefetch();
+
   public:
-    virtual ~FrameSetReader() {}
+    virtual ~FrameSetReader();
+
+    // Read up to depth frames ahead of next() on nthreads background
+    // threads (0 for the default number), so that frame i/o overlaps
+    // with processing by the caller.  The raw frame bytes are read
+    // ahead, and compressed positions are decompressed by the background
+    // threads; the rest of each frame is parsed into the timestep by
+    // next().  A depth of 0 (the default) disables read-ahead.
+    void set_readahead(unsigned depth, unsigned nthreads = 1);
+    unsigned readahead() const { return _readahead; }
+    unsigned readahead_threads() const { return _readahead_threads; }
 
     virtual bool has_velocities() const = 0;
 
@@ -214,9 +238,32 @@ namespace desres { namespace molfile {
     virtual dtr::KeyMap frame(ssize_t n, molfile_timestep_t *ts,
                               void ** bufptr = NULL) const = 0;
 
+    // read a specified frame through a read-only memory mapping of its
+    // frame file, without copying it.  The returned KeyMap points into 
+    // the mapping, which stays valid for as long as *mapping (or a copy
+    // of it) is held.  ts may be NULL.  Fields of frames whose endianism
+    // differs from the host must still be read through Key::get.
+    // Readers which cannot map frames return an empty KeyMap and leave
+    // *mapping empty, as this default does; use frame() instead.
+    virtual dtr::KeyMap mapped_frame(ssize_t n, molfile_timestep_t *ts,
+                                     std::shared_ptr<const void>* mapping) const {
+        mapping->reset();
+        return dtr::KeyMap();
+    }
+
     // read up to count times beginning at index start into the provided space;
     // return the number of times actually read.
     virtual ssize_t times(ssize_t start, ssize_t count, double * times) const = 0;
+
+    // read the nframes frames with the given indices, which need not be
+    // sorted or distinct.  Positions go to pos as nframes x natoms x 3;
+    // if supplied, velocities go to vel in the same layout and unit
+    // cells to box as nframes x 9.  Frames are split into contiguous
+    // runs read and decoded by up to nthreads threads (0 for the default
+    // number).  Reentrant; does not affect the position of next().
+    void read_frames(ssize_t nframes, const ssize_t* indices,
+                     float* pos, float* vel = NULL, double* box = NULL,
+                     unsigned nthreads = 0) const;
   };
 
   class metadata {
@@ -271,10 +318,18 @@ namespace desres { namespace molfile {
 
     mutable void* decompressed_data = nullptr;
 
+    // if doing SequentialAccess, the mapping of the last frame file
+    // used by mapped_frame().
+    mutable std::shared_ptr<void> _last_map;
+
   public:
     enum {
         RandomAccess
       , SequentialAccess    /* WARNING: MAKES frame() NOT REENTRANT */
+      , MappedAccess = 2    /* may be or'ed with either of the above: frame()
+                               reads through an mmap of the frame file
+                               rather than copying the frame into memory
+                               when no buffer is supplied. */
     };
 
     // initializing 
@@ -301,6 +356,7 @@ namespace desres { namespace molfile {
     }
 
     virtual ~DtrReader() {
+      stop_prefetch();
       if (_last_fd>0) close(_last_fd);
       free(decompressed_data);
     }
@@ -352,13 +408,33 @@ namespace desres { namespace molfile {
     virtual dtr::KeyMap frame(ssize_t n, molfile_timestep_t *ts,
                               void ** bufptr = NULL) const;
 
+    /* With SequentialAccess, the whole frame file is mapped once and
+     * shared by successive frames from the same file; with RandomAccess,
+     * only the pages holding the frame are mapped and this method is
+     * reentrant. */
+    virtual dtr::KeyMap mapped_frame(ssize_t n, molfile_timestep_t *ts,
+                                     std::shared_ptr<const void>* mapping) const;
+
     // path for frame at index.  Empty string on not found.
     std::string framefile(ssize_t n) const;
 
+    // read the raw bytes of frame n into buf.  If fd and path are 
+    // supplied, they cache the open frame file between calls and must
+    // be initialized to -1 and "" and eventually closed by the caller.
+    // Reentrant when no cache is supplied.
+    void read_frame_bytes(ssize_t n, std::vector<char>& buf,
+                          int* fd = NULL, std::string* path = NULL) const;
+
     // parse a frame from supplied bytes
     dtr::KeyMap frame_from_bytes( const void *buf, uint64_t len,
                              molfile_timestep_t *ts ) const;
 
+    // as frame_from_bytes, but decompressed fields are realloc'ed into
+    // *allocated, which the caller must free, rather than into storage
+    // owned by the reader.  Reentrant.
+    dtr::KeyMap parse_frame( const void *buf, uint64_t len,
+                             molfile_timestep_t *ts, void** allocated ) const;
+
     std::ostream& dump(std::ostream &out) const;
     std::istream& load_v8(std::istream &in);
     const std::string get_path() {
@@ -366,6 +442,8 @@ namespace desres { namespace molfile {
     }
   };
 
+  class FrameCompressor;
+
   struct DtrWriter {
     enum class Type {
 	DTR,
@@ -398,6 +476,12 @@ namespace desres { namespace molfile {
     void *etr_frame_buffer;
     uint32_t *etr_key_buffer;
     double coordinate_precision = 0;
+    std::shared_ptr<FrameCompressor> compressor;
+
+    // first error from writing frames constructed in the background.
+    // Once set, the writer accepts no more frames, and every later
+    // call that writes, including sync() and close(), throws it.
+    std::exception_ptr compress_error;
 
     // initialize for writing at path
     DtrWriter(std::string const& path, Type type, uint32_t natoms_, 
@@ -413,6 +497,16 @@ namespace desres { namespace molfile {
     // write an arbitrary set of keyvals
     void append(double time, dtr::KeyMap const& keyvals);
 
+    // construct, and compress if coordinate_precision > 0, DTR frames on
+    // nthreads background threads, so that next() and append() return
+    // once their input has been copied.  Frames are still written in
+    // order by the calling thread, in later calls to next() or append()
+    // and in sync() and close().  Errors are kept in compress_error and
+    // reported there, and the frames still pending are dropped; the
+    // destructor cannot report them, so call close() to see them.  0 (the
+    // default) constructs frames synchronously.
+    void set_compression_threads(unsigned nthreads);
+
     // commit timekeys current frame file to disk.  0 on success.
     int sync();
 
@@ -423,6 +517,12 @@ namespace desres { namespace molfile {
     void truncate(double after_time);
 
     void write_metadata(dtr::KeyMap const& map);
+
+  private:
+    // write constructed frames to disk
+    void write_frame(double time, const void* buf, uint64_t framesize);
+    void write_compressed(bool wait_all);
+    int sync_files();
   };
 
   class StkReader : public FrameSetReader {
@@ -452,6 +552,8 @@ namespace desres { namespace molfile {
     virtual bool next(molfile_timestep_t *ts);
     virtual dtr::KeyMap frame(ssize_t n, molfile_timestep_t *ts,
                               void ** bufptr = NULL) const;
+    virtual dtr::KeyMap mapped_frame(ssize_t n, molfile_timestep_t *ts,
+                                     std::shared_ptr<const void>* mapping) const;
 
     virtual const DtrReader * component(ssize_t &n) const;
 
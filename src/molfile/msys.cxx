@@ -135,14 +135,10 @@ static int read_next_timestep(void *v, int natoms, molfile_timestep_t *ts) {
     float* fvel = ts->velocities;
     double* dpos = ts->dcoords;
     double* dvel = ts->dvelocities;
-    for (Id i=0, n=mol->atomCount(); i<n; i++) {
-        Float* pos = &mol->atomFAST(i).x;
-        Float* vel = &mol->atomFAST(i).vx;
-        if (fpos) std::copy(pos, pos+3, fpos+3*i);
-        if (fvel) std::copy(vel, vel+3, fvel+3*i);
-        if (dpos) std::copy(pos, pos+3, dpos+3*i);
-        if (dvel) std::copy(vel, vel+3, dvel+3*i);
-    }
+    if (fpos) mol->getPositions(fpos);
+    if (fvel) mol->getVelocities(fvel);
+    if (dpos) mol->getPositions(dpos);
+    if (dvel) mol->getVelocities(dvel);
     memcpy(ts->unit_cell, mol->global_cell[0], sizeof(ts->unit_cell));
     return MOLFILE_SUCCESS;
 }
@@ -205,15 +201,10 @@ static int write_timestep(void *v, const molfile_timestep_t *ts) {
     const float* fvel = ts->velocities;
     const double* dpos = ts->dcoords;
     const double* dvel = ts->dvelocities;
-    for (int i=0, n=sys->natoms; i<n; i++) {
-        atom_t& atm = mol->atomFAST(i);
-        Float* pos = &atm.x;
-        Float* vel = &atm.vx;
-        if (fpos)       std::copy(fpos+3*i, fpos+3*(i+1), pos);
-        else if (dpos)  std::copy(dpos+3*i, dpos+3*(i+1), pos);
-        if (fvel)       std::copy(fvel+3*i, fvel+3*(i+1), vel);
-        else if (dvel)  std::copy(dvel+3*i, dvel+3*(i+1), vel);
-    }
+    if (fpos)       mol->setPositions(fpos);
+    else if (dpos)  mol->setPositions(dpos);
+    if (fvel)       mol->setVelocities(fvel);
+    else if (dvel)  mol->setVelocities(dvel);
     try {
         static char* argv[] = {(char *)"vmd", 0};
         unsigned options = SaveOptions::Default;
@@ -10,6 +10,13 @@ OverrideTablePtr OverrideTable::create(ParamTablePtr target) {
     return OverrideTablePtr(new OverrideTable(target));
 }
 
+OverrideTablePtr OverrideTable::snapshot(ParamTablePtr target) const {
+    OverrideTablePtr o = create(target);
+    o->_params = _params->snapshot();
+    for (auto const& p : _map) o->set(p.first, p.second);
+    return o;
+}
+
 void OverrideTable::clear() {
     for (OverrideMap::const_iterator it=_map.begin(); it!=_map.end(); ++it) {
         _target->decref(it->first.first);
@@ -53,6 +53,9 @@ namespace desres { namespace msys {
         /* create an override table */
         static OverrideTablePtr create(ParamTablePtr target);
 
+        /* a copy of this table, overriding target in place of target() */
+        OverrideTablePtr snapshot(ParamTablePtr target) const;
+
         /* default constructor for serialization purposes */
         OverrideTable() {}
 
@@ -0,0 +1,71 @@
+#ifndef desres_msys_parallel_hxx
+#define desres_msys_parallel_hxx
+
+#include "types.hxx"
+#include <thread>
+#include <exception>
+#include <stdlib.h>
+
+namespace desres { namespace msys {
+
+    /* Number of worker threads used when a caller asks for 0 threads.
+     * Honors MSYS_NUM_THREADS if set, otherwise the hardware concurrency. */
+    inline unsigned default_thread_count() {
+        const char* env = getenv("MSYS_NUM_THREADS");
+        if (env) {
+            int n = atoi(env);
+            if (n>0) return n;
+        }
+        unsigned n = std::thread::hardware_concurrency();
+        return n ? n : 1;
+    }
+
+    /* Split [0,n) into at most nthreads contiguous chunks of at least
+     * grain elements each, and call func(chunk, begin, end) for each
+     * chunk on its own thread.  Chunks are numbered in order, so callers
+     * can merge per-chunk results deterministically.  nthreads==0 means
+     * default_thread_count().  Returns the number of chunks used.  The
+     * first exception thrown by any chunk is rethrown after all threads
+     * have been joined. */
+    template <typename Func>
+    unsigned parallel_chunks(uint64_t n, unsigned nthreads, Func func,
+                             uint64_t grain=1) {
+        if (nthreads==0) nthreads = default_thread_count();
+        if (grain==0) grain = 1;
+        uint64_t maxchunks = (n + grain - 1) / grain;
+        unsigned nchunks = std::max<uint64_t>(1, std::min<uint64_t>(nthreads, maxchunks));
+        if (nchunks==1) {
+            func(0u, uint64_t(0), n);
+            return 1;
+        }
+        std::vector<std::thread> threads(nchunks-1);
+        std::vector<std::exception_ptr> errs(nchunks);
+        auto run = [&](unsigned i) {
+            uint64_t b = (n*i)/nchunks;
+            uint64_t e = (n*(i+1))/nchunks;
+            try {
+                func(i, b, e);
+            } catch (...) {
+                errs[i] = std::current_exception();
+            }
+        };
+        try {
+            for (unsigned i=1; i<nchunks; i++) {
+                threads[i-1] = std::thread(run, i);
+            }
+        } catch (...) {
+            // Must join any started threads or we crash
+            for (auto& t : threads) if (t.joinable()) t.join();
+            throw;
+        }
+        run(0);
+        for (auto& t : threads) t.join();
+        for (auto& e : errs) {
+            if (e) std::rethrow_exception(e);
+        }
+        return nchunks;
+    }
+
+}}
+
+#endif
@@ -3,6 +3,8 @@
 #include <sstream>
 #include <string.h>
 #include <cstdio>
+#include <algorithm>
+#include <limits>
 
 using namespace desres::msys;
 
@@ -10,18 +12,28 @@ ParamTablePtr ParamTable::create() {
     return ParamTablePtr(new ParamTable);
 }
 
+ParamTablePtr ParamTable::snapshot() const {
+    ParamTablePtr p = create();
+    for (Property const& prop : _props) {
+        p->_props.push_back(Property());
+        Property& copy = p->_props.back();
+        copy.name = prop.name;
+        copy.type = prop.type;
+        copy.ints = prop.ints;
+        copy.floats = prop.floats;
+        copy.strs = prop.strs;
+        copy.arena = prop.arena;
+    }
+    p->_nrows = _nrows;
+    p->_paramrefs.resize(_paramrefs.size());
+    return p;
+}
+
 ParamTable::ParamTable()
 : _nrows(0)
 {}
 
 ParamTable::~ParamTable() {
-    for (Id i=0; i<_props.size(); i++) {
-        if (_props[i].type==StringType) {
-            ValueList& vals=_props[i].vals;
-            Id j,n = vals.size();
-            for (j=0; j<n; j++) free(vals[j].s);
-        }
-    }
 }
 
 Id ParamTable::propIndex(const String& name) const {
@@ -33,17 +45,45 @@ Id ParamTable::propIndex(const String& name) const {
 }
 
 void ParamTable::Property::update_index() {
-    for (Id i=maxIndexId; i<vals.size(); i++) {
-        ValueRef r(type, vals[i]);
-        index[r].push_back(i);
+    const Id n = size();
+    /* read through const views, so shared blocks are not copied */
+    Property const& p = *this;
+    switch (type) {
+        case IntType:
+            for (Id i=maxIndexId; i<n; i++) int_index[p.ints[i]].push_back(i);
+            break;
+        case FloatType:
+            for (Id i=maxIndexId; i<n; i++) float_index[p.floats[i]].push_back(i);
+            break;
+        default:
+        case StringType:
+            for (Id i=maxIndexId; i<n; i++) str_index[p.strs[i]].push_back(i);
+            break;
     }
-    maxIndexId = vals.size();
+    maxIndexId = n;
 }
 
-void ParamTable::Property::extend() {
-    Value v;
-    memset(&v, 0, sizeof(v));
-    vals.push_back(v);
+void ParamTable::Property::extend(Id n) {
+    switch (type) {
+        case IntType:   ints.append(n, 0); break;
+        case FloatType: floats.append(n, 0); break;
+        default:
+        case StringType: strs.append(n, arena->intern("", 0)); break;
+    }
+}
+
+ParamTable::Property& ParamTable::column(Id col, ValueType type) {
+    return const_cast<Property&>(
+            const_cast<ParamTable const*>(this)->column(col, type));
+}
+
+ParamTable::Property const& ParamTable::column(Id col, ValueType type) const {
+    static const char* names[] = {"Int", "Float", "String"};
+    Property const& prop = _props.at(col);
+    if (prop.type != type) {
+        MSYS_FAIL(names[type] << " values requested for non-" << names[type] << " column");
+    }
+    return prop;
 }
 
 Id ParamTable::addProp( const String& name, ValueType type) {
@@ -60,14 +100,20 @@ Id ParamTable::addProp( const String& name, ValueType type) {
     Property& prop = _props.back();
     prop.name = name;
     prop.type = type;
-    for (Id i=0; i<_nrows; i++) prop.extend();
+    prop.extend(_nrows);
     return _props.size()-1;
 }
 
 Id ParamTable::addParam() {
-    for (Id i=0; i<_props.size(); i++) _props[i].extend();
-    _paramrefs.push_back(0);
-    return _nrows++;
+    return addParams(1);
+}
+
+Id ParamTable::addParams(Id n) {
+    for (Id i=0; i<_props.size(); i++) _props[i].extend(n);
+    _paramrefs.resize(_paramrefs.size()+n);
+    Id first = _nrows;
+    _nrows += n;
+    return first;
 }
 
 void ParamTable::incref(Id p) {
@@ -78,6 +124,20 @@ void ParamTable::incref(Id p) {
     ++_paramrefs[p];
 }
 
+void ParamTable::incref(const Id* params, Id n) {
+    const Id nrefs = _paramrefs.size();
+    for (Id i=0; i<n; i++) {
+        Id p = params[i];
+        if (!bad(p) && p>=nrefs) {
+            MSYS_FAIL("Could not incref param " << p << " in ParamTable of size " << nrefs);
+        }
+    }
+    for (Id i=0; i<n; i++) {
+        Id p = params[i];
+        if (!bad(p)) ++_paramrefs[p];
+    }
+}
+
 void ParamTable::decref(Id p) {
     if (bad(p)) return;
     if (p>=_paramrefs.size()) {
@@ -98,13 +158,14 @@ Id ParamTable::duplicate(Id param) {
     }
     Id dst = addParam();
     for (unsigned i=0; i<_props.size(); i++) {
-        _props[i].vals[dst] = _props[i].vals[param];
-        if (_props[i].type == StringType) {
-            char* s = _props[i].vals[param].s;
-            if (s) s=strdup(s);
-            _props[i].vals[dst].s = s;
+        Property& prop = _props[i];
+        Property const& src = prop;
+        switch (prop.type) {
+            case IntType:   prop.ints[dst] = src.ints[param]; break;
+            case FloatType: prop.floats[dst] = src.floats[param]; break;
+            default:
+            case StringType: prop.strs[dst] = src.strs[param]; break;
         }
-
     }
     return dst;
 }
@@ -123,6 +184,78 @@ int ParamTable::compare(Id L, Id R) {
     return 0;
 }
 
+namespace {
+    inline uint64_t mix(uint64_t h, uint64_t v) {
+        /* splitmix64 finalizer applied to the running hash */
+        h ^= v + 0x9e3779b97f4a7c15ULL + (h<<6) + (h>>2);
+        h ^= h >> 30; h *= 0xbf58476d1ce4e5b9ULL;
+        h ^= h >> 27; h *= 0x94d049bb133111ebULL;
+        return h ^ (h >> 31);
+    }
+
+    /* bits of a float value such that values comparing equal, including
+     * 0.0 and -0.0, have equal bits; all NaNs share one value. */
+    inline uint64_t float_bits(Float f) {
+        if (f==0) f=0;
+        else if (f!=f) f=std::numeric_limits<Float>::quiet_NaN();
+        uint64_t v;
+        memcpy(&v, &f, sizeof(v));
+        return v;
+    }
+}
+
+std::vector<uint64_t> ParamTable::hashParams() const {
+    std::vector<uint64_t> h(_nrows, 0);
+    for (Property const& prop : _props) {
+        Id row = 0;
+        switch (prop.type) {
+            case IntType:
+                prop.ints.forEachBlock([&](const Int* v, Id n) {
+                    for (Id i=0; i<n; i++, row++) h[row] = mix(h[row], v[i]);
+                });
+                break;
+            case FloatType:
+                prop.floats.forEachBlock([&](const Float* v, Id n) {
+                    for (Id i=0; i<n; i++, row++) {
+                        h[row] = mix(h[row], float_bits(v[i]));
+                    }
+                });
+                break;
+            default:
+            case StringType:
+                /* strings in a column are equal iff their pointers are */
+                prop.strs.forEachBlock([&](const char* const* v, Id n) {
+                    for (Id i=0; i<n; i++, row++) {
+                        h[row] = mix(h[row], uintptr_t(v[i]));
+                    }
+                });
+                break;
+        }
+    }
+    return h;
+}
+
+bool ParamTable::equalParams(Id L, Id R) const {
+    if (L==R) return true;
+    for (Property const& prop : _props) {
+        switch (prop.type) {
+            case IntType:
+                if (prop.ints[L]!=prop.ints[R]) return false;
+                break;
+            case FloatType:
+                if (float_bits(prop.floats[L])!=float_bits(prop.floats[R])) {
+                    return false;
+                }
+                break;
+            default:
+            case StringType:
+                if (prop.strs[L]!=prop.strs[R]) return false;
+                break;
+        }
+    }
+    return true;
+}
+
 void ParamTable::delProp(Id index) {
     if (bad(index)) return;
     if (index>=_props.size()) {
@@ -160,13 +293,66 @@ IdList ParamTable::findString(Id col, String const& val) {
     return findValue(col,r);
 }
 
+template <typename K>
+static IdList find_in_index(std::unordered_map<K,IdList> const& index, K key) {
+    auto p = index.find(key);
+    return p==index.end() ? IdList() : p->second;
+}
+
 IdList ParamTable::findValue(Id col, ValueRef const& v) {
     if (col>=_props.size()) {
         MSYS_FAIL("no such column " << col);
     }
     Property& prop = _props[col];
     prop.update_index();
-    Property::Index::iterator p = prop.index.find(v);
-    if (p==prop.index.end()) return IdList();
-    return p->second;
+    /* numeric values match numerically across Int and Float; strings
+     * match only strings. */
+    switch (prop.type) {
+        case IntType:
+            if (v.type()==IntType) {
+                return find_in_index(prop.int_index, v.asInt());
+            } else if (v.type()==FloatType) {
+                Float f = v.asFloat();
+                if (f==Float(Int(f))) return find_in_index(prop.int_index, Int(f));
+            }
+            break;
+        case FloatType:
+            if (v.type()!=StringType) {
+                return find_in_index(prop.float_index, v.asFloat());
+            }
+            break;
+        default:
+        case StringType:
+            if (v.type()==StringType) {
+                /* strings in a column are equal only if their pointers are */
+                const char* s = prop.arena->find(v.c_str(), strlen(v.c_str()));
+                if (s) return find_in_index(prop.str_index, s);
+            }
+            break;
+    }
+    return IdList();
+}
+
+void ParamTable::setIntValues(Id col, Id first, Id n, const Int* vals) {
+    Property& prop = column(col, IntType);
+    if (first>_nrows || n>_nrows-first) MSYS_FAIL("rows out of range");
+    for (Id i=0; i<n; i++) prop.ints[first+i] = vals[i];
+    prop.valueChanged(first);
+}
+
+void ParamTable::setFloatValues(Id col, Id first, Id n, const Float* vals) {
+    Property& prop = column(col, FloatType);
+    if (first>_nrows || n>_nrows-first) MSYS_FAIL("rows out of range");
+    for (Id i=0; i<n; i++) prop.floats[first+i] = vals[i];
+    prop.valueChanged(first);
+}
+
+void ParamTable::setStringValues(Id col, Id first, Id n, const String* vals) {
+    Property& prop = column(col, StringType);
+    if (first>_nrows || n>_nrows-first) MSYS_FAIL("rows out of range");
+    for (Id i=0; i<n; i++) {
+        const char* s = vals[i].c_str();
+        prop.strs[first+i] = prop.arena->intern(s, strlen(s));
+    }
+    prop.valueChanged(first);
 }
@@ -2,60 +2,118 @@
 #define msys_param_table_hxx
 
 #include "value.hxx"
+#include "block_array.hxx"
 #include <deque>
-#include <map>
+#include <vector>
+#include <unordered_map>
 #include <memory>
+#include <stdexcept>
+#include <algorithm>
 #include <string.h>
 
 namespace desres { namespace msys {
 
+    /* Read-only view of a column of a ParamTable */
+    template <typename T>
+    class ColumnView {
+        BlockArray<T> const* _vals;
+    public:
+        explicit ColumnView(BlockArray<T> const& vals) : _vals(&vals) {}
+        Id size() const { return _vals->size(); }
+        T const& operator[](Id i) const { return (*_vals)[i]; }
+
+        /* call f(const T* values, Id count) on contiguous runs of values,
+         * in order */
+        template <typename F>
+        void forEachBlock(F f) const { _vals->forEachBlock(f); }
+    };
+
     /* A ParamTable instance is a table whose rows are indexed by id and whose
-     * columns are named and can have int, float, and string types. */
+     * columns are named and can have int, float, and string types.  Each
+     * column is an array of its type, stored in blocks which are shared
+     * with snapshots of the table.
+     * String values are owned by a StringArena for each column, shared
+     * with snapshots of the table, so equal strings in a column share a
+     * pointer and are freed along with the column. */
     class ParamTable : public std::enable_shared_from_this<ParamTable> {
     
-        /* we use deque so that references to values returned by the value()
-         * method aren't invalidated by later calls to addProp(). */
-        typedef std::deque<Value> ValueList;
-    
         struct Property : public ValueCallback {
             String      name;
             ValueType   type;
-            ValueList   vals;
+
+            /* values; only the vector matching type is used */
+            BlockArray<Int>             ints;
+            BlockArray<Float>           floats;
+            BlockArray<const char*>     strs;
+
+            /* owner of the text in strs */
+            StringArenaPtr              arena;
     
-            /* index on values in this column */
-            typedef std::map<ValueRef, IdList> Index;
-            Index       index;  
+            /* index on values in this column, built on demand */
+            std::unordered_map<Int, IdList>         int_index;
+            std::unordered_map<Float, IdList>       float_index;
+            std::unordered_map<const char*, IdList> str_index;
 
             /* one more than last row indexed */
             Id          maxIndexId;
             
-            /* reindex rows [maxIndexId, vals.size()) */
+            Id size() const {
+                return type==IntType   ? ints.size()
+                     : type==FloatType ? floats.size()
+                     :                   strs.size();
+            }
+
+            /* address of the value in the given row.  Reads go through
+             * the const arrays so that shared blocks are not copied. */
+            virtual const void* valuePtr(Id row) {
+                Property const& p = *this;
+                return type==IntType   ? (const void*)&p.ints.at(row)
+                     : type==FloatType ? (const void*)&p.floats.at(row)
+                     :                   (const void*)&p.strs.at(row);
+            }
+            virtual void* writableValuePtr(Id row) {
+                return type==IntType   ? (void*)&ints.at(row)
+                     : type==FloatType ? (void*)&floats.at(row)
+                     :                   (void*)&strs.at(row);
+            }
+
+            /* reindex rows [maxIndexId, size()) */
             void update_index();
 
-            /* add a new row */
-            void extend();
+            /* add n rows with default values */
+            void extend(Id n=1);
 
-            /* invalidate the entire index */
-            virtual void valueChanged() {
-                index.clear();
-                maxIndexId = 0;
+            /* invalidate the index if it covers the changed row.  Rows
+             * not yet indexed are picked up by the next update_index(). */
+            virtual void valueChanged(Id row) {
+                if (bad(row) || row<maxIndexId) {
+                    int_index.clear();
+                    float_index.clear();
+                    str_index.clear();
+                    maxIndexId = 0;
+                }
             }
 
-            Property() : maxIndexId(0) {}
+            virtual const char* internString(const char* s, size_t sz) {
+                return arena->intern(s, sz);
+            }
+
+            Property() : arena(std::make_shared<StringArena>()), maxIndexId(0) {}
     
             template<class Archive>
             void save(Archive & archive) const {
-                archive(name, type, vals.size());
+                size_t nvals = size();
+                archive(name, type, nvals);
                 switch (type) {
                     default:
                     case IntType:
-                        for (auto& val : vals) archive(val.i);
+                        for (Id i=0; i<nvals; i++) archive(ints[i]);
                         break;
                     case FloatType:
-                        for (auto& val : vals) archive(val.f);
+                        for (Id i=0; i<nvals; i++) archive(floats[i]);
                         break;
                     case StringType:
-                        for (auto& val : vals) archive(std::string(val.s));
+                        for (Id i=0; i<nvals; i++) archive(std::string(strs[i]));
                         break;
                 };
             }
@@ -64,25 +122,27 @@ namespace desres { namespace msys {
                 size_t nvals;
                 std::string s;
                 archive(name, type, nvals);
-                vals.resize(nvals);
+                extend(nvals);
                 switch (type) {
                     default:
                     case IntType:
-                        for (size_t i=0; i<nvals; i++) archive(vals[i].i);
+                        for (size_t i=0; i<nvals; i++) archive(ints[i]);
                         break;
                     case FloatType:
-                        for (size_t i=0; i<nvals; i++) archive(vals[i].f);
+                        for (size_t i=0; i<nvals; i++) archive(floats[i]);
                         break;
                     case StringType:
                         for (size_t i=0; i<nvals; i++) {
                             archive(s);
-                            vals[i].s = strdup(s.data());
+                            strs[i] = arena->intern(s.c_str(), strlen(s.c_str()));
                         }
                         break;
                 };
             }
         };
         
+        /* we use deque so that references to properties aren't
+         * invalidated by later calls to addProp(). */
         typedef std::deque<Property> PropList;
         PropList _props;
     
@@ -92,6 +152,9 @@ namespace desres { namespace msys {
         /* reference count for parameters in this table */
         IdList _paramrefs;
 
+        Property& column(Id col, ValueType type);
+        Property const& column(Id col, ValueType type) const;
+
     public:
         template<class Archive>
         void serialize(Archive & archive) {
@@ -99,6 +162,12 @@ namespace desres { namespace msys {
         }
 
         static std::shared_ptr<ParamTable> create();
+
+        /* a copy of this table, sharing column storage with it until
+         * either one writes to a block of rows.  The copy starts with
+         * no references to its params. */
+        std::shared_ptr<ParamTable> snapshot() const;
+
         ParamTable();
         ~ParamTable();
 
@@ -106,6 +175,10 @@ namespace desres { namespace msys {
         void incref(Id param);
         void decref(Id param);
 
+        /* incref each of n params, after checking that all are valid.
+         * BadId entries are skipped. */
+        void incref(const Id* params, Id n);
+
         /* reference for the given parameter */
         Id refcount(Id param) const {
             return param>=_paramrefs.size() ? 0 : _paramrefs[param];
@@ -113,6 +186,10 @@ namespace desres { namespace msys {
     
         Id paramCount() const { return _nrows; }
         Id addParam();
+
+        /* add n parameters with default values, returning the id of the
+         * first; the new ids are contiguous. */
+        Id addParams(Id n);
         bool hasParam(Id param) const {
             return param<paramCount();
         }
@@ -125,6 +202,15 @@ namespace desres { namespace msys {
          * or greater than those of R, with comparisons performed
          * lexicographically using ValueRef::compare(). */
         int compare(Id L, Id R);
+
+        /* hash of the values of every row, computed a column at a time.
+         * Rows for which equalParams() is true hash equal. */
+        std::vector<uint64_t> hashParams() const;
+
+        /* true if rows L and R hold the same values; equivalent to
+         * compare(L,R)==0 for valid rows, except that NaN equals only
+         * NaN, but without going through ValueRef. */
+        bool equalParams(Id L, Id R) const;
     
         Id propCount() const            { return _props.size();     }
         String propName(Id i) const     { return _props.at(i).name; }
@@ -138,10 +224,9 @@ namespace desres { namespace msys {
         void delProp(Id index);
 
         ValueRef value(Id row, Id col)  { 
-            return ValueRef(
-                    propType(col), 
-                    _props.at(col).vals.at(row),
-                    &_props.at(col));
+            Property& prop = _props.at(col);
+            prop.valuePtr(row);     /* check the row */
+            return ValueRef(prop.type, &prop, row);
         }
         ValueRef value(Id row, String const& name);
 
@@ -159,34 +244,51 @@ namespace desres { namespace msys {
 
         template <typename T>
         std::vector<T> valuesForColumn(Id col) const;
+
+        /* values of a column, which must have the matching type.  Views
+         * are invalidated by delProp(). */
+        ColumnView<Int> intValues(Id col) const {
+            return ColumnView<Int>(column(col, IntType).ints);
+        }
+        ColumnView<Float> floatValues(Id col) const {
+            return ColumnView<Float>(column(col, FloatType).floats);
+        }
+        ColumnView<const char*> stringValues(Id col) const {
+            return ColumnView<const char*>(column(col, StringType).strs);
+        }
+
+        /* assign values to rows [first, first+n) of a column, which must
+         * have the matching type. */
+        void setIntValues(Id col, Id first, Id n, const Int* vals);
+        void setFloatValues(Id col, Id first, Id n, const Float* vals);
+        void setStringValues(Id col, Id first, Id n, const String* vals);
     };
     typedef std::shared_ptr<ParamTable> ParamTablePtr;
 
+    template <typename T>
+    static inline std::vector<T> column_to_vector(ColumnView<T> const& view) {
+        std::vector<T> vals;
+        vals.reserve(view.size());
+        view.forEachBlock([&vals](const T* v, Id n) {
+            vals.insert(vals.end(), v, v+n);
+        });
+        return vals;
+    }
+
     template<> inline std::vector<Int>
     ParamTable::valuesForColumn(Id col) const {
-        auto& prop = _props.at(col);
-        if (prop.type != IntType) MSYS_FAIL("Int values requested for non-Int column");
-        std::vector<Int> vals;
-        vals.reserve(_nrows);
-        for (auto& v : prop.vals) vals.push_back(v.i);
-        return vals;
+        return column_to_vector(intValues(col));
     }
     template<> inline std::vector<Float>
     ParamTable::valuesForColumn(Id col) const {
-        auto& prop = _props.at(col);
-        if (prop.type != FloatType) MSYS_FAIL("Float values requested for non-Float column");
-        std::vector<Float> vals;
-        vals.reserve(_nrows);
-        for (auto& v : prop.vals) vals.push_back(v.f);
-        return vals;
+        return column_to_vector(floatValues(col));
     }
     template<> inline std::vector<String>
     ParamTable::valuesForColumn(Id col) const {
-        auto& prop = _props.at(col);
-        if (prop.type != StringType) MSYS_FAIL("String values requested for non-String column");
+        auto view = stringValues(col);
         std::vector<String> vals;
-        vals.reserve(_nrows);
-        for (auto& v : prop.vals) vals.push_back(v.s);
+        vals.reserve(view.size());
+        for (Id i=0, n=view.size(); i<n; i++) vals.push_back(view[i]);
         return vals;
     }
 }}
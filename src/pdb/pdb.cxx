@@ -93,9 +93,10 @@ SystemPtr iterator::next() {
             Id atm = imp.addAtom(chainname, segid, resid, resname, 
                     name, insertion);
             atom_t& atom = mol->atom(atm);
-            atom.x = x;
-            atom.y = y;
-            atom.z = z;
+            double* pos = mol->atomPos(atm);
+            pos[0] = x;
+            pos[1] = y;
+            pos[2] = z;
             atom.formal_charge = formal_charge;
             if (*element) {
                 atom.atomic_number = ElementForAbbreviation(element);
@@ -240,8 +241,9 @@ void desres::msys::ImportPDBCoordinates(SystemPtr mol, std::string const& path)
     do {
         indx = desres_msys_read_pdb_record(fd, pdbstr);
         if (indx == PDB_ATOM) {
-            atom_t& atm = mol->atom(id++);
-            desres_msys_get_pdb_coordinates(pdbstr, &atm.x, &atm.y, &atm.z,
+            atom_t& atm = mol->atom(id);
+            double* pos = mol->atomPos(id++);
+            desres_msys_get_pdb_coordinates(pdbstr, pos, pos+1, pos+2,
                     NULL, NULL, &atm.formal_charge);
         } else if (indx==PDB_CRYST1) {
             double alpha, beta, gamma, a, b, c;
@@ -388,9 +390,10 @@ void desres::msys::ExportPDB(SystemPtr mol, std::string const& path,
                     int anum = mol->atom(atm).atomic_number;
                     const char* name = mol->atom(atm).name.c_str();
                     const char* elementsym = AbbreviationForElement(anum);
-                    double x = mol->atom(atm).x;
-                    double y = mol->atom(atm).y;
-                    double z = mol->atom(atm).z;
+                    const double* pos = mol->atomPos(atm);
+                    double x = pos[0];
+                    double y = pos[1];
+                    double z = pos[2];
                     double occ = bad(occupancy_index) ? 1.0 :
                                     mol->atomPropValue(atm, occupancy_index);
                     double beta = bad(bfactor_index) ? 0.0 :
@@ -413,6 +416,7 @@ void desres::msys::ExportPDB(SystemPtr mol, std::string const& path,
         Id cur_ct=0;
         for (auto aid : mol->atoms()) {
             auto& atm = mol->atomFAST(aid);
+            auto pos = mol->atomPosFAST(aid);
             double occ = bad(occupancy_index) ? 1.0 :
                             mol->atomPropValue(aid, occupancy_index);
             double beta = bad(bfactor_index) ? 0.0 :
@@ -427,7 +431,7 @@ void desres::msys::ExportPDB(SystemPtr mol, std::string const& path,
             }
             if (!desres_msys_write_raw_pdb_record(
                     fd, "ATOM", ++index, atm.name.c_str(), res.name.c_str(), res.resid,
-                    res.insertion.c_str(), altloc, elementsym, atm.x, atm.y, atm.z,
+                    res.insertion.c_str(), altloc, elementsym, pos[0], pos[1], pos[2],
                     occ, beta, atm.formal_charge, chn.name.c_str(), chn.segid.c_str())) {
                 MSYS_FAIL("Failed writing PDB to " << path << " at line " << index);
             }
@@ -478,6 +478,7 @@ desres::msys::SystemPtr desres::msys::ImportPSF( std::string const& path ) {
     Id col = params->addProp("type", StringType);
 
     /* read atoms */
+    IdList nbids, nbparams;
     for (int i=0; i<natoms; i++) {
         char name[8];
         char type[8];
@@ -506,8 +507,10 @@ desres::msys::SystemPtr desres::msys::ImportPSF( std::string const& path ) {
             types[type] = param;
             params->value(param, col) = type;
         } 
-        nb->addTerm(IdList(1,id), types[type]);
+        nbids.push_back(id);
+        nbparams.push_back(types[type]);
     }
+    nb->addTerms(nbids.size(), nbids.data(), nbparams.data());
 
     /* read bonds */
     int nbonds = psf_start_block(fp, "NBOND"); /* get bond count */
@@ -515,7 +518,7 @@ desres::msys::SystemPtr desres::msys::ImportPSF( std::string const& path ) {
     if (nbonds > 0) {
         TermTablePtr stretch = AddTable(mol, "stretch_harm");
         Id param = stretch->params()->addParam();
-        IdList ids(2);
+        IdList ids(2*nbonds), pids(nbonds, param);
         std::vector<int> from(nbonds), to(nbonds);
         if (!psf_get_bonds(fp, nbonds, &from[0], &to[0],
                     charmmext, namdfmt)) {
@@ -523,10 +526,10 @@ desres::msys::SystemPtr desres::msys::ImportPSF( std::string const& path ) {
         }
         for (int i=0; i<nbonds; i++) {
             mol->addBond(from[i]-1, to[i]-1);
-            ids[0]=from[i]-1;
-            ids[1]=to[i]-1;
-            stretch->addTerm(ids, param);
+            ids[2*i  ]=from[i]-1;
+            ids[2*i+1]=to[i]-1;
         }
+        stretch->addTerms(nbonds, ids.data(), pids.data());
     }
 
     /* read angles */
@@ -534,15 +537,13 @@ desres::msys::SystemPtr desres::msys::ImportPSF( std::string const& path ) {
     if (nangles > 0) {
         TermTablePtr table = AddTable(mol, "angle_harm");
         Id param = table->params()->addParam();
-        IdList tmp(3);
         std::vector<int> ids(3*nangles);
         if (psf_get_angles(fp, nangles, &ids[0], charmmext)) {
             MSYS_FAIL("Error reading angles");
         }
-        for (int i=0; i<nangles; i++) {
-            for (int j=0; j<3; j++) tmp[j] = ids[3*i+j]-1;
-            table->addTerm(tmp, param);
-        }
+        IdList tmp(3*nangles), pids(nangles, param);
+        for (int i=0; i<3*nangles; i++) tmp[i] = ids[i]-1;
+        table->addTerms(nangles, tmp.data(), pids.data());
     }
 
     /* read dihedrals */
@@ -550,15 +551,13 @@ desres::msys::SystemPtr desres::msys::ImportPSF( std::string const& path ) {
     if (ndihed > 0) {
         TermTablePtr table = AddTable(mol, "dihedral_trig");
         Id param = table->params()->addParam();
-        IdList tmp(4);
         std::vector<int> ids(4*ndihed);
         if (psf_get_dihedrals_impropers(fp, ndihed, &ids[0], charmmext)) {
             MSYS_FAIL("Error reading dihedrals");
         }
-        for (int i=0; i<ndihed; i++) {
-            for (int j=0; j<4; j++) tmp[j] = ids[4*i+j]-1;
-            table->addTerm(tmp, param);
-        }
+        IdList tmp(4*ndihed), pids(ndihed, param);
+        for (int i=0; i<4*ndihed; i++) tmp[i] = ids[i]-1;
+        table->addTerms(ndihed, tmp.data(), pids.data());
     }
 
     /* read impropers */
@@ -566,13 +565,11 @@ desres::msys::SystemPtr desres::msys::ImportPSF( std::string const& path ) {
     if (nimp > 0) {
         TermTablePtr table = AddTable(mol, "improper_harm");
         Id param = table->params()->addParam();
-        IdList tmp(4);
         std::vector<int> ids(4*nimp);
         psf_get_dihedrals_impropers(fp, nimp, &ids[0], charmmext);
-        for (int i=0; i<nimp; i++) {
-            for (int j=0; j<4; j++) tmp[j] = ids[4*i+j]-1;
-            table->addTerm(tmp, param);
-        }
+        IdList tmp(4*nimp), pids(nimp, param);
+        for (int i=0; i<4*nimp; i++) tmp[i] = ids[i]-1;
+        table->addTerms(nimp, tmp.data(), pids.data());
     }
 
     /* read cross-terms (cmap) */
@@ -580,13 +577,11 @@ desres::msys::SystemPtr desres::msys::ImportPSF( std::string const& path ) {
     if (ncmap> 0) {
         TermTablePtr table = AddTable(mol, "torsiontorsion_cmap");
         Id param = table->params()->addParam();
-        IdList tmp(8);
         std::vector<int> ids(8*ncmap);
         psf_get_dihedrals_impropers(fp, 2*ncmap, &ids[0], charmmext);
-        for (int i=0; i<ncmap; i++) {
-            for (int j=0; j<8; j++) tmp[j] = ids[8*i+j]-1;
-            table->addTerm(tmp, param);
-        }
+        IdList tmp(8*ncmap), pids(ncmap, param);
+        for (int i=0; i<8*ncmap; i++) tmp[i] = ids[i]-1;
+        table->addTerms(ncmap, tmp.data(), pids.data());
     }
 
     return mol;
@@ -110,9 +110,10 @@ static std::string format_ct( SystemPtr mol ) {
     // atoms
     for (unsigned i=0; i<natoms; i++) {
         auto const& atm = mol->atomFAST(i);
-        format_coord(atombuf   , atm.x);
-        format_coord(atombuf+10, atm.y);
-        format_coord(atombuf+20, atm.z);
+        auto pos = mol->atomPosFAST(i);
+        format_coord(atombuf   , pos[0]);
+        format_coord(atombuf+10, pos[1]);
+        format_coord(atombuf+20, pos[2]);
         const char* abbr = AbbreviationForElement(atm.atomic_number);
         atombuf[31] = abbr[0];
         atombuf[32] = abbr[1] ? abbr[1] : ' ';
@@ -184,10 +184,12 @@ namespace {
                 if (sz<34) {
                     MSYS_FAIL("Malformed atom line: " << skip_to_end());
                 }
-                auto& atm = mol.atomFAST(mol.addAtom(0));
-                atm.x = parse_coord(buf   );
-                atm.y = parse_coord(buf+10);
-                atm.z = parse_coord(buf+20);
+                Id id = mol.addAtom(0);
+                auto& atm = mol.atomFAST(id);
+                auto pos = mol.atomPosFAST(id);
+                pos[0] = parse_coord(buf   );
+                pos[1] = parse_coord(buf+10);
+                pos[2] = parse_coord(buf+20);
                 atm.atomic_number = parse_element(buf+31);
                 atm.name = AbbreviationForElement(atm.atomic_number);
 
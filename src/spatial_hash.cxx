@@ -1,4 +1,5 @@
 #include "spatial_hash.hxx"
+#include "spatial_hash_simd.hxx"
 #include <limits>
 #include <stdio.h>
 
@@ -100,6 +101,15 @@ IdList SpatialHash::find_within_small(float r, const float* pos,
 
 template<>
 bool SpatialHash::test2(float r2, int voxid, float x, float y, float z) const {
+    static const auto simd = spatial_hash_simd::kernels<float>();
+    if (simd) {
+        for (int i=0; i<10; i++) {
+            int vox = voxid + full_shell[i];
+            uint32_t b = _counts[vox], e = _counts[vox+strip_lens[i]];
+            if (b<e && simd->within(_x+b, _y+b, _z+b, e-b, x,y,z, r2)) return true;
+        }
+        return false;
+    }
 #ifdef __SSE2__
     __m128 xj = _mm_set1_ps(x);
     __m128 yj = _mm_set1_ps(y);
@@ -338,6 +348,20 @@ void SpatialHash::find_contacts(float r2, int voxid, float x, float y, float z,
     float* rd = result->d2;
     uint64_t count = result->count;
 
+    /* strips running into the trailing pad voxels have e==0 */
+    static const auto simd = spatial_hash_simd::kernels<float>();
+    if (simd) {
+        for (int i=0; i<10; i++) {
+            int vox = voxid + full_shell[i];
+            uint32_t b = _counts[vox], e = _counts[vox+strip_lens[i]];
+            if (b<e) count += simd->contacts(_x+b, _y+b, _z+b, _ids+b, e-b,
+                                             x,y,z, r2, id,
+                                             ri+count, rj+count, rd+count);
+        }
+        result->count = count;
+        return;
+    }
+
 #ifdef __SSE4_1__
     __m128i packed_i = _mm_set1_epi32(id);
     __m128 xj = _mm_set1_ps(x);
@@ -2,9 +2,13 @@
 #define desres_msys_spatial_hash_hxx
 
 #include "types.hxx"
+#include "parallel.hxx"
 #include <math.h>
+#include <string.h>
 #include "pfx/rms.hxx"
+#include "pfx/cell.hxx"
 #include <unordered_set>
+#include <memory>
 #include <assert.h>
 #include <limits>
 #include <algorithm>
@@ -36,6 +40,13 @@ namespace desres { namespace msys {
         /* cell dims */
         Float cx, cy, cz;
 
+        /* triclinic cells: cell vectors, fractional projection (rows are
+         * the reciprocal vectors), fractional bounds of the hashed points
+         * and lengths of the reciprocal vectors. */
+        bool triclinic;
+        Float tri[9], frac[9];
+        Float fmin[3], fmax[3], fpad[3];
+
         /* neighbor full shell offsets */
         int full_shell[10];
         int strip_lens[10];
@@ -54,9 +65,23 @@ namespace desres { namespace msys {
         Id* _ids;
         Id *_tmpids;
 
+        /* voxel of each hashed particle, in hashed order */
+        std::vector<uint32_t> _voxids, _tmpvoxids;
+
         void compute_full_shell();
+        void set_cell(const double* cell);
+        void load_points(const Float* pos);
+        void bin_points();
         bool test2(Float r2, int voxid, Float x, Float y, Float z) const;
 
+        /* Call func(x,y,z) for each periodic image of px,py,pz in a
+         * triclinic cell, other than the point itself, that might lie
+         * within r of a hashed point.  Stops and returns true as soon
+         * as func returns true. */
+        template <typename Func>
+        bool for_each_triclinic_image(Float r, Float px, Float py, Float pz,
+                                      Func func) const;
+
         static
         void find_bbox(int n, const Float* x, Float *_min, Float *_max) {
             Float min = x[0], max=x[0];
@@ -77,6 +102,19 @@ namespace desres { namespace msys {
 
         SpatialHashT& voxelize(Float r);
 
+        /* Replace the hashed points with new positions for the same ids,
+         * e.g. from the next frame of a trajectory, and a new cell (NULL
+         * for non-periodic).  All buffers are reused.  If the hash has
+         * been voxelized, the current grid is kept: points are re-binned
+         * only if some point changed voxel, and the grid is rebuilt only
+         * if some point left it.  Queries using the previous voxelization
+         * radius may then be made with reuse_voxels semantics. */
+        SpatialHashT& update(const Float* pos, const double* cell);
+
+        /* number and ids of the hashed points, in hashed order */
+        int size() const { return ntarget; }
+        const Id* ids() const { return _ids; }
+
         /* Is the given point within r of any point in the region? */
         bool test(Float r, Float x, Float y, Float z) const {
             int xi = (x-ox) * ir;
@@ -98,11 +136,14 @@ namespace desres { namespace msys {
                            unsigned num, const Id* ids);
 
         /* Find the points within r of the hashed points.  If cell
-         * is not NULL, use minimum image distances.  */
+         * is not NULL, use minimum image distances.  The query points
+         * are split across nthreads workers (0 means use the default
+         * thread count); results are identical to the serial search. */
         IdList findWithin(Float r, const Float* pos,
-                          int n, const Id* ids) {
+                          int n, const Id* ids,
+                          unsigned nthreads=1) {
             voxelize(r);
-            return find_within(r,pos,n,ids);
+            return find_within_parallel(r,pos,n,ids,nthreads);
         }
 
         struct contact_t {
@@ -120,7 +161,8 @@ namespace desres { namespace msys {
         };
         typedef std::vector<contact_t> ContactList;
         ContactList findContacts(Float r, const Float* pos,
-                                 int n, const Id* ids);
+                                 int n, const Id* ids,
+                                 unsigned nthreads=1);
 
         struct contact_array_t {
             Id* i = nullptr;
@@ -147,6 +189,16 @@ namespace desres { namespace msys {
                     d2= (Float*)realloc(d2,max_size*sizeof(*d2));
                 }
             }
+
+            /* append the contents of another array */
+            void append(contact_array_t const& other) {
+                if (!other.count) return;
+                reserve_additional(other.count);
+                memcpy(i+count, other.i, other.count*sizeof(*i));
+                memcpy(j+count, other.j, other.count*sizeof(*j));
+                memcpy(d2+count, other.d2, other.count*sizeof(*d2));
+                count += other.count;
+            }
         };
 
         /* find contacts, performing a voxelization step before
@@ -154,13 +206,20 @@ namespace desres { namespace msys {
          */
         void findContacts(Float r, const Float* pos,
                           int n, const Id* ids,
-                          contact_array_t* result);
+                          contact_array_t* result,
+                          unsigned nthreads=1);
 
         /* find contacts assuming voxelize(R) for for R>=r has already been
-         * called.  const and reentrant.  */
+         * called.  const and reentrant.  If nthreads is not 1, the query
+         * points are split into contiguous chunks searched by separate
+         * threads (0 means use the default thread count), each filling
+         * its own contact_array_t.  The per-thread results are appended
+         * in query order, so the output matches the serial search
+         * exactly. */
         void findContactsReuseVoxels(Float r, const Float* pos,
                                      int n, const Id* ids,
-                                     contact_array_t* result) const;
+                                     contact_array_t* result,
+                                     unsigned nthreads=1) const;
 
         /* find contacts in the original set of atoms, using the specified
          * set of exclusions in C-major order and assuming pre-voxelization */
@@ -173,12 +232,23 @@ namespace desres { namespace msys {
         IdList find_within(Float r, const Float* pos, 
                           int n, const Id* ids) const;
 
+        /* As find_within, splitting the query points across nthreads
+         * workers and concatenating their results in query order. */
+        IdList find_within_parallel(Float r, const Float* pos,
+                                    int n, const Id* ids,
+                                    unsigned nthreads) const;
+
         IdList find_within_small(Float r, const Float* pos, 
                                  int n, const Id* ids) const;
  
         void find_contacts(Float r2, int voxid, Float x, Float y, Float z,
                            Id id, contact_array_t* result) const;
 
+        /* serial contact search over query points [begin,end) */
+        void find_contacts_range(Float r, const Float* pos,
+                                 int begin, int end, const Id* ids,
+                                 contact_array_t* result) const;
+
         template <typename SpatialHashExclusions>
         void find_pairlist(Float r2, int voxid, Float x, Float y, Float z,
                            Id id, SpatialHashExclusions const& excl, contact_array_t* result) const;
@@ -195,7 +265,8 @@ namespace desres { namespace msys {
 
         /* Return true if point px,py,pz is within r of some hashed
          * point assuming an orthorhombic periodic cell with lengths
-         * ga,gb,gc. */
+         * ga,gb,gc.  If the hash was constructed with a triclinic cell,
+         * the cell vectors are used instead of ga,gb,gc. */
         bool minimage(Float r, Float ga, Float gb, Float gc,
 		      Float px, Float py, Float pz) const;
 
@@ -209,9 +280,10 @@ namespace desres { namespace msys {
     inline IdList FindWithin(IdList const& wsel, const float* wat,
                       IdList const& psel, const float* pro,
                       float radius,
-                      const double* cell) {
+                      const double* cell,
+                      unsigned nthreads=1) {
         return SpatialHash(pro, psel.size(), &psel[0], cell)
-            .findWithin(radius, wat, wsel.size(), &wsel[0]);
+            .findWithin(radius, wat, wsel.size(), &wsel[0], nthreads);
     }
  
     inline IdList FindNearest(IdList const& wsel, const float* wat,
@@ -221,8 +293,58 @@ namespace desres { namespace msys {
             .findNearest(k, wat, wsel.size(), &wsel[0]);
     }
  
+    /* Keeps spatial hashes between searches, so that repeated queries
+     * against the same hashed ids, e.g. once per trajectory frame, update
+     * an existing hash in place rather than building a new one.  The
+     * most recently used max_entries hashes are kept.  Not thread safe. */
+    class SpatialHashCache {
+        struct entry_t {
+            IdList ids;
+            bool periodic;
+            std::unique_ptr<SpatialHash> hash;
+        };
+        std::vector<entry_t> _entries;
+        unsigned _max_entries;
+
+    public:
+        explicit SpatialHashCache(unsigned max_entries=8)
+        : _max_entries(std::max(1u, max_entries)) {}
+
+        /* Return a hash of the given ids at positions pos and cell,
+         * voxelized at radius r. */
+        SpatialHash& get(IdList const& ids, const float* pos,
+                         const double* cell, float r);
+
+        void clear() { _entries.clear(); }
+    };
+
 #include "spatial_hash_detail.hxx"
 
+    inline SpatialHash& SpatialHashCache::get(IdList const& ids,
+                                              const float* pos,
+                                              const double* cell,
+                                              float r) {
+        bool periodic = cell!=nullptr;
+        auto iter = std::find_if(_entries.begin(), _entries.end(),
+                [&](entry_t const& e) {
+                    return e.periodic==periodic && e.ids==ids; });
+        if (iter==_entries.end()) {
+            if (_entries.size() >= _max_entries) _entries.pop_back();
+            entry_t e;
+            e.ids = ids;
+            e.periodic = periodic;
+            e.hash.reset(new SpatialHash(pos, ids.size(), ids.data(), cell));
+            e.hash->voxelize(r);
+            _entries.insert(_entries.begin(), std::move(e));
+        } else {
+            std::rotate(_entries.begin(), iter, iter+1);
+            SpatialHash& hash = *_entries.front().hash;
+            hash.update(pos, cell);
+            if (hash.radius() != r) hash.voxelize(r);
+        }
+        return *_entries.front().hash;
+    }
+
 }}
 
 #endif
@@ -57,6 +57,7 @@ SpatialHashT<Float>::SpatialHashT( const Float *pos, int n, const Id* ids,
   xmin(), ymin(), zmin(),
   xmax(), ymax(), zmax(),
   rot(), cx(), cy(), cz(),
+  triclinic(), tri(), frac(), fmin(), fmax(), fpad(),
   ntarget(n), 
   _x(), _y(), _z(), 
   _tmpx(), _tmpy(), _tmpz(), 
@@ -66,58 +67,88 @@ SpatialHashT<Float>::SpatialHashT( const Float *pos, int n, const Id* ids,
     ox = oy = oz = 0;
     if (ntarget<1) return;
 
-    if (cell) {
-        cx = sqrt(cell[0]*cell[0] + cell[1]*cell[1] + cell[2]*cell[2]);
-        cy = sqrt(cell[3]*cell[3] + cell[4]*cell[4] + cell[5]*cell[5]);
-        cz = sqrt(cell[6]*cell[6] + cell[7]*cell[7] + cell[8]*cell[8]);
-        if (cx==0 || cy==0 || cz==0) {
-            MSYS_FAIL("cell has zero-length dimensions");
-        }
+    set_cell(cell);
+
+    /* copy to transposed arrays */
 #ifdef WIN32
-        rot = (Float*)_aligned_malloc(9*sizeof(*rot), 16);
+    _x = (Float*)_aligned_malloc(ntarget*sizeof(*_x), 64);
+    _y = (Float*)_aligned_malloc(ntarget*sizeof(*_y), 64);
+    _z = (Float*)_aligned_malloc(ntarget*sizeof(*_z), 64);
+    _tmpx = (Float*)_aligned_malloc(ntarget*sizeof(*_tmpx), 64);
+    _tmpy = (Float*)_aligned_malloc(ntarget*sizeof(*_tmpy), 64);
+    _tmpz = (Float*)_aligned_malloc(ntarget*sizeof(*_tmpz), 64);
 #else
-        assert(0==posix_memalign((void **)&rot, 16, 9*sizeof(*rot)));
+    assert(0==posix_memalign((void **)&_x, 64, ntarget*sizeof(*_x)));
+    assert(0==posix_memalign((void **)&_y, 64, ntarget*sizeof(*_y)));
+    assert(0==posix_memalign((void **)&_z, 64, ntarget*sizeof(*_z)));
+    assert(0==posix_memalign((void **)&_tmpx, 64, ntarget*sizeof(*_tmpx)));
+    assert(0==posix_memalign((void **)&_tmpy, 64, ntarget*sizeof(*_tmpy)));
+    assert(0==posix_memalign((void **)&_tmpz, 64, ntarget*sizeof(*_tmpz)));
+    assert(0==posix_memalign((void **)&_ids, 64, ntarget*sizeof(*_ids)));
+    assert(0==posix_memalign((void **)&_tmpids, 64, ntarget*sizeof(*_tmpids)));
 #endif
-        double d1=0, d2=0, d3=0; /* row dot-products */
-        for (int i=0; i<3; i++) {
-            rot[0+i] = cell[0+i]/cx;
-            rot[3+i] = cell[3+i]/cy;
-            rot[6+i] = cell[6+i]/cz;
-            d1 += rot[0+i]*rot[3+i];
-            d2 += rot[0+i]*rot[6+i];
-            d3 += rot[3+i]*rot[6+i];
-        }
-        static const Float eps = 1e-4;
-        if (fabs(d1)>eps || fabs(d2)>eps || fabs(d3)>eps) {
-            MSYS_FAIL("cell appears triclinic: dot products " << d1 << " " << d2 << " " << d3);
-        }
-        if (!(rot[1] || rot[2] || rot[3] || rot[5] || rot[6] || rot[7])) {
-            free(rot);
-            rot=NULL;
-        }
+    for (int i=0; i<ntarget; i++) {
+        _ids[i] = ids ? ids[i] : i;
     }
+    load_points(pos);
+}
 
-    /* copy to transposed arrays */
+template <typename Float>
+void SpatialHashT<Float>::set_cell(const double* cell) {
+    cx = cy = cz = 0;
+    triclinic = false;
+    if (!cell) {
+        free(rot);
+        rot=NULL;
+        return;
+    }
+    cx = sqrt(cell[0]*cell[0] + cell[1]*cell[1] + cell[2]*cell[2]);
+    cy = sqrt(cell[3]*cell[3] + cell[4]*cell[4] + cell[5]*cell[5]);
+    cz = sqrt(cell[6]*cell[6] + cell[7]*cell[7] + cell[8]*cell[8]);
+    if (cx==0 || cy==0 || cz==0) {
+        MSYS_FAIL("cell has zero-length dimensions");
+    }
+    if (!rot) {
 #ifdef WIN32
-    _x = (Float*)_aligned_malloc(ntarget*sizeof(*_x), 16);
-    _y = (Float*)_aligned_malloc(ntarget*sizeof(*_y), 16);
-    _z = (Float*)_aligned_malloc(ntarget*sizeof(*_z), 16);
-    _tmpx = (Float*)_aligned_malloc(ntarget*sizeof(*_tmpx), 16);
-    _tmpy = (Float*)_aligned_malloc(ntarget*sizeof(*_tmpy), 16);
-    _tmpz = (Float*)_aligned_malloc(ntarget*sizeof(*_tmpz), 16);
+        rot = (Float*)_aligned_malloc(9*sizeof(*rot), 16);
 #else
-    assert(0==posix_memalign((void **)&_x, 16, ntarget*sizeof(*_x)));
-    assert(0==posix_memalign((void **)&_y, 16, ntarget*sizeof(*_y)));
-    assert(0==posix_memalign((void **)&_z, 16, ntarget*sizeof(*_z)));
-    assert(0==posix_memalign((void **)&_tmpx, 16, ntarget*sizeof(*_tmpx)));
-    assert(0==posix_memalign((void **)&_tmpy, 16, ntarget*sizeof(*_tmpy)));
-    assert(0==posix_memalign((void **)&_tmpz, 16, ntarget*sizeof(*_tmpz)));
-    assert(0==posix_memalign((void **)&_ids, 16, ntarget*sizeof(*_ids)));
-    assert(0==posix_memalign((void **)&_tmpids, 16, ntarget*sizeof(*_tmpids)));
+        assert(0==posix_memalign((void **)&rot, 16, 9*sizeof(*rot)));
 #endif
+    }
+    double d1=0, d2=0, d3=0; /* row dot-products */
+    for (int i=0; i<3; i++) {
+        rot[0+i] = cell[0+i]/cx;
+        rot[3+i] = cell[3+i]/cy;
+        rot[6+i] = cell[6+i]/cz;
+        d1 += rot[0+i]*rot[3+i];
+        d2 += rot[0+i]*rot[6+i];
+        d3 += rot[3+i]*rot[6+i];
+    }
+    static const Float eps = 1e-4;
+    if (fabs(d1)>eps || fabs(d2)>eps || fabs(d3)>eps) {
+        /* Triclinic: hash in the lab frame and find images using
+         * fractional coordinates, computed from the inverse of the
+         * transposed cell as in pfx::wrap_vector. */
+        double box[9], inv[9];
+        pfx::trans_3x3(box, cell);
+        if (!pfx::inverse_3x3(inv, box)) {
+            MSYS_FAIL("cell is singular");
+        }
+        std::copy(cell, cell+9, tri);
+        std::copy(inv, inv+9, frac);
+        triclinic = true;
+        free(rot);
+        rot=NULL;
+    } else if (!(rot[1] || rot[2] || rot[3] || rot[5] || rot[6] || rot[7])) {
+        free(rot);
+        rot=NULL;
+    }
+}
+
+template <typename Float>
+void SpatialHashT<Float>::load_points(const Float* pos) {
     for (int i=0; i<ntarget; i++) {
-        Id id = ids ? ids[i] : i;
-        const Float *xyz = pos+3*id;
+        const Float *xyz = pos+3*_ids[i];
         if(rot) {
             Float pos[3]={xyz[0],xyz[1],xyz[2]};
             pfx::apply_rotation(1,pos,rot);
@@ -129,15 +160,60 @@ SpatialHashT<Float>::SpatialHashT( const Float *pos, int n, const Id* ids,
             _y[i] = xyz[1];
             _z[i] = xyz[2];
         }
-        _ids[i] = id;
     }
 
     /* compute bounds for positions */
     find_bbox(ntarget, _x, &xmin, &xmax);
     find_bbox(ntarget, _y, &ymin, &ymax);
     find_bbox(ntarget, _z, &zmin, &zmax);
+    if (!triclinic) return;
+    for (int m=0; m<3; m++) {
+        const Float* v = frac+3*m;
+        Float lo = 0, hi = 0;
+        for (int i=0; i<ntarget; i++) {
+            Float f = v[0]*_x[i] + v[1]*_y[i] + v[2]*_z[i];
+            if (i==0 || f<lo) lo = f;
+            if (i==0 || f>hi) hi = f;
+        }
+        fmin[m] = lo;
+        fmax[m] = hi;
+        fpad[m] = sqrt(v[0]*v[0] + v[1]*v[1] + v[2]*v[2]);
+    }
 }
 
+template <typename Float>
+SpatialHashT<Float>& SpatialHashT<Float>::update(const Float* pos,
+                                                 const double* cell) {
+    if (ntarget<1) return *this;
+    set_cell(cell);
+    load_points(pos);
+    if (rad==0) return *this;
+
+    /* re-bin into the current grid unless some point left its interior.
+     * The searches skip query points outside the grid, so every hashed
+     * point must stay at least rad from its edges, as voxelize() leaves
+     * them: voxels [1,n-2] unless the grid was coarsened.  Compare before
+     * truncating, so that NaN and coordinates just below the origin are
+     * caught too. */
+    const Float pad = rad*ir;
+    bool moved = false;
+    for (int i=0; i<ntarget; i++) {
+        Float fx = (_x[i]-ox) * ir;
+        Float fy = (_y[i]-oy) * ir;
+        Float fz = (_z[i]-oz) * ir;
+        if (!(fx>=pad && fx+pad<nx &&
+              fy>=pad && fy+pad<ny &&
+              fz>=pad && fz+pad<nz)) {
+            return voxelize(rad);
+        }
+        int xi = fx, yi = fy, zi = fz;
+        uint32_t voxid = zi + nz*(yi + ny*xi);
+        moved |= voxid != _voxids[i];
+        _voxids[i] = voxid;
+    }
+    if (moved) bin_points();
+    return *this;
+}
 
 template <typename Float>
 SpatialHashT<Float>& SpatialHashT<Float>::voxelize(Float r) {
@@ -160,20 +236,11 @@ SpatialHashT<Float>& SpatialHashT<Float>::voxelize(Float r) {
         ny = (ymax-ymin)*ir + 3;
         nz = (zmax-zmin)*ir + 3;
     }
-    int nvoxels = nx*ny*nz;
-
-    /* allocate space for extra voxels so we don't have to worry
-     * about edge cases. */
-    int voxpad = 1 + nz*(1 + ny);
-    _countspace.resize(nvoxels+2*voxpad+1);
-    std::fill(_countspace.begin(), _countspace.end(), 0);
-    _counts = &_countspace[voxpad];
-    ++_counts;
     compute_full_shell();
 
-    /* map points to voxels and compute voxel histogram */
+    /* map points to voxels */
     /* FIXME: SIMD */
-    std::vector<uint32_t> voxids(ntarget);
+    _voxids.resize(ntarget);
     for (int i=0; i<ntarget; i++) {
         Float x = _x[i];
         Float y = _y[i];
@@ -182,8 +249,27 @@ SpatialHashT<Float>& SpatialHashT<Float>::voxelize(Float r) {
         int yi = (y-oy) * ir;
         int zi = (z-oz) * ir;
         int voxid = zi + nz*(yi + ny*xi);
-        voxids[i] = voxid;
-        ++_counts[voxid];
+        _voxids[i] = voxid;
+    }
+    bin_points();
+    return *this;
+}
+
+template <typename Float>
+void SpatialHashT<Float>::bin_points() {
+    int nvoxels = nx*ny*nz;
+
+    /* allocate space for extra voxels so we don't have to worry
+     * about edge cases. */
+    int voxpad = 1 + nz*(1 + ny);
+    _countspace.resize(nvoxels+2*voxpad+1);
+    std::fill(_countspace.begin(), _countspace.end(), 0);
+    _counts = &_countspace[voxpad];
+    ++_counts;
+
+    /* compute voxel histogram */
+    for (int i=0; i<ntarget; i++) {
+        ++_counts[_voxids[i]];
     }
 
     /* compute starting index for each voxel */
@@ -197,26 +283,28 @@ SpatialHashT<Float>& SpatialHashT<Float>::voxelize(Float r) {
     }
 
     /* copy positions sorted by voxel */
+    _tmpvoxids.resize(ntarget);
     for (int i=0; i<ntarget; i++) {
-        int voxid = voxids[i];
+        int voxid = _voxids[i];
         unsigned& j = _counts[voxid];
         _tmpx[j] = _x[i];
         _tmpy[j] = _y[i];
         _tmpz[j] = _z[i];
         _tmpids[j] = _ids[i];
+        _tmpvoxids[j] = voxid;
         ++j;
     }
     std::swap(_x,_tmpx);
     std::swap(_y,_tmpy);
     std::swap(_z,_tmpz);
     std::swap(_ids, _tmpids);
+    _voxids.swap(_tmpvoxids);
 
     /* space for contacts */
     maxcount += 3;  // since we're writing in chunks of four
 
     /* shift counts up by to undo the counting sort we just did */
     --_counts;
-    return *this;
 }
 
 template <typename Float>
@@ -303,12 +391,34 @@ IdList SpatialHashT<Float>::findNearest(unsigned k, const Float* pos,
     return smin;
 }
 
+template <typename Float>
+IdList SpatialHashT<Float>::find_within_parallel(Float r, const Float* pos,
+                                                 int n, const Id* ids,
+                                                 unsigned nthreads) const {
+    if (nthreads==1) return find_within(r, pos, n, ids);
+    std::vector<IdList> results(nthreads ? nthreads : default_thread_count());
+    unsigned nchunks = parallel_chunks(n, results.size(),
+            [&](unsigned i, uint64_t b, uint64_t e) {
+                results[i] = find_within(r, pos, e-b, ids+b);
+            }, 1024);
+    if (nchunks==1) return std::move(results[0]);
+    size_t size = 0;
+    for (unsigned i=0; i<nchunks; i++) size += results[i].size();
+    IdList result;
+    result.reserve(size);
+    for (unsigned i=0; i<nchunks; i++) {
+        result.insert(result.end(), results[i].begin(), results[i].end());
+    }
+    return result;
+}
+
 template <typename Float>
 typename SpatialHashT<Float>::ContactList
 SpatialHashT<Float>::findContacts(Float r, const Float* pos,
-                               int n, const Id* ids) {
+                               int n, const Id* ids,
+                               unsigned nthreads) {
     contact_array_t arr;
-    findContacts(r, pos, n, ids, &arr);
+    findContacts(r, pos, n, ids, &arr, nthreads);
     ContactList result;
     result.reserve(arr.count);
     for (uint64_t i=0, n=arr.count; i<n; i++) {
@@ -320,20 +430,41 @@ SpatialHashT<Float>::findContacts(Float r, const Float* pos,
 template <typename Float>
 void SpatialHashT<Float>::findContacts(Float r, const Float* pos,
                                int n, const Id* ids,
-                               contact_array_t* result) {
+                               contact_array_t* result,
+                               unsigned nthreads) {
     voxelize(r);
-    findContactsReuseVoxels(r, pos, n, ids, result);
+    findContactsReuseVoxels(r, pos, n, ids, result, nthreads);
 }
 
 template <typename Float>
 void SpatialHashT<Float>::findContactsReuseVoxels(Float r, const Float* pos,
                                           int n, const Id* ids,
+                                          contact_array_t* result,
+                                          unsigned nthreads) const {
+    if (nthreads==1) {
+        find_contacts_range(r, pos, 0, n, ids, result);
+        return;
+    }
+    std::vector<contact_array_t> results(nthreads ? nthreads : default_thread_count());
+    unsigned nchunks = parallel_chunks(n, results.size(),
+            [&](unsigned i, uint64_t b, uint64_t e) {
+                find_contacts_range(r, pos, b, e, ids, &results[i]);
+            }, 1024);
+    uint64_t size = 0;
+    for (unsigned i=0; i<nchunks; i++) size += results[i].count;
+    result->reserve_additional(size);
+    for (unsigned i=0; i<nchunks; i++) result->append(results[i]);
+}
+
+template <typename Float>
+void SpatialHashT<Float>::find_contacts_range(Float r, const Float* pos,
+                                          int begin, int end, const Id* ids,
                                           contact_array_t* result) const {
 
     bool periodic = cx!=0 || cy!=0 || cz!=0;
     Float tmp[3];
 
-    for (int j=0; j<n; j++) {
+    for (int j=begin; j<end; j++) {
         unsigned id = ids ? ids[j] : j;
         const Float *xyz = pos + 3*id;
         if (rot) {
@@ -434,6 +565,20 @@ template <typename Float>
 void SpatialHashT<Float>::minimage_contacts(Float r, Float ga, Float gb, Float gc,
                                     Float px, Float py, Float pz,
                                     Id id, contact_array_t* result) const {
+    if (triclinic) {
+        for_each_triclinic_image(r, px, py, pz, [&](Float x, Float y, Float z) {
+            int xi = (x-ox) * ir;
+            int yi = (y-oy) * ir;
+            int zi = (z-oz) * ir;
+            if (xi<0 || xi>=nx ||
+                yi<0 || yi>=ny ||
+                zi<0 || zi>=nz) return false;
+            int voxid = zi + nz*(yi + ny*xi);
+            find_contacts(r*r, voxid, x,y,z, id, result);
+            return false;
+        });
+        return;
+    }
     Float xlo = xmin - r;
     Float ylo = ymin - r;
     Float zlo = zmin - r;
@@ -469,6 +614,20 @@ void SpatialHashT<Float>::minimage_pairlist(Float r, Float ga, Float gb, Float g
                                             Float px, Float py, Float pz,
                                             Id id, SpatialHashExclusions const& excl,
                                             contact_array_t* result) const {
+    if (triclinic) {
+        for_each_triclinic_image(r, px, py, pz, [&](Float x, Float y, Float z) {
+            int xi = (x-ox) * ir;
+            int yi = (y-oy) * ir;
+            int zi = (z-oz) * ir;
+            if (xi<0 || xi>=nx ||
+                yi<0 || yi>=ny ||
+                zi<0 || zi>=nz) return false;
+            int voxid = zi + nz*(yi + ny*xi);
+            find_pairlist(r*r, voxid, x,y,z, id, excl, result);
+            return false;
+        });
+        return;
+    }
     Float xlo = xmin - r;
     Float ylo = ymin - r;
     Float zlo = zmin - r;
@@ -501,6 +660,10 @@ void SpatialHashT<Float>::minimage_pairlist(Float r, Float ga, Float gb, Float g
 template <typename Float>
 bool SpatialHashT<Float>::minimage(Float r, Float ga, Float gb, Float gc,
                            Float px, Float py, Float pz) const {
+    if (triclinic) {
+        return for_each_triclinic_image(r, px, py, pz,
+                [&](Float x, Float y, Float z) { return test(r,x,y,z); });
+    }
     Float xlo = xmin - r;
     Float ylo = ymin - r;
     Float zlo = zmin - r;
@@ -525,3 +688,44 @@ bool SpatialHashT<Float>::minimage(Float r, Float ga, Float gb, Float gc,
 }
 
 
+
+template <typename Float>
+template <typename Func>
+bool SpatialHashT<Float>::for_each_triclinic_image(Float r,
+                            Float px, Float py, Float pz, Func func) const {
+    /* Image (i,j,k) of the point has fractional coordinates f+(i,j,k),
+     * and a point within r of a hashed point has fractional coordinate
+     * m within r*|b_m| of the hashed points' range, b_m being the m'th
+     * reciprocal vector.  That bounds the images to try however the
+     * hashed points are spread and however skewed the cell; the bounds
+     * are padded slightly against roundoff. */
+    int lo[3], hi[3];
+    for (int m=0; m<3; m++) {
+        const Float* v = frac+3*m;
+        Float f = v[0]*px + v[1]*py + v[2]*pz;
+        Float pad = r*fpad[m] + Float(1e-4);
+        lo[m] = int(ceil(fmin[m] - pad - f));
+        hi[m] = int(floor(fmax[m] + pad - f));
+    }
+    Float xlo = xmin - r;
+    Float ylo = ymin - r;
+    Float zlo = zmin - r;
+    Float xhi = xmax + r;
+    Float yhi = ymax + r;
+    Float zhi = zmax + r;
+    for (int i=lo[0]; i<=hi[0]; i++) {
+        for (int j=lo[1]; j<=hi[1]; j++) {
+            for (int k=lo[2]; k<=hi[2]; k++) {
+                if (i==0 && j==0 && k==0) continue;
+                Float x = px + i*tri[0] + j*tri[3] + k*tri[6];
+                if (x<xlo || x>xhi) continue;
+                Float y = py + i*tri[1] + j*tri[4] + k*tri[7];
+                if (y<ylo || y>yhi) continue;
+                Float z = pz + i*tri[2] + j*tri[5] + k*tri[8];
+                if (z<zlo || z>zhi) continue;
+                if (func(x,y,z)) return true;
+            }
+        }
+    }
+    return false;
+}
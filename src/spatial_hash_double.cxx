@@ -1,4 +1,5 @@
 #include "spatial_hash.hxx"
+#include "spatial_hash_simd.hxx"
 #include <limits>
 #include <stdio.h>
 
@@ -49,9 +50,14 @@ IdList SpatialHashT<double>::find_within_small(double r, const double* pos,
 
 template<>
 bool SpatialHashT<double>::test2(double r2, int voxid, double x, double y, double z) const {
+    static const auto simd = spatial_hash_simd::kernels<double>();
     for (int i=0; i<10; i++) {
         int vox = voxid + full_shell[i];
         uint32_t b = _counts[vox], e = _counts[vox+strip_lens[i]];
+        if (simd) {
+            if (b<e && simd->within(_x+b, _y+b, _z+b, e-b, x,y,z, r2)) return true;
+            continue;
+        }
         const double * xi = _x+b;
         const double * yi = _y+b;
         const double * zi = _z+b;
@@ -109,9 +115,16 @@ void SpatialHashT<double>::find_contacts(double r2, int voxid, double x, double
     double* rd = result->d2;
     uint64_t count = result->count;
 
+    static const auto simd = spatial_hash_simd::kernels<double>();
     for (int i=0; i<10; i++) {
         int vox = voxid + full_shell[i];
         uint32_t b = _counts[vox], e = _counts[vox+strip_lens[i]];
+        if (simd) {
+            if (b<e) count += simd->contacts(_x+b, _y+b, _z+b, _ids+b, e-b,
+                                             x,y,z, r2, id,
+                                             ri+count, rj+count, rd+count);
+            continue;
+        }
         const double * xi = _x+b;
         const double * yi = _y+b;
         const double * zi = _z+b;
@@ -0,0 +1,380 @@
+#include "spatial_hash_simd.hxx"
+#include <stdlib.h>
+#include <string.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__GNUC__) || defined(__clang__)) && !defined(MSYS_WITHOUT_SIMD)
+#define MSYS_SIMD_DISPATCH
+#include <immintrin.h>
+#if defined(__GNUC__) && !defined(__clang__)
+/* gcc's avx512 headers trip this on their own _mm512_undefined values */
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+#endif
+
+namespace desres { namespace msys { namespace spatial_hash_simd {
+
+#ifdef MSYS_SIMD_DISPATCH
+
+/* AVX2 has no compress-store, so surviving lanes are packed with a
+ * permutation looked up from the comparison mask.  perm8[m] lists the
+ * set bits of the 8-bit mask m, lowest first; perm4d[m] does the same for
+ * the 4 double lanes of a 4-bit mask, as pairs of 32-bit indices. */
+namespace {
+    struct PermTables {
+        alignas(32) int32_t perm8[256][8];
+        alignas(32) int32_t perm4d[16][8];
+        PermTables() {
+            memset(this, 0, sizeof(*this));
+            for (int m=0; m<256; m++) {
+                int n=0;
+                for (int b=0; b<8; b++) if (m & (1<<b)) perm8[m][n++] = b;
+            }
+            for (int m=0; m<16; m++) {
+                int n=0;
+                for (int b=0; b<4; b++) if (m & (1<<b)) {
+                    perm4d[m][n++] = 2*b;
+                    perm4d[m][n++] = 2*b+1;
+                }
+            }
+        }
+    };
+    const PermTables tables;
+}
+
+/* The AVX-512 kernels use the explicitly rounded arithmetic intrinsics,
+ * which the compiler will not contract into fused multiply-adds; that
+ * keeps every d2 bitwise identical to the scalar computation. */
+#define R512 (_MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)
+
+/* float, AVX2 */
+
+__attribute__((target("avx2")))
+static uint32_t contacts_avx2_f(const float* x, const float* y, const float* z,
+                                const Id* ids, uint32_t n,
+                                float px, float py, float pz, float r2, Id id,
+                                Id* ri, Id* rj, float* rd) {
+    const __m256 X = _mm256_set1_ps(px);
+    const __m256 Y = _mm256_set1_ps(py);
+    const __m256 Z = _mm256_set1_ps(pz);
+    const __m256 R2 = _mm256_set1_ps(r2);
+    const __m256i I = _mm256_set1_epi32(id);
+    uint32_t k=0, count=0;
+    for (; k+8<=n; k+=8) {
+        __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(x+k), X);
+        __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(y+k), Y);
+        __m256 dz = _mm256_sub_ps(_mm256_loadu_ps(z+k), Z);
+        __m256 d2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx,dx),
+                                                _mm256_mul_ps(dy,dy)),
+                                                _mm256_mul_ps(dz,dz));
+        __m256i j8 = _mm256_loadu_si256((const __m256i*)(ids+k));
+        int mask = _mm256_movemask_ps(_mm256_andnot_ps(
+                    _mm256_castsi256_ps(_mm256_cmpeq_epi32(j8, I)),
+                    _mm256_cmp_ps(d2, R2, _CMP_LE_OQ)));
+        if (!mask) continue;
+        __m256i perm = _mm256_load_si256((const __m256i*)tables.perm8[mask]);
+        _mm256_storeu_si256((__m256i*)(ri+count), I);
+        _mm256_storeu_si256((__m256i*)(rj+count),
+                _mm256_permutevar8x32_epi32(j8, perm));
+        _mm256_storeu_ps(rd+count, _mm256_permutevar8x32_ps(d2, perm));
+        count += __builtin_popcount(mask);
+    }
+    for (; k<n; k++) {
+        if (ids[k]==id) continue;
+        float dx = px - x[k];
+        float dy = py - y[k];
+        float dz = pz - z[k];
+        float d2 = dx*dx + dy*dy + dz*dz;
+        if (d2<=r2) {
+            ri[count] = id;
+            rj[count] = ids[k];
+            rd[count] = d2;
+            ++count;
+        }
+    }
+    return count;
+}
+
+__attribute__((target("avx2")))
+static bool within_avx2_f(const float* x, const float* y, const float* z,
+                          uint32_t n, float px, float py, float pz, float r2) {
+    const __m256 X = _mm256_set1_ps(px);
+    const __m256 Y = _mm256_set1_ps(py);
+    const __m256 Z = _mm256_set1_ps(pz);
+    const __m256 R2 = _mm256_set1_ps(r2);
+    uint32_t k=0;
+    for (; k+8<=n; k+=8) {
+        __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(x+k), X);
+        __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(y+k), Y);
+        __m256 dz = _mm256_sub_ps(_mm256_loadu_ps(z+k), Z);
+        __m256 d2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx,dx),
+                                                _mm256_mul_ps(dy,dy)),
+                                                _mm256_mul_ps(dz,dz));
+        if (_mm256_movemask_ps(_mm256_cmp_ps(d2, R2, _CMP_LE_OQ))) return true;
+    }
+    for (; k<n; k++) {
+        float dx = px - x[k];
+        float dy = py - y[k];
+        float dz = pz - z[k];
+        if (dx*dx + dy*dy + dz*dz <= r2) return true;
+    }
+    return false;
+}
+
+/* double, AVX2 */
+
+__attribute__((target("avx2")))
+static uint32_t contacts_avx2_d(const double* x, const double* y, const double* z,
+                                const Id* ids, uint32_t n,
+                                double px, double py, double pz, double r2, Id id,
+                                Id* ri, Id* rj, double* rd) {
+    const __m256d X = _mm256_set1_pd(px);
+    const __m256d Y = _mm256_set1_pd(py);
+    const __m256d Z = _mm256_set1_pd(pz);
+    const __m256d R2 = _mm256_set1_pd(r2);
+    const __m128i I = _mm_set1_epi32(id);
+    uint32_t k=0, count=0;
+    for (; k+4<=n; k+=4) {
+        __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(x+k), X);
+        __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(y+k), Y);
+        __m256d dz = _mm256_sub_pd(_mm256_loadu_pd(z+k), Z);
+        __m256d d2 = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(dx,dx),
+                                                 _mm256_mul_pd(dy,dy)),
+                                                 _mm256_mul_pd(dz,dz));
+        __m128i j4 = _mm_loadu_si128((const __m128i*)(ids+k));
+        __m256i self = _mm256_cvtepi32_epi64(_mm_cmpeq_epi32(j4, I));
+        int mask = _mm256_movemask_pd(_mm256_andnot_pd(
+                    _mm256_castsi256_pd(self),
+                    _mm256_cmp_pd(d2, R2, _CMP_LE_OQ)));
+        if (!mask) continue;
+        __m256i pj = _mm256_load_si256((const __m256i*)tables.perm8[mask]);
+        __m256i pd = _mm256_load_si256((const __m256i*)tables.perm4d[mask]);
+        _mm_storeu_si128((__m128i*)(ri+count), I);
+        _mm_storeu_si128((__m128i*)(rj+count), _mm256_castsi256_si128(
+                _mm256_permutevar8x32_epi32(_mm256_castsi128_si256(j4), pj)));
+        _mm256_storeu_pd(rd+count, _mm256_castps_pd(_mm256_permutevar8x32_ps(
+                _mm256_castpd_ps(d2), pd)));
+        count += __builtin_popcount(mask);
+    }
+    for (; k<n; k++) {
+        if (ids[k]==id) continue;
+        double dx = px - x[k];
+        double dy = py - y[k];
+        double dz = pz - z[k];
+        double d2 = dx*dx + dy*dy + dz*dz;
+        if (d2<=r2) {
+            ri[count] = id;
+            rj[count] = ids[k];
+            rd[count] = d2;
+            ++count;
+        }
+    }
+    return count;
+}
+
+__attribute__((target("avx2")))
+static bool within_avx2_d(const double* x, const double* y, const double* z,
+                          uint32_t n, double px, double py, double pz, double r2) {
+    const __m256d X = _mm256_set1_pd(px);
+    const __m256d Y = _mm256_set1_pd(py);
+    const __m256d Z = _mm256_set1_pd(pz);
+    const __m256d R2 = _mm256_set1_pd(r2);
+    uint32_t k=0;
+    for (; k+4<=n; k+=4) {
+        __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(x+k), X);
+        __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(y+k), Y);
+        __m256d dz = _mm256_sub_pd(_mm256_loadu_pd(z+k), Z);
+        __m256d d2 = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(dx,dx),
+                                                 _mm256_mul_pd(dy,dy)),
+                                                 _mm256_mul_pd(dz,dz));
+        if (_mm256_movemask_pd(_mm256_cmp_pd(d2, R2, _CMP_LE_OQ))) return true;
+    }
+    for (; k<n; k++) {
+        double dx = px - x[k];
+        double dy = py - y[k];
+        double dz = pz - z[k];
+        if (dx*dx + dy*dy + dz*dz <= r2) return true;
+    }
+    return false;
+}
+
+/* float, AVX-512.  Remainders are handled with masked loads. */
+
+__attribute__((target("avx512f")))
+static uint32_t contacts_avx512_f(const float* x, const float* y, const float* z,
+                                  const Id* ids, uint32_t n,
+                                  float px, float py, float pz, float r2, Id id,
+                                  Id* ri, Id* rj, float* rd) {
+    const __m512 X = _mm512_set1_ps(px);
+    const __m512 Y = _mm512_set1_ps(py);
+    const __m512 Z = _mm512_set1_ps(pz);
+    const __m512 R2 = _mm512_set1_ps(r2);
+    const __m512i I = _mm512_set1_epi32(id);
+    uint32_t count=0;
+    for (uint32_t k=0; k<n; k+=16) {
+        __mmask16 live = n-k>=16 ? 0xffff : (__mmask16)((1u<<(n-k))-1);
+        __m512 dx = _mm512_sub_round_ps(_mm512_maskz_loadu_ps(live, x+k), X, R512);
+        __m512 dy = _mm512_sub_round_ps(_mm512_maskz_loadu_ps(live, y+k), Y, R512);
+        __m512 dz = _mm512_sub_round_ps(_mm512_maskz_loadu_ps(live, z+k), Z, R512);
+        __m512 d2 = _mm512_add_round_ps(
+                _mm512_add_round_ps(_mm512_mul_round_ps(dx,dx,R512),
+                                    _mm512_mul_round_ps(dy,dy,R512), R512),
+                _mm512_mul_round_ps(dz,dz,R512), R512);
+        __m512i j16 = _mm512_maskz_loadu_epi32(live, ids+k);
+        __mmask16 mask = _mm512_mask_cmp_ps_mask(live, d2, R2, _CMP_LE_OQ);
+        mask = _mm512_mask_cmpneq_epi32_mask(mask, j16, I);
+        if (!mask) continue;
+        unsigned c = __builtin_popcount(mask);
+        _mm512_mask_storeu_epi32(ri+count, (__mmask16)((1u<<c)-1), I);
+        _mm512_mask_compressstoreu_epi32(rj+count, mask, j16);
+        _mm512_mask_compressstoreu_ps(rd+count, mask, d2);
+        count += c;
+    }
+    return count;
+}
+
+__attribute__((target("avx512f")))
+static bool within_avx512_f(const float* x, const float* y, const float* z,
+                            uint32_t n, float px, float py, float pz, float r2) {
+    const __m512 X = _mm512_set1_ps(px);
+    const __m512 Y = _mm512_set1_ps(py);
+    const __m512 Z = _mm512_set1_ps(pz);
+    const __m512 R2 = _mm512_set1_ps(r2);
+    for (uint32_t k=0; k<n; k+=16) {
+        __mmask16 live = n-k>=16 ? 0xffff : (__mmask16)((1u<<(n-k))-1);
+        __m512 dx = _mm512_sub_round_ps(_mm512_maskz_loadu_ps(live, x+k), X, R512);
+        __m512 dy = _mm512_sub_round_ps(_mm512_maskz_loadu_ps(live, y+k), Y, R512);
+        __m512 dz = _mm512_sub_round_ps(_mm512_maskz_loadu_ps(live, z+k), Z, R512);
+        __m512 d2 = _mm512_add_round_ps(
+                _mm512_add_round_ps(_mm512_mul_round_ps(dx,dx,R512),
+                                    _mm512_mul_round_ps(dy,dy,R512), R512),
+                _mm512_mul_round_ps(dz,dz,R512), R512);
+        if (_mm512_mask_cmp_ps_mask(live, d2, R2, _CMP_LE_OQ)) return true;
+    }
+    return false;
+}
+
+/* double, AVX-512 */
+
+__attribute__((target("avx512f")))
+static uint32_t contacts_avx512_d(const double* x, const double* y, const double* z,
+                                  const Id* ids, uint32_t n,
+                                  double px, double py, double pz, double r2, Id id,
+                                  Id* ri, Id* rj, double* rd) {
+    const __m512d X = _mm512_set1_pd(px);
+    const __m512d Y = _mm512_set1_pd(py);
+    const __m512d Z = _mm512_set1_pd(pz);
+    const __m512d R2 = _mm512_set1_pd(r2);
+    const __m512i I = _mm512_set1_epi64(id);
+    uint32_t count=0;
+    for (uint32_t k=0; k<n; k+=8) {
+        __mmask8 live = n-k>=8 ? 0xff : (__mmask8)((1u<<(n-k))-1);
+        __m512d dx = _mm512_sub_round_pd(_mm512_maskz_loadu_pd(live, x+k), X, R512);
+        __m512d dy = _mm512_sub_round_pd(_mm512_maskz_loadu_pd(live, y+k), Y, R512);
+        __m512d dz = _mm512_sub_round_pd(_mm512_maskz_loadu_pd(live, z+k), Z, R512);
+        __m512d d2 = _mm512_add_round_pd(
+                _mm512_add_round_pd(_mm512_mul_round_pd(dx,dx,R512),
+                                    _mm512_mul_round_pd(dy,dy,R512), R512),
+                _mm512_mul_round_pd(dz,dz,R512), R512);
+        /* widen ids to 64 bits so that only AVX512F is required */
+        __m512i j8 = _mm512_cvtepu32_epi64(_mm512_castsi512_si256(
+                    _mm512_maskz_loadu_epi32((__mmask16)live, ids+k)));
+        __mmask8 mask = _mm512_mask_cmp_pd_mask(live, d2, R2, _CMP_LE_OQ);
+        mask = _mm512_mask_cmpneq_epi64_mask(mask, j8, I);
+        if (!mask) continue;
+        unsigned c = __builtin_popcount(mask);
+        __mmask8 head = (__mmask8)((1u<<c)-1);
+        _mm512_mask_cvtepi64_storeu_epi32(ri+count, head, I);
+        _mm512_mask_cvtepi64_storeu_epi32(rj+count, head,
+                _mm512_maskz_compress_epi64(mask, j8));
+        _mm512_mask_compressstoreu_pd(rd+count, mask, d2);
+        count += c;
+    }
+    return count;
+}
+
+__attribute__((target("avx512f")))
+static bool within_avx512_d(const double* x, const double* y, const double* z,
+                            uint32_t n, double px, double py, double pz, double r2) {
+    const __m512d X = _mm512_set1_pd(px);
+    const __m512d Y = _mm512_set1_pd(py);
+    const __m512d Z = _mm512_set1_pd(pz);
+    const __m512d R2 = _mm512_set1_pd(r2);
+    for (uint32_t k=0; k<n; k+=8) {
+        __mmask8 live = n-k>=8 ? 0xff : (__mmask8)((1u<<(n-k))-1);
+        __m512d dx = _mm512_sub_round_pd(_mm512_maskz_loadu_pd(live, x+k), X, R512);
+        __m512d dy = _mm512_sub_round_pd(_mm512_maskz_loadu_pd(live, y+k), Y, R512);
+        __m512d dz = _mm512_sub_round_pd(_mm512_maskz_loadu_pd(live, z+k), Z, R512);
+        __m512d d2 = _mm512_add_round_pd(
+                _mm512_add_round_pd(_mm512_mul_round_pd(dx,dx,R512),
+                                    _mm512_mul_round_pd(dy,dy,R512), R512),
+                _mm512_mul_round_pd(dz,dz,R512), R512);
+        if (_mm512_mask_cmp_pd_mask(live, d2, R2, _CMP_LE_OQ)) return true;
+    }
+    return false;
+}
+
+#undef R512
+
+static Level supported() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return Avx512;
+    if (__builtin_cpu_supports("avx2")) return Avx2;
+    return Scalar;
+}
+
+static Level detect() {
+    Level best = supported();
+    const char* env = getenv("MSYS_SIMD");
+    if (env) {
+        Level cap = best;
+        if      (!strcmp(env, "scalar")) cap = Scalar;
+        else if (!strcmp(env, "avx2"))   cap = Avx2;
+        else if (!strcmp(env, "avx512")) cap = Avx512;
+        if (cap < best) best = cap;
+    }
+    return best;
+}
+
+Level level() {
+    static const Level lvl = detect();
+    return lvl;
+}
+
+template <>
+Kernels<float> const* kernels<float>(Level lvl) {
+    static const Kernels<float> avx2 = { contacts_avx2_f, within_avx2_f };
+    static const Kernels<float> avx512 = { contacts_avx512_f, within_avx512_f };
+    if (lvl > supported()) return nullptr;
+    switch (lvl) {
+        case Avx512: return &avx512;
+        case Avx2:   return &avx2;
+        default:     return nullptr;
+    }
+}
+
+template <>
+Kernels<double> const* kernels<double>(Level lvl) {
+    static const Kernels<double> avx2 = { contacts_avx2_d, within_avx2_d };
+    static const Kernels<double> avx512 = { contacts_avx512_d, within_avx512_d };
+    if (lvl > supported()) return nullptr;
+    switch (lvl) {
+        case Avx512: return &avx512;
+        case Avx2:   return &avx2;
+        default:     return nullptr;
+    }
+}
+
+#else
+
+Level level() { return Scalar; }
+
+template <>
+Kernels<float> const* kernels<float>(Level) { return nullptr; }
+
+template <>
+Kernels<double> const* kernels<double>(Level) { return nullptr; }
+
+#endif
+
+}}}
@@ -0,0 +1,52 @@
+#ifndef desres_msys_spatial_hash_simd_hxx
+#define desres_msys_spatial_hash_simd_hxx
+
+#include "types.hxx"
+
+namespace desres { namespace msys { namespace spatial_hash_simd {
+
+    /* Instruction sets for which distance kernels are available. */
+    enum Level { Scalar=0, Avx2=1, Avx512=2 };
+
+    /* The widest level supported by both this build and the running cpu,
+     * capped by the MSYS_SIMD environment variable ("scalar", "avx2" or
+     * "avx512") if set.  Determined on first use. */
+    Level level();
+
+    /* Kernels over one strip of n hashed points in SoA layout.  No
+     * alignment is assumed.  Distances are computed exactly as in the
+     * scalar code, so results do not depend on the level in use.
+     *
+     * contacts appends (id, ids[k], d2) for every point k with
+     * d2 <= r2 and ids[k] != id to ri, rj, rd in strip order, and returns
+     * the number appended.  Entries past the returned count, up to n,
+     * may be overwritten.
+     *
+     * within returns true if any point has d2 <= r2. */
+    template <typename Float>
+    struct Kernels {
+        uint32_t (*contacts)(const Float* x, const Float* y, const Float* z,
+                             const Id* ids, uint32_t n,
+                             Float px, Float py, Float pz, Float r2, Id id,
+                             Id* ri, Id* rj, Float* rd);
+        bool (*within)(const Float* x, const Float* y, const Float* z,
+                       uint32_t n, Float px, Float py, Float pz, Float r2);
+    };
+
+    /* Kernels for the given level, or NULL if the level is Scalar or is
+     * not supported by this build and cpu. */
+    template <typename Float>
+    Kernels<Float> const* kernels(Level lvl);
+    template <> Kernels<float> const* kernels<float>(Level lvl);
+    template <> Kernels<double> const* kernels<double>(Level lvl);
+
+    /* Kernels for level(), or NULL if level() is Scalar. */
+    template <typename Float>
+    Kernels<Float> const* kernels() {
+        static Kernels<Float> const* k = kernels<Float>(level());
+        return k;
+    }
+
+}}}
+
+#endif
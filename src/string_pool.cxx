@@ -0,0 +1,175 @@
+#include "string_pool.hxx"
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+using namespace desres::msys;
+
+namespace {
+
+    struct entry_t {
+        const char*             s;
+        uint32_t                n;
+        std::atomic<uint32_t>   refs;
+    };
+
+    /* Entries live in chunks which are never moved or freed, so readers
+     * can index them without locking.  Chunk k holds first_size<<k
+     * entries, so max_chunks chunks cover every 32-bit handle. */
+    const Id first_bits = 12;
+    const Id first_size = 1<<first_bits;
+    const Id max_chunks = 32-first_bits+1;
+
+    std::atomic<entry_t*> chunks[max_chunks];
+    std::atomic<Id> nstrings(1);    /* handle 0 is the empty string */
+
+    /* the text itself is owned by the keys of this map.  Handles of
+     * released strings are kept in free for reuse. */
+    struct pool_t {
+        std::mutex mtx;
+        std::unordered_map<std::string, Id> ids;
+        std::vector<Id> free;
+    };
+
+    pool_t& pool() {
+        static pool_t* p = new pool_t;  /* never destroyed */
+        return *p;
+    }
+
+    /* Recently interned handles, so that repeated names can be found
+     * without taking the lock.  A cached handle may since have been
+     * released and reused, so hits are checked after taking a reference. */
+    const unsigned cache_size = 64;
+    thread_local Id cache[cache_size];
+
+    inline unsigned slot(const char* s, size_t sz) {
+        uint32_t h = 2166136261u;
+        for (size_t i=0; i<sz; i++) h = (h ^ (unsigned char)s[i]) * 16777619u;
+        return h % cache_size;
+    }
+
+    inline unsigned chunk_of(Id id) {
+        return 31 - __builtin_clz((id>>first_bits)+1);
+    }
+
+    inline entry_t& entry(Id id) {
+        unsigned k = chunk_of(id);
+        Id base = ((Id(1)<<k)-1) << first_bits;
+        return chunks[k].load(std::memory_order_acquire)[id-base];
+    }
+
+    inline bool matches(Id id, const char* s, size_t sz) {
+        entry_t const& e = entry(id);
+        return e.n==sz && !memcmp(e.s, s, sz);
+    }
+
+    /* take a reference to id unless it has already been released */
+    inline bool try_retain(Id id) {
+        std::atomic<uint32_t>& refs = entry(id).refs;
+        uint32_t n = refs.load(std::memory_order_relaxed);
+        while (n && !refs.compare_exchange_weak(n, n+1,
+                    std::memory_order_acquire, std::memory_order_relaxed)) {}
+        return n!=0;
+    }
+
+    /* a free handle, with its chunk allocated.  Called with the lock held. */
+    Id allocate(pool_t& p) {
+        if (!p.free.empty()) {
+            Id id = p.free.back();
+            p.free.pop_back();
+            return id;
+        }
+        Id id = nstrings.load(std::memory_order_relaxed);
+        if (id==BadId) MSYS_FAIL("StringPool is full");
+        unsigned k = chunk_of(id);
+        if (!chunks[k].load(std::memory_order_relaxed)) {
+            chunks[k].store(new entry_t[first_size<<k](),
+                            std::memory_order_release);
+        }
+        nstrings.store(id+1, std::memory_order_release);
+        return id;
+    }
+}
+
+Id StringPool::intern(const char* s, size_t sz) {
+    if (sz==0) return 0;
+    Id& cached = cache[slot(s,sz)];
+    if (cached && try_retain(cached)) {
+        if (matches(cached, s, sz)) return cached;
+        release(cached);
+    }
+
+    pool_t& p = pool();
+    std::lock_guard<std::mutex> lock(p.mtx);
+    auto r = p.ids.emplace(std::string(s, sz), 0);
+    if (r.second) {
+        Id id;
+        try {
+            id = allocate(p);
+        } catch (std::exception&) {
+            p.ids.erase(r.first);
+            throw;
+        }
+        entry_t& e = entry(id);
+        e.s = r.first->first.c_str();
+        e.n = sz;
+        e.refs.store(1, std::memory_order_release);
+        r.first->second = id;
+    } else {
+        /* may revive a string whose last reference is being released */
+        entry(r.first->second).refs.fetch_add(1, std::memory_order_relaxed);
+    }
+    cached = r.first->second;
+    return cached;
+}
+
+void StringPool::retain(Id id) {
+    if (id) entry(id).refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+void StringPool::release(Id id) {
+    if (!id) return;
+    entry_t& e = entry(id);
+    if (e.refs.fetch_sub(1, std::memory_order_acq_rel)!=1) return;
+
+    pool_t& p = pool();
+    std::lock_guard<std::mutex> lock(p.mtx);
+    /* someone else may have revived or already freed the entry */
+    if (e.refs.load(std::memory_order_relaxed) || !e.s) return;
+    p.ids.erase(std::string(e.s, e.n));
+    e.s = NULL;
+    e.n = 0;
+    p.free.push_back(id);
+}
+
+Id StringPool::find(const char* s, size_t sz) {
+    if (sz==0) return 0;
+    pool_t& p = pool();
+    std::lock_guard<std::mutex> lock(p.mtx);
+    auto iter = p.ids.find(std::string(s, sz));
+    return iter==p.ids.end() ? BadId : iter->second;
+}
+
+const char* StringPool::c_str(Id id) {
+    return id ? entry(id).s : "";
+}
+
+size_t StringPool::size(Id id) {
+    return id ? entry(id).n : 0;
+}
+
+Id StringPool::count() {
+    return nstrings.load(std::memory_order_acquire);
+}
+
+const char* StringArena::intern(const char* s, size_t sz) {
+    std::lock_guard<std::mutex> lock(_mtx);
+    return _strs.emplace(s, sz).first->c_str();
+}
+
+const char* StringArena::find(const char* s, size_t sz) {
+    std::lock_guard<std::mutex> lock(_mtx);
+    auto iter = _strs.find(std::string(s, sz));
+    return iter==_strs.end() ? NULL : iter->c_str();
+}
@@ -0,0 +1,178 @@
+#ifndef desres_msys_string_pool_hxx
+#define desres_msys_string_pool_hxx
+
+#include "types.hxx"
+#include <string>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string.h>
+#include <utility>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+
+namespace desres { namespace msys {
+
+    /* Process-wide table of interned strings.  Each distinct string is
+     * stored once and named by a 4-byte handle; handle 0 is the empty
+     * string.  Handles are reference counted: a string is freed, and its
+     * handle reused, once the last reference is released.  Interning may
+     * take a lock; getting the text of a handle never does. */
+    class StringPool {
+    public:
+        /* handle for the given string, adding it to the pool if needed.
+         * The caller owns one reference to the handle. */
+        static Id intern(const char* s, size_t sz);
+
+        /* add or drop a reference to a handle */
+        static void retain(Id id);
+        static void release(Id id);
+
+        /* handle for the given string, or BadId if it is not in the pool.
+         * No reference is taken. */
+        static Id find(const char* s, size_t sz);
+
+        /* text and length of a handle, valid while it is referenced */
+        static const char* c_str(Id id);
+        static size_t size(Id id);
+
+        /* one more than the largest handle issued so far */
+        static Id count();
+    };
+
+    /* Strings owned by whoever holds the arena, rather than by the
+     * process.  Each distinct string is stored once, so equal strings
+     * interned in the same arena share a pointer; the text is freed
+     * when the last holder of the arena goes away. */
+    class StringArena {
+        std::mutex _mtx;
+        std::unordered_set<std::string> _strs;
+
+    public:
+        /* the arena's copy of s, added if needed */
+        const char* intern(const char* s, size_t sz);
+
+        /* the arena's copy of s, or NULL if it has none */
+        const char* find(const char* s, size_t sz);
+    };
+    typedef std::shared_ptr<StringArena> StringArenaPtr;
+
+    /* Drop-in replacement for SmallString<N> holding a reference to a
+     * StringPool handle.  Equal strings have equal handles, so equality is an
+     * integer comparison.  Strings longer than N characters are rejected
+     * as SmallString<N> does, and serialization uses the SmallString<N>
+     * layout so that archives are unchanged. */
+    template <int N>
+    class InternedString {
+        Id _id;
+
+        void _copy(const char* p, size_t sz) {
+            if (sz>N) {
+                std::stringstream ss;
+                ss << "Could not assign string of size " << sz << " ('"
+                    << p << " to InternedString<" << N << ">";
+                throw std::runtime_error(ss.str());
+            }
+            Id id = StringPool::intern(p, sz);
+            StringPool::release(_id);
+            _id = id;
+        }
+
+    public:
+        template<class Archive>
+        void save(Archive & archive) const {
+            char s[N+1] = {0};
+            unsigned char n = StringPool::size(_id);
+            memcpy(s, c_str(), n);
+            archive(s, n);
+        }
+
+        template<class Archive>
+        void load(Archive & archive) {
+            char s[N+1];
+            unsigned char n;
+            archive(s, n);
+            _copy(s, n>N ? N : n);
+        }
+
+        InternedString() : _id() {}
+
+        InternedString(std::string const& o) : _id() {
+            *this = o;
+        }
+
+        InternedString(InternedString const& o) : _id(o._id) {
+            StringPool::retain(_id);
+        }
+
+        InternedString(InternedString&& o) : _id(o._id) {
+            o._id = 0;
+        }
+
+        ~InternedString() {
+            StringPool::release(_id);
+        }
+
+        InternedString& operator=(InternedString const& o) {
+            StringPool::retain(o._id);
+            StringPool::release(_id);
+            _id = o._id;
+            return *this;
+        }
+
+        InternedString& operator=(InternedString&& o) {
+            std::swap(_id, o._id);
+            return *this;
+        }
+
+        operator std::string() const {
+            return std::string(c_str(), size());
+        }
+
+        bool operator==(InternedString<N> const& o) const {
+            return _id==o._id;
+        }
+
+        bool operator==(std::string const& o) const {
+            return !strcmp(c_str(), o.data());
+        }
+
+        InternedString& operator=(std::string const& p) {
+            _copy(p.data(), p.size());
+            return *this;
+        }
+
+        InternedString& assign(const char* p, size_t sz) {
+            _copy(p,sz);
+            return *this;
+        }
+
+        /* the pool handle */
+        Id id() const { return _id; }
+
+        const char* c_str() const {
+            return StringPool::c_str(_id);
+        }
+
+        size_t size() const {
+            return StringPool::size(_id);
+        }
+
+        bool empty() const {
+            return _id==0;
+        }
+
+        char const& operator[](size_t i) const {
+            return c_str()[i];
+        }
+    };
+
+    template <int M>
+    std::ostream& operator<<(std::ostream& out, InternedString<M> const& self) {
+        out << self.c_str();
+        return out;
+    }
+}}
+
+#endif
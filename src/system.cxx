@@ -1,8 +1,9 @@
 #include "system.hxx"
 #include "append.hxx"
+#include "parallel.hxx"
 #include <msys/version.hxx>
 #include <sstream>
-#include <stack>
+#include <atomic>
 #include <stdexcept>
 #include <stdio.h>
 #include <ctype.h>
@@ -26,31 +27,68 @@ System::System()
 System::~System() {
 }
 
+SystemPtr System::snapshot() const {
+    SystemPtr ptr = create();
+    System& dst = *ptr;
+    dst.name = name;
+    dst.global_cell = global_cell;
+    dst.nonbonded_info = nonbonded_info;
+
+    dst._atoms = _atoms;
+    dst._deadatoms = _deadatoms;
+    dst._pos = _pos;
+    dst._vel = _vel;
+    dst._atomprops = _atomprops->snapshot();
+    dst._bonds = _bonds;
+    dst._deadbonds = _deadbonds;
+    dst._bondprops = _bondprops->snapshot();
+    dst._bondindex = _bondindex;
+    dst._residues = _residues;
+    dst._deadresidues = _deadresidues;
+    dst._residueatoms = _residueatoms;
+    dst._chains = _chains;
+    dst._deadchains = _deadchains;
+    dst._chainresidues = _chainresidues;
+    dst._cts = _cts;
+    dst._deadcts = _deadcts;
+    dst._ctchains = _ctchains;
+
+    std::unordered_map<ParamTablePtr, ParamTablePtr> params;
+    for (auto const& t : _tables) {
+        ParamTablePtr& p = params[t.second->params()];
+        if (!p) p = t.second->params()->snapshot();
+        dst._tables[t.first] = t.second->snapshot(ptr, p);
+    }
+    for (auto const& t : _auxtables) {
+        dst._auxtables[t.first] = t.second->snapshot();
+    }
+    dst._provenance = _provenance;
+    return ptr;
+}
+
 Id System::addAtom(Id residue) { 
     Id id = _atoms.size();
     atom_t atm;
     atm.residue = residue;
     _residueatoms.at(residue).push_back(id);
     _atoms.push_back(atm);
+    _pos.push_back(Coord());
+    _vel.push_back(Coord());
     _atomprops->addParam();
     while (_bondindex.size() < _atoms.size()) {
         _bondindex.push_back(IdList());
     }
+    _bondgraph.reset();
     return id;
 }
 
 template <typename T>
-static IdList get_ids( const T& list, const IdSet& dead ) {
+static IdList get_ids( const T& list, const IdBitmap& dead ) {
     IdList ids(list.size()-dead.size());
-    if (!dead.size()) for (Id i=0; i<ids.size(); i++) {
-        ids[i] = i;
-    } else {
-        Id j=0;
-        for (Id i=0; i<list.size(); i++) {
-            if (!dead.count(i)) {
-                ids[j++]=i;
-            }
-        }
+    const Id end = list.size();
+    Id j=0;
+    for (Id i=dead.next_clear(0, end); i<end; i=dead.next_clear(i+1, end)) {
+        ids[j++]=i;
     }
     return ids;
 }
@@ -106,6 +144,7 @@ Id System::addBond(Id i, Id j) {
     _bondindex[i].push_back(id);
     _bondindex[j].push_back(id);
     _bondprops->addParam();
+    _bondgraph.reset();
     return id;
 }
 
@@ -190,20 +229,23 @@ component_t& component_t::operator=(component_t const& c) {
 }
 
 void System::delBond(Id id) {
-    const bond_t& b = _bonds.at(id);
+    System const& self = *this;     /* read without copying blocks */
+    const bond_t& b = self.bond(id);
     _deadbonds.insert(id);
     find_and_remove(_bondindex[b.i], id);
     find_and_remove(_bondindex[b.j], id);
+    _bondgraph.reset();
 }
 
 void System::delAtom(Id id) {
     if (id>=_atoms.size()) return;
+    System const& self = *this;
     IdList del = bondsForAtom(id);
     for (IdList::const_iterator i=del.begin(); i!=del.end(); ++i) {
         delBond(*i);
     }
     _deadatoms.insert(id);
-    find_and_remove(_residueatoms.at(_atoms[id].residue), id);
+    find_and_remove(_residueatoms.at(self.atomFAST(id).residue), id);
     for (TableMap::iterator t=_tables.begin(); t!=_tables.end(); ++t) {
         t->second->delTermsWithAtom(id);
     }
@@ -303,12 +345,13 @@ IdList System::residuesForCt(Id ct) const {
 void System::delResidue(Id id) {
     /* nothing to do if invalid residue */
     if (id>=_residues.size()) return;
+    System const& self = *this;
 
     /* nothing to do if already deleted */
-    if (!_deadresidues.insert(id).second) return;
+    if (!_deadresidues.insert(id)) return;
 
     /* remove from parent chain */
-    find_and_remove(_chainresidues.at(_residues[id].chain), id);
+    find_and_remove(_chainresidues.at(self.residueFAST(id).chain), id);
 
     /* remove child atoms.  Clear the index first to avoid O(N) lookups */
     IdList ids;
@@ -321,12 +364,13 @@ void System::delResidue(Id id) {
 void System::delChain(Id id) {
     /* nothing to do if invalid chain */
     if (id>=_chains.size()) return;
+    System const& self = *this;
 
     /* nothing to do if already deleted */
-    if (!_deadchains.insert(id).second) return;
+    if (!_deadchains.insert(id)) return;
 
     /* remove from parent ct */
-    find_and_remove(_ctchains.at(_chains[id].ct), id);
+    find_and_remove(_ctchains.at(self.chainFAST(id).ct), id);
 
     /* remove child residues.  Clear the index first to avoid O(N) lookups */
     IdList ids;
@@ -341,7 +385,7 @@ void System::delCt(Id id) {
     if (id>=_cts.size()) return;
 
     /* nothing to do if already deleted */
-    if (!_deadcts.insert(id).second) return;
+    if (!_deadcts.insert(id)) return;
 
     /* remove child chains .  Clear the index first to avoid O(N) lookups */
     IdList ids;
@@ -351,49 +395,82 @@ void System::delCt(Id id) {
     }
 }
 
+namespace {
+    /* Union-find which may be updated from several threads at once.
+     * Every link points from the larger root to the smaller, so the
+     * root of each set is its smallest member. */
+    class MinUnionFind {
+        std::vector<std::atomic<Id> > _parent;
+
+    public:
+        explicit MinUnionFind(Id n) : _parent(n) {
+            for (Id i=0; i<n; i++) _parent[i].store(i, std::memory_order_relaxed);
+        }
+
+        Id find(Id x) {
+            for (;;) {
+                Id p = _parent[x].load();
+                if (p==x) return x;
+                Id gp = _parent[p].load();
+                /* path halving: gp is still an ancestor of x if this fails */
+                if (gp!=p) _parent[x].compare_exchange_weak(p, gp);
+                x = gp;
+            }
+        }
+
+        void unite(Id a, Id b) {
+            for (;;) {
+                a = find(a);
+                b = find(b);
+                if (a==b) return;
+                if (a<b) std::swap(a,b);
+                Id expected = a;
+                if (_parent[a].compare_exchange_strong(expected, b)) return;
+            }
+        }
+    };
+}
+
 Id System::updateFragids(MultiIdList* fragments) {
 
-    /* Create local storage for all atoms (even deleted)
-     * this simplifies and speeds up the code below. */
-    IdList assignments(_atoms.size(),BadId);
+    /* Join the endpoints of every live bond, in parallel for large
+     * systems.  Deleted atoms have no bonds, so they remain singletons.
+     * Reads go through self so that blocks shared with a snapshot are
+     * neither copied nor touched from several threads. */
+    System const& self = *this;
+    const Id natoms = _atoms.size();
+    MinUnionFind sets(natoms);
+    static const uint64_t grain = 1<<16;
+    parallel_chunks(_bonds.size(), 0, [&](unsigned, uint64_t b, uint64_t e) {
+        for (Id i=b; i<e; i++) {
+            if (_deadbonds.count(i)) continue;
+            bond_t const& bnd = self.bondFAST(i);
+            sets.unite(bnd.i, bnd.j);
+        }
+    }, grain);
 
-    std::stack<Id> S;
+    /* Number the fragments in order of their smallest atom, which is the
+     * root of each set and so is numbered before the rest of its set.
+     * Only changed fragids are written, so an up to date snapshot keeps
+     * sharing its atoms. */
     Id fragid=0;
-    for (Id idx=0, n=_atoms.size(); idx<n; idx++) {
-        if (!bad(assignments[idx])) continue;   /* already assigned */
-        if (_deadatoms.count(idx)) continue;  /* ignore removed atoms */
-        S.push(idx);
-        assignments[idx] = fragid;
-        do {
-            Id aid=S.top();
-            S.pop();
-            IdList& bonds = _bondindex[aid];
-            for (IdList::iterator j=bonds.begin(), e=bonds.end(); j!=e; ++j) {
-                Id other = _bonds[*j].other(aid);
-                if(bad(assignments[other])){
-                   assignments[other]=fragid;
-                   /* Only add this atom if its non-terminal */
-                   if(_bondindex[other].size() >1) S.push(other);
-                }
-            }
-        } while (S.size());
-        ++fragid;
+    for (Id aid=0; aid<natoms; aid++) {
+        Id fid = BadId;
+        if (!_deadatoms.count(aid)) {
+            Id root = sets.find(aid);
+            fid = root==aid ? fragid++ : self.atomFAST(root).fragid;
+        }
+        if (self.atomFAST(aid).fragid != fid) _atoms[aid].fragid = fid;
     }
-    
-    /* assign computed fragids to atoms and fragment list */
+
     if(fragments){
         fragments->clear();
         fragments->resize(fragid);
-        for (Id aid=0, n=_atoms.size(); aid<n; aid++) {
-            Id fid=assignments[aid];
-            _atoms[aid].fragid = fid;
+        for (Id aid=0; aid<natoms; aid++) {
+            Id fid=self.atomFAST(aid).fragid;
             if(bad(fid)) continue;   /* deleted atom */
             (*fragments)[fid].push_back(aid);
         }
-    }else{
-        for (Id aid=0, n=_atoms.size(); aid<n; aid++) {
-            _atoms[aid].fragid = assignments[aid];
-        }
     }
     return fragid;
 }
@@ -536,9 +613,37 @@ void System::removeTable(TermTablePtr terms) {
 }
 
 void System::coalesceTables() {
-    for (TableMap::iterator i=_tables.begin(), e=_tables.end(); i!=e; ++i) {
-        i->second->coalesce();
+    /* Tables are coalesced in parallel, except that tables sharing a
+     * param table (directly or through their overrides) must be done
+     * serially, since coalescing updates reference counts in it. */
+    std::vector<TermTablePtr> tables;
+    for (auto const& it : _tables) tables.push_back(it.second);
+    const Id n = tables.size();
+    IdList group(n);
+    std::map<ParamTable*, Id> owner;
+    for (Id i=0; i<n; i++) {
+        group[i] = i;
+        ParamTable* ptrs[] = { tables[i]->params().get(),
+                               tables[i]->overrides()->params().get() };
+        for (ParamTable* ptr : ptrs) {
+            auto r = owner.insert(std::make_pair(ptr, i));
+            if (r.second) continue;
+            Id g = group[r.first->second];
+            Id h = group[i];
+            if (g==h) continue;
+            for (Id& x : group) if (x==h) x=g;
+        }
     }
+    std::map<Id, std::vector<TermTablePtr> > groups;
+    for (Id i=0; i<n; i++) groups[group[i]].push_back(tables[i]);
+    std::vector<std::vector<TermTablePtr> const*> work;
+    for (auto const& it : groups) work.push_back(&it.second);
+
+    parallel_chunks(work.size(), 0, [&](unsigned, uint64_t b, uint64_t e) {
+        for (uint64_t i=b; i<e; i++) {
+            for (auto const& table : *work[i]) table->coalesce();
+        }
+    });
 }
 
 void System::addAuxTable(String const& name, ParamTablePtr aux) {
@@ -586,6 +691,18 @@ IdList System::bondedAtoms(Id id) const {
     return ids;
 }
 
+BondGraphPtr System::bondGraph() const {
+    /* const callers may race to build the snapshot; each builds the same
+     * graph, so whichever is stored last is fine. */
+    BondGraphPtr g = std::atomic_load(&_bondgraph);
+    if (!g) {
+        g = std::make_shared<BondGraph>(_bondindex,
+                [this](Id b, Id i) { return _bonds[b].other(i); });
+        std::atomic_store(&_bondgraph, g);
+    }
+    return g;
+}
+
 Id System::atomPropCount() const {
     return _atomprops->propCount();
 }
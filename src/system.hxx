@@ -2,13 +2,19 @@
 #define desres_msys_system_hxx
 
 #include <vector>
+#include <array>
 #include <map>
 #include <cstddef>
+#include <algorithm>
 
 #include "term_table.hxx"
 #include "provenance.hxx"
 #include "value.hxx"
 #include "smallstring.hxx"
+#include "string_pool.hxx"
+#include "id_bitmap.hxx"
+#include "block_array.hxx"
+#include "bond_graph.hxx"
 
 namespace desres { namespace msys {
 
@@ -60,6 +66,8 @@ namespace desres { namespace msys {
         pod() { memset(this,0,sizeof(T)); }
     };
 
+    /* Positions and velocities are not stored here but in separate
+     * per-System arrays; see System::atomPos() and System::atomVel(). */
     struct atom_t : pod<atom_t> {
         Id  fragid;
         Id  residue;
@@ -69,25 +77,11 @@ namespace desres { namespace msys {
         int8_t stereo_parity;
         int8_t aromatic;
     
-        Float x,y,z;    /* position */
         Float charge;   /* partial charge */
-        Float vx,vy,vz; /* velocity */
         Float mass;
     
-        SmallString<30> name;
+        InternedString<30> name;
         AtomType type;
-
-        template<class Archive>
-        void serialize(Archive & archive) {
-            archive(fragid, residue, atomic_number, formal_charge, stereo_parity, aromatic);
-            archive(x,y,z,charge, vx,vy,vz,mass);
-            archive(name, type);
-        }
-    
-        /* Don't abuse these.  In particular, bear in mind that that an atom's
-         * memory location will move around if atoms are added.  */
-        double       *pos()       { return &x; }
-        const double *pos() const { return &x; }
     };
     
     struct bond_t {
@@ -118,7 +112,7 @@ namespace desres { namespace msys {
     struct residue_t {
         Id      chain;
         int     resid;
-        SmallString<30> name;
+        InternedString<30> name;
         SmallString<6> insertion;
         ResidueType type;
     
@@ -180,40 +174,90 @@ namespace desres { namespace msys {
     
         static IdList _empty;
     
+        /* Elements, coordinates and the lists of subelements are kept in
+         * BlockArrays, so that a snapshot shares them block by block. */
+        typedef std::array<Float,3> Coord;
+        typedef BlockArray<Coord> CoordList;
+        typedef BlockArray<IdList> IdIndex;
+
         /* _atoms maps an id to an atom.  We almost never delete atoms, so
-         * keep track of deleted atoms in a separate set.  This is needed only
-         * by an atom iterator */
-        typedef std::vector<atom_t> AtomList;
+         * keep track of deleted atoms in a separate bitmap.  This is needed
+         * only by an atom iterator */
+        typedef BlockArray<atom_t> AtomList;
         AtomList    _atoms;
-        IdSet       _deadatoms;
+        IdBitmap    _deadatoms;
+
+        /* positions and velocities, one per atom id, including deleted
+         * atoms.  Each block is 3 x 1024 contiguous values. */
+        CoordList   _pos;
+        CoordList   _vel;
+
+        template <typename T>
+        void get_coords(CoordList const& v, T setter) const {
+            static_assert(sizeof(Coord)==3*sizeof(Float), "padded Coord");
+            if (_deadatoms.empty()) {
+                v.forEachBlock([&setter](const Coord* p, Id n) {
+                    setter = std::copy(p->data(), p->data()+3*n, setter);
+                });
+                return;
+            }
+            for (iterator i=atomBegin(), e=atomEnd(); i!=e; ++i) {
+                const Float* p = v[*i].data();
+                *setter++ = p[0];
+                *setter++ = p[1];
+                *setter++ = p[2];
+            }
+        }
+
+        template <typename T>
+        void set_coords(CoordList& v, T getter) {
+            if (_deadatoms.empty()) {
+                v.forEachWritableBlock([&getter](Coord* p, Id n) {
+                    for (Float *q=p->data(), *e=q+3*n; q!=e; ++q) {
+                        *q = *getter++;
+                    }
+                });
+                return;
+            }
+            for (iterator i=atomBegin(), e=atomEnd(); i!=e; ++i) {
+                Float* p = v[*i].data();
+                p[0] = *getter++;
+                p[1] = *getter++;
+                p[2] = *getter++;
+            }
+        }
 
         /* additional properties for atoms */
         ParamTablePtr _atomprops;
 
         /* same deal for bonds */
-        typedef std::vector<bond_t> BondList;
+        typedef BlockArray<bond_t> BondList;
         BondList    _bonds;
-        IdSet       _deadbonds;
+        IdBitmap    _deadbonds;
         ParamTablePtr _bondprops;
     
         /* map from atom id to 0 or more bond ids.  We do keep this updated when
          * atoms or bonds are deleted */
-        MultiIdList   _bondindex;
+        IdIndex     _bondindex;
+
+        /* CSR snapshot of _bondindex, built on demand by bondGraph() and
+         * dropped whenever atoms or bonds are added or removed. */
+        mutable BondGraphPtr _bondgraph;
     
-        typedef std::vector<residue_t> ResidueList;
+        typedef BlockArray<residue_t> ResidueList;
         ResidueList _residues;
-        IdSet       _deadresidues;
-        MultiIdList   _residueatoms;  /* residue id -> atom ids */
+        IdBitmap    _deadresidues;
+        IdIndex     _residueatoms;  /* residue id -> atom ids */
     
-        typedef std::vector<chain_t> ChainList;
+        typedef BlockArray<chain_t> ChainList;
         ChainList   _chains;
-        IdSet       _deadchains;
-        MultiIdList   _chainresidues; /* chain id -> residue id */
+        IdBitmap    _deadchains;
+        IdIndex     _chainresidues; /* chain id -> residue id */
     
-        typedef std::vector<component_t> CtList;
+        typedef BlockArray<component_t> CtList;
         CtList      _cts;
-        IdSet       _deadcts;
-        MultiIdList _ctchains; /* ct id -> chain id */
+        IdBitmap    _deadcts;
+        IdIndex     _ctchains; /* ct id -> chain id */
     
         typedef std::map<String,TermTablePtr> TableMap;
         TableMap    _tables;
@@ -273,7 +317,7 @@ namespace desres { namespace msys {
                 _f(_provenance)
 
 #define _SER_ENUM(_x)   S_ ## _x,
-#define _SER_A(_x)      case S_ ## _x: a(_x); break;
+#define _SER_A(_x)      case S_ ## _x: serialize_member(a, _x); break;
 
         enum serialized_vars {
             _SER_LIST(_SER_ENUM)
@@ -282,6 +326,25 @@ namespace desres { namespace msys {
 
         static inline size_t serialize_max() { return S_MAX; }
 
+        template <class Archive, typename T>
+        void serialize_member(Archive& a, T& x) { a(x); }
+
+        /* Atoms are serialized with their positions and velocities inline,
+         * as they were stored before the coordinates moved out of atom_t.
+         * Defined in cereal.cxx. */
+        template <class Archive>
+        void serialize_member(Archive& a, AtomList& atoms);
+
+        /* Other BlockArrays are serialized as the std::vector they used
+         * to be. */
+        template <class Archive, typename T>
+        void serialize_member(Archive& a, BlockArray<T>& v);
+
+        /* Deleted ids are serialized as the sorted std::set<Id> they
+         * used to be. */
+        template<class Archive>
+        void serialize_member(Archive& a, IdBitmap& dead);
+
         // Serialize each piece. Can be done in parallel threads
         template <class Archive>
         void serialize_x(Archive &a, int index)
@@ -297,6 +360,22 @@ namespace desres { namespace msys {
 #undef _SER_LIST
 
         static std::shared_ptr<System> create();
+
+        /* A copy of this System with the same ids, including deleted ones.
+         * Atoms, bonds, residues, chains, cts, positions, velocities and
+         * the lists of subelements are stored in blocks of 1024 ids which
+         * are shared with this System until either side writes to them;
+         * then only the written block is copied.  Term lists and the rows
+         * of ParamTables, including atom and bond properties, are shared
+         * the same way, a table or block of rows at a time; ParamTables
+         * shared between tables here are shared between the copied tables
+         * too.  Only the deleted-id bitmaps, at one bit per id, are copied
+         * outright.  Writes include any use of the non-const element
+         * accessors, so read a snapshot or its source through a const
+         * System to avoid copying blocks; and an element reference taken
+         * before the snapshot must not be written through afterwards. */
+        std::shared_ptr<System> snapshot() const;
+
         System();
         ~System();
 
@@ -339,21 +418,38 @@ namespace desres { namespace msys {
         const chain_t& chainFAST(Id id) const { return _chains[id]; }
         const component_t& ctFAST(Id id) const { return _cts[id]; }
 
+        /* position and velocity of an atom, as 3 contiguous values.  Like
+         * atom(), the memory may move if atoms are added or the System
+         * is snapshotted. */
+        Float* atomPos(Id id) { return _pos.at(id).data(); }
+        Float* atomVel(Id id) { return _vel.at(id).data(); }
+        const Float* atomPos(Id id) const { return _pos.at(id).data(); }
+        const Float* atomVel(Id id) const { return _vel.at(id).data(); }
+
+        Float* atomPosFAST(Id id) { return _pos[id].data(); }
+        Float* atomVelFAST(Id id) { return _vel[id].data(); }
+        const Float* atomPosFAST(Id id) const { return _pos[id].data(); }
+        const Float* atomVelFAST(Id id) const { return _vel[id].data(); }
+
         /* id iterator, skipping deleted ids */
         class iterator {
             friend class System;
-            Id            _i;
-            const IdSet*  _dead;
+            Id              _i;
+            Id              _end;
+            const IdBitmap* _dead;
 
-            iterator(Id i, const IdSet* dead) 
-            : _i(i), _dead(dead) {
-                while (_dead && _dead->count(_i)) ++_i;
+            iterator(Id i, Id end, const IdBitmap* dead)
+            : _i(i), _end(end), _dead(dead) {
+                if (_dead) _i = _dead->next_clear(_i, _end);
             }
 
 
             bool equal(iterator const& c) const { return _i==c._i; }
             const Id& dereference() const { return _i; }
-            void increment() { do ++_i; while (_dead && _dead->count(_i)); }
+            void increment() {
+                ++_i;
+                if (_dead) _i = _dead->next_clear(_i, _end);
+            }
 
         public:
             typedef std::forward_iterator_tag iterator_category;
@@ -362,7 +458,7 @@ namespace desres { namespace msys {
             typedef const Id* pointer;
             typedef const Id& reference;
 
-            iterator() : _i(), _dead() {}
+            iterator() : _i(), _end(), _dead() {}
             const Id& operator*() const { return dereference(); }
             const Id* operator->() const { return &dereference(); }
             iterator& operator++() { increment(); return *this; }
@@ -370,66 +466,46 @@ namespace desres { namespace msys {
             bool operator!=(iterator const& c) const { return !equal(c); }
         };
 
+        /* copy positions or velocities of live atoms to or from 3*atomCount()
+         * contiguous values.  Without deleted atoms, this is one copy per
+         * block of 1024 atoms. */
         template <typename T>
-        void getPositions(T setter) const {
-            for (iterator i=atomBegin(), e=atomEnd(); i!=e; ++i) {
-                atom_t const& a = atomFAST(*i);
-                *setter++ = a.x;
-                *setter++ = a.y;
-                *setter++ = a.z;
-            }
-        }
+        void getPositions(T setter) const { get_coords(_pos, setter); }
 
         template <typename T>
-        void getVelocities(T setter) const {
-            for (iterator i=atomBegin(), e=atomEnd(); i!=e; ++i) {
-                atom_t const& a = atomFAST(*i);
-                *setter++ = a.vx;
-                *setter++ = a.vy;
-                *setter++ = a.vz;
-            }
-        }
+        void getVelocities(T setter) const { get_coords(_vel, setter); }
 
         template <typename T>
-        void setPositions(T getter) {
-            for (iterator i=atomBegin(), e=atomEnd(); i!=e; ++i) {
-                atom_t& a = atomFAST(*i);
-                a.x = *getter++;
-                a.y = *getter++;
-                a.z = *getter++;
-            }
-        }
+        void setPositions(T getter) { set_coords(_pos, getter); }
 
         template <typename T>
-        void setVelocities(T getter) {
-            for (iterator i=atomBegin(), e=atomEnd(); i!=e; ++i) {
-                atom_t& a = atomFAST(*i);
-                a.vx = *getter++;
-                a.vy = *getter++;
-                a.vz = *getter++;
-            }
-        }
+        void setVelocities(T getter) { set_coords(_vel, getter); }
 
         /* iterators over element ids */
         iterator atomBegin() const { 
-            return iterator(0, _deadatoms.empty() ? NULL : &_deadatoms); 
+            return iterator(0, maxAtomId(), _deadatoms.empty() ? NULL : &_deadatoms);
         }
-        iterator atomEnd() const { return iterator(maxAtomId(), NULL); }
+        iterator atomEnd() const { return iterator(maxAtomId(), maxAtomId(), NULL); }
         iterator bondBegin() const { 
-            return iterator(0, _deadbonds.empty() ? NULL : &_deadbonds); 
+            return iterator(0, maxBondId(), _deadbonds.empty() ? NULL : &_deadbonds);
         }
-        iterator bondEnd() const { return iterator(maxBondId(), NULL); }
+        iterator bondEnd() const { return iterator(maxBondId(), maxBondId(), NULL); }
         iterator residueBegin() const { 
-            return iterator(0, _deadresidues.empty() ? NULL : &_deadresidues); 
+            return iterator(0, maxResidueId(), _deadresidues.empty() ? NULL : &_deadresidues);
         }
-        iterator residueEnd() const { return iterator(maxResidueId(), NULL); }
+        iterator residueEnd() const { return iterator(maxResidueId(), maxResidueId(), NULL); }
         iterator chainBegin() const { 
-            return iterator(0, _deadchains.empty() ? NULL : &_deadchains); 
+            return iterator(0, maxChainId(), _deadchains.empty() ? NULL : &_deadchains);
         }
-        iterator chainEnd() const { return iterator(maxChainId(), NULL); }
+        iterator chainEnd() const { return iterator(maxChainId(), maxChainId(), NULL); }
 
         /* reserve vector sizes */
-        void atomReserve(size_t s) { _atoms.reserve(s); }
+        void atomReserve(size_t s) {
+            _atoms.reserve(s);
+            _pos.reserve(s);
+            _vel.reserve(s);
+            _bondindex.reserve(s);
+        }
         void bondReserve(size_t s) { _bonds.reserve(s); }
 
         /* add an element */
@@ -608,6 +684,11 @@ namespace desres { namespace msys {
         /* ids of atoms bonded to given atom */
         IdList bondedAtoms(Id id) const;
 
+        /* immutable CSR view of the current bond topology.  The snapshot
+         * stays valid after later edits, but no longer reflects them;
+         * call again to get an up to date one. */
+        BondGraphPtr bondGraph() const;
+
         /* bonded atoms satisfying a predicate.  predicate implements
          * bool operator()(atom_t const& atm) const; */
         template <typename T>
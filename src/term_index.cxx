@@ -0,0 +1,79 @@
+#include "term_index.hxx"
+#include <algorithm>
+
+using namespace desres::msys;
+
+namespace {
+    /* true if atm appears among the first j atoms of a term, so that a
+     * term with a repeated atom is listed only once for it. */
+    inline bool seen(const Id* atoms, Id j, Id atm) {
+        for (Id k=0; k<j; k++) if (atoms[k]==atm) return true;
+        return false;
+    }
+}
+
+void TermIndex::clear() {
+    _offsets.clear();
+    _entries.clear();
+    _tail.clear();
+    _nbuilt = _ndead = _ntail = _maxId = 0;
+}
+
+void TermIndex::build(const Id* terms, Id natoms, Id nterms, Id ndead) {
+    const Id stride = natoms+1;
+    Id maxatom = 0;
+    for (Id i=0; i<nterms; i++) {
+        const Id* atoms = terms + i*stride;
+        if (bad(atoms[0])) continue;
+        for (Id j=0; j<natoms; j++) maxatom = std::max(maxatom, atoms[j]+1);
+    }
+    _offsets.assign(maxatom+1, 0);
+    for (Id i=0; i<nterms; i++) {
+        const Id* atoms = terms + i*stride;
+        if (bad(atoms[0])) continue;
+        for (Id j=0; j<natoms; j++) {
+            if (!seen(atoms, j, atoms[j])) ++_offsets[atoms[j]+1];
+        }
+    }
+    for (Id a=0; a<maxatom; a++) _offsets[a+1] += _offsets[a];
+    _entries.resize(_offsets[maxatom]);
+    std::vector<Id> cursor(_offsets.begin(), _offsets.end()-1);
+    for (Id i=0; i<nterms; i++) {
+        const Id* atoms = terms + i*stride;
+        if (bad(atoms[0])) continue;
+        for (Id j=0; j<natoms; j++) {
+            if (!seen(atoms, j, atoms[j])) _entries[cursor[atoms[j]]++] = i;
+        }
+    }
+    _tail.clear();
+    _ntail = 0;
+    _nbuilt = _maxId = nterms;
+    _ndead = ndead;
+}
+
+void TermIndex::update(const Id* terms, Id natoms, Id nterms, Id ndead) {
+    if (nterms<_maxId) {
+        clear();
+    }
+    /* rebuild once deletions since the last build cover half the index,
+     * or once the overflow table outgrows its share. */
+    if (_offsets.empty() || 2*(ndead-std::min(ndead,_ndead)) > _nbuilt) {
+        build(terms, natoms, nterms, ndead);
+        return;
+    }
+    if (nterms==_maxId) return;
+    const Id stride = natoms+1;
+    for (Id i=_maxId; i<nterms; i++) {
+        const Id* atoms = terms + i*stride;
+        if (bad(atoms[0])) continue;
+        for (Id j=0; j<natoms; j++) {
+            if (seen(atoms, j, atoms[j])) continue;
+            _tail[atoms[j]].push_back(i);
+            ++_ntail;
+        }
+    }
+    _maxId = nterms;
+    if (_ntail > std::max<Id>(4096, _entries.size()/8)) {
+        build(terms, natoms, nterms, ndead);
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef desres_msys_term_index_hxx
+#define desres_msys_term_index_hxx
+
+#include "types.hxx"
+#include <vector>
+#include <unordered_map>
+
+namespace desres { namespace msys {
+
+    /* Mapping from atom id to the ids of the terms containing that atom,
+     * for the flat term array of a TermTable: natoms atom ids followed by
+     * a param id per term, with dead terms marked by a leading BadId.
+     *
+     * Terms are held in compressed sparse row form.  Terms added since
+     * the last build go into a small per-atom overflow table, which is
+     * folded into the CSR arrays once it grows past a fraction of their
+     * size, so that interleaved adds and queries stay cheap.  Deleted
+     * terms are not removed; callers filter them out, and the index is
+     * rebuilt once they make up half of it. */
+    class TermIndex {
+        std::vector<Id> _offsets;   /* CSR row starts, one per atom id + 1 */
+        std::vector<Id> _entries;   /* term ids, increasing within a row */
+        Id _nbuilt = 0;             /* terms [0, _nbuilt) are in the CSR */
+        Id _ndead = 0;              /* dead terms when the CSR was built */
+
+        std::unordered_map<Id, IdList> _tail;   /* terms [_nbuilt, _maxId) */
+        Id _ntail = 0;
+        Id _maxId = 0;              /* one more than the last term indexed */
+
+        void build(const Id* terms, Id natoms, Id nterms, Id ndead);
+
+    public:
+        /* forget everything; the next update() rebuilds from scratch */
+        void clear();
+
+        /* index terms not yet seen.  terms holds nterms rows of natoms+1
+         * ids; ndead is the number of those rows which are dead. */
+        void update(const Id* terms, Id natoms, Id nterms, Id ndead);
+
+        /* number of indexed terms containing atm, including dead ones */
+        Id count(Id atm) const {
+            Id n = atm+1<_offsets.size() ? _offsets[atm+1]-_offsets[atm] : 0;
+            if (_ntail) {
+                auto it = _tail.find(atm);
+                if (it!=_tail.end()) n += it->second.size();
+            }
+            return n;
+        }
+
+        /* call f(term) on each indexed term containing atm, in increasing
+         * order of term id, including dead terms. */
+        template <typename F>
+        void forEach(Id atm, F f) const {
+            if (atm+1<_offsets.size()) {
+                for (Id i=_offsets[atm], e=_offsets[atm+1]; i<e; i++) {
+                    f(_entries[i]);
+                }
+            }
+            if (_ntail) {
+                auto it = _tail.find(atm);
+                if (it!=_tail.end()) for (Id t : it->second) f(t);
+            }
+        }
+    };
+
+}}
+
+#endif
@@ -6,12 +6,14 @@
 #include <iostream>
 #include <algorithm>
 #include <cassert>
+#include <unordered_map>
 
 using namespace desres::msys;
 
 TermTable::TermTable( SystemPtr system, Id natoms, ParamTablePtr ptr ) 
-: _system(system), _natoms(natoms), _ndead(0), _props(ParamTable::create()),
-  _maxIndexId(0), category(NO_CATEGORY) {
+: _system(system), _natoms(natoms), _ndead(0),
+  _terms(std::make_shared<IdList>()), _props(ParamTable::create()),
+  category(NO_CATEGORY) {
     _params = ptr ? ptr : ParamTable::create();
     _overrides = OverrideTable::create(_params);
     if (natoms<1) MSYS_FAIL("TermTable must have at least 1 atom");
@@ -27,10 +29,24 @@ void TermTable::destroy() {
         _params->decref(param(i));
     }
     _overrides->clear();
-    _terms.clear();
+    _terms = std::make_shared<IdList>();
     _index.clear();
 }
 
+TermTablePtr TermTable::snapshot(SystemPtr system,
+                                 ParamTablePtr params) const {
+    TermTablePtr t(new TermTable(system, _natoms, params));
+    t->_ndead = _ndead;
+    t->_terms = _terms;
+    t->_props = _props->snapshot();
+    t->_overrides = _overrides->snapshot(params);
+    t->category = category;
+    for (Id i=0, n=maxTermId(); i<n; i++) {
+        if (_alive(i)) params->incref(paramFAST(i));
+    }
+    return t;
+}
+
 String TermTable::name() const {
     SystemPtr sys = system();
     if (!sys) return "";
@@ -56,36 +72,43 @@ Id TermTable::addTerm(const IdList& atoms, Id param) {
     if (atoms.size() != _natoms) {
         MSYS_FAIL("incorrect atom count for TermTable " << name());
     }
+    return addTerms(1, atoms.data(), &param);
+}
+
+Id TermTable::addTerms(Id n, const Id* atoms, const Id* params) {
     SystemPtr s = system();
     if (!s) MSYS_FAIL("Table has been destroyed");
     System const& sys = *s;
-    for (IdList::const_iterator atm=atoms.begin(); atm!=atoms.end(); ++atm) {
-        if (!sys.hasAtom(*atm)) {
+    const Id natoms = _natoms;
+    for (Id i=0, m=n*natoms; i<m; i++) {
+        if (!sys.hasAtom(atoms[i])) {
             std::stringstream ss;
-            ss << "addTerm: no such atom " << *atm;
+            ss << "addTerm: no such atom " << atoms[i];
             throw std::runtime_error(ss.str());
         }
     }
+    if (params) _params->incref(params, n);
+
     Id id=maxTermId();
-    _terms.insert(_terms.end(), atoms.begin(), atoms.end());
-    _terms.push_back(param);
-    _params->incref(param);
-    _props->addParam();
+    if (!n) return id;
+    IdList& terms = writable_terms();
+    size_t pos = terms.size();
+    terms.resize(pos + size_t(n)*(natoms+1));
+    Id* dst = &terms[pos];
+    for (Id i=0; i<n; i++) {
+        std::copy(atoms, atoms+natoms, dst);
+        atoms += natoms;
+        dst += natoms;
+        *dst++ = params ? params[i] : BadId;
+    }
+    _props->addParams(n);
     return id;
 }
 
 void TermTable::delTerm(Id id) {
     if (!hasTerm(id)) return;
     _params->decref(param(id));
-    if (_index.size()) {
-        Id i,n = atomCount();
-        for (i=0; i<n; i++) {
-            Id atm = atom(id,i);
-            IdList& p = _index.at(atm);
-            p.resize(std::remove(p.begin(), p.end(), id)-p.begin());
-        }
-    }
-    _terms[id*(1+_natoms)] = BadId; /* mark as dead */
+    writable_terms()[id*(1+_natoms)] = BadId; /* mark as dead */
     ++_ndead;
 }
 
@@ -99,7 +122,7 @@ Id TermTable::param(Id term) const {
     if (!hasTerm(term)) {
         MSYS_FAIL("Table '" << name() << "' has no term with id " << term);
     }
-    return  _terms.at((1+term)*(1+_natoms)-1);
+    return  _terms->at((1+term)*(1+_natoms)-1);
 }
 
 void TermTable::setParam(Id term, Id param) {
@@ -110,7 +133,7 @@ void TermTable::setParam(Id term, Id param) {
         MSYS_FAIL("Invalid param " << param << " for table " << name());
     }
     _params->decref(this->param(term));
-    _terms.at((1+term)*(1+_natoms)-1) = param;
+    writable_terms().at((1+term)*(1+_natoms)-1) = param;
     _params->incref(param);
 }
 
@@ -118,7 +141,7 @@ IdList TermTable::atoms(Id term) const {
     if (term>=maxTermId()) {
         MSYS_FAIL("Table '" << name() << "' has no term with id " << term);
     }
-    IdList::const_iterator b=_terms.begin()+term*(1+_natoms);
+    IdList::const_iterator b=_terms->begin()+term*(1+_natoms);
     return IdList(b, b+_natoms);
 }
 
@@ -129,7 +152,7 @@ Id TermTable::atom(Id term, Id index) const {
     if (index>=atomCount()) {
         MSYS_FAIL("Table '" << name() << "' has no atoms for index " << index);
     }
-    IdList::const_iterator b=_terms.begin()+term*(1+_natoms);
+    IdList::const_iterator b=_terms->begin()+term*(1+_natoms);
     return *(b+index);
 }
 
@@ -196,50 +219,47 @@ ValueRef TermTable::propValue(Id term, String const& name) {
     return propValue(term, index);
 }
 
-namespace {
-    struct ParamComparator {
-        ParamTablePtr params;
-        std::vector<bool> overridden;
-        
-        explicit ParamComparator(ParamTablePtr p, OverrideTablePtr o) : params(p) {
-            // Treat parameters with an override as different from every other parameter
-            overridden.resize(params->paramCount());
-            for (auto pair : o->list()) {
-                overridden[pair.first] = true;
-                overridden[pair.second] = true;
-            }
-        }
-        bool operator()(Id const& pi, Id const& pj) const {
-            if (overridden[pi] || overridden[pj]) {
-                return pi < pj;
-            }
-            return params->compare(pi,pj)<0;
-        }
-    };
-}
-
 void TermTable::coalesce() {
-    if (!_params->paramCount()) return;
-    typedef std::map<Id,IdList,ParamComparator> ParamMap;
-    IdList old2new(_params->paramCount(), BadId);
-    ParamComparator comp(_params, _overrides);
-    assert(!comp(0,0));
-    ParamMap map(comp);
+    const Id nparams = _params->paramCount();
+    if (!nparams) return;
+
+    /* Parameters with an override are treated as different from every
+     * other parameter. */
+    std::vector<bool> overridden(nparams);
+    for (auto pair : _overrides->list()) {
+        overridden[pair.first] = true;
+        overridden[pair.second] = true;
+    }
 
+    /* Visit terms in order, mapping each param to the first param seen
+     * with the same values.  Hash collisions are resolved by comparing
+     * the candidate rows exactly. */
+    std::vector<uint64_t> hashes = _params->hashParams();
+    std::unordered_map<uint64_t, IdList> reps;
+    IdList old2new(nparams, BadId);
     for (Id i=0, n=maxTermId(); i<n; i++) {
         if (!hasTerm(i)) continue;
         Id p = param(i);
         if (bad(p)) continue;
-        map[p].push_back(i);
-    }
-    for (auto& pair : map) {
-        Id p = pair.first;
-        IdList& ids = pair.second;
-        for (Id i=0; i<ids.size(); i++) {
-            Id t = ids[i];
-            old2new.at(param(t)) = p;
-            setParam(t, p);
+        Id& q = old2new[p];
+        if (bad(q)) {
+            if (overridden[p]) {
+                q = p;
+            } else {
+                IdList& bucket = reps[hashes[p]];
+                for (Id r : bucket) {
+                    if (_params->equalParams(p, r)) {
+                        q = r;
+                        break;
+                    }
+                }
+                if (bad(q)) {
+                    bucket.push_back(p);
+                    q = p;
+                }
+            }
         }
+        if (q!=p) setParam(i, q);
     }
 
     /* coalesce the override table, if it exists.  Reuse the same set of
@@ -292,100 +312,121 @@ std::string desres::msys::print(Category const& c) {
 
 
 void TermTable::update_index() {
-    _index.resize(system()->maxAtomId());
-    if (_terms.empty()) return;
-    Id i=_maxIndexId, n=maxTermId();
-    if (i==n) return;
-    std::vector<bool> found(system()->maxAtomId(), false);
-    const Id natoms=atomCount();
-    for (; i<n; i++) {
-        if (!hasTerm(i)) continue;
-        for (Id j=0; j<natoms; j++) {
-            Id atm = atom(i,j);
-            if (!found.at(atm))
-                _index.at(atm).push_back(i);
-            found.at(atm)=true;
-        }
-        for (Id j=0; j<natoms; j++) {
-            Id atm = atom(i,j);
-            found.at(atm)=false;
+    _index.update(_terms->data(), _natoms, maxTermId(), _ndead);
+}
+
+void TermTable::check_index_atoms(IdList const& ids) const {
+    SystemPtr sys = system();
+    Id n = sys ? sys->maxAtomId() : 0;
+    for (Id id : ids) {
+        if (id>=n) {
+            std::stringstream ss;
+            ss << "TermTable: invalid atom id " << id;
+            throw std::out_of_range(ss.str());
         }
     }
-    _maxIndexId = n;
 }
 
 IdList TermTable::findWithAll(IdList const& ids) {
     update_index();
+    check_index_atoms(ids);
     IdList terms;
-    for (unsigned i=0; i<ids.size(); i++) {
-        IdList const& p = _index.at(ids[i]);
-        if (i==0) {
-            terms = p;
-        } else {
-            IdList v(terms.size());
-            v.resize(
-                    std::set_intersection(
-                        p.begin(), p.end(), 
-                        terms.begin(), terms.end(),
-                        v.begin())-v.begin());
-            terms = v;
-        }
+    if (ids.empty()) return terms;
+    /* scan the terms of the rarest atom, keeping those with the rest */
+    Id pivot = ids[0];
+    for (Id id : ids) {
+        if (_index.count(id) < _index.count(pivot)) pivot = id;
     }
+    const Id natoms = _natoms;
+    _index.forEach(pivot, [&](Id t) {
+        if (!_alive(t)) return;
+        const Id* atoms = atomsFAST(t);
+        for (Id id : ids) {
+            if (std::find(atoms, atoms+natoms, id)==atoms+natoms) return;
+        }
+        terms.push_back(t);
+    });
     return terms;
 }
 
+IdBitmap TermTable::findWithAnyBitmap(IdList const& ids) {
+    update_index();
+    check_index_atoms(ids);
+    IdBitmap bits;
+    for (Id id : ids) {
+        _index.forEach(id, [&](Id t) {
+            if (_alive(t)) bits.insert(t);
+        });
+    }
+    return bits;
+}
+
 IdList TermTable::findWithAny(IdList const& ids) {
     update_index();
+    check_index_atoms(ids);
     IdList terms;
-    for (unsigned i=0; i<ids.size(); i++) {
-        IdList const& p = _index.at(ids[i]);
-        if (i==0) {
-            terms = p;
-        } else {
-            IdList v(terms.size()+p.size());
-            v.resize(
-                    std::set_union(
-                        p.begin(), p.end(), 
-                        terms.begin(), terms.end(),
-                        v.begin())-v.begin());
-            terms = v;
+    if (ids.size()==1) {
+        _index.forEach(ids[0], [&](Id t) {
+            if (_alive(t)) terms.push_back(t);
+        });
+        return terms;
+    }
+    /* small queries are cheaper to sort than to mark in a bitmap which
+     * spans the whole table. */
+    Id total = 0;
+    for (Id id : ids) total += _index.count(id);
+    if (total < maxTermId()/16) {
+        terms.reserve(total);
+        for (Id id : ids) {
+            _index.forEach(id, [&](Id t) {
+                if (_alive(t)) terms.push_back(t);
+            });
         }
+        sort_unique(terms);
+    } else {
+        IdBitmap bits = findWithAnyBitmap(ids);
+        terms.reserve(bits.size());
+        bits.for_each([&](Id t) { terms.push_back(t); });
     }
     return terms;
 }
 
-IdList TermTable::findWithOnly(IdList const& _ids) {
+/* Call f on each live term whose atoms all lie in ids, once per term. */
+template <typename F>
+static void for_each_with_only(TermTable& table, TermIndex const& index,
+                               IdList const& ids, F f) {
+    IdBitmap inset;
+    for (Id id : ids) inset.insert(id);
+    const Id natoms = table.atomCount();
+    inset.for_each([&](Id id) {
+        index.forEach(id, [&](Id t) {
+            const Id* atoms = table.atomsFAST(t);
+            /* visit each term from its first atom only; this also skips
+             * dead terms, whose first atom is BadId. */
+            if (atoms[0]!=id) return;
+            for (Id j=1; j<natoms; j++) {
+                if (!inset.count(atoms[j])) return;
+            }
+            f(t);
+        });
+    });
+}
+
+IdBitmap TermTable::findWithOnlyBitmap(IdList const& ids) {
+    update_index();
+    check_index_atoms(ids);
+    IdBitmap bits;
+    for_each_with_only(*this, _index, ids, [&](Id t) { bits.insert(t); });
+    return bits;
+}
+
+IdList TermTable::findWithOnly(IdList const& ids) {
     update_index();
-    IdList ids(_ids);
-    sort_unique(ids);
+    check_index_atoms(ids);
     IdList terms;
-    for (unsigned i=0; i<ids.size(); i++) {
-        IdList const& q = _index.at(ids[i]);
-        IdList p;
-        for (Id t : q) {
-            bool keep = true;
-            for (Id j=0; j<_natoms; j++) {
-                if (!std::binary_search(ids.begin(), ids.end(), atom(t,j))) {
-                    keep = false;
-                    break;
-                }
-            }
-            if (keep) p.push_back(t);
-        }
-        if (i==0) {
-            terms = p;
-        } else {
-            IdList v(terms.size()+p.size());
-            v.resize(
-                    std::set_union(
-                        p.begin(), p.end(), 
-                        terms.begin(), terms.end(),
-                        v.begin())-v.begin());
-            terms = v;
-        }
-    }
+    for_each_with_only(*this, _index, ids, [&](Id t) { terms.push_back(t); });
+    std::sort(terms.begin(), terms.end());
     return terms;
-
 }
 
 IdList TermTable::findExact(IdList const& ids) {
@@ -2,6 +2,8 @@
 #define desres_msys_term_table_hxx
 
 #include "override.hxx"
+#include "term_index.hxx"
+#include "id_bitmap.hxx"
 
 namespace desres { namespace msys {
 
@@ -38,12 +40,19 @@ namespace desres { namespace msys {
         /* number of dead terms */
         Id      _ndead;
     
-        /* all the terms. */
-        IdList  _terms;
+        /* all the terms.  Shared with snapshots of this table until one
+         * of them adds, removes or changes a term. */
+        std::shared_ptr<IdList> _terms;
+
+        /* the terms, copied first if they are shared */
+        IdList& writable_terms() {
+            if (_terms.use_count()>1) _terms = std::make_shared<IdList>(*_terms);
+            return *_terms;
+        }
 
         /* terms are live if their first atom is not BadId */
         bool _alive(Id term) const {
-            return BadId != _terms.at(term*(1+_natoms));
+            return BadId != _terms->at(term*(1+_natoms));
         }
 
         /* extra term properties, analogous to extra atom properties.
@@ -55,25 +64,33 @@ namespace desres { namespace msys {
         /* overrides for the parameters of this table */
         OverrideTablePtr _overrides;
 
-        /* mapping from atom id to list of terms having that id. */
-        std::vector<IdList> _index;
-        /* max term id from last update */
-        Id _maxIndexId;
+        /* mapping from atom id to the terms having that id. */
+        TermIndex _index;
 
-        /* the index is updated only by the find() operations, and by 
-         * delTerm if an index has already been created.  */
+        /* the index is updated only by the find() operations; dead terms
+         * remain in it and are skipped by them. */
         void update_index();
 
+        /* throw if any of the ids is not a valid atom id for the index */
+        void check_index_atoms(IdList const& ids) const;
+
         std::map<String, String> _unused_keep_for_binary_compatibility;
 
     public:
+        /* the terms are archived as a plain IdList.  Saving reads them
+         * in place; loading must not write into terms shared with a
+         * snapshot. */
+        template <class Archive>
+        void save(Archive & archive) const {
+            archive(_system, _params, _natoms, _ndead, *_terms, _props, _overrides, category);
+        }
         template <class Archive>
-        void serialize(Archive & archive) {
-            archive(_system, _params, _natoms, _ndead, _terms, _props, _overrides, category);
+        void load(Archive & archive) {
+            archive(_system, _params, _natoms, _ndead, writable_terms(), _props, _overrides, category);
         }
 
         // default constructor for serialization only
-        TermTable() {}
+        TermTable() : _terms(std::make_shared<IdList>()) {}
 
         TermTable( SystemPtr system, Id natoms, 
                    ParamTablePtr ptr = ParamTablePtr() );
@@ -81,6 +98,12 @@ namespace desres { namespace msys {
         /* delete all terms and remove from parent system */
         void destroy();
 
+        /* a copy of this table for system, using params in place of
+         * params().  The terms are shared with this table until either
+         * one modifies them; term properties are snapshotted. */
+        std::shared_ptr<TermTable> snapshot(SystemPtr system,
+                                            ParamTablePtr params) const;
+
         SystemPtr system() const { return _system.lock(); }
         ParamTablePtr params() { return _params; }
         inline ParamTablePtr props() { return _props; }
@@ -96,7 +119,9 @@ namespace desres { namespace msys {
         void rename(String const& name);
 
         /* reserve space */
-        void reserve(size_t nterms) { _terms.reserve(nterms * (_natoms+1)); }
+        void reserve(size_t nterms) {
+            writable_terms().reserve(nterms * (_natoms+1));
+        }
 
         class term_t {
         protected:
@@ -144,13 +169,13 @@ namespace desres { namespace msys {
 
         /* iterator pointing to first element */
         const_iterator begin() const {
-            if (_terms.empty()) return const_iterator();
-            return const_iterator(&_terms[0], _natoms, 0);
+            if (_terms->empty()) return const_iterator();
+            return const_iterator(_terms->data(), _natoms, 0);
         }
         /* iterator pointing past last element */
         const_iterator end() const {
-            if (_terms.empty()) return const_iterator();
-            return const_iterator(&_terms[0], _natoms, maxTermId());
+            if (_terms->empty()) return const_iterator();
+            return const_iterator(_terms->data(), _natoms, maxTermId());
         }
 
         /* Operations on the set of terms */
@@ -159,7 +184,7 @@ namespace desres { namespace msys {
             return maxTermId() - _ndead;
         }
         Id maxTermId() const {
-            return _terms.size()/(1+_natoms);
+            return _terms->size()/(1+_natoms);
         }
 
         bool hasTerm(Id term) const {
@@ -167,6 +192,13 @@ namespace desres { namespace msys {
         }
 
         Id addTerm(const IdList& atoms, Id param);
+
+        /* Add n terms at once.  atoms holds atomCount() atom ids for each
+         * term in turn; params holds a param id for each term, or may be
+         * NULL if the terms have no params.  Every atom and param is
+         * checked before any term is added.  Returns the id of the first
+         * new term; the ids of the new terms are contiguous. */
+        Id addTerms(Id n, const Id* atoms, const Id* params);
         void delTerm(Id id);
 
         /* delete all terms t containing atom id atm i the atoms list.  */
@@ -187,6 +219,11 @@ namespace desres { namespace msys {
          */
         IdList findWithOnly(IdList const& ids);
 
+        /* As findWithAny() and findWithOnly(), but returning the matching
+         * term ids as a bitmap, which avoids sorting for large queries. */
+        IdBitmap findWithAnyBitmap(IdList const& ids);
+        IdBitmap findWithOnlyBitmap(IdList const& ids);
+
         /* return the ids of the terms containing _exactly_ the given ids,
          * in the given order.
          *
@@ -200,10 +237,10 @@ namespace desres { namespace msys {
         IdList atoms(Id term) const;
         Id atom(Id term, Id index) const;
         const Id* atomsFAST(Id term) const {
-            return &_terms[term*(1+_natoms)];
+            return _terms->data() + term*(1+_natoms);
         }
         Id paramFAST(Id term) const {
-            return _terms[(1+term)*(1+_natoms)-1];
+            return (*_terms)[(1+term)*(1+_natoms)-1];
         }
 
         /* look up the value of a property of the term from the associated
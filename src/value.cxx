@@ -6,37 +6,37 @@
 using namespace desres::msys;
 
 Int ValueRef::asInt() const {
-    if (_type==IntType) return _val.i;
-    if (_type==FloatType) return (Int)_val.f;
-    MSYS_FAIL("Cannot convert ValueRef string '" << _val.s << "' to int");
+    if (_type==IntType) return _i();
+    if (_type==FloatType) return (Int)_f();
+    MSYS_FAIL("Cannot convert ValueRef string '" << _s() << "' to int");
 }
 
 Float ValueRef::asFloat() const {
-    if (_type==IntType) return _val.i;
-    if (_type==FloatType) return _val.f;
+    if (_type==IntType) return _i();
+    if (_type==FloatType) return _f();
     throw std::runtime_error("Cannot convert ValueRef to float");
 }
 String ValueRef::asString() const {
-    if (_type==StringType) return _val.s ? _val.s : "";
+    if (_type==StringType) return _s() ? _s() : "";
     throw std::runtime_error("Cannot convert ValueRef to string");
 }
 const char* ValueRef::c_str() const {
-    if (_type==StringType) return _val.s ? _val.s : "";
+    if (_type==StringType) return _s() ? _s() : "";
     throw std::runtime_error("Cannot convert ValueRef to string");
 }
 
 void ValueRef::fromInt(const Int& i) {
-    if (_type==IntType) _val.i = i;
-    else if (_type==FloatType) _val.f = i;
+    if (_type==IntType) *static_cast<Int*>(_set()) = i;
+    else if (_type==FloatType) *static_cast<Float*>(_set()) = i;
     else throw std::runtime_error("cannot assign int to string prop");
-    if (_cb) _cb->valueChanged();
+    if (_cb) _cb->valueChanged(_row);
 }
 
 void ValueRef::fromFloat(const Float& i) {
-    if (_type==IntType) _val.i = (Int)i;
-    else if (_type==FloatType) _val.f = i;
+    if (_type==IntType) *static_cast<Int*>(_set()) = (Int)i;
+    else if (_type==FloatType) *static_cast<Float*>(_set()) = i;
     else throw std::runtime_error("cannot assign float to string prop");
-    if (_cb) _cb->valueChanged();
+    if (_cb) _cb->valueChanged(_row);
 }
 
 void ValueRef::fromString(const String& i) {
@@ -44,28 +44,30 @@ void ValueRef::fromString(const String& i) {
         throw std::runtime_error("cannot assign string to int prop");
     else if (_type==FloatType) 
         throw std::runtime_error("cannot assign string to float prop");
+    else if (!_cb)
+        throw std::runtime_error("cannot assign string without an owner");
     else {
-        if (_val.s) free(_val.s);
-        _val.s = strdup(i.c_str());
+        const char* s = _cb->internString(i.c_str(), strlen(i.c_str()));
+        *static_cast<const char**>(_set()) = s;
     }
-    if (_cb) _cb->valueChanged();
+    if (_cb) _cb->valueChanged(_row);
 }
 
 bool ValueRef::operator==(const ValueRef& rhs) const {
     switch (_type) {
         case IntType:
-            if (rhs._type==IntType) return _val.i==rhs._val.i;
-            if (rhs._type==FloatType) return _val.i==rhs._val.f;
+            if (rhs._type==IntType) return _i()==rhs._i();
+            if (rhs._type==FloatType) return _i()==rhs._f();
             break;
         case FloatType: 
-            if (rhs._type==IntType) return _val.f==rhs._val.i;
-            if (rhs._type==FloatType) return _val.f==rhs._val.f;
+            if (rhs._type==IntType) return _f()==rhs._i();
+            if (rhs._type==FloatType) return _f()==rhs._f();
             break;
         default:
         case StringType:
             if (rhs._type==StringType) 
-                return strcmp(_val.s ?     _val.s : "", 
-                          rhs._val.s ? rhs._val.s : "")==0;
+                return strcmp(_s() ?     _s() : "", 
+                          rhs._s() ? rhs._s() : "")==0;
             break;
     }
     return false;
@@ -75,31 +77,31 @@ int ValueRef::compare(const ValueRef& rhs) const {
     switch (_type) {
         case IntType:
             if (rhs._type==IntType) 
-                return _val.i<rhs._val.i ? -1 : 
-                       _val.i>rhs._val.i ?  1 : 
+                return _i()<rhs._i() ? -1 : 
+                       _i()>rhs._i() ?  1 : 
                                             0 ;
 
             if (rhs._type==FloatType) 
-                return _val.i<rhs._val.f ? -1 :
-                       _val.i>rhs._val.f ?  1 : 
+                return _i()<rhs._f() ? -1 :
+                       _i()>rhs._f() ?  1 : 
                                             0 ;
             break;
         case FloatType:
             if (rhs._type==FloatType) 
-                return _val.f<rhs._val.f ? -1 :
-                       _val.f>rhs._val.f ?  1 :
+                return _f()<rhs._f() ? -1 :
+                       _f()>rhs._f() ?  1 :
                                             0;
 
             if (rhs._type==IntType) 
-                return _val.f<rhs._val.i ? -1 :
-                       _val.f<rhs._val.i ?  1 :
+                return _f()<rhs._i() ? -1 :
+                       _f()<rhs._i() ?  1 :
                                             0 ;
             break;
         default:
         case StringType:
             if (rhs._type==StringType) 
-                return strcmp(_val.s ?     _val.s : "", 
-                          rhs._val.s ? rhs._val.s : "");
+                return strcmp(_s() ?     _s() : "", 
+                          rhs._s() ? rhs._s() : "");
             break;
     }
     return 0;
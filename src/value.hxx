@@ -2,6 +2,7 @@
 #define mol_value_hxx
 
 #include "types.hxx"
+#include "string_pool.hxx"
 #include <map>
 
 namespace desres { namespace msys {
@@ -12,6 +13,8 @@ namespace desres { namespace msys {
         StringType
     };
     
+    /* A single value, used for temporaries.  String values are owned
+     * by the table holding the value. */
     union Value {
         Int     i;
         Float   f;
@@ -19,26 +22,61 @@ namespace desres { namespace msys {
     };
 
     struct ValueCallback {
-        /* let holders of the values know about mutations.  This interface
-         * could be refined to hold some sort of id about which value
-         * changed, but for now a simple thunk will suffice. */
-        virtual void valueChanged() = 0;
+        /* let holders of the values know about mutations.  row is the
+         * row which changed, or BadId if it is not known. */
+        virtual void valueChanged(Id row) = 0;
+
+        /* address of the value in the given row, for reading or for
+         * writing.  Holders whose storage may be shared with a copy hand
+         * out a private copy for writing. */
+        virtual const void* valuePtr(Id row) = 0;
+        virtual void* writableValuePtr(Id row) = 0;
+
+        /* storage for a string being assigned; the holder owns the
+         * returned text for as long as it holds the value. */
+        virtual const char* internString(const char* s, size_t sz) = 0;
+
         virtual ~ValueCallback() {}
     };
 
+    /* Reference to an Int, Float or string value, according to type.
+     * Strings are stored as const char* owned by the callback, so
+     * string values can only be assigned through a ValueRef which has
+     * one. */
     class ValueRef {
         ValueType   _type;
-        Value&      _val;
+        void*       _ptr;
         ValueCallback *_cb;
+        Id          _row;
+
+        /* storage is looked up on every access when it belongs to a row,
+         * so that a reference stays correct if the row's storage is
+         * shared with a copy made after the reference was taken. */
+        const void* _get() const {
+            return bad(_row) ? _ptr : _cb->valuePtr(_row);
+        }
+        void* _set() const {
+            return bad(_row) ? _ptr : _cb->writableValuePtr(_row);
+        }
+
+        Int _i() const { return *static_cast<const Int*>(_get()); }
+        Float _f() const { return *static_cast<const Float*>(_get()); }
+        const char* _s() const { return *static_cast<const char* const*>(_get()); }
     
     public:
         ValueRef( ValueType type, Value& val ) 
-        : _type(type), _val(val), _cb(NULL) {}
+        : _type(type), _ptr(&val), _cb(NULL), _row(BadId) {}
 
         /* constructor taking a callback to notify when modifications are
          * made */
         ValueRef( ValueType type, Value& val, ValueCallback* cb) 
-        : _type(type), _val(val), _cb(cb) {}
+        : _type(type), _ptr(&val), _cb(cb), _row(BadId) {}
+
+        /* reference to an Int, Float or const char* according to type,
+         * at the given row of the callback's owner, which provides the
+         * storage. */
+        ValueRef( ValueType type, ValueCallback* cb, Id row)
+        : _type(type), _ptr(NULL), _cb(cb), _row(row) {}
 
         ValueType type() const { return _type; }
     
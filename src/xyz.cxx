@@ -21,9 +21,10 @@ namespace desres { namespace msys {
         for (Id i=0; i<mol->maxAtomId(); i++) {
             if (!mol->hasAtom(i)) continue;
             atom_t const& atm = mol->atomFAST(i);
-            desres::msys::fastjson::floatify(atm.x, x);
-            desres::msys::fastjson::floatify(atm.y, y);
-            desres::msys::fastjson::floatify(atm.z, z);
+            const double* pos = mol->atomPosFAST(i);
+            desres::msys::fastjson::floatify(pos[0], x);
+            desres::msys::fastjson::floatify(pos[1], y);
+            desres::msys::fastjson::floatify(pos[2], z);
             fprintf(fd, "%4s %20s %20s %20s\n", 
                     AbbreviationForElement(atm.atomic_number), x, y, z);
         }
@@ -67,9 +68,10 @@ namespace desres { namespace msys {
                 MSYS_FAIL("Failed parsing atom " << i+1 << " in xyz file " << path);
             }
             atom_t& atom = mol->atom(i);
-            atom.x = x;
-            atom.y = y;
-            atom.z = z;
+            double* pos = mol->atomPos(i);
+            pos[0] = x;
+            pos[1] = y;
+            pos[2] = z;
 
             /* guess atomic number: if name is a number, assume it's the
              * atomic number; otherwise treat as element name. */
@@ -0,0 +1,67 @@
+#ifndef desres_msys_tests_dtr_fixture_hxx
+#define desres_msys_tests_dtr_fixture_hxx
+
+#include "molfile/dtrplugin.hxx"
+#include <assert.h>
+#include <string.h>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace desres { namespace molfile { namespace test {
+
+    /* A timestep with its own position and velocity buffers. */
+    struct Frame {
+        std::vector<float> pos, vel;
+        molfile_timestep_t ts;
+
+        explicit Frame(int natoms, bool with_vel=false)
+        : pos(3*natoms), vel(with_vel ? 3*natoms : 0) {
+            memset(&ts, 0, sizeof(ts));
+            ts.coords = pos.data();
+            ts.velocities = with_vel ? vel.data() : NULL;
+        }
+        Frame(Frame const&) = delete;
+        Frame& operator=(Frame const&) = delete;
+    };
+
+    /* Frame f of a test dtr has time t0+f, a cubic cell of edge 50+f,
+     * and coordinates and velocities which differ in every atom. */
+    struct DtrSpec {
+        int         natoms = 0;
+        int         nframes = 0;
+        double      t0 = 0;
+        uint32_t    frames_per_file = 4;
+        bool        with_vel = false;
+        double      precision = 0;      /* nonzero for TNG positions */
+        unsigned    compression_threads = 0;
+        int         sync_after = -1;    /* call sync() after this frame */
+    };
+
+    inline void write_dtr(std::string const& path, DtrSpec const& spec) {
+        Frame frame(spec.natoms, spec.with_vel);
+        molfile_timestep_t& ts = frame.ts;
+        DtrWriter w(path, DtrWriter::Type::DTR, spec.natoms, DtrWriter::CLOBBER,
+                    spec.frames_per_file, nullptr, spec.precision);
+        w.set_compression_threads(spec.compression_threads);
+        for (int f=0; f<spec.nframes; f++) {
+            for (int i=0; i<3*spec.natoms; i++) {
+                frame.pos[i] = spec.t0 + f + 0.001*i;
+                if (spec.with_vel) frame.vel[i] = spec.t0 - f - 0.001*i;
+            }
+            ts.unit_cell[0] = ts.unit_cell[4] = ts.unit_cell[8] = 50+f;
+            ts.physical_time = spec.t0 + f;
+            w.next(&ts);
+            if (f==spec.sync_after) assert(w.sync()==0);
+        }
+    }
+
+    inline void write_stk(std::string const& path,
+                          std::vector<std::string> const& dtrs) {
+        std::ofstream out(path.c_str());
+        for (auto const& dtr : dtrs) out << dtr << '\n';
+    }
+
+}}}
+
+#endif
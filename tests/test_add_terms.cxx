@@ -0,0 +1,58 @@
+#include "system.hxx"
+#include <assert.h>
+#include <stdio.h>
+
+using namespace desres::msys;
+
+int main() {
+    SystemPtr mol = System::create();
+    for (int i=0; i<10; i++) mol->addAtom(mol->addResidue(mol->addChain()));
+    TermTablePtr a = mol->addTable("a", 2);
+    TermTablePtr b = mol->addTable("b", 2);
+    a->params()->addParams(3);
+    b->params()->addParams(3);
+    a->addTermProp("k", IntType);
+    b->addTermProp("k", IntType);
+
+    Id atoms[] = {0,1, 1,2, 2,3, 3,3};
+    Id params[] = {0, 2, BadId, 2};
+    /* the same terms one at a time and in bulk */
+    for (int i=0; i<4; i++) {
+        a->addTerm(IdList(atoms+2*i, atoms+2*i+2), params[i]);
+    }
+    assert(b->addTerms(4, atoms, params)==0);
+    assert(b->addTerms(0, atoms, params)==4);
+    assert(a->maxTermId()==b->maxTermId());
+    for (Id t=0; t<4; t++) {
+        assert(a->atoms(t)==b->atoms(t));
+        assert(a->param(t)==b->param(t));
+        assert(b->termPropValue(t, 0).asInt()==0);
+    }
+    for (Id p=0; p<3; p++) {
+        assert(a->params()->refcount(p)==b->params()->refcount(p));
+    }
+    assert(b->params()->refcount(2)==2);
+
+    /* without params */
+    assert(b->addTerms(2, atoms, NULL)==4);
+    assert(bad(b->param(4)) && bad(b->param(5)));
+    assert(b->findWithAll(IdList(1, 3)).size()==2);
+
+    /* invalid atom or param: nothing is added */
+    Id badatoms[] = {0,1, 1,10};
+    bool threw = false;
+    try { b->addTerms(2, badatoms, params); }
+    catch (std::exception&) { threw = true; }
+    assert(threw);
+    Id badparams[] = {0, 3};
+    threw = false;
+    try { b->addTerms(2, atoms, badparams); }
+    catch (std::exception&) { threw = true; }
+    assert(threw);
+    assert(b->maxTermId()==6);
+    assert(b->termProps()->paramCount()==6);
+    assert(b->params()->refcount(0)==1);
+
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,98 @@
+#include "atomsel.hxx"
+#include "elements.hxx"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <regex>
+
+using namespace desres::msys;
+
+/* atoms of mol for which f holds, in id order */
+template <typename F>
+static IdList scan(SystemPtr mol, F f) {
+    IdList ids;
+    for (Id i : mol->atoms()) if (f(i)) ids.push_back(i);
+    return ids;
+}
+
+int main() {
+    srand(3);
+    SystemPtr mol = System::create();
+    const char* resnames[] = {"ALA", "GLY", "HOH", "ALB"};
+    const char* segids[] = {"A", "B", ""};
+    Id iprop = mol->addAtomProp("flag", IntType);
+    Id sprop = mol->addAtomProp("tag", StringType);
+    for (int c=0; c<6; c++) {
+        Id chn = mol->addChain();
+        mol->chain(chn).segid = segids[c%3];
+        for (int r=0; r<20; r++) {
+            Id res = mol->addResidue(chn);
+            mol->residue(res).resid = r - 5 + 1000*(c%2);
+            mol->residue(res).name = resnames[rand()%4];
+            for (int a=0; a<5; a++) {
+                Id atm = mol->addAtom(res);
+                mol->atom(atm).atomic_number = 1 + rand()%8;
+                mol->atom(atm).name = a ? "C" : "CA";
+                mol->atom(atm).charge = (rand()%5)*0.5;
+                mol->atomPropValue(atm, iprop) = rand()%3;
+                mol->atomPropValue(atm, sprop) = a%2 ? "odd" : "even";
+            }
+        }
+    }
+    for (int i=0; i<40; i++) mol->delAtom(rand() % mol->maxAtomId());
+
+    auto resid = [&](Id i) { return mol->residue(mol->atom(i).residue).resid; };
+    auto resname = [&](Id i) {
+        return std::string(mol->residue(mol->atom(i).residue).name.c_str());
+    };
+    auto segid = [&](Id i) {
+        return mol->chain(mol->residue(mol->atom(i).residue).chain).segid;
+    };
+
+    assert(Atomselect(mol, "resid 3 -4 to -2 1000 to 1002")==scan(mol, [&](Id i) {
+        int r = resid(i);
+        return r==3 || (r>=-4 && r<=-2) || (r>=1000 && r<=1002);
+    }));
+    assert(Atomselect(mol, "resid 2 to 100000000")==scan(mol, [&](Id i) {
+        return resid(i)>=2;
+    }));
+    assert(Atomselect(mol, "resname HOH \"AL.\"")==scan(mol, [&](Id i) {
+        return resname(i)!="GLY";
+    }));
+    assert(Atomselect(mol, "segid A or segname \"\"")==scan(mol, [&](Id i) {
+        return segid(i)=="A" || segid(i)=="";
+    }));
+    assert(Atomselect(mol, "element C O")==scan(mol, [&](Id i) {
+        int n = mol->atom(i).atomic_number;
+        return n==6 || n==8;
+    }));
+    assert(Atomselect(mol, "flag 1 and tag odd")==scan(mol, [&](Id i) {
+        return mol->atomPropValue(i, iprop).asInt()==1
+            && mol->atomPropValue(i, sprop).asString()=="odd";
+    }));
+    assert(Atomselect(mol, "charge 1.5 and name CA")==scan(mol, [&](Id i) {
+        return mol->atom(i).charge==1.5 && mol->atom(i).name=="CA";
+    }));
+    assert(Atomselect(mol, "charge > 0.7 and index < 300")==scan(mol, [&](Id i) {
+        return mol->atom(i).charge>0.7 && i<300;
+    }));
+
+    /* same residue as: every live atom of a residue with a selected atom */
+    IdList ca = Atomselect(mol, "name CA and resname GLY");
+    IdList same = scan(mol, [&](Id i) {
+        for (Id j : ca) if (mol->atom(j).residue==mol->atom(i).residue) return true;
+        return false;
+    });
+    assert(Atomselect(mol, "same residue as (name CA and resname GLY)")==same);
+    assert(Atomselect(mol, "same resname as name CA")==scan(mol, [&](Id i) {
+        for (Id j : Atomselect(mol, "name CA")) if (resname(j)==resname(i)) return true;
+        return false;
+    }));
+    assert(Atomselect(mol, "same segid as resid -5")==scan(mol, [&](Id i) {
+        for (Id j : Atomselect(mol, "resid -5")) if (segid(j)==segid(i)) return true;
+        return false;
+    }));
+
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,57 @@
+#include "atomsel.hxx"
+#include "smarts.hxx"
+#include "smiles.hxx"
+#include <assert.h>
+#include <stdio.h>
+#include <algorithm>
+#include <iterator>
+
+using namespace desres::msys;
+
+/* matches found by a fresh annotation, restricted to atoms */
+static IdList reference(SystemPtr mol, const char* pat, IdList const& atoms) {
+    AnnotatedSystem annotated(mol);
+    IdList ids;
+    for (auto const& match : SmartsPattern(pat).findMatches(annotated, mol->atoms())) {
+        ids.insert(ids.end(), match.begin(), match.end());
+    }
+    sort_unique(ids);
+    IdList result;
+    std::set_intersection(ids.begin(), ids.end(), atoms.begin(), atoms.end(),
+                          std::back_inserter(result));
+    return result;
+}
+
+int main() {
+    SystemPtr mol = FromSmilesString("CC(=O)O.C1=CC=CC=C1O.CCO.OC(=O)CC(=O)O");
+    mol->updateFragids();
+    const char* pats[] = {"C(=O)O", "[OX2H]", "c", "[#6]~[#6]"};
+
+    for (int pass=0; pass<2; pass++) {
+        for (const char* pat : pats) {
+            std::string sel = std::string("smarts '") + pat + "'";
+            /* restricted to one fragment first, then all */
+            IdList frag = Atomselect(mol, "fragid 2");
+            assert(Atomselect(mol, "fragid 2 and " + sel)==reference(mol, pat, frag));
+            assert(Atomselect(mol, sel)==reference(mol, pat, mol->atoms()));
+            assert(Atomselect(mol, sel)==reference(mol, pat, mol->atoms()));
+        }
+        /* edit in place: C=O of acetic acid becomes [C+]-[O-] */
+        for (Id b : mol->bonds()) {
+            bond_t& bond = mol->bond(b);
+            if (bond.order==2 && mol->atom(bond.i).fragid==0) {
+                bond.order = 1;
+                mol->atom(bond.i).formal_charge = 1;
+                mol->atom(bond.j).formal_charge = -1;
+                break;
+            }
+        }
+    }
+
+    /* deleting atoms changes the topology too */
+    for (Id i : Atomselect(mol, "fragid 3")) mol->delAtom(i);
+    assert(Atomselect(mol, "smarts 'C(=O)O'")==reference(mol, "C(=O)O", mol->atoms()));
+
+    printf("ok\n");
+    return 0;
+}
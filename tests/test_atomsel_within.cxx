@@ -0,0 +1,99 @@
+#include "atomsel.hxx"
+#include "spatial_hash.hxx"
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+
+using namespace desres::msys;
+
+static float dist2(const float* a, const float* b, const double* cell) {
+    float d2 = 0;
+    for (int k=0; k<3; k++) {
+        float d = a[k]-b[k];
+        if (cell) {
+            float L = cell[4*k];
+            d -= L*roundf(d/L);
+        }
+        d2 += d*d;
+    }
+    return d2;
+}
+
+static IdList brute_within(SystemPtr mol, const float* pos, IdList const& sub,
+                           float rad, const double* cell, bool exclude) {
+    IdList ids;
+    IdList sorted(sub);
+    std::sort(sorted.begin(), sorted.end());
+    for (Id i : mol->atoms()) {
+        bool in = std::binary_search(sorted.begin(), sorted.end(), i);
+        if (exclude && in) continue;
+        bool hit = in;
+        for (Id j : sub) {
+            if (hit) break;
+            hit = dist2(pos+3*i, pos+3*j, cell) <= rad*rad;
+        }
+        if (hit) ids.push_back(i);
+    }
+    return ids;
+}
+
+static IdList brute_nearest(SystemPtr mol, const float* pos, IdList const& sub,
+                            Id k) {
+    std::vector<std::pair<float,Id>> d;
+    for (Id i : mol->atoms()) {
+        if (std::find(sub.begin(), sub.end(), i)!=sub.end()) continue;
+        float best = HUGE_VALF;
+        for (Id j : sub) best = std::min(best, dist2(pos+3*i, pos+3*j, nullptr));
+        d.emplace_back(best, i);
+    }
+    std::sort(d.begin(), d.end());
+    IdList ids;
+    for (Id i=0; i<k; i++) ids.push_back(d[i].second);
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+int main() {
+    srand48(11);
+    SystemPtr mol = System::create();
+    const Id N = 10000;
+    Id res = mol->addResidue(mol->addChain());
+    for (Id i=0; i<N; i++) mol->addAtom(res);
+    for (Id i=0; i<200; i++) mol->delAtom(lrand48() % N);
+
+    double cell[9] = {30,0,0, 0,30,0, 0,0,30};
+    std::copy(cell, cell+9, mol->global_cell[0]);
+    std::vector<float> pos(3*N);
+    for (float& x : pos) x = 30*drand48();
+    for (Id i=0; i<N; i++) {
+        std::copy(&pos[3*i], &pos[3*i+3], mol->atomPos(i));
+    }
+    /* positions differing from the System's */
+    std::vector<float> moved(pos);
+    for (float& x : moved) x = fmodf(x + 7.5f, 30);
+
+    IdList sub = Atomselect(mol, "index < 1500");
+    IdList sub2 = Atomselect(mol, "index 17 42 4000");
+    SpatialHashCache hashes;
+    for (int pass=0; pass<2; pass++) {
+        const float* p = pass ? moved.data() : pos.data();
+        const float* arg = pass ? moved.data() : nullptr;
+        assert(Atomselect(mol, "within 1.5 of index < 1500", arg, nullptr)
+               ==brute_within(mol, p, sub, 1.5, nullptr, false));
+        assert(Atomselect(mol, "exwithin 1.5 of index < 1500", arg, nullptr)
+               ==brute_within(mol, p, sub, 1.5, nullptr, true));
+        assert(Atomselect(mol, "pbwithin 2 of index 17 42 4000", arg, nullptr)
+               ==brute_within(mol, p, sub2, 2, cell, false));
+        assert(Atomselect(mol, "nearest 25 to index 17 42 4000", arg, nullptr)
+               ==brute_nearest(mol, p, sub2, 25));
+        if (arg) {
+            assert(Atomselect(mol, "pbwithin 2 of index < 1500", arg, cell, &hashes)
+                   ==brute_within(mol, p, sub, 2, cell, false));
+        }
+    }
+
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,68 @@
+#include "system.hxx"
+#include "atomsel.hxx"
+#include <set>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace desres::msys;
+
+/* the graph lists bonds and neighbors in bondsForAtom order */
+static void compare_with_bonds(SystemPtr mol) {
+    BondGraphPtr g = mol->bondGraph();
+    assert(g->atomCount()==mol->maxAtomId());
+    for (Id i=0; i<mol->maxAtomId(); i++) {
+        IdList const& bonds = mol->bondsForAtom(i);
+        IdList nbrs = mol->bondedAtoms(i);
+        assert(g->degree(i)==bonds.size());
+        assert(IdList(g->bonds(i).begin(), g->bonds(i).end())==bonds);
+        assert(IdList(g->neighbors(i).begin(), g->neighbors(i).end())==nbrs);
+    }
+}
+
+int main() {
+    SystemPtr mol = System::create();
+    Id res = mol->addResidue(mol->addChain());
+    const Id natoms = 500;
+    for (Id i=0; i<natoms; i++) mol->addAtom(res);
+    compare_with_bonds(mol);
+
+    srand48(11);
+    for (int k=0; k<800; k++) {
+        Id i = lrand48() % natoms, j = lrand48() % natoms;
+        if (i!=j) mol->addBond(i,j);
+    }
+    compare_with_bonds(mol);
+    BondGraphPtr g = mol->bondGraph();
+    assert(mol->bondGraph()==g);    /* cached while unchanged */
+
+    Id ndeg = g->degree(7);
+    mol->delAtom(3);
+    mol->delBond(mol->bonds().at(10));
+    assert(mol->bondGraph()!=g);
+    assert(g->degree(7)==ndeg);     /* old snapshot is untouched */
+    compare_with_bonds(mol);
+
+    Id id = mol->addAtom(res);
+    mol->addBond(id, 0);
+    compare_with_bonds(mol);
+
+    /* fragments computed from the graph agree with a full traversal */
+    MultiIdList frags;
+    Id nfrags = mol->updateFragids(&frags);
+    assert(nfrags==frags.size());
+    for (Id b : mol->bonds()) {
+        bond_t const& bnd = mol->bond(b);
+        assert(mol->atom(bnd.i).fragid==mol->atom(bnd.j).fragid);
+    }
+    /* withinbonds agrees with a naive expansion */
+    std::set<Id> near = {5, 6};
+    for (int k=0; k<3; k++) {
+        std::set<Id> tmp(near);
+        for (Id i : near) for (Id j : mol->bondedAtoms(i)) tmp.insert(j);
+        near.swap(tmp);
+    }
+    assert(Atomselect(mol, "withinbonds 3 of index 5 6")==IdList(near.begin(), near.end()));
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,102 @@
+#include "clone.hxx"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace desres::msys;
+
+/* dst holds the terms of src whose atoms are all in atoms, renumbered,
+ * with the same params; the very same rows if the params are shared */
+static void compare_terms(SystemPtr src, IdList const& atoms, SystemPtr dst,
+                          bool shared) {
+    IdList atmmap(src->maxAtomId(), BadId);
+    for (Id i=0; i<atoms.size(); i++) atmmap[atoms[i]] = i;
+    assert(dst->tableNames()==src->tableNames());
+    for (String const& name : src->tableNames()) {
+        TermTablePtr a = src->table(name);
+        TermTablePtr b = dst->table(name);
+        assert(a->category==b->category);
+        assert(shared == (a->params()==b->params()));
+        Id dt = 0;
+        for (Id t : a->terms()) {
+            IdList ids = a->atoms(t);
+            bool ok = true;
+            for (Id& id : ids) {
+                id = atmmap[id];
+                if (bad(id)) ok = false;
+            }
+            if (!ok) continue;
+            assert(b->hasTerm(dt));
+            assert(b->atoms(dt)==ids);
+            assert(b->termPropValue(dt, "w").asInt()==
+                   a->termPropValue(t, "w").asInt());
+            Id p = a->param(t), q = b->param(dt);
+            assert(bad(p)==bad(q));
+            if (!bad(p)) {
+                assert(b->params()->value(q, "k").asFloat()==
+                       a->params()->value(p, "k").asFloat());
+                if (shared) assert(p==q);
+            }
+            dt++;
+        }
+        assert(b->maxTermId()==dt);
+    }
+}
+
+int main() {
+    srand(1);
+    SystemPtr mol = System::create();
+    const Id natoms = 200;
+    for (Id i=0; i<natoms; i++) mol->addAtom(mol->addResidue(mol->addChain()));
+
+    /* "bond" and "pair" share a ParamTable; "angle" has its own */
+    TermTablePtr bond = mol->addTable("bond", 2);
+    TermTablePtr pair = mol->addTable("pair", 2, bond->params());
+    TermTablePtr angle = mol->addTable("angle", 3);
+    bond->category = BOND;
+    angle->category = BOND;
+    pair->category = EXCLUSION;
+    for (TermTablePtr table : {bond, pair, angle}) {
+        ParamTablePtr params = table->params();
+        params->addProp("k", FloatType);
+        if (!params->paramCount()) {
+            for (int i=0; i<50; i++) params->value(params->addParam(), "k") = i;
+        }
+        table->addTermProp("w", IntType);
+        for (int i=0; i<1000; i++) {
+            IdList ids(table->atomCount());
+            for (Id& id : ids) id = rand() % natoms;
+            Id p = rand()%5 ? Id(rand()%50) : BadId;
+            Id t = table->addTerm(ids, p);
+            table->termPropValue(t, "w") = i;
+        }
+        for (int i=0; i<100; i++) table->delTerm(rand() % table->maxTermId());
+    }
+    for (Id i : {7, 8, 9}) mol->delAtom(i);
+
+    /* enough terms that the tables are filled in parallel */
+    TermTablePtr big = mol->addTable("big", 1);
+    big->params()->addProp("k", FloatType);
+    big->addTermProp("w", IntType);
+    big->params()->addParam();
+    for (int i=0; i<100000; i++) big->addTerm(IdList(1, mol->atoms()[i%197]), 0);
+
+    for (int iter=0; iter<5; iter++) {
+        IdList atoms;
+        for (Id i : mol->atoms()) if (rand()%4) atoms.push_back(i);
+        compare_terms(mol, atoms, Clone(mol, atoms), false);
+        compare_terms(mol, atoms, Clone(mol, atoms, CloneOption::UseIndex), false);
+        SystemPtr dst = Clone(mol, atoms, CloneOption::ShareParams);
+        compare_terms(mol, atoms, dst, true);
+        assert(bond->params()->paramCount()==50);
+        assert(angle->params()->paramCount()==50);
+        dst = Clone(mol, atoms);
+        assert(dst->table("bond")->params()==dst->table("pair")->params());
+        assert(dst->table("angle")->params()!=dst->table("bond")->params());
+    }
+    assert(Clone(mol, mol->atoms(), CloneOption::StructureOnly)
+            ->tableNames().empty());
+
+    printf("ok\n");
+    return 0;
+}
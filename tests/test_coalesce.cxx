@@ -0,0 +1,164 @@
+#include "system.hxx"
+#include "override.hxx"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <map>
+
+using namespace desres::msys;
+
+static SystemPtr build(unsigned seed) {
+    srand(seed);
+    SystemPtr mol = System::create();
+    for (int i=0; i<200; i++) mol->addAtom(mol->addResidue(mol->addChain()));
+
+    /* stretch and angle share a param table; pair has its own */
+    ParamTablePtr shared = ParamTable::create();
+    shared->addProp("fc", FloatType);
+    shared->addProp("n", IntType);
+    shared->addProp("type", StringType);
+    TermTablePtr stretch = mol->addTable("stretch", 2, shared);
+    TermTablePtr angle = mol->addTable("angle", 3, shared);
+    TermTablePtr pair = mol->addTable("pair", 2);
+    pair->params()->addProp("aij", FloatType);
+    pair->params()->addProp("bij", IntType);
+
+    const char* types[] = {"a", "b", "c"};
+    Float fcs[] = {0.0, -0.0, 1.5, 2.5};
+    for (int i=0; i<3000; i++) {
+        TermTablePtr table = i%3==0 ? stretch : i%3==1 ? angle : pair;
+        IdList atoms(table->atomCount());
+        for (Id& a : atoms) a = rand() % 200;
+        Id p = BadId;
+        if (rand() % 10) {
+            ParamTablePtr params = table->params();
+            p = params->addParam();
+            if (table==pair) {
+                params->value(p,0) = fcs[rand()%4];
+                params->value(p,1) = rand()%3;
+            } else {
+                params->value(p,0) = fcs[rand()%4];
+                params->value(p,1) = rand()%2;
+                params->value(p,2) = types[rand()%3];
+            }
+        }
+        table->addTerm(atoms, p);
+    }
+    /* delete some terms, leaving their params unused */
+    for (Id t=0; t<pair->maxTermId(); t+=7) pair->delTerm(t);
+
+    /* overrides in the pair table */
+    ParamTablePtr oparams = pair->overrides()->params();
+    oparams->addProp("scale", FloatType);
+    for (int i=0; i<20; i++) {
+        Id p1 = rand() % pair->params()->paramCount();
+        Id p2 = rand() % pair->params()->paramCount();
+        Id o = oparams->addParam();
+        oparams->value(o,0) = Float(i);
+        pair->overrides()->set(IdPair(p1,p2), o);
+    }
+    return mol;
+}
+
+/* first param in term order with the same values; overridden params
+ * are distinct from all others. */
+static void reference_coalesce(TermTablePtr table) {
+    ParamTablePtr params = table->params();
+    OverrideTablePtr overrides = table->overrides();
+    std::vector<bool> overridden(params->paramCount());
+    for (auto pair : overrides->list()) {
+        overridden[pair.first] = true;
+        overridden[pair.second] = true;
+    }
+    IdList reps;
+    IdList old2new(params->paramCount(), BadId);
+    for (Id t : table->terms()) {
+        Id p = table->param(t);
+        if (bad(p)) continue;
+        Id q = BadId;
+        if (overridden[p]) {
+            q = p;
+        } else {
+            for (Id r : reps) {
+                if (!overridden[r] && params->compare(p,r)==0) {
+                    q = r;
+                    break;
+                }
+            }
+            if (bad(q)) {
+                reps.push_back(p);
+                q = p;
+            }
+        }
+        old2new[p] = q;
+        table->setParam(t, q);
+    }
+    for (auto pair : overrides->list()) {
+        Id o = overrides->get(pair);
+        overrides->del(pair);
+        Id p1 = old2new[pair.first];
+        Id p2 = old2new[pair.second];
+        if (bad(p1) || bad(p2)) continue;
+        overrides->set(IdPair(p1,p2), o);
+    }
+}
+
+/* the original std::map based implementation, for tables without
+ * overrides */
+struct Less {
+    ParamTablePtr params;
+    bool operator()(Id i, Id j) const { return params->compare(i,j)<0; }
+};
+static void map_coalesce(TermTablePtr table) {
+    std::map<Id, IdList, Less> map(Less{table->params()});
+    for (Id t : table->terms()) {
+        if (!bad(table->param(t))) map[table->param(t)].push_back(t);
+    }
+    for (auto& it : map) {
+        for (Id t : it.second) table->setParam(t, it.first);
+    }
+}
+
+static void compare(SystemPtr a, SystemPtr b) {
+    for (String name : a->tableNames()) {
+        TermTablePtr ta = a->table(name);
+        TermTablePtr tb = b->table(name);
+        assert(ta->terms()==tb->terms());
+        for (Id t : ta->terms()) assert(ta->param(t)==tb->param(t));
+        for (Id p=0; p<ta->params()->paramCount(); p++) {
+            assert(ta->params()->refcount(p)==tb->params()->refcount(p));
+        }
+        auto oa = ta->overrides()->list();
+        auto ob = tb->overrides()->list();
+        assert(oa==ob);
+        for (auto pair : oa) {
+            assert(ta->overrides()->get(pair)==tb->overrides()->get(pair));
+        }
+    }
+}
+
+int main() {
+    for (unsigned seed : {1, 2, 3}) {
+        SystemPtr ref = build(seed);
+        for (String name : ref->tableNames()) {
+            reference_coalesce(ref->table(name));
+        }
+        for (const char* nthreads : {"1", "4"}) {
+            setenv("MSYS_NUM_THREADS", nthreads, 1);
+            SystemPtr mol = build(seed);
+            mol->coalesceTables();
+            compare(ref, mol);
+        }
+
+        /* without overrides, same as the map-based algorithm */
+        SystemPtr old = build(seed);
+        SystemPtr mol = build(seed);
+        old->table("pair")->overrides()->clear();
+        mol->table("pair")->overrides()->clear();
+        for (String name : old->tableNames()) map_coalesce(old->table(name));
+        mol->coalesceTables();
+        compare(old, mol);
+    }
+    printf("ok\n");
+    return 0;
+}
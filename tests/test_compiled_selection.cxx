@@ -0,0 +1,68 @@
+#include "atomsel.hxx"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+
+using namespace desres::msys;
+
+int main() {
+    srand48(1);
+    SystemPtr mol = System::create();
+    const Id N = 300;
+    for (Id i=0; i<N; i++) {
+        Id res = mol->addResidue(mol->addChain());
+        Id atm = mol->addAtom(res);
+        mol->atom(atm).name = i%3 ? "C" : "O";
+        mol->residue(res).resid = i/3;
+    }
+    const char* sels[] = {
+        "name O and within 2 of resid 3",
+        "pbwithin 3 of name O and not resid 1 to 10",
+        "x < 5 and name C",
+        "same residue as (y > 4)",
+        "nearest 5 to resid 7",
+        "name O",
+    };
+    const bool positional[] = {true, true, true, true, true, false};
+    std::vector<CompiledSelectionPtr> compiled;
+    for (int i=0; i<6; i++) {
+        compiled.emplace_back(new CompiledSelection(mol, sels[i]));
+        assert(compiled.back()->positional()==positional[i]);
+        assert(compiled.back()->text()==sels[i]);
+    }
+
+    double cell[9] = {10,0,0, 0,10,0, 0,0,10};
+    std::copy(cell, cell+9, mol->global_cell[0]);
+    std::vector<float> pos(3*N);
+    for (int frame=0; frame<5; frame++) {
+        for (float& x : pos) x = 10*drand48();
+        for (int i=0; i<6; i++) {
+            IdList ids = Atomselect(mol, sels[i], &pos[0], cell);
+            assert(compiled[i]->select(&pos[0], cell)==ids);
+        }
+        /* positions from the System */
+        for (Id i=0; i<N; i++) {
+            std::copy(&pos[3*i], &pos[3*i+3], mol->atomPos(i));
+        }
+        for (int i=0; i<6; i++) {
+            assert(compiled[i]->select()==Atomselect(mol, sels[i]));
+        }
+    }
+
+    /* static clauses are cached until reset */
+    CompiledSelection& sel = *compiled[5];
+    IdList oxygens = sel.select();
+    mol->atom(0).name = "N";
+    assert(sel.select()==oxygens);
+    sel.reset();
+    assert(sel.select()==IdList(oxygens.begin()+1, oxygens.end()));
+
+    bool threw = false;
+    try { CompiledSelection(mol, "  "); }
+    catch (std::exception&) { threw = true; }
+    assert(threw);
+
+    printf("ok\n");
+    return 0;
+}
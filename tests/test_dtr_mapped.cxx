@@ -0,0 +1,71 @@
+#include "dtr_fixture.hxx"
+#include "molfile/dtrframe.hxx"
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <vector>
+
+using namespace desres::molfile;
+
+static const int natoms = 1000;
+static const int nframes = 10;
+
+/* Compare a MappedAccess reader against a plain pread reader, frame by
+ * frame, over several frame files. */
+static void compare_with_pread(std::string const& path, unsigned access) {
+    DtrReader ref(path);
+    ref.init();
+    DtrReader r(path, access | DtrReader::MappedAccess);
+    r.init();
+    assert(r.size()==nframes);
+
+    test::Frame f0(natoms, true), f1(natoms, true);
+    std::vector<std::shared_ptr<const void>> held;
+    std::vector<dtr::KeyMap> maps;
+    for (int f=0; f<nframes; f++) {
+        void* buf = nullptr;
+        auto keys = ref.frame(f, &f0.ts, &buf);
+
+        /* frame() reads through the mapping when no buffer is given */
+        if (access & DtrReader::SequentialAccess) {
+            assert(r.next(&f1.ts));
+        } else {
+            r.frame(f, &f1.ts);
+        }
+        assert(f0.ts.physical_time==f1.ts.physical_time);
+        assert(f0.pos==f1.pos);
+        assert(f0.vel==f1.vel);
+
+        std::shared_ptr<const void> mapping;
+        auto mkeys = r.mapped_frame(f, NULL, &mapping);
+        assert(mapping);
+        assert(keys.size()==mkeys.size());
+        auto pos = mkeys.at("POSITION");
+        assert(pos.count==3*natoms);
+        assert(!memcmp(pos.data, keys.at("POSITION").data, 3*natoms*sizeof(float)));
+        held.push_back(mapping);
+        maps.push_back(mkeys);
+        free(buf);
+    }
+    if (access & DtrReader::SequentialAccess) assert(!r.next(&f1.ts));
+
+    /* mapped fields stay valid while the mapping is held */
+    for (int f=0; f<nframes; f++) {
+        const float* pos = (const float*)maps[f].at("POSITION").data;
+        assert(pos[0]==f);
+    }
+}
+
+int main() {
+    std::string path = "/tmp/test_dtr_mapped.dtr";
+    test::DtrSpec spec;
+    spec.natoms = natoms;
+    spec.nframes = nframes;
+    spec.frames_per_file = 3;
+    spec.with_vel = true;
+    test::write_dtr(path, spec);
+    compare_with_pread(path, DtrReader::RandomAccess);
+    compare_with_pread(path, DtrReader::SequentialAccess);
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,97 @@
+#include "dtr_fixture.hxx"
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <vector>
+
+using namespace desres::molfile;
+
+static const int natoms = 700;
+
+static void write_dtr(std::string const& path, int nframes, double t0,
+                      double precision) {
+    test::DtrSpec spec;
+    spec.natoms = natoms;
+    spec.nframes = nframes;
+    spec.t0 = t0;
+    spec.with_vel = !precision;
+    spec.precision = precision;
+    test::write_dtr(path, spec);
+}
+
+/* read_frames over a mix of reversed, strided and repeated indices must
+ * give the same positions, velocities and cells as frame(), whatever
+ * the number of threads. */
+static void compare_with_frame(FrameSetReader const& r) {
+    std::vector<ssize_t> indices;
+    for (ssize_t i=r.size()-1; i>=0; i--) indices.push_back(i);
+    for (ssize_t i=0; i<r.size(); i+=3) indices.push_back(i);
+    indices.push_back(0);
+    const size_t n = indices.size();
+    const size_t stride = 3*natoms;
+    const bool with_vel = r.has_velocities();
+
+    std::vector<float> ref(n*stride), refvel(n*stride);
+    std::vector<double> refbox(9*n);
+    molfile_timestep_t ts;
+    memset(&ts, 0, sizeof(ts));
+    for (size_t i=0; i<n; i++) {
+        ts.coords = &ref[i*stride];
+        ts.velocities = with_vel ? &refvel[i*stride] : NULL;
+        r.frame(indices[i], &ts);
+        memcpy(&refbox[9*i], ts.unit_cell, sizeof(ts.unit_cell));
+    }
+
+    for (unsigned nthreads : {1, 2, 5, 64}) {
+        std::vector<float> pos(n*stride, -1), vel(n*stride, -1);
+        std::vector<double> box(9*n, -1);
+        r.read_frames(n, indices.data(), pos.data(),
+                      with_vel ? vel.data() : NULL, box.data(), nthreads);
+        assert(pos==ref);
+        if (with_vel) assert(vel==refvel);
+        assert(box==refbox);
+    }
+
+    /* bad indices are reported */
+    ssize_t bad = r.size();
+    std::vector<float> pos(stride);
+    bool threw = false;
+    try {
+        r.read_frames(1, &bad, pos.data());
+    } catch (std::exception&) {
+        threw = true;
+    }
+    assert(threw);
+}
+
+int main() {
+    write_dtr("/tmp/test_read_frames_1.dtr", 25, 0, 0);
+    write_dtr("/tmp/test_read_frames_2.dtr", 13, 25, 0);
+    bool with_tng = true;
+    try {
+        write_dtr("/tmp/test_read_frames_c.dtr", 17, 0, 0.001);
+    } catch (std::exception&) {
+        /* built without TNG compression */
+        with_tng = false;
+    }
+    test::write_stk("/tmp/test_read_frames.stk",
+            {"/tmp/test_read_frames_1.dtr", "/tmp/test_read_frames_2.dtr"});
+    {
+        DtrReader r("/tmp/test_read_frames_1.dtr");
+        r.init();
+        compare_with_frame(r);
+    }
+    if (with_tng) {
+        DtrReader r("/tmp/test_read_frames_c.dtr");
+        r.init();
+        compare_with_frame(r);
+    }
+    {
+        StkReader s("/tmp/test_read_frames.stk");
+        s.init();
+        assert(s.size()==38);
+        compare_with_frame(s);
+    }
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,67 @@
+#include "dtr_fixture.hxx"
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <vector>
+
+using namespace desres::molfile;
+
+static const int natoms = 500;
+
+/* Iterate r with the given read-ahead depth, skipping every seventh
+ * frame, and compare against random access through ref. */
+static void compare_with_random_access(FrameSetReader& ref, FrameSetReader& r,
+                                       unsigned depth) {
+    r.set_readahead(depth);
+    test::Frame f0(natoms), f1(natoms);
+    for (ssize_t i=0; i<ref.size(); i++) {
+        ref.frame(i, &f0.ts);
+        if (i % 7 == 3) {
+            /* skipped frames are discarded from the read-ahead */
+            assert(r.next(NULL));
+            continue;
+        }
+        assert(r.next(&f1.ts));
+        assert(f0.ts.physical_time==f1.ts.physical_time);
+        assert(f0.pos==f1.pos);
+    }
+    assert(!r.next(&f1.ts));
+}
+
+int main() {
+    test::DtrSpec spec;
+    spec.natoms = natoms;
+    spec.nframes = 25;
+    test::write_dtr("/tmp/test_readahead_1.dtr", spec);
+    spec.nframes = 13;
+    spec.t0 = 25;
+    test::write_dtr("/tmp/test_readahead_2.dtr", spec);
+    test::write_stk("/tmp/test_readahead.stk",
+            {"/tmp/test_readahead_1.dtr", "/tmp/test_readahead_2.dtr"});
+
+    for (unsigned depth : {1, 2, 8, 100}) {
+        DtrReader ref("/tmp/test_readahead_1.dtr");
+        ref.init();
+        DtrReader r("/tmp/test_readahead_1.dtr", DtrReader::SequentialAccess);
+        r.init();
+        compare_with_random_access(ref, r, depth);
+
+        StkReader sref("/tmp/test_readahead.stk");
+        sref.init();
+        StkReader s("/tmp/test_readahead.stk", DtrReader::SequentialAccess);
+        s.init();
+        assert(s.size()==38);
+        compare_with_random_access(sref, s, depth);
+    }
+
+    /* stopping early must not hang or leak the reader thread */
+    {
+        DtrReader r("/tmp/test_readahead_1.dtr", DtrReader::SequentialAccess);
+        r.init();
+        r.set_readahead(4);
+        test::Frame frame(natoms);
+        assert(r.next(&frame.ts));
+    }
+    printf("ok\n");
+    return 0;
+}
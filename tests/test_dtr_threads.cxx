@@ -0,0 +1,131 @@
+#include "dtr_fixture.hxx"
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iterator>
+#include <iomanip>
+
+using namespace desres::molfile;
+
+static const int natoms = 600;
+static const int nframes = 23;
+
+/* the writer copies each frame before next() returns, so the fixture's
+ * reuse of its buffers also checks that the background threads don't
+ * read from them */
+static void write_dtr(std::string const& path, unsigned nthreads,
+                      double precision) {
+    test::DtrSpec spec;
+    spec.natoms = natoms;
+    spec.nframes = nframes;
+    spec.frames_per_file = 5;
+    spec.precision = precision;
+    spec.compression_threads = nthreads;
+    spec.sync_after = nframes/2;
+    test::write_dtr(path, spec);
+}
+
+static std::string slurp(std::string const& path) {
+    std::ifstream in(path.c_str(), std::ios::binary);
+    assert(in);
+    return std::string(std::istreambuf_iterator<char>(in),
+                       std::istreambuf_iterator<char>());
+}
+
+/* frame files written with and without compression threads must be
+ * byte for byte the same */
+static void compare_dtrs(std::string const& a, std::string const& b) {
+    assert(slurp(a+"/timekeys")==slurp(b+"/timekeys"));
+    for (int i=0; i<(nframes+4)/5; i++) {
+        std::stringstream ss;
+        ss << "/frame" << std::setfill('0') << std::setw(9) << i;
+        assert(slurp(a+ss.str())==slurp(b+ss.str()));
+    }
+}
+
+/* read-ahead decoding on several threads, skipping every fifth frame */
+static void check_readahead(std::string const& path) {
+    DtrReader ref(path);
+    ref.init();
+    test::Frame f0(natoms), f1(natoms);
+    molfile_timestep_t& t0 = f0.ts;
+    molfile_timestep_t& t1 = f1.ts;
+    for (unsigned nthreads : {2, 3, 8}) {
+        for (unsigned depth : {1, 4, 100}) {
+            DtrReader r(path, DtrReader::SequentialAccess);
+            r.init();
+            r.set_readahead(depth, nthreads);
+            for (ssize_t i=0; i<ref.size(); i++) {
+                ref.frame(i, &t0);
+                if (i % 5 == 2) {
+                    assert(r.next(NULL));
+                    continue;
+                }
+                assert(r.next(&t1));
+                assert(t0.physical_time==t1.physical_time);
+                assert(f0.pos==f1.pos);
+                assert(!memcmp(t0.unit_cell, t1.unit_cell, sizeof(t0.unit_cell)));
+            }
+            assert(!r.next(&t1));
+        }
+    }
+}
+
+int main() {
+    write_dtr("/tmp/test_dtr_threads_0.dtr", 0, 0);
+    for (unsigned nthreads : {1, 3}) {
+        write_dtr("/tmp/test_dtr_threads_n.dtr", nthreads, 0);
+        compare_dtrs("/tmp/test_dtr_threads_0.dtr", "/tmp/test_dtr_threads_n.dtr");
+    }
+    check_readahead("/tmp/test_dtr_threads_n.dtr");
+
+    bool with_tng = true;
+    try {
+        write_dtr("/tmp/test_dtr_threads_c0.dtr", 0, 0.001);
+    } catch (std::exception&) {
+        /* built without TNG compression */
+        with_tng = false;
+    }
+    if (with_tng) {
+        write_dtr("/tmp/test_dtr_threads_cn.dtr", 4, 0.001);
+        compare_dtrs("/tmp/test_dtr_threads_c0.dtr", "/tmp/test_dtr_threads_cn.dtr");
+        check_readahead("/tmp/test_dtr_threads_cn.dtr");
+    } else {
+        /* errors from the background threads surface in the writer, and
+         * stay there: every later write, sync() and close() reports them */
+        test::Frame frame(natoms);
+        molfile_timestep_t& ts = frame.ts;
+        DtrWriter w("/tmp/test_dtr_threads_cn.dtr", DtrWriter::Type::DTR,
+                    natoms, DtrWriter::CLOBBER, 5, nullptr, 0.001);
+        w.set_compression_threads(2);
+        int nthrown = 0;
+        for (int f=0; f<nframes; f++) {
+            ts.physical_time = f;
+            try {
+                w.next(&ts);
+            } catch (std::exception&) {
+                ++nthrown;
+            }
+        }
+        assert(nthrown>0);
+        bool threw = false;
+        try {
+            w.sync();
+        } catch (std::exception&) {
+            threw = true;
+        }
+        assert(threw);
+        threw = false;
+        try {
+            w.close();
+        } catch (std::exception&) {
+            threw = true;
+        }
+        assert(threw);
+    }
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,75 @@
+#include "system.hxx"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stack>
+#include <algorithm>
+
+using namespace desres::msys;
+
+static IdList reference_fragids(SystemPtr mol) {
+    IdList frag(mol->maxAtomId(), BadId);
+    Id fragid=0;
+    for (Id i : mol->atoms()) {
+        if (!bad(frag[i])) continue;
+        std::stack<Id> S;
+        S.push(i);
+        frag[i] = fragid;
+        while (!S.empty()) {
+            Id a = S.top();
+            S.pop();
+            for (Id b : mol->bondedAtoms(a)) {
+                if (bad(frag[b])) {
+                    frag[b] = fragid;
+                    S.push(b);
+                }
+            }
+        }
+        ++fragid;
+    }
+    return frag;
+}
+
+/* fragids numbered by smallest atom, for any number of threads */
+static void compare_fragids(SystemPtr mol) {
+    IdList ref = reference_fragids(mol);
+    for (const char* nthreads : {"1", "3", "16"}) {
+        setenv("MSYS_NUM_THREADS", nthreads, 1);
+        MultiIdList frags;
+        Id n = mol->updateFragids(&frags);
+        assert(n==frags.size());
+        for (Id i=0; i<mol->maxAtomId(); i++) {
+            assert(mol->atomFAST(i).fragid==ref[i]);
+        }
+        for (Id f=0; f<n; f++) {
+            assert(!frags[f].empty());
+            assert(std::is_sorted(frags[f].begin(), frags[f].end()));
+            if (f) assert(frags[f-1][0] < frags[f][0]);
+        }
+    }
+}
+
+int main() {
+    SystemPtr mol = System::create();
+    Id res = mol->addResidue(mol->addChain());
+    const Id natoms = 200000;
+    for (Id i=0; i<natoms; i++) mol->addAtom(res);
+    compare_fragids(mol);
+
+    /* short chains plus random long-range links, so fragments span the
+     * work of several threads */
+    srand48(3);
+    for (Id i=0; i+1<natoms; i++) {
+        if (lrand48() % 4) mol->addBond(i, i+1);
+    }
+    for (int k=0; k<20000; k++) {
+        Id i = lrand48() % natoms, j = lrand48() % natoms;
+        if (i!=j) mol->addBond(i, j);
+    }
+    compare_fragids(mol);
+
+    for (int k=0; k<5000; k++) mol->delAtom(lrand48() % natoms);
+    compare_fragids(mol);
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,98 @@
+#include "analyze.hxx"
+#include "elements.hxx"
+#include "pfx/cell.hxx"
+#include "pfx/rms.hxx"
+#include <stdlib.h>
+#include <stdio.h>
+#include <cassert>
+
+using namespace desres::msys;
+
+/* all-pairs reference for GuessBondConnectivity(periodic=true) */
+static std::vector<IdPair> brute_force(SystemPtr mol) {
+    std::vector<IdPair> bonds;
+    const double* cell = mol->global_cell[0];
+    double box[9], inv[9];
+    pfx::trans_3x3(box, cell);
+    if (!pfx::inverse_3x3(inv, box)) memset(inv, 0, sizeof(inv));
+    std::copy(cell, cell+9, box);
+    IdList atoms = mol->atoms();
+    for (Id i=0; i<atoms.size(); i++) {
+        auto const& a = mol->atomFAST(atoms[i]);
+        for (Id j=i+1; j<atoms.size(); j++) {
+            auto const& b = mol->atomFAST(atoms[j]);
+            int ai = a.atomic_number, aj = b.atomic_number;
+            if ((ai==1 && aj==1) || (ai==0 && aj==0)) continue;
+            double cut = 0.6*(RadiusForElement(ai)+RadiusForElement(aj));
+            const Float* pa = mol->atomPosFAST(atoms[i]);
+            const Float* pb = mol->atomPosFAST(atoms[j]);
+            double d[3] = {pb[0]-pa[0], pb[1]-pa[1], pb[2]-pa[2]}, v[3];
+            std::copy(d, d+3, v);
+            pfx::wrap_vector(box, inv, d);
+            double dx=d[0]+v[0], dy=d[1]+v[1], dz=d[2]+v[2];
+            if (dx*dx+dy*dy+dz*dz < cut*cut) {
+                bonds.emplace_back(atoms[i], atoms[j]);
+            }
+        }
+    }
+    return bonds;
+}
+
+/* atoms at fractional coordinates in [lo,hi) */
+static void compare_with_brute_force(const double* cell, int natoms,
+                                     double lo=-1, double hi=2) {
+    auto mol = System::create();
+    Id res = mol->addResidue(mol->addChain());
+    for (int i=0; i<natoms; i++) {
+        Id id = mol->addAtom(res);
+        auto& atm = mol->atomFAST(id);
+        Float* pos = mol->atomPosFAST(id);
+        /* heavy atoms only, so no bonds are pruned afterwards */
+        atm.atomic_number = 6 + i%3;
+        double f[3];
+        for (int m=0; m<3; m++) f[m] = lo + (hi-lo)*drand48();
+        pos[0] = f[0]*cell[0] + f[1]*cell[3] + f[2]*cell[6];
+        pos[1] = f[0]*cell[1] + f[1]*cell[4] + f[2]*cell[7];
+        pos[2] = f[0]*cell[2] + f[1]*cell[5] + f[2]*cell[8];
+    }
+    std::copy(cell, cell+9, mol->global_cell[0]);
+    /* a deleted atom must be skipped */
+    mol->delAtom(natoms/2);
+
+    auto expected = brute_force(mol);
+    GuessBondConnectivity(mol, true);
+    std::vector<IdPair> found;
+    for (Id b : mol->bonds()) {
+        found.emplace_back(mol->bondFAST(b).i, mol->bondFAST(b).j);
+    }
+    printf("%lu bonds\n", found.size());
+    assert(found == expected);
+}
+
+int main() {
+    srand48(1973);
+    const double d = 20.0;
+    double ortho[9] = {d, 0, 0, 0, 1.2*d, 0, 0, 0, 0.9*d};
+    double toct[9] = {d, 0, 0,
+                      d/3, 2*sqrt(2.)*d/3, 0,
+                      -d/3, sqrt(2.)*d/3, sqrt(6.)*d/3};
+    double small[9] = {1.5, 0, 0, 0, 1.5, 0, 0.5, 0, 1.5};
+    double none[9] = {0,0,0, 0,0,0, 0,0,0};
+    compare_with_brute_force(ortho, 3000);
+    compare_with_brute_force(toct, 3000);
+    compare_with_brute_force(small, 20);
+
+    /* skewed cells, one with heights just above the cutoff, and atoms
+     * clustered across a corner of the cell */
+    double skew[9] = {d, 0, 0,
+                      0.9*d, 0.5*d, 0,
+                      -0.8*d, 0.45*d, 0.6*d};
+    double tight[9];
+    for (int i=0; i<9; i++) tight[i] = 0.4*skew[i];
+    compare_with_brute_force(skew, 3000);
+    compare_with_brute_force(skew, 600, 0.85, 1.15);
+    compare_with_brute_force(tight, 400);
+    compare_with_brute_force(tight, 300, 0.8, 1.2);
+    compare_with_brute_force(none, 100);
+    return 0;
+}
@@ -0,0 +1,60 @@
+#include "system.hxx"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <set>
+
+using namespace desres::msys;
+
+/* the atoms of mol are exactly those not in dead, in order */
+static void check_live(SystemPtr mol, std::set<Id> const& dead) {
+    IdList ids = mol->atoms();
+    IdList iter(mol->atomBegin(), mol->atomEnd());
+    assert(ids==iter);
+    assert(mol->atomCount()==mol->maxAtomId()-dead.size());
+    Id j=0;
+    for (Id i=0; i<mol->maxAtomId(); i++) {
+        assert(mol->hasAtom(i) == !dead.count(i));
+        if (!dead.count(i)) assert(ids.at(j++)==i);
+    }
+    assert(j==ids.size());
+}
+
+int main() {
+    IdBitmap bits;
+    assert(bits.empty() && bits.next_clear(5, 10)==5);
+    assert(bits.insert(3) && !bits.insert(3) && bits.size()==1);
+    for (Id i=64; i<200; i++) bits.insert(i);
+    assert(bits.next_clear(64, 1000)==200);
+    assert(bits.next_clear(64, 150)==150);
+    assert(bits.next_clear(3, 1000)==4);
+    IdList members;
+    bits.for_each([&](Id id) { members.push_back(id); });
+    assert(members.size()==bits.size() && members[0]==3 && members[1]==64);
+
+    SystemPtr mol = System::create();
+    Id res = mol->addResidue(mol->addChain());
+    const Id natoms = 1000;
+    for (Id i=0; i<natoms; i++) mol->addAtom(res);
+    std::set<Id> dead;
+    check_live(mol, dead);
+
+    /* a trailing dead run, a run spanning several words, and scattered */
+    for (Id i=900; i<natoms; i++) { mol->delAtom(i); dead.insert(i); }
+    for (Id i=60; i<400; i++) { mol->delAtom(i); dead.insert(i); }
+    srand48(7);
+    for (int k=0; k<100; k++) {
+        Id i = lrand48() % natoms;
+        mol->delAtom(i);
+        dead.insert(i);
+    }
+    check_live(mol, dead);
+
+    /* deleting a residue deletes its atoms exactly once */
+    mol->delResidue(res);
+    mol->delResidue(res);
+    assert(mol->atomCount()==0 && mol->residueCount()==0);
+    assert(mol->atomBegin()==mol->atomEnd());
+    printf("ok\n");
+    return 0;
+}
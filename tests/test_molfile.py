@@ -889,6 +889,48 @@ class TestFrameCornerCases(unittest.TestCase):
                     v2 = v2.tolist()
                 self.assertEqual(v1, v2)
 
+    def testKeyvalsMapped(self):
+        for sequential in False, True:
+            dtr = molfile.DtrReader("tests/files/ch4.dtr", sequential=sequential)
+            mapped = molfile.DtrReader(
+                "tests/files/ch4.dtr", sequential=sequential, mapped=True
+            )
+            for i in range(dtr.nframes):
+                k1 = dtr.keyvals(i)
+                k2 = dtr.keyvals(i, mapped=True)
+                self.assertEqual(sorted(k1.keys()), sorted(k2.keys()))
+                for k in k1:
+                    v1 = k1[k]
+                    v2 = k2[k]
+                    if not isinstance(v1, str):
+                        v1 = v1.tolist()
+                        v2 = v2.tolist()
+                    self.assertEqual(v1, v2)
+                pos = k2["POSITION"]
+                self.assertFalse(pos.flags.writeable)
+                del k2
+                self.assertEqual(pos.tolist(), k1["POSITION"].tolist())
+                f1 = dtr.frame(i)
+                f2 = mapped.frame(i)
+                self.assertEqual(f1.pos.tolist(), f2.pos.tolist())
+                self.assertEqual(f1.time, f2.time)
+
+    def testReadFrames(self):
+        dtr = molfile.DtrReader("tests/files/ch4.dtr")
+        indices = [dtr.nframes - 1, 0, 0] + list(range(dtr.nframes))
+        box = numpy.zeros((len(indices), 3, 3))
+        for nthreads in 1, 4:
+            pos = dtr.read_frames(indices, box=box, nthreads=nthreads)
+            self.assertEqual(pos.shape, (len(indices), dtr.natoms, 3))
+            for i, index in enumerate(indices):
+                f = dtr.frame(index)
+                self.assertEqual(pos[i].tolist(), f.pos.tolist())
+                self.assertEqual(box[i].tolist(), f.box.tolist())
+        with self.assertRaises(IndexError):
+            dtr.read_frames([dtr.nframes])
+        with self.assertRaises(ValueError):
+            dtr.read_frames([0], pos=numpy.zeros((2, dtr.natoms, 3), "f"))
+
 
 class TestFrame2(unittest.TestCase):
     def testFrames(self):
@@ -1040,6 +1082,18 @@ class TestDtrWriter(unittest.TestCase):
         # vel is None when reciprocal masses are not written to the metadata file
         self.assertFalse(r.frame(0).vel is None)
 
+    def testCompressionThreads(self):
+        writer = molfile.DtrWriter(self.PATH, natoms=10, compression_threads=3)
+        pos = numpy.zeros(30, "f")
+        for i in range(20):
+            pos[:] = i
+            writer.append(float(i), {"POSITION": pos})
+        writer.close()
+        r = molfile.DtrReader(self.PATH)
+        self.assertEqual(r.nframes, 20)
+        for i in range(20):
+            self.assertEqual(r.keyvals(i)["POSITION"].tolist(), [i] * 30)
+
 
 class TestDtrWriterEtr(unittest.TestCase):
     @classmethod
@@ -1,6 +1,7 @@
 #include "param_table.hxx"
 #include <assert.h>
 #include <stdio.h>
+#include <vector>
 
 using namespace desres::msys;
 
@@ -76,5 +77,73 @@ int main(int argc, char *argv[]) {
     p->value(param,0)=32;
     assert(p->value(param,0)==32);
 
+    /* bulk rows and typed columns */
+    ParamTablePtr t = ParamTable::create();
+    Id icol = t->addProp("i", IntType);
+    Id fcol = t->addProp("f", FloatType);
+    Id scol = t->addProp("s", StringType);
+    const Id n = 5000;
+    assert(t->addParams(n)==0 && t->paramCount()==n);
+    assert(t->addParam()==n);
+    std::vector<Int> ints(n);
+    std::vector<Float> flts(n);
+    std::vector<String> strs(n);
+    for (Id i=0; i<n; i++) {
+        ints[i] = i%7;
+        flts[i] = 0.5*i;
+        strs[i] = i%2 ? "odd" : "even";
+    }
+    t->setIntValues(icol, 0, n, ints.data());
+    t->setFloatValues(fcol, 0, n, flts.data());
+    t->setStringValues(scol, 0, n, strs.data());
+    assert(t->value(1234, icol)==1234%7);
+    assert(t->value(1234, fcol)==617.0);
+    assert(t->value(1233, scol)==std::string("odd"));
+    assert(t->value(n, scol).asString()=="");
+    auto iv = t->intValues(icol);
+    assert(iv.size()==n+1 && iv[4999]==4999%7 && iv[n]==0);
+    Id total = 0;
+    t->floatValues(fcol).forEachBlock([&](const Float* v, Id m) {
+        for (Id i=0; i<m; i++) assert(v[i]==(total+i<n ? 0.5*(total+i) : 0));
+        total += m;
+    });
+    assert(total==n+1);
+    assert(t->valuesForColumn<String>(scol)[3]=="odd");
+    caught = false;
+    try {
+        t->floatValues(icol);
+    } catch (Failure&) {
+        caught = true;
+    }
+    assert(caught);
+
+    /* lookups stay correct as rows are added and modified */
+    assert(t->findInt(icol, 3).size()==714);
+    assert(t->findFloat(icol, 3.0).size()==714);
+    assert(t->findFloat(icol, 3.5).empty());
+    assert(t->findString(scol, "odd").size()==2500);
+    assert(t->findString(scol, "never seen").empty());
+    Id row = t->addParam();
+    t->value(row, icol) = 3;
+    t->value(row, scol) = "odd";
+    assert(t->findInt(icol, 3).size()==715);
+    assert(t->findString(scol, "odd").size()==2501);
+    t->value(3, icol) = 4;
+    assert(t->findInt(icol, 3).size()==714);
+    assert(t->findFloat(fcol, 1.5)==IdList(1, 3));
+    Id dup = t->duplicate(3);
+    assert(t->findFloat(fcol, 1.5)==IdList({3, dup}));
+    assert(t->compare(3, dup)==0);
+
+    /* string values belong to the table: they outlive the table they
+     * were set in only through a snapshot sharing the column. */
+    ParamTablePtr snap = t->snapshot();
+    t.reset();
+    assert(snap->value(1233, scol)==std::string("odd"));
+    assert(snap->findString(scol, "odd").size()==2502);
+    snap->value(0, scol) = "new";
+    assert(snap->findString(scol, "new")==IdList(1, 0));
+    assert(snap->findString(scol, "")==IdList(1, n));
+
     return 0;
 }
@@ -0,0 +1,71 @@
+#include "system.hxx"
+#include "clone.hxx"
+#include <assert.h>
+#include <stdio.h>
+#include <vector>
+#include <algorithm>
+
+using namespace desres::msys;
+
+int main() {
+    SystemPtr mol = System::create();
+    Id res = mol->addResidue(mol->addChain());
+    const int natoms = 10;
+    for (int i=0; i<natoms; i++) {
+        Id id = mol->addAtom(res);
+        Float* pos = mol->atomPos(id);
+        Float* vel = mol->atomVel(id);
+        for (int k=0; k<3; k++) {
+            pos[k] = 10*i + k;
+            vel[k] = -(10*i + k);
+        }
+    }
+    mol->delAtom(3);
+    mol->delAtom(7);
+
+    std::vector<double> pos(3*mol->atomCount()), vel(3*mol->atomCount());
+    mol->getPositions(pos.data());
+    mol->getVelocities(vel.data());
+    IdList ids = mol->atoms();
+    for (Id i=0; i<ids.size(); i++) {
+        for (int k=0; k<3; k++) {
+            assert(pos[3*i+k] == 10*ids[i] + k);
+            assert(vel[3*i+k] == -(10.0*ids[i] + k));
+        }
+    }
+
+    for (auto& x : pos) x += 0.5;
+    mol->setPositions(pos.data());
+    assert(mol->atomPos(4)[1] == 41.5);
+    assert(mol->atomPos(3)[0] == 30);
+
+    /* new atoms start at the origin */
+    Id id = mol->addAtom(res);
+    assert(mol->atomPos(id)[0]==0 && mol->atomVel(id)[2]==0);
+
+    SystemPtr dup = Clone(mol, mol->atoms());
+    assert(dup->atomCount()==mol->atomCount());
+    for (Id i=0; i<ids.size(); i++) {
+        for (int k=0; k<3; k++) {
+            assert(dup->atomPos(i)[k] == mol->atomPos(ids[i])[k]);
+            assert(dup->atomVel(i)[k] == mol->atomVel(ids[i])[k]);
+        }
+    }
+
+    /* atom_t is a plain value; copying one leaves coordinates alone */
+    const Float before[3] = {dup->atomPos(0)[0], dup->atomPos(0)[1],
+                             dup->atomPos(0)[2]};
+    dup->atom(0) = mol->atom(4);
+    assert(dup->atom(0).charge == mol->atom(4).charge);
+    assert(std::equal(before, before+3, dup->atomPos(0)));
+
+    bool threw = false;
+    try {
+        mol->atomPos(1000);
+    } catch (std::exception&) {
+        threw = true;
+    }
+    assert(threw);
+    printf("ok\n");
+    return 0;
+}
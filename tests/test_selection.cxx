@@ -0,0 +1,84 @@
+#include "atomsel/selection.hxx"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace desres::msys;
+using namespace desres::msys::atomsel;
+
+typedef std::vector<bool> Flags;
+
+static Selection make(Flags const& f) {
+    Selection s(f.size());
+    for (Id i=0; i<f.size(); i++) if (f[i]) s.set(i);
+    return s;
+}
+
+static void compare_flags(Selection const& s, Flags const& f) {
+    IdList ids;
+    for (Id i=0; i<f.size(); i++) {
+        assert(s[i]==f[i]);
+        if (f[i]) ids.push_back(i);
+    }
+    assert(s.size()==f.size());
+    assert(s.count()==ids.size());
+    assert(s.ids()==ids);
+    IdList each;
+    s.for_each([&](Id i) { each.push_back(i); });
+    assert(each==ids);
+}
+
+static Flags random_flags(Id n, int density) {
+    Flags f(n);
+    for (Id i=0; i<n; i++) f[i] = rand()%density==0;
+    return f;
+}
+
+int main() {
+    srand(7);
+    Id sizes[] = {0, 1, 63, 64, 65, 255, 256, 257, 1000, 4099};
+    for (Id n : sizes) {
+        Flags all(n, true), none(n, false);
+        Selection s(n);
+        compare_flags(s, none);
+        s.fill();
+        compare_flags(s, all);
+        s.clear();
+        compare_flags(s, none);
+
+        for (int density : {1, 2, 17}) {
+            Flags a = random_flags(n, density), b = random_flags(n, 3);
+            Flags fand(n), f_or(n), fsub(n), ffilt(n);
+            for (Id i=0; i<n; i++) {
+                fand[i] = a[i] && b[i];
+                f_or[i] = a[i] || b[i];
+                fsub[i] = a[i] && !b[i];
+                ffilt[i] = a[i] && i%3==0;
+            }
+            Selection x = make(a);
+            compare_flags(x, a);
+            compare_flags(Selection(n, x.ids()), a);
+            compare_flags(Selection(x).intersect(make(b)), fand);
+            compare_flags(Selection(x).add(make(b)), f_or);
+            compare_flags(Selection(x).subtract(make(b)), fsub);
+            for (int k=0; k<5; k++) {
+                Id b = n ? rand()%n : 0, e = n ? b + rand()%(n-b+1) : 0;
+                IdList in, ref;
+                x.for_each_in(b, e, [&](Id i) { in.push_back(i); });
+                for (Id i=b; i<e; i++) if (a[i]) ref.push_back(i);
+                assert(in==ref);
+            }
+            Id calls = 0;
+            x.filter([&](Id i) { ++calls; return i%3==0; });
+            compare_flags(x, ffilt);
+            assert(calls==make(a).count());
+            if (n) {
+                x.reset(n-1);
+                ffilt[n-1] = false;
+                compare_flags(x, ffilt);
+            }
+        }
+    }
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,177 @@
+#include "clone.hxx"
+#include "hash.hxx"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace desres::msys;
+
+/* two tables sharing one ParamTable, plus an aux table */
+static SystemPtr build() {
+    SystemPtr mol = System::create();
+    mol->addAtomProp("q", FloatType);
+    for (Id c=0; c<4; c++) {
+        Id chn = mol->addChain();
+        for (Id r=0; r<250; r++) {
+            Id res = mol->addResidue(chn);
+            for (Id a=0; a<3; a++) {
+                Id atm = mol->addAtom(res);
+                mol->atomFAST(atm).atomic_number = 6;
+                mol->atomPropValue(atm, "q") = double(atm);
+                mol->atomPosFAST(atm)[0] = atm;
+                if (a) mol->addBond(atm-1, atm);
+            }
+        }
+    }
+    TermTablePtr stretch = mol->addTable("stretch", 2);
+    TermTablePtr pair = mol->addTable("pair", 2, stretch->params());
+    ParamTablePtr params = stretch->params();
+    params->addProp("k", FloatType);
+    params->addProp("type", StringType);
+    stretch->addTermProp("w", IntType);
+    for (Id b : mol->bonds()) {
+        Id p = params->addParam();
+        params->value(p, "k") = double(p);
+        params->value(p, "type") = "cc";
+        bond_t const& bnd = mol->bondFAST(b);
+        Id t = stretch->addTerm(IdList{bnd.i, bnd.j}, p);
+        stretch->termPropValue(t, "w") = int(t);
+        pair->addTerm(IdList{bnd.i, bnd.j}, p);
+    }
+    mol->addAuxTable("cmap1", ParamTable::create());
+    mol->updateFragids();
+    return mol;
+}
+
+/* address of the first block of a float column */
+static const Float* first_block(ParamTablePtr params, Id col) {
+    const Float* p = NULL;
+    params->floatValues(col).forEachBlock([&p](const Float* v, Id) {
+        if (!p) p = v;
+    });
+    return p;
+}
+
+static void check_refcounts(TermTablePtr table) {
+    ParamTablePtr params = table->params();
+    for (Id p=0; p<params->paramCount(); p++) {
+        Id n = 0;
+        for (String const& name : table->system()->tableNames()) {
+            TermTablePtr t = table->system()->table(name);
+            if (t->params()!=params) continue;
+            for (Id term : t->terms()) if (t->param(term)==p) ++n;
+        }
+        assert(params->refcount(p)==n);
+    }
+}
+
+int main() {
+    SystemPtr mol = build();
+    uint64_t hash = HashSystem(mol);
+
+    SystemPtr snap = mol->snapshot();
+    assert(HashSystem(snap)==hash);
+    assert(snap->table("stretch")->params()==snap->table("pair")->params());
+    assert(snap->table("stretch")->params()!=mol->table("stretch")->params());
+    assert(snap->auxTable("cmap1") && snap->auxTable("cmap1")!=mol->auxTable("cmap1"));
+    check_refcounts(snap->table("stretch"));
+
+    /* edit the snapshot; the source is unchanged */
+    snap->atomFAST(5).atomic_number = 8;
+    snap->atomPropValue(6, "q") = -1.0;
+    snap->setPositions(std::vector<double>(3*snap->atomCount(), 0.0).data());
+    TermTablePtr stretch = snap->table("stretch");
+    ParamTablePtr params = stretch->params();
+    params->value(1500, "k") = -1.0;
+    params->value(1, "type") = "xx";
+    stretch->delTerm(0);
+    stretch->setParam(1, 2);
+    stretch->termPropValue(3, "w") = -1;
+    Id p = params->addParam();
+    stretch->addTerm(IdList{0, 1}, p);
+    snap->delAtom(10);
+    check_refcounts(stretch);
+    assert(HashSystem(mol)==hash);
+    assert(HashSystem(snap)!=hash);
+    assert(mol->table("stretch")->termCount()==2000);
+    assert(mol->table("stretch")->params()->paramCount()==2000);
+    assert(mol->table("stretch")->params()->value(1, "type").asString()=="cc");
+
+    /* edit the source; the snapshot is unchanged */
+    snap = mol->snapshot();
+    uint64_t snaphash = HashSystem(snap);
+    mol->table("pair")->params()->value(0, "k") = 5.0;
+    mol->table("pair")->delTermsWithAtom(4);
+    mol->atomPropValue(0, "q") = 7.0;
+    mol->delBond(0);
+    assert(HashSystem(snap)==snaphash);
+    assert(snap->table("stretch")->params()->value(0, "k").asFloat()==0);
+    assert(snap->table("pair")->findWithAny(IdList(1, 4)).size()==2);
+    check_refcounts(mol->table("pair"));
+    check_refcounts(snap->table("pair"));
+
+    /* reads share rows; a ValueRef taken before the snapshot writes only
+     * to its own table, and sees later writes made through other paths */
+    mol = build();
+    ParamTablePtr src = mol->table("stretch")->params();
+    Id kcol = src->propIndex("k");
+    ValueRef k0 = src->value(0, kcol);
+    ValueRef t0 = src->value(0, "type");
+    snap = mol->snapshot();
+    params = snap->table("stretch")->params();
+    assert(params->value(0, kcol).asFloat()==0 && params->compare(0, 1)<0);
+    assert(first_block(params, kcol)==first_block(src, kcol));
+    k0 = 9.0;
+    t0 = "yy";
+    assert(first_block(params, kcol)!=first_block(src, kcol));
+    assert(params->value(0, kcol).asFloat()==0);
+    assert(params->value(0, "type").asString()=="cc");
+    assert(src->value(0, kcol).asFloat()==9 && t0.asString()=="yy");
+    snap = mol->snapshot();
+    src->value(0, kcol) = 10.0;
+    assert(k0.asFloat()==10);
+    assert(snap->table("stretch")->params()->value(0, kcol).asFloat()==9);
+
+    /* structure is shared in blocks of 1024 ids: reads through a const
+     * System share, and a write copies only the block written */
+    {
+        mol = build();
+        snap = mol->snapshot();
+        System const& m = *mol;
+        System const& s = *snap;
+        assert(&s.atomFAST(0)==&m.atomFAST(0));
+        assert(s.atomPosFAST(2999)==m.atomPosFAST(2999));
+        assert(&s.bondFAST(0)==&m.bondFAST(0));
+        assert(&s.residueFAST(999)==&m.residueFAST(999));
+        assert(&s.chainFAST(3)==&m.chainFAST(3));
+        assert(&s.atomsForResidue(0)==&m.atomsForResidue(0));
+        assert(&s.bondsForAtom(2999)==&m.bondsForAtom(2999));
+        snap->atomFAST(2000).charge = 1;
+        snap->atomPosFAST(2000)[1] = 1;
+        assert(&s.atomFAST(2000)!=&m.atomFAST(2000));
+        assert(&s.atomFAST(1023)==&m.atomFAST(1023));
+        assert(s.atomPosFAST(2000)!=m.atomPosFAST(2000));
+        assert(s.atomPosFAST(1023)==m.atomPosFAST(1023));
+        assert(m.atomFAST(2000).charge==0 && m.atomPosFAST(2000)[1]==0);
+        snap->updateFragids();
+        assert(&s.atomFAST(0)==&m.atomFAST(0));
+        SystemPtr dst = Clone(mol, mol->atoms());
+        assert(&static_cast<System const&>(*dst).atomFAST(0)==&m.atomFAST(0));
+    }
+
+    /* Clone of every atom, with and without deletions and unused params */
+    mol = build();
+    assert(HashSystem(Clone(mol, mol->atoms()))==hash);
+    mol->table("stretch")->params()->addParam();
+    SystemPtr dst = Clone(mol, mol->atoms());
+    assert(dst->table("stretch")->params()->paramCount()==2000);
+    check_refcounts(dst->table("stretch"));
+    mol->delAtom(0);
+    dst = Clone(mol, mol->atoms());
+    assert(dst->maxAtomId()==mol->atomCount());
+    assert(dst->table("stretch")->termCount()==1999);
+    assert(dst->table("stretch")->params()->paramCount()==1999);
+
+    printf("ok\n");
+    return 0;
+}
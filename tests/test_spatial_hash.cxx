@@ -58,6 +58,69 @@ int main() {
     }
     printf("findContacts: single %.3fms double %.3fms ratio %.3f\n",tf,td,td/tf);
 
+    /* threaded searches must reproduce the serial results exactly */
+    for (unsigned nthreads : {0u, 2u, 3u, 7u}) {
+        auto f = sf.findWithin(0.125, fpos.data(), B.size(), B.data());
+        auto fp = sf.findWithin(0.125, fpos.data(), B.size(), B.data(), nthreads);
+        assert(f == fp);
+        auto c = sf.findContacts(0.125, fpos.data(), B.size(), B.data());
+        auto cp = sf.findContacts(0.125, fpos.data(), B.size(), B.data(), nthreads);
+        assert(c == cp);
+        auto d = sd.findContacts(0.125, dpos.data(), B.size(), B.data());
+        auto dp = sd.findContacts(0.125, dpos.data(), B.size(), B.data(), nthreads);
+        assert(d == dp);
+    }
+
+    /* updating a voxelized hash with new frames matches a fresh hash */
+    {
+        double box[9] = {1.5,0,0, 0,1.5,0, 0,0,1.5};
+        SpatialHashT<float> hash(fpos.data(), A.size(), A.data(), box);
+        hash.voxelize(0.125);
+        SpatialHashCache cache;
+        std::vector<float> frame(fpos);
+        for (float step : {0.f, 0.001f, 0.05f, 0.5f}) {
+            for (auto& x : frame) x += step*(drand48()-0.5);
+            hash.update(frame.data(), box);
+            SpatialHashT<float> fresh(frame.data(), A.size(), A.data(), box);
+            auto expected = fresh.findContacts(0.125, frame.data(), B.size(), B.data());
+            SpatialHashT<float>::contact_array_t arr;
+            hash.findContactsReuseVoxels(0.125, frame.data(), B.size(), B.data(), &arr);
+            std::vector<SpatialHashT<float>::contact_t> found;
+            for (uint64_t i=0; i<arr.count; i++) found.emplace_back(arr.i[i], arr.j[i], arr.d2[i]);
+            std::sort(expected.begin(), expected.end());
+            std::sort(found.begin(), found.end());
+            assert(found == expected);
+            auto within = fresh.findWithin(0.125, frame.data(), B.size(), B.data());
+            assert(within == hash.find_within(0.125, frame.data(), B.size(), B.data()));
+            assert(within == cache.get(A, frame.data(), box, 0.125)
+                    .find_within(0.125, frame.data(), B.size(), B.data()));
+        }
+    }
+
+    /* a hashed point moved into the outermost voxel, or just below the
+     * origin, must still be found from outside the old grid */
+    {
+        const float r = 0.5;
+        std::vector<float> pos = {0,0,0, 1,1,1, 2,2,2, 0,0,0};
+        IdList hashed = {0, 1, 2}, query = {3};
+        for (float x : {2.9f, 3.2f, -0.3f, -0.7f}) {
+            SpatialHashT<float> hash(pos.data(), hashed.size(), hashed.data(), NULL);
+            hash.voxelize(r);
+            std::vector<float> frame(pos);
+            frame[6] = frame[7] = frame[8] = x;
+            float q = x + (x>1 ? 0.4f : -0.4f);
+            frame[9] = q;
+            frame[10] = frame[11] = x;
+            hash.update(frame.data(), NULL);
+            SpatialHashT<float> fresh(frame.data(), hashed.size(), hashed.data(), NULL);
+            IdList expected = fresh.findWithin(r, frame.data(), 1, query.data());
+            assert(expected.size()==1);
+            assert(hash.find_within(r, frame.data(), 1, query.data())==expected);
+            SpatialHashT<float>::contact_array_t arr;
+            hash.findContactsReuseVoxels(r, frame.data(), 1, query.data(), &arr);
+            assert(arr.count==1 && arr.j[0]==2);
+        }
+    }
+
     return 0;
 }
-
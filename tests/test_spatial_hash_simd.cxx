@@ -0,0 +1,118 @@
+#include "spatial_hash.hxx"
+#include "spatial_hash_simd.hxx"
+#include <stdlib.h>
+#include <stdio.h>
+#include <numeric>
+#include <cassert>
+
+using namespace desres::msys;
+namespace simd = desres::msys::spatial_hash_simd;
+
+/* Check every available kernel against the scalar computation, on strips
+ * of every length up to 40 so that each remainder case is covered, with
+ * the query id sometimes present in the strip. */
+template <typename Float>
+static int check_kernels(const char* name) {
+    const int N = 40;
+    std::vector<Float> x(N), y(N), z(N);
+    IdList ids(N);
+    std::iota(ids.begin(), ids.end(), 100);
+    int nchecked = 0;
+    for (int lvl=simd::Avx2; lvl<=simd::Avx512; lvl++) {
+        auto k = simd::kernels<Float>(simd::Level(lvl));
+        if (!k) continue;
+        ++nchecked;
+        for (int trial=0; trial<200; trial++) {
+            for (int i=0; i<N; i++) {
+                x[i] = drand48();
+                y[i] = drand48();
+                z[i] = drand48();
+            }
+            Float px = drand48(), py = drand48(), pz = drand48();
+            Float r2 = 0.3*drand48();
+            Id id = 100 + lrand48() % (2*N);
+            for (int n=0; n<=N; n++) {
+                IdList ei, ej;
+                std::vector<Float> ed;
+                bool ewithin = false;
+                for (int i=0; i<n; i++) {
+                    Float dx = px - x[i];
+                    Float dy = py - y[i];
+                    Float dz = pz - z[i];
+                    Float d2 = dx*dx + dy*dy + dz*dz;
+                    if (d2<=r2) {
+                        ewithin = true;
+                        if (ids[i]==id) continue;
+                        ei.push_back(id);
+                        ej.push_back(ids[i]);
+                        ed.push_back(d2);
+                    }
+                }
+                IdList ri(N, BadId), rj(N, BadId);
+                std::vector<Float> rd(N);
+                uint32_t c = k->contacts(x.data(), y.data(), z.data(),
+                                         ids.data(), n, px, py, pz, r2, id,
+                                         ri.data(), rj.data(), rd.data());
+                assert(c==ei.size());
+                for (uint32_t i=0; i<c; i++) {
+                    assert(ri[i]==ei[i]);
+                    assert(rj[i]==ej[i]);
+                    assert(rd[i]==ed[i]);
+                }
+                assert(k->within(x.data(), y.data(), z.data(), n,
+                                 px, py, pz, r2) == ewithin);
+            }
+        }
+    }
+    printf("%s: checked %d simd levels\n", name, nchecked);
+    return nchecked;
+}
+
+/* Whole-hash searches with the dispatched kernels must match a brute
+ * force search exactly, distances included. */
+template <typename Float>
+static void check_hash(const char* name) {
+    const int N = 4000;
+    std::vector<Float> pos(3*N);
+    for (auto& p : pos) p = 4*drand48();
+    IdList A(N/2), B(N);
+    std::iota(A.begin(), A.end(), 0);
+    std::iota(B.begin(), B.end(), 0);
+    const Float r = 0.4;
+
+    SpatialHashT<Float> hash(pos.data(), A.size(), A.data(), NULL);
+    auto contacts = hash.findContacts(r, pos.data(), B.size(), B.data());
+    std::sort(contacts.begin(), contacts.end());
+
+    typename SpatialHashT<Float>::ContactList expected;
+    IdList within;
+    for (Id i : B) {
+        bool found = false;
+        for (Id j : A) {
+            Float dx = pos[3*i  ] - pos[3*j  ];
+            Float dy = pos[3*i+1] - pos[3*j+1];
+            Float dz = pos[3*i+2] - pos[3*j+2];
+            Float d2 = dx*dx + dy*dy + dz*dz;
+            if (d2<=r*r) {
+                found = true;
+                if (i!=j) expected.emplace_back(i, j, d2);
+            }
+        }
+        if (found) within.push_back(i);
+    }
+    std::sort(expected.begin(), expected.end());
+    assert(contacts.size()==expected.size());
+    assert(contacts==expected);
+    assert(hash.findWithin(r, pos.data(), B.size(), B.data())==within);
+    printf("%s: %lu contacts at level %d\n", name, contacts.size(),
+            int(simd::level()));
+}
+
+int main() {
+    srand48(1973);
+    check_kernels<float>("float");
+    check_kernels<double>("double");
+    check_hash<float>("float");
+    check_hash<double>("double");
+    return 0;
+}
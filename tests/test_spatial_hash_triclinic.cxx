@@ -0,0 +1,143 @@
+#include "spatial_hash.hxx"
+#include <stdlib.h>
+#include <stdio.h>
+#include <set>
+#include <cassert>
+
+using namespace desres::msys;
+
+/* brute force minimum image search over images -n..n.  If nimages is
+ * given, it receives the number of images of all pairs within r. */
+template <typename Float>
+static std::set<std::pair<Id,Id> > brute_contacts(Float r, const Float* pos,
+        IdList const& A, IdList const& B, const double* cell, int n=2,
+        size_t* nimages=NULL) {
+    std::set<std::pair<Id,Id> > result;
+    if (nimages) *nimages = 0;
+    for (Id a : A) for (Id b : B) {
+        if (a==b) continue;
+        for (int i=-n; i<=n; i++) for (int j=-n; j<=n; j++) for (int k=-n; k<=n; k++) {
+            Float d2=0;
+            for (int m=0; m<3; m++) {
+                Float d = pos[3*a+m] + i*cell[m] + j*cell[3+m] + k*cell[6+m]
+                        - pos[3*b+m];
+                d2 += d*d;
+            }
+            if (d2<=r*r) {
+                result.insert(std::make_pair(a,b));
+                if (nimages) ++*nimages;
+            }
+        }
+    }
+    return result;
+}
+
+/* points spread uniformly over the cell */
+template <typename Float>
+static void check_uniform(const double* cell, Float r, int N) {
+    std::vector<Float> pos(3*N);
+    for (int i=0; i<N; i++) {
+        double f[3] = {drand48(), drand48(), drand48()};
+        for (int m=0; m<3; m++) {
+            pos[3*i+m] = f[0]*cell[m] + f[1]*cell[3+m] + f[2]*cell[6+m];
+        }
+    }
+    IdList A, B;
+    for (int i=0; i<N; i++) (i%3 ? A : B).push_back(i);
+
+    auto expected = brute_contacts(r, pos.data(), A, B, cell);
+    assert(!expected.empty());
+
+    SpatialHashT<Float> hash(pos.data(), B.size(), B.data(), cell);
+    auto contacts = hash.findContacts(r, pos.data(), A.size(), A.data());
+    std::set<std::pair<Id,Id> > found;
+    for (auto const& c : contacts) found.insert(std::make_pair(c.i, c.j));
+    assert(found == expected);
+
+    IdList within = hash.findWithin(r, pos.data(), A.size(), A.data());
+    IdList expected_within;
+    for (auto const& p : expected) expected_within.push_back(p.first);
+    sort_unique(expected_within);
+    assert(within == expected_within);
+    printf("%lu contacts, %lu within\n", found.size(), within.size());
+
+    /* query points displaced by whole cell vectors give the same result */
+    for (Id i : A) {
+        for (int m=0; m<3; m++) pos[3*i+m] += cell[m] - cell[6+m];
+    }
+    contacts = hash.findContacts(r, pos.data(), A.size(), A.data());
+    found.clear();
+    for (auto const& c : contacts) found.insert(std::make_pair(c.i, c.j));
+    assert(found == expected);
+    assert(within == hash.findWithin(r, pos.data(), A.size(), A.data()));
+}
+
+/* Hashed points clustered away from the center of the cell, and query
+ * points scattered over several cells, so that the images within r are
+ * not the neighbors of the image nearest the hashed points' center. */
+template <typename Float>
+static void check_clustered(const double* cell, Float r, Float lo, Float hi,
+                            int N) {
+    std::vector<Float> pos(3*N);
+    IdList A, B;
+    for (int i=0; i<N; i++) {
+        bool hashed = i%4==0;
+        double f[3];
+        for (int m=0; m<3; m++) {
+            f[m] = hashed ? lo + (hi-lo)*drand48() : 5*drand48()-2;
+        }
+        for (int m=0; m<3; m++) {
+            pos[3*i+m] = f[0]*cell[m] + f[1]*cell[3+m] + f[2]*cell[6+m];
+        }
+        (hashed ? B : A).push_back(i);
+    }
+    size_t nimages;
+    auto expected = brute_contacts(r, pos.data(), A, B, cell, 7, &nimages);
+    assert(!expected.empty());
+
+    SpatialHashT<Float> hash(pos.data(), B.size(), B.data(), cell);
+    auto contacts = hash.findContacts(r, pos.data(), A.size(), A.data());
+    std::set<std::pair<Id,Id> > found;
+    for (auto const& c : contacts) found.insert(std::make_pair(c.i, c.j));
+    assert(found == expected);
+    /* every image within r is found, not just one per pair */
+    assert(contacts.size() == nimages);
+
+    IdList expected_within;
+    for (auto const& p : expected) expected_within.push_back(p.first);
+    sort_unique(expected_within);
+    assert(hash.findWithin(r, pos.data(), A.size(), A.data()) == expected_within);
+    printf("%lu clustered contacts\n", found.size());
+}
+
+int main() {
+    srand48(1973);
+    const double d = 4.0;
+    /* truncated octahedron */
+    double toct[9] = {d, 0, 0,
+                      d/3, 2*sqrt(2.)*d/3, 0,
+                      -d/3, sqrt(2.)*d/3, sqrt(6.)*d/3};
+    /* rhombic dodecahedron (xy-square) */
+    double rdod[9] = {d, 0, 0,
+                      0, d, 0,
+                      d/2, d/2, sqrt(2.)*d/2};
+    check_uniform<float>(toct, 1.0f, 500);
+    check_uniform<double>(toct, 1.0, 500);
+    check_uniform<float>(rdod, 1.2f, 500);
+    check_uniform<double>(rdod, 1.2, 500);
+
+    /* strongly skewed cell whose smallest height is less than r */
+    double skew[9] = {d, 0, 0,
+                      0.9*d, 0.5*d, 0,
+                      -0.8*d, 0.45*d, 0.6*d};
+    check_clustered<float>(skew, 1.5f, 0.7f, 0.95f, 400);
+    check_clustered<double>(skew, 1.5, 0.7, 0.95, 400);
+    check_clustered<double>(toct, 1.0, 0.05, 0.3, 400);
+    check_clustered<double>(rdod, 1.2, 0.6, 1.0, 400);
+    double thin[9] = {d, 0, 0,
+                      0.95*d, 0.2*d, 0,
+                      0, 0, d};
+    check_clustered<float>(thin, 2.0f, 0.3f, 0.6f, 400);
+    check_clustered<double>(thin, 2.0, 0.3, 0.6, 400);
+    return 0;
+}
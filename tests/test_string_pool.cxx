@@ -0,0 +1,116 @@
+#include "system.hxx"
+#include "atomsel.hxx"
+#include "clone.hxx"
+#include <assert.h>
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+using namespace desres::msys;
+
+int main() {
+    Id ca = StringPool::intern("CA", 2);
+    assert(ca==StringPool::intern("CA", 2));
+    assert(ca!=StringPool::intern("CB", 2));
+    assert(StringPool::find("CA", 2)==ca);
+    assert(bad(StringPool::find("never interned", 14)));
+    assert(StringPool::intern("", 0)==0 && !strcmp(StringPool::c_str(0), ""));
+    assert(!strcmp(StringPool::c_str(ca), "CA") && StringPool::size(ca)==2);
+
+    InternedString<30> a, b;
+    assert(a.empty() && a.size()==0 && !strcmp(a.c_str(), ""));
+    a = "HW1";
+    b = std::string("HW") + "1";
+    assert(a==b && a.id()==b.id() && a==std::string("HW1"));
+    assert(std::string(a)=="HW1" && a[2]=='1');
+    bool threw = false;
+    try {
+        a = std::string(31, 'x');
+    } catch (std::exception&) {
+        threw = true;
+    }
+    assert(threw && a=="HW1");
+
+    /* released strings leave the pool and their handles are reused */
+    Id tmp = StringPool::intern("reclaimed", 9);
+    assert(StringPool::intern("reclaimed", 9)==tmp);
+    StringPool::release(tmp);
+    assert(StringPool::find("reclaimed", 9)==tmp);
+    StringPool::release(tmp);
+    assert(bad(StringPool::find("reclaimed", 9)));
+    Id reused = StringPool::intern("reused", 6);
+    assert(reused==tmp && !strcmp(StringPool::c_str(reused), "reused"));
+    assert(StringPool::intern("reclaimed", 9)!=tmp);
+    {
+        InternedString<30> x, y;
+        x = "scoped";
+        y = x;
+        InternedString<30> z(y);
+        x = "other";
+        assert(y==z && !strcmp(z.c_str(), "scoped"));
+    }
+    assert(bad(StringPool::find("scoped", 6)) && bad(StringPool::find("other", 5)));
+
+    /* concurrent interning agrees on handles */
+    const int nthreads = 8, nnames = 5000;
+    std::vector<std::vector<Id> > ids(nthreads, std::vector<Id>(nnames));
+    std::vector<std::thread> threads;
+    for (int t=0; t<nthreads; t++) {
+        threads.emplace_back([t, &ids]() {
+            for (int i=0; i<nnames; i++) {
+                int k = (i*7 + t*131) % nnames;
+                std::string s = "N" + std::to_string(k);
+                ids[t][k] = StringPool::intern(s.data(), s.size());
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    for (int t=1; t<nthreads; t++) assert(ids[t]==ids[0]);
+    for (int i=0; i<nnames; i++) {
+        assert(std::string(StringPool::c_str(ids[0][i]))=="N"+std::to_string(i));
+    }
+
+    /* concurrent interning and releasing of the same names */
+    threads.clear();
+    for (int t=0; t<nthreads; t++) {
+        threads.emplace_back([t]() {
+            for (int i=0; i<20000; i++) {
+                std::string s = "T" + std::to_string((i+t) % 37);
+                Id id = StringPool::intern(s.data(), s.size());
+                assert(StringPool::c_str(id)==s);
+                StringPool::release(id);
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    for (int i=0; i<37; i++) {
+        std::string s = "T" + std::to_string(i);
+        assert(bad(StringPool::find(s.data(), s.size())));
+    }
+
+    /* name and resname selections */
+    SystemPtr mol = System::create();
+    Id chn = mol->addChain();
+    const char* names[] = {"OW", "HW1", "HW2"};
+    for (int r=0; r<10; r++) {
+        Id res = mol->addResidue(chn);
+        mol->residue(res).name = r%2 ? "WAT" : "SOL";
+        for (auto name : names) mol->atom(mol->addAtom(res)).name = name;
+    }
+    assert(Atomselect(mol, "name OW").size()==10);
+    assert(Atomselect(mol, "name HW1 OW").size()==20);
+    assert(Atomselect(mol, "name \"HW.\"").size()==20);
+    assert(Atomselect(mol, "name XYZ").size()==0);
+    assert(Atomselect(mol, "resname WAT and name HW2").size()==5);
+    assert(Atomselect(mol, "resname \"S.*\"").size()==15);
+    assert(Atomselect(mol, "same resname as index 0").size()==15);
+
+    SystemPtr dup = Clone(mol, mol->atoms());
+    for (Id i : mol->atoms()) {
+        assert(dup->atom(i).name==mol->atom(i).name);
+        assert(dup->residue(dup->atom(i).residue).name==
+               mol->residue(mol->atom(i).residue).name);
+    }
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,86 @@
+#include "system.hxx"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+
+using namespace desres::msys;
+
+static bool has(TermTablePtr table, Id t, Id atm) {
+    IdList atoms = table->atoms(t);
+    return std::find(atoms.begin(), atoms.end(), atm)!=atoms.end();
+}
+
+/* findWith* against a scan of every term */
+static void compare_with_scan(TermTablePtr table, IdList const& ids) {
+    IdList all, any, only;
+    IdList sorted(ids);
+    sort_unique(sorted);
+    for (Id t : table->terms()) {
+        bool a=!ids.empty(), b=false;
+        for (Id id : ids) {
+            if (has(table, t, id)) b=true;
+            else a=false;
+        }
+        bool c=true;
+        for (Id atm : table->atoms(t)) {
+            if (!std::binary_search(sorted.begin(), sorted.end(), atm)) c=false;
+        }
+        if (a) all.push_back(t);
+        if (b) any.push_back(t);
+        if (c && !ids.empty()) only.push_back(t);
+    }
+    assert(table->findWithAll(ids)==all);
+    assert(table->findWithAny(ids)==any);
+    assert(table->findWithOnly(ids)==only);
+
+    IdList bits;
+    table->findWithAnyBitmap(ids).for_each([&](Id t) { bits.push_back(t); });
+    assert(bits==any);
+    bits.clear();
+    table->findWithOnlyBitmap(ids).for_each([&](Id t) { bits.push_back(t); });
+    assert(bits==only);
+}
+
+int main() {
+    srand(1);
+    SystemPtr mol = System::create();
+    const Id natoms = 60;
+    for (Id i=0; i<natoms; i++) mol->addAtom(mol->addResidue(mol->addChain()));
+    TermTablePtr table = mol->addTable("angle", 3);
+
+    for (int iter=0; iter<200; iter++) {
+        int nadd = iter%50==0 ? 2000 : rand()%20;
+        for (int i=0; i<nadd; i++) {
+            /* allow repeated atoms within a term */
+            IdList atoms(3);
+            for (Id& a : atoms) a = rand() % natoms;
+            table->addTerm(atoms, BadId);
+        }
+        int ndel = rand()%30;
+        for (int i=0; i<ndel; i++) table->delTerm(rand() % table->maxTermId());
+        if (iter%37==0) table->delTermsWithAtom(rand() % natoms);
+
+        IdList ids(rand()%5);
+        for (Id& a : ids) a = rand() % natoms;
+        compare_with_scan(table, ids);
+        compare_with_scan(table, IdList(1, rand() % natoms));
+    }
+
+    /* atoms added after the index was built */
+    Id atm = mol->addAtom(mol->addResidue(mol->addChain()));
+    assert(table->findWithAny(IdList(1, atm)).empty());
+    Id t = table->addTerm(IdList{atm, 0, 1}, BadId);
+    assert(table->findWithAll(IdList{1, atm})==IdList(1, t));
+    assert(table->findExact(IdList{atm, 0, 1})==IdList(1, t));
+    assert(table->findExact(IdList{0, atm, 1}).empty());
+
+    /* invalid ids */
+    bool threw = false;
+    try { table->findWithAny(IdList(1, atm+1)); }
+    catch (std::out_of_range&) { threw = true; }
+    assert(threw);
+
+    printf("ok\n");
+    return 0;
+}
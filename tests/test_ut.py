@@ -524,6 +524,41 @@ class Contacts(unittest.TestCase):
         with self.assertRaises(RuntimeError):
             sh.voxelize(-1)
 
+    def testParallel(self):
+        """threaded searches give the same results as serial"""
+        mol = msys.Load("tests/files/2f4k.dms")
+        pro = mol.selectIds("protein")
+        wat = mol.selectIds("water")
+        pos = mol.positions.astype("f")
+        sh = msys.SpatialHash(pos, pro, box=mol.cell)
+        for nthreads in 0, 2, 5:
+            i, j, d = sh.findContacts(4.0, pos, wat)
+            ip, jp, dp = sh.findContacts(4.0, pos, wat, nthreads=nthreads)
+            self.assertEqual(list(i), list(ip))
+            self.assertEqual(list(j), list(jp))
+            self.assertEqual(list(d), list(dp))
+            w = sh.findWithin(4.0, pos, wat)
+            wp = sh.findWithin(4.0, pos, wat, nthreads=nthreads)
+            self.assertEqual(list(w), list(wp))
+
+    def testUpdate(self):
+        """updating a hash with new positions matches a fresh hash"""
+        mol = msys.Load("tests/files/2f4k.dms")
+        pro = mol.selectIds("protein")
+        wat = mol.selectIds("water")
+        pos = mol.positions.astype("f")
+        sh = msys.SpatialHash(pos, pro, box=mol.cell)
+        sh.voxelize(4.0)
+        NP.random.seed(1973)
+        for step in 0.01, 0.5, 5.0:
+            pos = pos + step * NP.random.uniform(-1, 1, pos.shape).astype("f")
+            sh.update(pos, box=mol.cell)
+            fresh = msys.SpatialHash(pos, pro, box=mol.cell)
+            self.assertEqual(
+                list(sh.findWithin(4.0, pos, wat, reuse_voxels=True)),
+                list(fresh.findWithin(4.0, pos, wat)),
+            )
+
     def testSelf(self):
         """self-contacts"""
         mol = msys.Load("tests/files/jandor.sdf")
@@ -693,6 +728,24 @@ class TestSpatialHash(unittest.TestCase):
         self.assertTrue((old2 == new2).all())
         self.assertFalse(old1.tolist() == old2.tolist())
 
+    def testTriclinicPbwithin(self):
+        # truncated octahedron cell
+        d = 4.0
+        box = NP.array([[d, 0, 0],
+                        [d / 3, 2 * NP.sqrt(2) * d / 3, 0],
+                        [-d / 3, NP.sqrt(2) * d / 3, NP.sqrt(6) * d / 3]])
+        mol = msys.CreateSystem()
+        mol.cell[:] = box
+        a = mol.addAtom()
+        b = mol.addAtom()
+        a.pos = 0.1 * box[0]
+        b.pos = 0.9 * box[0] + box[1]
+        # b's nearest image is 0.2*d away from a
+        self.assertEqual(mol.selectIds("index 0 and within 1 of index 1"), [])
+        self.assertEqual(mol.selectIds("index 0 and pbwithin 1 of index 1"), [0])
+        sph = msys.SpatialHash(mol.positions.astype("f"), [1], box=box)
+        self.assertEqual(list(sph.findWithin(1, mol.positions.astype("f"), [0])), [0])
+
     def testEmptyWithin(self):
         mol = msys.CreateSystem()
         mol.addAtom()
@@ -1069,10 +1122,36 @@ class TestAtomsel(unittest.TestCase):
             mol.setCell(box)
             id3 = mol.selectIds("within 5 of residue 3")
             id4 = mol.selectIds("pbwithin 7 of residue 3")
-
             self.assertEqual(id1, id3)
             self.assertEqual(id2, id4)
 
+    def testPreparedSelection(self):
+        mol = msys.Load("tests/files/alanin.pdb")
+        trj = molfile.dcd.read("tests/files/alanin.dcd")
+        sels = [
+            "within 5 of residue 3",
+            "pbwithin 7 of residue 3 and not name CA",
+            "nearest 4 to resid 2",
+            "same residue as (x > 0 and noh)",
+            "name CA",
+        ]
+        prepared = [mol.prepareSelection(s) for s in sels]
+        self.assertEqual([p.positional for p in prepared], [True] * 4 + [False])
+        for f in trj.frames():
+            box = NP.diag(NP.max(f.pos, 0) - NP.min(f.pos, 0))
+            for sel, p in zip(sels, prepared):
+                self.assertEqual(p.ids(pos=f.pos, box=box), mol.selectIds(sel, pos=f.pos, box=box))
+                self.assertEqual(p.array(pos=f.pos, box=box).tolist(), mol.selectIds(sel, pos=f.pos, box=box))
+
+        # cached clauses are recomputed only after reset
+        p = mol.prepareSelection("name CA")
+        ca = p.ids()
+        mol.atom(ca[0]).name = "CX"
+        self.assertEqual(p.ids(), ca)
+        p.reset()
+        self.assertEqual(p.ids(), ca[1:])
+        self.assertEqual(mol.selectIds("name CA"), ca[1:])
+
     def testSmartsQuotes(self):
         """smarts can be single or double quoted"""
         mol = msys.Load("tests/files/jandor.sdf")